@@ -12,11 +12,15 @@
  */
 
 /* System includes. */
-#include <ncurses.h>
-#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
 
 /* Local includes. */
 #include "empire.h"
+#include "attack.h"
+#include "engine.h"
+#include "render.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -28,17 +32,22 @@
  * Attack prototypes.
  */
 
-static void Attack(Player *aPlayer, Player *aTargetPlayer);
+static void ChooseTarget(Session *aSession, const char *aInput);
 
-static void GetSoldiersToAttack(Battle *aBattle);
+static void Attack(Session *aSession, const char *aInput);
 
-static void RunBattle(Battle *aBattle);
+static void DrawBattleRound(Game   *aGame,
+                            Battle *aBattle,
+                            Render *aRender);
 
-static void DisplayBattleResults(Battle *aBattle);
+static void DisplayBattleResults(Game       *aGame,
+                                 Battle     *aBattle,
+                                 SackReport *aSackReport,
+                                 Render     *aRender);
 
-static void Sack(Player *aTargetPlayer);
-
-static void DrawAttackScreen(Player *aPlayer);
+static void DrawAttackScreen(Game   *aGame,
+                             Player *aPlayer,
+                             Render *aRender);
 
 
 /*------------------------------------------------------------------------------
@@ -47,72 +56,101 @@ static void DrawAttackScreen(Player *aPlayer);
  */
 
 /*
- * Manage attacking for the player specified by aPlayer.
+ *   Enter the current attack screen state of the session specified by
+ * aSession.  The attack screen lets the player whose turn it is attack other
+ * countries, and shows each battle round by round.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
  */
 
-void AttackScreen(Player *aPlayer)
+void AttackScreenEnter(Session *aSession)
 {
-    Player *targetPlayer;
-    char    input[80];
-    int     country;
-    int     maxAttacks;
+    Game   *game;
+    Player *player;
+    Render *render;
+
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+    switch (aSession->state)
+    {
+        case SESSION_ATTACK :
+            /* Start attacking other countries. */
+            player->attackCount = 0;
+            SessionGoto(aSession, SESSION_ATTACK_MENU);
+            break;
+
+        case SESSION_ATTACK_MENU :
+            /* Draw the attack screen and get country to attack. */
+            DrawAttackScreen(game, player, render);
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "WHO DO YOU WISH TO ATTACK (GIVE #)? ");
+            break;
+
+        case SESSION_SOLDIERS_TO_ATTACK :
+            /* Get the number of soldiers with which to attack. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "HOW MANY SOLDIERS DO YOU WISH TO SEND? ");
+            break;
+
+        case SESSION_BATTLE_ROUND :
+            /* Show soldiers remaining. */
+            DrawBattleRound(game, &(aSession->battle), render);
+            SessionDelay(aSession, BATTLE_ROUND_TIME);
+            SessionGoto(aSession, SESSION_BATTLE_FIGHT);
+            break;
+
+        case SESSION_BATTLE_FIGHT :
+            /* Run a round of the battle. */
+            if (EngineBattleRound(game, &(aSession->battle)))
+                SessionGoto(aSession, SESSION_BATTLE_RESULTS);
+            else
+                SessionGoto(aSession, SESSION_BATTLE_ROUND);
+            break;
+
+        case SESSION_BATTLE_RESULTS :
+            /* Update soldiers, land, etc. */
+            EngineEndBattle(game,
+                            &(aSession->battle),
+                            &(aSession->sackReport));
+            DisplayBattleResults(game,
+                                 &(aSession->battle),
+                                 &(aSession->sackReport),
+                                 render);
+            break;
+
+        default :
+            break;
+    }
+}
+
 
-    /* Determine the maximum number of attacks per year. */
-    maxAttacks = (aPlayer->nobleCount / 4) + 1;
+/*
+ *   Handle the input line specified by aInput for the current attack screen
+ * state of the session specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
 
-    /* Attack other countries. */
-    aPlayer->attackCount = 0;
-    while (1)
+void AttackScreenInput(Session *aSession, const char *aInput)
+{
+    switch (aSession->state)
     {
-        /* Draw the attack screen. */
-        DrawAttackScreen(aPlayer);
+        case SESSION_ATTACK_MENU :
+            ChooseTarget(aSession, aInput);
+            break;
 
-        /* Get country to attack. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("WHO DO YOU WISH TO ATTACK (GIVE #)? ");
-        getnstr(input, sizeof(input));
-        country = strtol(input, NULL, 0);
+        case SESSION_SOLDIERS_TO_ATTACK :
+            Attack(aSession, aInput);
+            break;
 
-        /* Parse input. */
-        if (country == 0)
-        {
+        case SESSION_BATTLE_RESULTS :
+            SessionGoto(aSession, SESSION_ATTACK_MENU);
             break;
-        }
-        else if (country == 1)
-        {
-            targetPlayer = NULL;
-        }
-        else if ((country >= 2) && (country <= (COUNTRY_COUNT + 1)))
-        {
-            targetPlayer = &(playerList[country - 2]);
-            if (targetPlayer == aPlayer)
-            {
-                mvprintw(15,
-                         0,
-                         "%s, PLEASE THINK AGAIN.  YOU ARE # %d!",
-                         aPlayer->title,
-                         country);
-                refresh();
-                sleep(DELAY_TIME);
-                continue;
-            }
-        }
 
-        /* Attack. */
-        if (aPlayer->attackCount < maxAttacks)
-        {
-            Attack(aPlayer, targetPlayer);
-        }
-        else
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("DUE TO A SHORTAGE OF NOBLES , YOU ARE LIMITED TO ONLY\n");
-            printw(" %d ATTACKS PER YEAR", maxAttacks);
-            refresh();
-            sleep(DELAY_TIME);
-        }
+        default :
+            break;
     }
 }
 
@@ -123,255 +161,183 @@ void AttackScreen(Player *aPlayer)
  */
 
 /*
- *   Attack the player specified by aTargetPlayer for the player specified by
- * aPlayer.  If aTargetPlayer is NULL, attack barbarians.
+ *   Handle the country to attack specified by aInput for the session specified
+ * by aSession.
  *
- *   aPlayer                Player.
- *   aTargetPlayer          Player to attack.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void Attack(Player *aPlayer, Player *aTargetPlayer)
+static void ChooseTarget(Session *aSession, const char *aInput)
 {
-    Battle battle;
+    Game   *game;
+    Player *player;
+    Player *targetPlayer;
+    Render *render;
+    int     country;
 
-    /* Can't attack other players until the third year. */
-    if ((aTargetPlayer != NULL) && (year < 3))
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+
+    /* Parse input.  The player's turn is over when they choose no country. */
+    country = strtol(aInput, NULL, 0);
+    SessionGoto(aSession, SESSION_ATTACK_MENU);
+    if (country == 0)
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("DUE TO INTERNATIONAL TREATY, YOU CANNOT ATTACK OTHER\n"
-               "NATIONS UNTIL THE THIRD YEAR.");
-        refresh();
-        sleep(DELAY_TIME);
+        SessionGoto(aSession, SESSION_NEXT_PLAYER);
         return;
     }
-
-    /* If attacking the barbarians, make sure they have land. */
-    if ((aTargetPlayer == NULL) && (barbarianLand == 0))
+    else if (country == 1)
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("ALL BARBARIAN LANDS HAVE BEEN SEIZED\n");
-        refresh();
-        sleep(DELAY_TIME);
-        return;
+        targetPlayer = NULL;
     }
-
-    /* Initialize the battle information. */
-    memset(&battle, 0, sizeof(battle));
-
-    /* Set the player battle information. */
-    battle.player = aPlayer;
-    battle.soldierEfficiency = aPlayer->armyEfficiency;
-    snprintf(battle.soldierLabel,
-             sizeof(battle.soldierLabel),
-             "%s %s OF %s",
-             aPlayer->title,
-             aPlayer->name,
-             aPlayer->country->name);
-    GetSoldiersToAttack(&battle);
-
-    /* Set the target battle information. */
-    if (aTargetPlayer != NULL)
+    else if ((country >= 2) && (country <= (game->countryCount + 1)))
     {
-        battle.targetPlayer = aTargetPlayer;
-        battle.targetLand = aTargetPlayer->land;
-        snprintf(battle.targetSoldierLabel,
-                 sizeof(battle.targetSoldierLabel),
-                 "%s %s OF %s",
-                 aTargetPlayer->title,
-                 aTargetPlayer->name,
-                 aTargetPlayer->country->name);
-        if (aTargetPlayer->soldierCount > 0)
-        {
-            battle.targetSoldierCount = aTargetPlayer->soldierCount;
-            battle.targetSoldierEfficiency = aTargetPlayer->armyEfficiency;
-        }
-        else
-        {
-            battle.targetSerfs = TRUE;
-            battle.targetSoldierCount = aTargetPlayer->serfCount;
-            battle.targetSoldierEfficiency = SERF_EFFICIENCY;
-        }
+        targetPlayer = &(game->playerList[country - 2]);
     }
     else
     {
-        battle.targetLand = barbarianLand;
-        snprintf(battle.targetSoldierLabel,
-                 sizeof(battle.targetSoldierLabel),
-                 "PAGAN BARBARIANS");
-        battle.targetSoldierCount =
-              RandRange(3 * RandRange(battle.soldierCount))
-            + RandRange(RandRange(3 * battle.soldierCount / 2));
-        battle.targetSoldierEfficiency = 9;
+        return;
     }
 
-    /* Battle. */
-    RunBattle(&battle);
-    DisplayBattleResults(&battle);
-
-    /* Update soldiers, land, etc. */
-    aPlayer->attackCount++;
-    aPlayer->soldierCount -=   battle.soldiersToAttackCount
-                             - battle.soldierCount;
-    if (aTargetPlayer != NULL)
+    /* Validate the attack. */
+    switch (EngineCheckAttack(game, player, targetPlayer))
     {
-        if (battle.targetSerfs)
-            aTargetPlayer->serfCount = battle.targetSoldierCount;
-        else
-            aTargetPlayer->soldierCount = battle.targetSoldierCount;
-    }
-    aPlayer->land += battle.landCaptured;
-    if (aTargetPlayer != NULL)
-        aTargetPlayer->land -= battle.landCaptured;
-    else
-        barbarianLand -= battle.landCaptured;
-    if ((aTargetPlayer != NULL) && battle.targetOverrun)
-    {
-        aPlayer->serfCount += aTargetPlayer->serfCount;
-        aTargetPlayer->dead = TRUE;
+        case ENGINE_OK :
+            aSession->targetPlayer = targetPlayer;
+            SessionGoto(aSession, SESSION_SOLDIERS_TO_ATTACK);
+            break;
+
+        case ENGINE_ATTACK_SELF :
+            RenderMovePrint(render,
+                            15,
+                            0,
+                            "%s, PLEASE THINK AGAIN.  YOU ARE # %d!",
+                            PlayerTitle(game, player),
+                            country);
+            SessionDelay(aSession, DELAY_TIME);
+            break;
+
+        case ENGINE_TOO_MANY_ATTACKS :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "DUE TO A SHORTAGE OF NOBLES , "
+                        "YOU ARE LIMITED TO ONLY\n");
+            RenderPrint(render,
+                        " %d ATTACKS PER YEAR",
+                        EngineMaxAttacks(game, player));
+            SessionDelay(aSession, DELAY_TIME);
+            break;
+
+        case ENGINE_TREATY :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "DUE TO INTERNATIONAL TREATY, YOU CANNOT ATTACK OTHER\n"
+                        "NATIONS UNTIL THE THIRD YEAR.");
+            SessionDelay(aSession, DELAY_TIME);
+            break;
+
+        case ENGINE_NO_BARBARIAN_LAND :
+        default :
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "ALL BARBARIAN LANDS HAVE BEEN SEIZED\n");
+            SessionDelay(aSession, DELAY_TIME);
+            break;
     }
 }
 
 
 /*
- *   Get the number of player soldiers to attack in the battle specified by
- * aBattle.
+ *   Attack the player being attacked with the number of soldiers specified by
+ * aInput for the session specified by aSession.
  *
- *   aBattle                Battle for which to get attacking soldiers.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void GetSoldiersToAttack(Battle *aBattle)
+static void Attack(Session *aSession, const char *aInput)
 {
-    char    input[80];
+    Game   *game;
     Player *player;
-    int     soldiersToAttackCount;
-    bool    soldiersToAttackCountValid;
+    Player *targetPlayer;
+    Battle *battle;
+    Render *render;
+    int     soldierCount;
 
-    /* Get battle information. */
-    player = aBattle->player;
+    game = aSession->game;
+    player = aSession->player;
+    targetPlayer = aSession->targetPlayer;
+    render = &(aSession->render);
+    battle = &(aSession->battle);
 
-    /* Get the number of soldiers with which to attack. */
-    soldiersToAttackCountValid = FALSE;
-    while (!soldiersToAttackCountValid)
+    /* Validate the number of soldiers with which to attack. */
+    soldierCount = strtol(aInput, NULL, 0);
+    if (EngineCheckSoldiersToAttack(game, player, soldierCount) != ENGINE_OK)
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY SOLDIERS DO YOU WISH TO SEND? ");
-        getnstr(input, sizeof(input));
-        soldiersToAttackCount = strtol(input, NULL, 0);
-        if (soldiersToAttackCount > player->soldierCount)
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("THINK AGAIN... YOU HAVE ONLY %d SOLDIERS",
-                   player->soldierCount);
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else
-        {
-            soldiersToAttackCountValid = TRUE;
-        }
+        SessionClearPrompt(aSession);
+        RenderPrint(render,
+                    "THINK AGAIN... YOU HAVE ONLY %d SOLDIERS",
+                    player->soldierCount);
+        SessionDelay(aSession, DELAY_TIME);
+        SessionGoto(aSession, SESSION_SOLDIERS_TO_ATTACK);
+        return;
     }
 
-    /* Update battle information. */
-    aBattle->soldiersToAttackCount = soldiersToAttackCount;
-    aBattle->soldierCount = soldiersToAttackCount;
+    /* Set up the battle. */
+    EngineStartBattle(game, battle, player, targetPlayer, soldierCount);
+    snprintf(battle->soldierLabel,
+             sizeof(battle->soldierLabel),
+             "%s %s OF %s",
+             PlayerTitle(game, player),
+             PlayerName(game, player),
+             PlayerCountry(game, player)->name);
+    if (targetPlayer != NULL)
+    {
+        snprintf(battle->targetSoldierLabel,
+                 sizeof(battle->targetSoldierLabel),
+                 "%s %s OF %s",
+                 PlayerTitle(game, targetPlayer),
+                 PlayerName(game, targetPlayer),
+                 PlayerCountry(game, targetPlayer)->name);
+    }
+    else
+    {
+        snprintf(battle->targetSoldierLabel,
+                 sizeof(battle->targetSoldierLabel),
+                 "PAGAN BARBARIANS");
+    }
+
+    /* Battle. */
+    SessionGoto(aSession, SESSION_BATTLE_ROUND);
 }
 
 
 /*
- * Run the battle specified by aBattle.
+ * Draw the soldiers remaining in the battle specified by aBattle.
  *
- *   aBattle                Battle to run.
+ *   aGame                  Game.
+ *   aBattle                Battle.
+ *   aRender                Renderer.
  */
 
-static void RunBattle(Battle *aBattle)
+static void DrawBattleRound(Game   *aGame,
+                            Battle *aBattle,
+                            Render *aRender)
 {
-    Player *player;
-    Player *targetPlayer;
-    int     soldierCount;
-    int     soldierEfficiency;
-    int     targetSoldierCount;
-    int     targetSoldierEfficiency;
-    int     targetLand;
-    int     soldierKillCount;
-    int     landCaptured = 0;
-    bool    targetSerfs = FALSE;
-    bool    targetOverrun = FALSE;
-    bool    battleDone;
-
-    /* Get battle information. */
-    player = aBattle->player;
-    targetPlayer = aBattle->targetPlayer;
-    soldierCount = aBattle->soldierCount;
-    soldierEfficiency = aBattle->soldierEfficiency;
-    targetSoldierCount = aBattle->targetSoldierCount;
-    targetSoldierEfficiency = aBattle->targetSoldierEfficiency;
-    targetLand = aBattle->targetLand;
-    targetSerfs = aBattle->targetSerfs;
-
-    /* Battle. */
-    landCaptured = 0;
-    battleDone = FALSE;
-    while (!battleDone)
+    RenderErase(aRender);
+    RenderMovePrint(aRender, 2, 41, "SOLDIERS REMAINING:");
+    RenderMovePrint(aRender, 4, 13, "%s:", aBattle->soldierLabel);
+    RenderMovePrint(aRender, 5, 13, "%s:", aBattle->targetSoldierLabel);
+    RenderMovePrint(aRender, 4, 51, "%d", aBattle->soldierCount);
+    RenderMovePrint(aRender, 5, 51, "%d", aBattle->targetSoldierCount);
+    if (aBattle->targetSerfs)
     {
-        /* Show soldiers remaining. */
-        clear();
-        mvprintw(2, 41, "SOLDIERS REMAINING:");
-        mvprintw(4, 13, "%s:", aBattle->soldierLabel);
-        mvprintw(5, 13, "%s:", aBattle->targetSoldierLabel);
-        mvprintw(4, 51, "%d", soldierCount);
-        mvprintw(5, 51, "%d", targetSoldierCount);
-        if (targetSerfs)
-        {
-            mvprintw(8, 0, "%s'S SERFS ARE FORCED TO DEFEND THEIR COUNTRY!",
-                     targetPlayer->country->name);
-        }
-        refresh();
-        usleep(250000);
-
-        /*
-         * Determine how many soldiers were killed in this round, who won the
-         * round, and how much land was captured.
-         */
-        soldierKillCount = (soldierCount / 15) + 1;
-        if (RandRange(soldierEfficiency) < RandRange(targetSoldierEfficiency))
-        {
-            /* Player lost. */
-            soldierCount -= soldierKillCount;
-            if (soldierCount < 0)
-                soldierCount = 0;
-
-            /* Battle is done if all target land has been captured. */
-            if (landCaptured >= targetLand)
-                battleDone = TRUE;
-        }
-        else
-        {
-            /* Player won. */
-            landCaptured +=   RandRange(26 * soldierKillCount)
-                            - RandRange(soldierKillCount + 5);
-            if (landCaptured < 0)
-                landCaptured = 0;
-            else if (landCaptured > targetLand)
-                landCaptured = targetLand;
-            targetSoldierCount -= soldierKillCount;
-            if (targetSoldierCount < 0)
-                targetSoldierCount = 0;
-        }
-
-        /* Keep battling until one army is defeated. */
-        if ((soldierCount == 0) || (targetSoldierCount == 0))
-            battleDone = TRUE;
-    }
-
-    /* Update battle information. */
-    aBattle->soldierCount = soldierCount;
-    aBattle->targetSoldierCount = targetSoldierCount;
-    aBattle->landCaptured = landCaptured;
-    if (soldierCount > 0)
-    {
-        aBattle->targetDefeated = TRUE;
-        if (targetSerfs || (landCaptured >= targetLand))
-            aBattle->targetOverrun = TRUE;
+        RenderMovePrint(aRender,
+                        8,
+                        0,
+                        "%s'S SERFS ARE FORCED TO DEFEND THEIR COUNTRY!",
+                        PlayerCountry(aGame, aBattle->targetPlayer)->name);
     }
 }
 
@@ -379,204 +345,200 @@ static void RunBattle(Battle *aBattle)
 /*
  * Display results of the battle specified by aBattle.
  *
+ *   aGame                  Game.
  *   aBattle                Battle for which to display results.
+ *   aSackReport            What was sacked in the battle.
+ *   aRender                Renderer.
  */
 
-static void DisplayBattleResults(Battle *aBattle)
+static void DisplayBattleResults(Game       *aGame,
+                                 Battle     *aBattle,
+                                 SackReport *aSackReport,
+                                 Render     *aRender)
 {
-    char    input[80];
     Player *player;
     Player *targetPlayer;
-    int     soldierCount;
-    int     targetLand;
-    int     landCaptured;
-    bool    targetSerfs;
 
     /* Get battle information. */
     player = aBattle->player;
     targetPlayer = aBattle->targetPlayer;
-    soldierCount = aBattle->soldierCount;
-    targetLand = aBattle->targetLand;
-    targetSerfs = aBattle->targetSerfs;
-    landCaptured = aBattle->landCaptured;
 
     /* Display battle results. */
-    clear();
-    mvprintw(1, 23, "BATTLE OVER\n\n");
+    RenderErase(aRender);
+    RenderMovePrint(aRender, 1, 23, "BATTLE OVER\n\n");
     if ((targetPlayer != NULL) && aBattle->targetOverrun)
     {
         /* Target player overrun. */
-        printw("THE COUNTRY OF %s WAS OVERUN!\n", targetPlayer->country->name);
-        printw("ALL ENEMY NOBLES WERE SUMMARILY EXECUTED!\n\n\n");
-        printw("THE REMAINING ENEMY SOLDIERS "
-               "WERE IMPRISONED. ALL ENEMY SERFS\n");
-        printw("HAVE PLEDGED OATHS OF FEALTY TO "
-               "YOU, AND SHOULD NOW BE CONSID-\n");
-        printw("ERED TO BE YOUR PEOPLE TOO. ALL "
-               "ENEMY MERCHANTS FLED THE COUN-\n");
-        printw("TRY. UNFORTUNATELY, ALL ENEMY "
-               "ASSETS WERE SACKED AND DESTROYED\n");
-        printw("BY YOUR REVENGEFUL ARMY IN A "
-               "DRUNKEN RIOT FOLLOWING THE VICTORY\n");
-        printw("CELEBRATION.\n");
+        RenderPrint(aRender,
+                    "THE COUNTRY OF %s WAS OVERUN!\n",
+                    PlayerCountry(aGame, targetPlayer)->name);
+        RenderPrint(aRender, "ALL ENEMY NOBLES WERE SUMMARILY EXECUTED!\n\n\n");
+        RenderPrint(aRender,
+                    "THE REMAINING ENEMY SOLDIERS "
+                    "WERE IMPRISONED. ALL ENEMY SERFS\n");
+        RenderPrint(aRender,
+                    "HAVE PLEDGED OATHS OF FEALTY TO "
+                    "YOU, AND SHOULD NOW BE CONSID-\n");
+        RenderPrint(aRender,
+                    "ERED TO BE YOUR PEOPLE TOO. ALL "
+                    "ENEMY MERCHANTS FLED THE COUN-\n");
+        RenderPrint(aRender,
+                    "TRY. UNFORTUNATELY, ALL ENEMY "
+                    "ASSETS WERE SACKED AND DESTROYED\n");
+        RenderPrint(aRender,
+                    "BY YOUR REVENGEFUL ARMY IN A "
+                    "DRUNKEN RIOT FOLLOWING THE VICTORY\n");
+        RenderPrint(aRender, "CELEBRATION.\n");
     }
     else if ((targetPlayer == NULL) && aBattle->targetOverrun)
     {
-        printw("ALL BARBARIAN LANDS HAVE BEEN SEIZED\n");
-        printw("THE REMAINING BARBARIANS FLED\n");
+        RenderPrint(aRender, "ALL BARBARIAN LANDS HAVE BEEN SEIZED\n");
+        RenderPrint(aRender, "THE REMAINING BARBARIANS FLED\n");
     }
     else if (aBattle->targetDefeated)
     {
         /* Player won. */
-        printw("THE FORCES OF %s %s WERE VICTORIOUS.\n",
-               player->title,
-               player->name);
-        printw(" %d ACRES WERE SEIZED.\n", landCaptured);
+        RenderPrint(aRender,
+                    "THE FORCES OF %s %s WERE VICTORIOUS.\n",
+                    PlayerTitle(aGame, player),
+                    PlayerName(aGame, player));
+        RenderPrint(aRender, " %d ACRES WERE SEIZED.\n", aBattle->landCaptured);
     }
     else
     {
         /* Player lost. */
-        printw("%s %s WAS DEFEATED.\n", player->title, player->name);
-        if (landCaptured > 2)
+        RenderPrint(aRender,
+                    "%s %s WAS DEFEATED.\n",
+                    PlayerTitle(aGame, player),
+                    PlayerName(aGame, player));
+        if (aBattle->landCaptured > 0)
         {
-            landCaptured /= RandRange(3);
-            printw("IN YOUR DEFEAT YOU NEVERTHELESS "
-                   "MANAGED TO CAPTURE %d ACRES.\n",
-                   landCaptured);
+            RenderPrint(aRender,
+                        "IN YOUR DEFEAT YOU NEVERTHELESS "
+                        "MANAGED TO CAPTURE %d ACRES.\n",
+                        aBattle->landCaptured);
         }
         else
         {
-            landCaptured = 0;
-            printw(" 0 ACRES WERE SEIZED.\n");
+            RenderPrint(aRender, " 0 ACRES WERE SEIZED.\n");
         }
     }
 
-    /* Check for sacking. */
-    if (   (targetPlayer != NULL)
-        && !aBattle->targetOverrun
-        && (landCaptured > (targetLand / 3)))
+    /* Display what was sacked. */
+    if (aBattle->targetSacked)
     {
-        Sack(targetPlayer);
+        if (aSackReport->serfCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY SERFS WERE BEATEN AND MURDERED "
+                        "BY YOUR TROOPS!\n",
+                        aSackReport->serfCount);
+        }
+        if (aSackReport->marketplaceCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY MARKETPLACES WERE DESTROYED\n",
+                        aSackReport->marketplaceCount);
+        }
+        if (aSackReport->grain > 0)
+        {
+            RenderPrint(aRender,
+                        " %d BUSHELS OF ENEMY GRAIN WERE BURNED\n",
+                        aSackReport->grain);
+        }
+        if (aSackReport->grainMillCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY GRAIN MILLS WERE SABOTAGED\n",
+                        aSackReport->grainMillCount);
+        }
+        if (aSackReport->foundryCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY FOUNDRIES WERE LEVELED\n",
+                        aSackReport->foundryCount);
+        }
+        if (aSackReport->shipyardCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY SHIPYARDS WERE OVER-RUN\n",
+                        aSackReport->shipyardCount);
+        }
+        if (aSackReport->nobleCount > 0)
+        {
+            RenderPrint(aRender,
+                        " %d ENEMY NOBLES WERE SUMMARILY EXECUTED\n",
+                        aSackReport->nobleCount);
+        }
     }
 
     /* Wait for player. */
-    printw("<ENTER>? ");
-    getnstr(input, sizeof(input));
-
-    /* Update battle information. */
-    aBattle->landCaptured = landCaptured;
+    RenderPrint(aRender, "<ENTER>? ");
 }
 
 
 /*
- * Sack the player specified by aTargetPlayer.
+ *   Draw the attack screen for the player specified by aPlayer, reusing the
+ * land holdings in the renderer specified by aRender if no land has
+ * changed hands.
  *
- *   aTargetPlayer          Player to sack.
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   aRender                Renderer.
  */
 
-static void Sack(Player *aTargetPlayer)
+static void DrawAttackScreen(Game   *aGame,
+                             Player *aPlayer,
+                             Render *aRender)
 {
-    int  sackCount;
+    Player        *player;
+    const Country *country;
+    uint64_t       stamp;
+    int            i;
 
-    /* Sack serfs. */
-    if (aTargetPlayer->serfCount > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->serfCount);
-        aTargetPlayer->serfCount -= sackCount;
-        printw(" %d ENEMY SERFS WERE BEATEN AND MURDERED BY YOUR TROOPS!\n",
-               sackCount);
-    }
-
-    /* Sack marketplaces. */
-    if (aTargetPlayer->marketplaceCount > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->marketplaceCount);
-        aTargetPlayer->marketplaceCount -= sackCount;
-        printw(" %d ENEMY MARKETPLACES WERE DESTROYED\n", sackCount);
-    }
-
-    /* Sack grain. */
-    if (aTargetPlayer->grain > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->grain);
-        aTargetPlayer->grain -= sackCount;
-        printw(" %d BUSHELS OF ENEMY GRAIN WERE BURNED\n", sackCount);
-    }
-
-    /* Sack grain mills. */
-    if (aTargetPlayer->grainMillCount > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->grainMillCount);
-        aTargetPlayer->grainMillCount -= sackCount;
-        printw(" %d ENEMY GRAIN MILLS WERE SABOTAGED\n", sackCount);
-    }
-
-    /* Sack foundries. */
-    if (aTargetPlayer->foundryCount > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->foundryCount);
-        aTargetPlayer->foundryCount -= sackCount;
-        printw(" %d ENEMY FOUNDRIES WERE LEVELED\n", sackCount);
-    }
-
-    /* Sack shipyards. */
-    if (aTargetPlayer->shipyardCount > 0)
-    {
-        sackCount = RandRange(aTargetPlayer->shipyardCount);
-        aTargetPlayer->shipyardCount -= sackCount;
-        printw(" %d ENEMY SHIPYARDS WERE OVER-RUN\n", sackCount);
-    }
+    /* Reset screen. */
+    RenderErase(aRender);
+    RenderMove(aRender, 0, 0);
 
-    /* Sack nobles. */
-    if (aTargetPlayer->nobleCount > 2)
+    /* Reuse the land holdings if they have not changed. */
+    stamp = RenderStamp(RENDER_STAMP_INIT, aGame->barbarianLand);
+    for (i = 0; i < aGame->liveCount; i++)
     {
-        sackCount = RandRange(aTargetPlayer->nobleCount / 2);
-        aTargetPlayer->nobleCount -= sackCount;
-        printw(" %d ENEMY NOBLES WERE SUMMARILY EXECUTED\n", sackCount);
+        player = &(aGame->playerList[aGame->liveList[i]]);
+        stamp = RenderStamp(stamp, player->number);
+        stamp = RenderStamp(stamp, player->dead);
+        stamp = RenderStamp(stamp, player->land);
     }
-}
-
-/*
- * Draw the attack screen for the player specified by aPlayer.
- *
- *   aPlayer                Player.
- */
-
-static void DrawAttackScreen(Player *aPlayer)
-{
-    Player     *player;
-    Country    *country;
-    const char *countryName;
-    int         playerLand;
-    int         i;
-
-    /* Reset screen. */
-    clear();
-    move(0, 0);
+    if (RenderRegionCached(aRender, RENDER_LAND_HOLDINGS, stamp))
+        return;
 
-    /* Display land holdings. */
-    printw("LAND HOLDINGS:\n\n");
-    for (i = 0; i < COUNTRY_COUNT + 1; i++)
+    /* Display land holdings, numbering the countries after the barbarians. */
+    RenderPrint(aRender, "LAND HOLDINGS:\n\n");
+    RenderPrint(aRender,
+                " %d)  %-11s %d\n",
+                1,
+                "BARBARIANS",
+                aGame->barbarianLand);
+    for (i = 0; i < aGame->liveCount; i++)
     {
-        /* Get the country name and player land.  Don't display dead players. */
-        if (i == 0)
-        {
-            countryName = "BARBARIANS";
-            playerLand = barbarianLand;
-        }
-        else
-        {
-            player = &(playerList[i - 1]);
-            if (player->dead)
-                continue;
-            country = player->country;
-            countryName = country->name;
-            playerLand = player->land;
-        }
+        /* Get the player.  Don't display dead players. */
+        player = &(aGame->playerList[aGame->liveList[i]]);
+        if (player->dead)
+            continue;
 
         /* Display land holdings. */
-        printw(" %d)  %-11s %d\n", i + 1, countryName, playerLand);
+        country = PlayerCountry(aGame, player);
+        RenderPrint(aRender,
+                    " %d)  %-11s %d\n",
+                    player->number + 1,
+                    country->name,
+                    player->land);
     }
+    RenderRegionSave(aRender,
+                     RENDER_LAND_HOLDINGS,
+                     stamp,
+                     0,
+                     RenderGetY(aRender));
 }
 
 
@@ -0,0 +1,32 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game attack screen header file.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __ATTACK_H__
+#define __ATTACK_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* Local includes. */
+#include "empire.h"
+#include "session.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+void AttackScreenEnter(Session *aSession);
+
+void AttackScreenInput(Session *aSession, const char *aInput);
+
+
+#endif /* __ATTACK_H__ */
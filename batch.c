@@ -0,0 +1,575 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire batch game state.
+ *
+ *   The batch kernels play the same rules as EngineNewYear and EngineCPUTurn
+ * and draw the same random numbers in the same order for each game, so a game
+ * played in a batch plays out exactly as it would with the engine.  Random
+ * draws are data dependent, so each kernel first makes a scalar pass over the
+ * games that draws the random numbers into scratch columns, then applies them
+ * with plain column arithmetic that the compiler can vectorize.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "batch.h"
+#include "empire.h"
+#include "engine.h"
+#include "probe.h"
+#include "rng.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Column alignment in bytes.
+ */
+
+#define BATCH_ALIGNMENT     64
+
+
+/*
+ * Scratch column list.
+ */
+
+#define BATCH_SERF          0
+#define BATCH_TREASURY      1
+#define BATCH_MERCHANT      2
+#define BATCH_MARKETPLACE   3
+#define BATCH_GRAIN_MILL    4
+#define BATCH_FOUNDRY       5
+#define BATCH_SHIPYARD      6
+#define BATCH_PALACE        7
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void *BatchColumn(size_t count, size_t size);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ *   Create and return a batch for the number of games specified by gameCount,
+ * each with the number of countries specified by countryCount.  Return NULL if
+ * out of memory.
+ *
+ *   gameCount              Number of games.
+ *   countryCount           Number of countries in each game.
+ */
+
+Batch *BatchCreate(int gameCount, int countryCount)
+{
+    Batch  *batch;
+    size_t  playerCount;
+    bool    allocated;
+    int     i;
+
+    /* Allocate the batch record. */
+    batch = calloc(1, sizeof(Batch));
+    if (batch == NULL)
+        return NULL;
+    batch->gameCount = gameCount;
+    batch->countryCount = countryCount;
+    playerCount = ((size_t) gameCount) * countryCount;
+
+    /* Allocate the game columns. */
+    batch->year = BatchColumn(gameCount, sizeof(int));
+    batch->weather = BatchColumn(gameCount, sizeof(int));
+    batch->weatherRng = BatchColumn(gameCount, sizeof(Rng));
+    batch->cpuRng = BatchColumn(gameCount, sizeof(Rng));
+
+    /* Allocate the player columns. */
+    batch->land = BatchColumn(playerCount, sizeof(int));
+    batch->grain = BatchColumn(playerCount, sizeof(int));
+    batch->treasury = BatchColumn(playerCount, sizeof(int));
+    batch->serfCount = BatchColumn(playerCount, sizeof(int));
+    batch->soldierCount = BatchColumn(playerCount, sizeof(int));
+    batch->nobleCount = BatchColumn(playerCount, sizeof(int));
+    batch->merchantCount = BatchColumn(playerCount, sizeof(int));
+    batch->armyEfficiency = BatchColumn(playerCount, sizeof(int));
+    batch->marketplaceCount = BatchColumn(playerCount, sizeof(int));
+    batch->grainMillCount = BatchColumn(playerCount, sizeof(int));
+    batch->foundryCount = BatchColumn(playerCount, sizeof(int));
+    batch->shipyardCount = BatchColumn(playerCount, sizeof(int));
+    batch->palaceCount = BatchColumn(playerCount, sizeof(int));
+    batch->grainForSale = BatchColumn(playerCount, sizeof(int));
+    batch->grainPrice = BatchColumn(playerCount, sizeof(float));
+
+    /* Allocate the scratch columns. */
+    allocated = TRUE;
+    for (i = 0; i < BATCH_SCRATCH_COUNT; i++)
+    {
+        batch->scratch[i] = BatchColumn(gameCount, sizeof(int));
+        if (batch->scratch[i] == NULL)
+            allocated = FALSE;
+    }
+
+    /* Check for allocation failures. */
+    if (   !allocated
+        || (batch->year == NULL) || (batch->weather == NULL)
+        || (batch->weatherRng == NULL) || (batch->cpuRng == NULL)
+        || (batch->land == NULL)
+        || (batch->grain == NULL) || (batch->treasury == NULL)
+        || (batch->serfCount == NULL) || (batch->soldierCount == NULL)
+        || (batch->nobleCount == NULL) || (batch->merchantCount == NULL)
+        || (batch->armyEfficiency == NULL)
+        || (batch->marketplaceCount == NULL)
+        || (batch->grainMillCount == NULL) || (batch->foundryCount == NULL)
+        || (batch->shipyardCount == NULL) || (batch->palaceCount == NULL)
+        || (batch->grainForSale == NULL) || (batch->grainPrice == NULL))
+    {
+        BatchDestroy(batch);
+        return NULL;
+    }
+
+    return batch;
+}
+
+
+/*
+ * Destroy the batch specified by aBatch.
+ *
+ *   aBatch                 Batch.
+ */
+
+void BatchDestroy(Batch *aBatch)
+{
+    int i;
+
+    if (aBatch == NULL)
+        return;
+
+    free(aBatch->year);
+    free(aBatch->weather);
+    free(aBatch->weatherRng);
+    free(aBatch->cpuRng);
+    free(aBatch->land);
+    free(aBatch->grain);
+    free(aBatch->treasury);
+    free(aBatch->serfCount);
+    free(aBatch->soldierCount);
+    free(aBatch->nobleCount);
+    free(aBatch->merchantCount);
+    free(aBatch->armyEfficiency);
+    free(aBatch->marketplaceCount);
+    free(aBatch->grainMillCount);
+    free(aBatch->foundryCount);
+    free(aBatch->shipyardCount);
+    free(aBatch->palaceCount);
+    free(aBatch->grainForSale);
+    free(aBatch->grainPrice);
+    for (i = 0; i < BATCH_SCRATCH_COUNT; i++)
+        free(aBatch->scratch[i]);
+    free(aBatch);
+}
+
+
+/*
+ *   Load the game specified by aGame into the batch specified by aBatch as game
+ * number game.  Only games with no human players and no dead players can be
+ * loaded; return false for any other game.
+ *
+ *   aBatch                 Batch.
+ *   game                   Batch game number.
+ *   aGame                  Game to load.
+ */
+
+bool BatchLoad(Batch *aBatch, int game, const Game *aGame)
+{
+    const Player *player;
+    int           index;
+    int           i;
+
+    /* Validate the game. */
+    if (   (aGame->playerCount != 0)
+        || (aGame->countryCount != aBatch->countryCount))
+    {
+        return FALSE;
+    }
+    for (i = 0; i < aGame->countryCount; i++)
+    {
+        if (aGame->playerList[i].dead)
+            return FALSE;
+    }
+
+    /* Load the game fields. */
+    aBatch->year[game] = aGame->year;
+    aBatch->weather[game] = aGame->weather;
+    aBatch->weatherRng[game] = aGame->rngList[STREAM_WEATHER];
+    aBatch->cpuRng[game] = aGame->rngList[STREAM_CPU];
+
+    /* Load the player fields. */
+    for (i = 0; i < aBatch->countryCount; i++)
+    {
+        player = &(aGame->playerList[i]);
+        index = BATCH_INDEX(aBatch, game, i);
+        aBatch->land[index] = player->land;
+        aBatch->grain[index] = player->grain;
+        aBatch->treasury[index] = player->treasury;
+        aBatch->serfCount[index] = player->serfCount;
+        aBatch->soldierCount[index] = player->soldierCount;
+        aBatch->nobleCount[index] = player->nobleCount;
+        aBatch->merchantCount[index] = player->merchantCount;
+        aBatch->armyEfficiency[index] = player->armyEfficiency;
+        aBatch->marketplaceCount[index] = player->marketplaceCount;
+        aBatch->grainMillCount[index] = player->grainMillCount;
+        aBatch->foundryCount[index] = player->foundryCount;
+        aBatch->shipyardCount[index] = player->shipyardCount;
+        aBatch->palaceCount[index] = player->palaceCount;
+        aBatch->grainForSale[index] = player->grainForSale;
+        aBatch->grainPrice[index] = player->grainPrice;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *   Store game number game of the batch specified by aBatch back into the game
+ * specified by aGame.  Fields that are not kept in the batch are left as they
+ * are, so aGame should be the game that was loaded.
+ *
+ *   aBatch                 Batch.
+ *   game                   Batch game number.
+ *   aGame                  Game to store into.
+ */
+
+void BatchStore(const Batch *aBatch, int game, Game *aGame)
+{
+    Player *player;
+    int     index;
+    int     i;
+
+    /* Store the game fields. */
+    aGame->year = aBatch->year[game];
+    aGame->weather = aBatch->weather[game];
+    aGame->rngList[STREAM_WEATHER] = aBatch->weatherRng[game];
+    aGame->rngList[STREAM_CPU] = aBatch->cpuRng[game];
+
+    /* Store the player fields. */
+    for (i = 0; i < aBatch->countryCount; i++)
+    {
+        player = &(aGame->playerList[i]);
+        index = BATCH_INDEX(aBatch, game, i);
+        player->land = aBatch->land[index];
+        player->grain = aBatch->grain[index];
+        player->treasury = aBatch->treasury[index];
+        player->serfCount = aBatch->serfCount[index];
+        player->soldierCount = aBatch->soldierCount[index];
+        player->nobleCount = aBatch->nobleCount[index];
+        player->merchantCount = aBatch->merchantCount[index];
+        player->armyEfficiency = aBatch->armyEfficiency[index];
+        player->marketplaceCount = aBatch->marketplaceCount[index];
+        player->grainMillCount = aBatch->grainMillCount[index];
+        player->foundryCount = aBatch->foundryCount[index];
+        player->shipyardCount = aBatch->shipyardCount[index];
+        player->palaceCount = aBatch->palaceCount[index];
+        if (   (player->grainForSale != aBatch->grainForSale[index])
+            || (player->grainPrice != aBatch->grainPrice[index]))
+        {
+            EngineSetGrainForSale(aGame,
+                                  player,
+                                  aBatch->grainForSale[index],
+                                  aBatch->grainPrice[index]);
+        }
+    }
+}
+
+
+/*
+ * Start a new year for all of the games in the batch specified by aBatch.
+ *
+ *   aBatch                 Batch.
+ */
+
+void BatchNewYear(Batch *aBatch)
+{
+    int game;
+
+    for (game = 0; game < aBatch->gameCount; game++)
+    {
+        aBatch->year[game]++;
+        aBatch->weather[game] = RngRange(&(aBatch->weatherRng[game]),
+                                          WEATHER_COUNT);
+    }
+}
+
+
+/*
+ *   Update the holdings of the CPU player in the slot specified by slot for all
+ * of the games in the batch specified by aBatch.  With no human players, the
+ * CPU players follow the first player, so the first slot's columns play the
+ * part of the average human holdings.
+ *
+ *   aBatch                 Batch.
+ *   slot                   Player slot.
+ */
+
+void BatchCPUTurn(Batch *aBatch, int slot)
+{
+    int *restrict       serfCount;
+    int *restrict       treasury;
+    int *restrict       merchantCount;
+    int *restrict       marketplaceCount;
+    int *restrict       grainMillCount;
+    int *restrict       foundryCount;
+    int *restrict       shipyardCount;
+    int *restrict       palaceCount;
+    int *restrict       armyEfficiency;
+    const int *restrict dSerfCount;
+    const int *restrict dTreasury;
+    const int *restrict dMerchantCount;
+    const int *restrict dMarketplaceCount;
+    const int *restrict dGrainMillCount;
+    const int *restrict dFoundryCount;
+    const int *restrict dShipyardCount;
+    const int *restrict dPalaceCount;
+    Rng                *rng;
+    float               cpuGrainPrice;
+    int                 cpuGrainForSale;
+    int                 delta;
+    int                 own;
+    int                 ref;
+    int                 game;
+
+    /*
+     * Draw the random numbers for each game in the same order as
+     * EngineCPUTurn.  Changes that need no other column are applied here;
+     * the rest are left in the scratch columns.
+     */
+    for (game = 0; game < aBatch->gameCount; game++)
+    {
+        rng = &(aBatch->cpuRng[game]);
+        own = BATCH_INDEX(aBatch, game, slot);
+        ref = BATCH_INDEX(aBatch, game, 0);
+
+        /* Serf count. */
+        aBatch->scratch[BATCH_SERF][game] =
+            RngRange(rng, 200) - RngRange(rng, 200);
+
+        /* Grain for sale.  Charge more in bad weather. */
+        cpuGrainForSale =   aBatch->grainForSale[ref]
+                          + RngRange(rng, 1000) - RngRange(rng, 1000);
+        cpuGrainPrice = aBatch->grainPrice[ref];
+        while (1)
+        {
+            cpuGrainPrice +=   RngRange(rng, 100)/100.0
+                             - RngRange(rng, 100)/100.0;
+            if (cpuGrainPrice < 0.0)
+                cpuGrainPrice = 0.0;
+            else
+                break;
+        }
+        if (   (cpuGrainForSale > aBatch->grainForSale[own])
+            && (RngRange(rng, 9) > 6))
+        {
+            aBatch->grainForSale[own] = cpuGrainForSale;
+            aBatch->grainPrice[own] = cpuGrainPrice;
+            if (aBatch->weather[game] < 3)
+                aBatch->grainPrice[own] += RngRange(rng, 100) / 150.0;
+        }
+
+        /* Treasury, merchants, marketplaces, and grain mills. */
+        aBatch->scratch[BATCH_TREASURY][game] =
+            RngRange(rng, 1500) - RngRange(rng, 1500);
+        aBatch->scratch[BATCH_MERCHANT][game] =
+            RngRange(rng, 25) - RngRange(rng, 25);
+        aBatch->scratch[BATCH_MARKETPLACE][game] =
+            RngRange(rng, 4) - RngRange(rng, 4);
+        aBatch->scratch[BATCH_GRAIN_MILL][game] =
+            RngRange(rng, 2) - RngRange(rng, 2);
+
+        /* Foundries and shipyards. */
+        delta = 0;
+        if (RngRange(rng, 100) > 30)
+            delta = RngRange(rng, 2) - RngRange(rng, 2);
+        aBatch->scratch[BATCH_FOUNDRY][game] = delta;
+        delta = 0;
+        if (RngRange(rng, 100) > 30)
+            delta = RngRange(rng, 2) - RngRange(rng, 2);
+        aBatch->scratch[BATCH_SHIPYARD][game] = delta;
+
+        /* Palaces. */
+        delta = 0;
+        if ((RngRange(rng, 100) > 30) && (RngRange(rng, 100) > 50))
+            delta = RngRange(rng, 2) - RngRange(rng, 2);
+        aBatch->scratch[BATCH_PALACE][game] = delta;
+
+        /* Nobles. */
+        delta = 0;
+        if ((RngRange(rng, 100) > 30) && (RngRange(rng, 100) > 50))
+            delta = RngRange(rng, 2) - RngRange(rng, 2);
+        aBatch->nobleCount[own] = MAX(aBatch->nobleCount[own],
+                                      aBatch->nobleCount[ref] + delta);
+
+        /* Soldiers. */
+        aBatch->soldierCount[own] =
+              (10 * aBatch->nobleCount[own])
+            + RngRange(rng, 10 * aBatch->nobleCount[own]);
+    }
+
+    /* Apply the scratch columns. */
+    serfCount = aBatch->serfCount + (slot * aBatch->gameCount);
+    treasury = aBatch->treasury + (slot * aBatch->gameCount);
+    merchantCount = aBatch->merchantCount + (slot * aBatch->gameCount);
+    marketplaceCount = aBatch->marketplaceCount + (slot * aBatch->gameCount);
+    grainMillCount = aBatch->grainMillCount + (slot * aBatch->gameCount);
+    foundryCount = aBatch->foundryCount + (slot * aBatch->gameCount);
+    shipyardCount = aBatch->shipyardCount + (slot * aBatch->gameCount);
+    palaceCount = aBatch->palaceCount + (slot * aBatch->gameCount);
+    armyEfficiency = aBatch->armyEfficiency + (slot * aBatch->gameCount);
+    dSerfCount = aBatch->scratch[BATCH_SERF];
+    dTreasury = aBatch->scratch[BATCH_TREASURY];
+    dMerchantCount = aBatch->scratch[BATCH_MERCHANT];
+    dMarketplaceCount = aBatch->scratch[BATCH_MARKETPLACE];
+    dGrainMillCount = aBatch->scratch[BATCH_GRAIN_MILL];
+    dFoundryCount = aBatch->scratch[BATCH_FOUNDRY];
+    dShipyardCount = aBatch->scratch[BATCH_SHIPYARD];
+    dPalaceCount = aBatch->scratch[BATCH_PALACE];
+    if (slot == 0)
+    {
+        /* The first slot follows itself. */
+        for (game = 0; game < aBatch->gameCount; game++)
+        {
+            serfCount[game] += dSerfCount[game];
+            treasury[game] += dTreasury[game];
+            merchantCount[game] += MAX(dMerchantCount[game], 0);
+            marketplaceCount[game] += MAX(dMarketplaceCount[game], 0);
+            grainMillCount[game] += MAX(dGrainMillCount[game], 0);
+            foundryCount[game] += MAX(dFoundryCount[game], 0);
+            shipyardCount[game] += MAX(dShipyardCount[game], 0);
+            palaceCount[game] += MAX(dPalaceCount[game], 0);
+        }
+    }
+    else
+    {
+        const int *restrict refSerfCount = aBatch->serfCount;
+        const int *restrict refTreasury = aBatch->treasury;
+        const int *restrict refMerchantCount = aBatch->merchantCount;
+        const int *restrict refMarketplaceCount = aBatch->marketplaceCount;
+        const int *restrict refGrainMillCount = aBatch->grainMillCount;
+        const int *restrict refFoundryCount = aBatch->foundryCount;
+        const int *restrict refShipyardCount = aBatch->shipyardCount;
+        const int *restrict refPalaceCount = aBatch->palaceCount;
+        const int *restrict refArmyEfficiency = aBatch->armyEfficiency;
+
+        for (game = 0; game < aBatch->gameCount; game++)
+        {
+            serfCount[game] = refSerfCount[game] + dSerfCount[game];
+            treasury[game] = refTreasury[game] + dTreasury[game];
+            merchantCount[game] =
+                MAX(merchantCount[game],
+                    refMerchantCount[game] + dMerchantCount[game]);
+            marketplaceCount[game] =
+                MAX(marketplaceCount[game],
+                    refMarketplaceCount[game] + dMarketplaceCount[game]);
+            grainMillCount[game] =
+                MAX(grainMillCount[game],
+                    refGrainMillCount[game] + dGrainMillCount[game]);
+            foundryCount[game] =
+                MAX(foundryCount[game],
+                    refFoundryCount[game] + dFoundryCount[game]);
+            shipyardCount[game] =
+                MAX(shipyardCount[game],
+                    refShipyardCount[game] + dShipyardCount[game]);
+            palaceCount[game] =
+                MAX(palaceCount[game],
+                    refPalaceCount[game] + dPalaceCount[game]);
+            armyEfficiency[game] = refArmyEfficiency[game];
+        }
+    }
+
+    /* Limit the soldiers to what the serfs and foundries can support. */
+    for (game = 0; game < aBatch->gameCount; game++)
+    {
+        own = BATCH_INDEX(aBatch, game, slot);
+        if (aBatch->serfCount[own] > 0)
+        {
+            while ((  ((float) aBatch->soldierCount[own])
+                    / ((float) aBatch->serfCount[own])) >
+                   ((0.01 * ((float) aBatch->foundryCount[own])) + 0.05))
+            {
+                aBatch->soldierCount[own] /= 2;
+            }
+        }
+        else
+        {
+            aBatch->soldierCount[own] = 0;
+        }
+    }
+}
+
+
+/*
+ *   Play a year of all of the games in the batch specified by aBatch.  This is
+ * the same as a new year followed by a turn for each CPU player.
+ *
+ *   aBatch                 Batch.
+ */
+
+void BatchCPUYear(Batch *aBatch)
+{
+    ProbeMark probe;
+    int       slot;
+
+    ProbeBegin(&probe);
+    BatchNewYear(aBatch);
+    for (slot = 0; slot < aBatch->countryCount; slot++)
+        BatchCPUTurn(aBatch, slot);
+    ProbeEnd(&probe, PROBE_BATCH_YEAR);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Allocate and return a zeroed, cache line aligned column of the number of
+ * entries specified by count, each the size specified by size.
+ *
+ *   count                  Number of entries.
+ *   size                   Size of each entry.
+ */
+
+static void *BatchColumn(size_t count, size_t size)
+{
+    void   *column;
+    size_t  bytes;
+
+    /* Round the column up to a whole number of cache lines. */
+    bytes = count * size;
+    bytes = (bytes + BATCH_ALIGNMENT - 1) & ~((size_t) BATCH_ALIGNMENT - 1);
+    if (bytes == 0)
+        bytes = BATCH_ALIGNMENT;
+
+    /* Allocate the column. */
+    column = aligned_alloc(BATCH_ALIGNMENT, bytes);
+    if (column != NULL)
+        memset(column, 0, bytes);
+
+    return column;
+}
+
@@ -0,0 +1,122 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire batch game state header file.
+ *
+ *   A batch holds the state of many all-CPU games in struct-of-arrays form.
+ * Each player field is a column with one entry per game and player slot, laid
+ * out slot by slot so that a year-step kernel for one slot streams through
+ * contiguous memory across all of the games.  Only the fields the CPU year
+ * touches are kept in the batch; games are loaded into and stored back out of
+ * a batch with BatchLoad and BatchStore.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* Local includes. */
+#include "empire.h"
+#include "rng.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Return the column index for the game specified by game and the player slot
+ * specified by slot in the batch specified by aBatch.
+ */
+
+#define BATCH_INDEX(aBatch, game, slot) \
+    (((slot) * (aBatch)->gameCount) + (game))
+
+
+/*
+ * Number of per-game scratch columns.
+ */
+
+#define BATCH_SCRATCH_COUNT 8
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ *   This structure contains fields for a batch of games.  Game columns have
+ * gameCount entries; player columns have gameCount * countryCount entries,
+ * indexed with BATCH_INDEX.  See the Player structure for the meaning of each
+ * player field.
+ *
+ *   gameCount              Number of games in the batch.
+ *   countryCount           Number of countries in each game.
+ *   year                   Current year of each game.
+ *   weather                Weather of each game.
+ *   weatherRng             Weather random number stream of each game.
+ *   cpuRng                 CPU player random number stream of each game.
+ *   land ... grainPrice    Player columns.
+ *   scratch                Per-game scratch columns used by the kernels.
+ */
+
+typedef struct
+{
+    int                     gameCount;
+    int                     countryCount;
+
+    int                    *year;
+    int                    *weather;
+    Rng                    *weatherRng;
+    Rng                    *cpuRng;
+
+    int                    *land;
+    int                    *grain;
+    int                    *treasury;
+    int                    *serfCount;
+    int                    *soldierCount;
+    int                    *nobleCount;
+    int                    *merchantCount;
+    int                    *armyEfficiency;
+    int                    *marketplaceCount;
+    int                    *grainMillCount;
+    int                    *foundryCount;
+    int                    *shipyardCount;
+    int                    *palaceCount;
+    int                    *grainForSale;
+    float                  *grainPrice;
+
+    int                    *scratch[BATCH_SCRATCH_COUNT];
+} Batch;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+Batch *BatchCreate(int gameCount, int countryCount);
+
+void BatchDestroy(Batch *aBatch);
+
+bool BatchLoad(Batch *aBatch, int game, const Game *aGame);
+
+void BatchStore(const Batch *aBatch, int game, Game *aGame);
+
+void BatchNewYear(Batch *aBatch);
+
+void BatchCPUTurn(Batch *aBatch, int slot);
+
+void BatchCPUYear(Batch *aBatch);
+
+
+#endif /* __BATCH_H__ */
+
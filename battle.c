@@ -0,0 +1,310 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire battle resolver.
+ *
+ *   Each round of a battle kills (soldierCount / 15) + 1 soldiers on the side
+ * that lost the round.  The number killed only changes when the player loses
+ * a round, so between player losses every round is an identical Bernoulli
+ * trial.  The resolver draws the length of each run of player wins from a
+ * geometric distribution and applies the whole run at once, so a battle takes
+ * one step per player loss, about 15 * ln(soldierCount) steps at most, instead
+ * of one per round.
+ *
+ *   The land captured in a run of wins is the clamped sum of one draw per win.
+ * Short runs draw each win exactly.  Long runs draw the first and last few wins
+ * exactly and the middle of the run from a normal approximation of its sum.
+ * The clamps only bind near the ends of the land range, which the exact draws
+ * at each end of the run cover.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <math.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "battle.h"
+#include "engine.h"
+#include "rng.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Number of wins at each end of a run of wins for which land is drawn exactly.
+ */
+
+#define BATTLE_EXACT_WINS   8
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static int BattleWinRun(Game *aGame, double winProbability, int maxWinCount);
+
+static void BattleCaptureLand(Game   *aGame,
+                              Battle *aBattle,
+                              int     soldierKillCount,
+                              int     winCount);
+
+static void BattleCaptureLandExact(Game   *aGame,
+                                   Battle *aBattle,
+                                   int     soldierKillCount,
+                                   int     winCount);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ *   Return the probability that a player with the soldier efficiency specified
+ * by soldierEfficiency wins a battle round against a target with the soldier
+ * efficiency specified by targetSoldierEfficiency.  The player wins unless
+ * RngRange(soldierEfficiency) < RngRange(targetSoldierEfficiency).
+ *
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ */
+
+double BattleRoundWinProbability(int soldierEfficiency,
+                                 int targetSoldierEfficiency)
+{
+    double se = soldierEfficiency;
+    double te = targetSoldierEfficiency;
+
+    /* RngRange returns 0 for ranges of 0 or less. */
+    if (targetSoldierEfficiency <= 0)
+        return 1.0;
+    if (soldierEfficiency <= 0)
+        return 0.0;
+
+    /* Sum min(a, te) over each player draw a and divide by the draw count. */
+    if (soldierEfficiency <= targetSoldierEfficiency)
+        return (se + 1.0) / (2.0 * te);
+
+    return ((te * (te + 1.0) / 2.0) + ((se - te) * te)) / (se * te);
+}
+
+
+/*
+ *   Run the battle specified by aBattle to completion.  The outcome has the
+ * same distribution as running EngineBattleRound until the battle is done.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to run.
+ */
+
+void BattleResolve(Game *aGame, Battle *aBattle)
+{
+    double winProbability;
+    int    soldierKillCount;
+    int    winsNeededCount;
+    int    winCount;
+    bool   battleDone = FALSE;
+
+    /* A battle without player soldiers is decided in a single round. */
+    if (aBattle->soldierCount <= 0)
+    {
+        EngineBattleRound(aGame, aBattle);
+        return;
+    }
+
+    /* Run the battle one run of player wins at a time. */
+    winProbability = BattleRoundWinProbability
+                         (aBattle->soldierEfficiency,
+                          aBattle->targetSoldierEfficiency);
+    while (!battleDone)
+    {
+        /* Determine how many wins in a row defeat the target. */
+        soldierKillCount = (aBattle->soldierCount / 15) + 1;
+        winsNeededCount =   (aBattle->targetSoldierCount + soldierKillCount - 1)
+                          / soldierKillCount;
+        if (winsNeededCount < 1)
+            winsNeededCount = 1;
+
+        /* Draw the number of wins before the next loss. */
+        winCount = BattleWinRun(aGame, winProbability, winsNeededCount);
+        BattleCaptureLand(aGame, aBattle, soldierKillCount, winCount);
+
+        if (winCount >= winsNeededCount)
+        {
+            /* Player defeated the target soldiers. */
+            aBattle->targetSoldierCount = 0;
+            battleDone = TRUE;
+        }
+        else
+        {
+            /* Player lost the round after the run of wins. */
+            aBattle->targetSoldierCount -= winCount * soldierKillCount;
+            aBattle->soldierCount -= soldierKillCount;
+            if (aBattle->soldierCount < 0)
+                aBattle->soldierCount = 0;
+            if (   (aBattle->soldierCount == 0)
+                || (aBattle->targetSoldierCount == 0)
+                || (aBattle->landCaptured >= aBattle->targetLand))
+            {
+                battleDone = TRUE;
+            }
+        }
+    }
+
+    /* Update the battle results. */
+    if (aBattle->soldierCount > 0)
+    {
+        aBattle->targetDefeated = TRUE;
+        if (   aBattle->targetSerfs
+            || (aBattle->landCaptured >= aBattle->targetLand))
+        {
+            aBattle->targetOverrun = TRUE;
+        }
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Return the number of battle rounds the player wins in a row, each with the
+ * probability specified by winProbability, before losing a round.  Runs longer
+ * than the number of wins specified by maxWinCount are cut to maxWinCount.
+ *
+ *   aGame                  Game.
+ *   winProbability         Probability of the player winning a round.
+ *   maxWinCount            Maximum number of wins to return.
+ */
+
+static int BattleWinRun(Game *aGame, double winProbability, int maxWinCount)
+{
+    double  winCount;
+    Rng    *rng;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /* Handle certain wins and losses. */
+    if (winProbability >= 1.0)
+        return maxWinCount;
+    if (winProbability <= 0.0)
+        return 0;
+
+    /* Invert the geometric distribution.  Keep the uniform away from 0. */
+    winCount =   log(1.0 - RngUniform(rng))
+               / log(winProbability);
+    if (winCount >= maxWinCount)
+        return maxWinCount;
+
+    return (int) winCount;
+}
+
+
+/*
+ *   Add the land captured over the number of battle rounds specified by
+ * winCount, each killing the number of target soldiers specified by
+ * soldierKillCount, to the battle specified by aBattle.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle.
+ *   soldierKillCount       Number of soldiers killed each round.
+ *   winCount               Number of rounds won.
+ */
+
+static void BattleCaptureLand(Game   *aGame,
+                              Battle *aBattle,
+                              int     soldierKillCount,
+                              int     winCount)
+{
+    double  gainRange;
+    double  lossRange;
+    double  mean;
+    double  variance;
+    double  sum;
+    int     approxCount;
+    Rng    *rng;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /* Draw short runs exactly. */
+    if (winCount <= 2 * BATTLE_EXACT_WINS)
+    {
+        BattleCaptureLandExact(aGame, aBattle, soldierKillCount, winCount);
+        return;
+    }
+
+    /* Draw the head of the run exactly. */
+    BattleCaptureLandExact(aGame, aBattle, soldierKillCount, BATTLE_EXACT_WINS);
+
+    /*
+     * Draw the middle of the run from a normal distribution with the mean and
+     * variance of the sum of RngRange(26 * k) - RngRange(k + 5).
+     */
+    approxCount = winCount - 2 * BATTLE_EXACT_WINS;
+    gainRange = 26.0 * soldierKillCount;
+    lossRange = soldierKillCount + 5.0;
+    mean = approxCount * (gainRange - lossRange) / 2.0;
+    variance =   approxCount
+               * (  ((gainRange * gainRange) - 1.0)
+                  + ((lossRange * lossRange) - 1.0))
+               / 12.0;
+    sum = round(mean + sqrt(variance) * RngNormal(rng));
+    sum += aBattle->landCaptured;
+    if (sum < 0.0)
+        aBattle->landCaptured = 0;
+    else if (sum > aBattle->targetLand)
+        aBattle->landCaptured = aBattle->targetLand;
+    else
+        aBattle->landCaptured = (int) sum;
+
+    /* Draw the tail of the run exactly. */
+    BattleCaptureLandExact(aGame, aBattle, soldierKillCount, BATTLE_EXACT_WINS);
+}
+
+
+/*
+ *   Add the land captured over the number of battle rounds specified by
+ * winCount, each killing the number of target soldiers specified by
+ * soldierKillCount, to the battle specified by aBattle, drawing the land for
+ * each round as EngineBattleRound does.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle.
+ *   soldierKillCount       Number of soldiers killed each round.
+ *   winCount               Number of rounds won.
+ */
+
+static void BattleCaptureLandExact(Game   *aGame,
+                                   Battle *aBattle,
+                                   int     soldierKillCount,
+                                   int     winCount)
+{
+    Rng *rng;
+    int  i;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+    for (i = 0; i < winCount; i++)
+    {
+        aBattle->landCaptured +=   RngRange(rng, 26 * soldierKillCount)
+                                 - RngRange(rng, soldierKillCount + 5);
+        if (aBattle->landCaptured < 0)
+            aBattle->landCaptured = 0;
+        else if (aBattle->landCaptured > aBattle->targetLand)
+            aBattle->landCaptured = aBattle->targetLand;
+    }
+}
+
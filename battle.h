@@ -0,0 +1,38 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire battle resolver header file.
+ *
+ *   The battle resolver runs a battle to completion without stepping through
+ * it a round at a time.  It gives the same distribution of outcomes as
+ * EngineBattleRound but draws different random numbers, so front ends that
+ * show a battle round by round still step through it with EngineBattleRound.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __BATTLE_H__
+#define __BATTLE_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* Local includes. */
+#include "empire.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+double BattleRoundWinProbability(int soldierEfficiency,
+                                 int targetSoldierEfficiency);
+
+void BattleResolve(Game *aGame, Battle *aBattle);
+
+
+#endif /* __BATTLE_H__ */
+
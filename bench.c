@@ -0,0 +1,553 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire rule kernel benchmarks.
+ *
+ *   The benchmarks time the hot functions of the rules engine on a game
+ * played a few years in, so the players hold realistic amounts.  Each
+ * benchmark is calibrated to run enough operations per repetition to take at
+ * least BENCH_REP_NS, warmed up, and then timed over a number of repetitions.
+ * The time per operation of each repetition is collected, and the minimum,
+ * median, 99th percentile, and mean are printed as CSV, one benchmark per line.
+ *
+ *   Benchmarks that change a player restore the player from a copy before each
+ * operation, so every operation starts from the same holdings.  Their times
+ * include that 128 byte copy.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "engine.h"
+#include "probe.h"
+#include "rng.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Benchmark defs.
+ *
+ *   BENCH_DEFAULT_REPS     Default number of timed repetitions.
+ *   BENCH_DEFAULT_WARMUP   Default number of warmup repetitions.
+ *   BENCH_DEFAULT_SEED     Default random number seed.
+ *   BENCH_REP_NS           Shortest time of a repetition in nanoseconds.
+ *   BENCH_MAX_OPS          Most operations in a repetition.
+ *   BENCH_COUNTRY_COUNT    Number of countries in the benchmark game.
+ *   BENCH_SETUP_YEARS      Number of years played before benchmarking.
+ */
+
+#define BENCH_DEFAULT_REPS  101
+#define BENCH_DEFAULT_WARMUP 10
+#define BENCH_DEFAULT_SEED  1
+#define BENCH_REP_NS        1000000
+#define BENCH_MAX_OPS       (1 << 30)
+#define BENCH_COUNTRY_COUNT 64
+#define BENCH_SETUP_YEARS   5
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the benchmark state.
+ *
+ *   game                   Benchmark game.
+ *   player                 Player the player benchmarks run on.
+ *   target                 Player the player attacks in battle benchmarks.
+ *   savedPlayer            Copy of the player to restore.
+ *   rng                    Random number generator for the rng benchmark.
+ *   sink                   Sum of results, so that they are not optimized away.
+ */
+
+typedef struct
+{
+    Game                   *game;
+    Player                 *player;
+    Player                 *target;
+    Player                  savedPlayer;
+    Rng                     rng;
+    uint64_t                sink;
+} Bench;
+
+
+/*
+ *   Benchmark function type.  A benchmark function runs the number of
+ * operations specified by opCount with the benchmark parameter specified by
+ * param.
+ */
+
+typedef void (*BenchFunction)(Bench *aBench, int param, uint64_t opCount);
+
+
+/*
+ * This structure contains fields for a benchmark.
+ *
+ *   name                   Name of the benchmark.
+ *   function               Function to run the benchmark.
+ *   param                  Parameter to pass to the function.
+ */
+
+typedef struct
+{
+    const char             *name;
+    BenchFunction           function;
+    int                     param;
+} BenchCase;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void BenchSetup(Bench *aBench, uint64_t seed);
+
+static void BenchRun(Bench           *aBench,
+                     const BenchCase *aCase,
+                     int              warmupCount,
+                     int              repCount,
+                     double          *aTimeList);
+
+static uint64_t BenchTime(Bench           *aBench,
+                          const BenchCase *aCase,
+                          uint64_t         opCount);
+
+static int BenchCompare(const void *aA, const void *aB);
+
+static void BenchRngRange(Bench *aBench, int param, uint64_t opCount);
+
+static void BenchRevenue(Bench *aBench, int param, uint64_t opCount);
+
+static void BenchBattle(Bench *aBench, int param, uint64_t opCount);
+
+static void BenchHarvest(Bench *aBench, int param, uint64_t opCount);
+
+static void BenchPopulation(Bench *aBench, int param, uint64_t opCount);
+
+static void BenchCPUTurn(Bench *aBench, int param, uint64_t opCount);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ *   List of benchmarks.  Battle benchmarks are parameterized by the number of
+ * soldiers on each side.
+ */
+
+static const BenchCase benchCaseList[] =
+{
+    { "rng-range",     BenchRngRange,   0 },
+    { "revenue",       BenchRevenue,    0 },
+    { "battle-100",    BenchBattle,     100 },
+    { "battle-1000",   BenchBattle,     1000 },
+    { "battle-10000",  BenchBattle,     10000 },
+    { "battle-100000", BenchBattle,     100000 },
+    { "harvest",       BenchHarvest,    0 },
+    { "population",    BenchPopulation, 0 },
+    { "cpu-turn",      BenchCPUTurn,    0 },
+};
+
+#define BENCH_CASE_COUNT (sizeof(benchCaseList) / sizeof(benchCaseList[0]))
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    Bench     bench;
+    double   *timeList;
+    uint64_t  seed;
+    bool      selected;
+    int       warmupCount;
+    int       repCount;
+    int       opt;
+    size_t    i;
+    int       j;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line. */
+    repCount = BENCH_DEFAULT_REPS;
+    warmupCount = BENCH_DEFAULT_WARMUP;
+    seed = BENCH_DEFAULT_SEED;
+    while ((opt = getopt(argc, argv, "r:w:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r' :
+                repCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 'w' :
+                warmupCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 's' :
+                seed = strtoull(optarg, NULL, 0);
+                break;
+
+            default :
+                fprintf(stderr,
+                        "usage: %s [-r repetitions] [-w warmup repetitions] "
+                        "[-s seed] [benchmark prefix...]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    if (repCount < 1)
+        repCount = 1;
+    if (warmupCount < 0)
+        warmupCount = 0;
+
+    /* Set up the benchmark game. */
+    timeList = calloc(repCount, sizeof(double));
+    if (timeList == NULL)
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    BenchSetup(&bench, seed);
+
+    /* Run each benchmark selected by a name prefix, or all of them. */
+    printf("benchmark,ops,reps,min_ns,median_ns,p99_ns,mean_ns\n");
+    for (i = 0; i < BENCH_CASE_COUNT; i++)
+    {
+        selected = (optind >= argc);
+        for (j = optind; j < argc; j++)
+        {
+            if (strncmp(benchCaseList[i].name, argv[j], strlen(argv[j])) == 0)
+                selected = TRUE;
+        }
+        if (selected)
+        {
+            BenchRun(&bench,
+                     &(benchCaseList[i]),
+                     warmupCount,
+                     repCount,
+                     timeList);
+        }
+    }
+
+    /* Clean up. */
+    EngineDestroyGame(bench.game);
+    free(timeList);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Set up the benchmark specified by aBench with an all-CPU game started with
+ * the random number seed specified by seed and played BENCH_SETUP_YEARS years.
+ * Exit if out of memory.
+ *
+ *   aBench                 Benchmark.
+ *   seed                   Random number seed.
+ */
+
+static void BenchSetup(Bench *aBench, uint64_t seed)
+{
+    Game   *game;
+    Player *player;
+    int     year;
+    int     i;
+
+    /* Create the game and play it a few years in. */
+    memset(aBench, 0, sizeof(*aBench));
+    game = EngineCreateGame(BENCH_COUNTRY_COUNT);
+    if (game == NULL)
+    {
+        fprintf(stderr, "empire-bench: out of memory\n");
+        exit(1);
+    }
+    EngineNewGame(game, 0, seed);
+    for (year = 0; year < BENCH_SETUP_YEARS; year++)
+    {
+        EngineNewYear(game);
+        for (i = 0; i < game->liveCount; i++)
+        {
+            player = &(game->playerList[game->liveList[i]]);
+            if (!player->dead)
+                EngineCPUTurn(game, player);
+        }
+    }
+
+    /* Pick the players and save the one that is changed. */
+    aBench->game = game;
+    aBench->player = &(game->playerList[0]);
+    aBench->target = &(game->playerList[1]);
+    aBench->savedPlayer = *(aBench->player);
+    RngSeed(&(aBench->rng), seed);
+}
+
+
+/*
+ *   Run the benchmark specified by aCase with the number of warmup repetitions
+ * specified by warmupCount and timed repetitions specified by repCount, using
+ * the list specified by aTimeList for the repetition times, and print the
+ * result.
+ *
+ *   aBench                 Benchmark.
+ *   aCase                  Benchmark to run.
+ *   warmupCount            Number of warmup repetitions.
+ *   repCount               Number of timed repetitions.
+ *   aTimeList              List of repCount repetition times.
+ */
+
+static void BenchRun(Bench           *aBench,
+                     const BenchCase *aCase,
+                     int              warmupCount,
+                     int              repCount,
+                     double          *aTimeList)
+{
+    uint64_t opCount;
+    double   totalTime;
+    int      i;
+
+    /* Double the operations per repetition until one is long enough. */
+    opCount = 1;
+    while (   (BenchTime(aBench, aCase, opCount) < BENCH_REP_NS)
+           && (opCount < BENCH_MAX_OPS))
+    {
+        opCount *= 2;
+    }
+
+    /* Warm up. */
+    for (i = 0; i < warmupCount; i++)
+        BenchTime(aBench, aCase, opCount);
+
+    /* Time the repetitions. */
+    totalTime = 0.0;
+    for (i = 0; i < repCount; i++)
+    {
+        aTimeList[i] = ((double) BenchTime(aBench, aCase, opCount)) / opCount;
+        totalTime += aTimeList[i];
+    }
+    qsort(aTimeList, repCount, sizeof(double), BenchCompare);
+
+    /* Print the minimum, median, 99th percentile, and mean. */
+    printf("%s,%" PRIu64 ",%d,%.2f,%.2f,%.2f,%.2f\n",
+           aCase->name,
+           opCount,
+           repCount,
+           aTimeList[0],
+           aTimeList[repCount / 2],
+           aTimeList[(99 * repCount - 1) / 100],
+           totalTime / repCount);
+    fflush(stdout);
+}
+
+
+/*
+ *   Run the number of operations specified by opCount of the benchmark
+ * specified by aCase and return the time they took in nanoseconds.
+ *
+ *   aBench                 Benchmark.
+ *   aCase                  Benchmark to run.
+ *   opCount                Number of operations.
+ */
+
+static uint64_t BenchTime(Bench           *aBench,
+                          const BenchCase *aCase,
+                          uint64_t         opCount)
+{
+    struct timespec startTime;
+    struct timespec endTime;
+
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    aCase->function(aBench, aCase->param, opCount);
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    return   ((uint64_t) (endTime.tv_sec - startTime.tv_sec)) * 1000000000
+           + endTime.tv_nsec - startTime.tv_nsec;
+}
+
+
+/*
+ * Compare the times specified by aA and aB for qsort.
+ *
+ *   aA                     First time.
+ *   aB                     Second time.
+ */
+
+static int BenchCompare(const void *aA, const void *aB)
+{
+    double a = *((const double *) aA);
+    double b = *((const double *) aB);
+
+    return (a > b) - (a < b);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Benchmark functions.
+ */
+
+/*
+ * Draw random numbers in a range.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Unused.
+ *   opCount                Number of numbers to draw.
+ */
+
+static void BenchRngRange(Bench *aBench, int param, uint64_t opCount)
+{
+    uint64_t i;
+    uint64_t sum = 0;
+
+    (void) param;
+    for (i = 0; i < opCount; i++)
+        sum += RngRange(&(aBench->rng), 1000);
+    aBench->sink += sum;
+}
+
+
+/*
+ * Compute the revenues of a player.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Unused.
+ *   opCount                Number of revenues to compute.
+ */
+
+static void BenchRevenue(Bench *aBench, int param, uint64_t opCount)
+{
+    uint64_t i;
+
+    (void) param;
+    for (i = 0; i < opCount; i++)
+    {
+        *(aBench->player) = aBench->savedPlayer;
+        EngineComputeRevenues(aBench->game, aBench->player);
+        aBench->sink += aBench->player->treasury;
+    }
+}
+
+
+/*
+ *   Run a battle to completion between two armies of the number of soldiers
+ * specified by param.  The players are not changed.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Number of soldiers on each side.
+ *   opCount                Number of battles to run.
+ */
+
+static void BenchBattle(Bench *aBench, int param, uint64_t opCount)
+{
+    Battle   battle;
+    uint64_t i;
+
+    aBench->target->soldierCount = param;
+    for (i = 0; i < opCount; i++)
+    {
+        EngineStartBattle(aBench->game,
+                          &battle,
+                          aBench->player,
+                          aBench->target,
+                          param);
+        EngineRunBattle(aBench->game, &battle);
+        aBench->sink += battle.landCaptured;
+    }
+}
+
+
+/*
+ * Compute the rats and harvest of a player.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Unused.
+ *   opCount                Number of harvests to compute.
+ */
+
+static void BenchHarvest(Bench *aBench, int param, uint64_t opCount)
+{
+    uint64_t i;
+
+    (void) param;
+    for (i = 0; i < opCount; i++)
+    {
+        *(aBench->player) = aBench->savedPlayer;
+        EngineHarvest(aBench->game, aBench->player);
+        aBench->sink += aBench->player->grain;
+    }
+}
+
+
+/*
+ * Compute the population changes of a player.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Unused.
+ *   opCount                Number of population updates to compute.
+ */
+
+static void BenchPopulation(Bench *aBench, int param, uint64_t opCount)
+{
+    uint64_t i;
+
+    (void) param;
+    for (i = 0; i < opCount; i++)
+    {
+        *(aBench->player) = aBench->savedPlayer;
+        EnginePopulation(aBench->game, aBench->player, NULL);
+        aBench->sink += aBench->player->serfCount;
+    }
+}
+
+
+/*
+ * Update the holdings of a CPU player.
+ *
+ *   aBench                 Benchmark.
+ *   param                  Unused.
+ *   opCount                Number of CPU turns to take.
+ */
+
+static void BenchCPUTurn(Bench *aBench, int param, uint64_t opCount)
+{
+    uint64_t i;
+
+    (void) param;
+    for (i = 0; i < opCount; i++)
+    {
+        *(aBench->player) = aBench->savedPlayer;
+        EngineCPUTurn(aBench->game, aBench->player);
+        aBench->sink += aBench->player->treasury;
+    }
+}
@@ -0,0 +1,357 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire battle odds check.
+ *
+ *   The odds check compares the battle odds computed by OddsCompute with the
+ * outcomes of battles stepped round by round with EngineBattleRound.  Each
+ * battle is fought a number of times, and the mean of each outcome is compared
+ * with the odds.  An outcome passes if it is within CHECK_SIGMAS standard
+ * errors of the mean, plus CHECK_SLACK of its scale for the land grid the odds
+ * use for large targets.  One CSV line is printed for each outcome, and the
+ * check exits with a failure if any outcome does not pass.
+ *
+ *   The battles checked include battles that capture all of the target land,
+ * where the battle ends early, and battles that can't, where it doesn't.  A
+ * single battle may be given on the command line instead.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "engine.h"
+#include "odds.h"
+#include "probe.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Odds check defs.
+ *
+ *   CHECK_DEFAULT_BATTLES  Default number of times each battle is fought.
+ *   CHECK_DEFAULT_SEED     Default random number seed.
+ *   CHECK_SIGMAS           Number of standard errors an outcome may be off.
+ *   CHECK_SLACK            Fraction of its scale an outcome may also be off.
+ */
+
+#define CHECK_DEFAULT_BATTLES   100000
+#define CHECK_DEFAULT_SEED      1
+#define CHECK_SIGMAS            5.0
+#define CHECK_SLACK             0.005
+
+
+/*
+ * Battle outcomes.
+ *
+ *   CHECK_WIN              Target defeated.
+ *   CHECK_LAND             Acres of land captured.
+ *   CHECK_SOLDIER_LOSS     Number of player soldiers lost.
+ *   CHECK_TARGET_LOSS      Number of target soldiers lost.
+ *   CHECK_OUTCOME_COUNT    Count of the number of outcomes.
+ */
+
+#define CHECK_WIN               0
+#define CHECK_LAND              1
+#define CHECK_SOLDIER_LOSS      2
+#define CHECK_TARGET_LOSS       3
+#define CHECK_OUTCOME_COUNT     4
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a battle to check.
+ *
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ *   soldierCount           Number of player soldiers.
+ *   targetSoldierCount     Number of target soldiers.
+ *   targetLand             Acres of land of target.
+ */
+
+typedef struct
+{
+    int                     soldierEfficiency;
+    int                     targetSoldierEfficiency;
+    int                     soldierCount;
+    int                     targetSoldierCount;
+    int                     targetLand;
+} CheckBattle;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static bool CheckOdds(Game              *aGame,
+                      const CheckBattle *aBattle,
+                      int                battleCount);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ *   List of battles to check.  The first battles capture all of the target
+ * land well before either army is gone.
+ */
+
+static const CheckBattle checkList[] =
+{
+    { 15, 15, 1000, 1000,   5000 },
+    { 15, 15,   50,   60,    200 },
+    { 15, 15,  200,  200,   1000 },
+    { 10, 12,   30,   40,     50 },
+    { 12, 10,  100,  100,     64 },
+    { 15, 10, 1000, 3000,  10000 },
+    {  8, 14,  200,  150,  10000 },
+    { 12, 10,  100,  120, 100000 },
+    { 10, 10,    0,   50,     40 },
+    { 10, 10,   50,    0,     40 },
+    { 10, 10,   50,   50,      0 },
+};
+
+#define CHECK_COUNT (sizeof(checkList) / sizeof(checkList[0]))
+
+
+/*
+ * Names of the outcomes.
+ */
+
+static const char *checkOutcomeNameList[CHECK_OUTCOME_COUNT] =
+{
+    "win",
+    "land",
+    "soldier_loss",
+    "target_loss",
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    Game        *game;
+    CheckBattle  battle;
+    uint64_t     seed;
+    bool         passed = TRUE;
+    int          battleCount;
+    int          opt;
+    size_t       i;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line. */
+    battleCount = CHECK_DEFAULT_BATTLES;
+    seed = CHECK_DEFAULT_SEED;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n' :
+                battleCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 's' :
+                seed = strtoull(optarg, NULL, 0);
+                break;
+
+            default :
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (   (optind > argc)
+        || ((optind != argc) && ((argc - optind) != 5)))
+    {
+        fprintf(stderr,
+                "usage: %s [-n battles] [-s seed] [soldier efficiency "
+                "target soldier efficiency soldiers target soldiers "
+                "target land]\n",
+                argv[0]);
+        return 1;
+    }
+    if (battleCount < 2)
+        battleCount = 2;
+
+    /* Create a game for its battle random numbers. */
+    game = EngineCreateGame(1);
+    if (game == NULL)
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+    EngineSeed(game, seed);
+
+    /* Check the battle given, or all of them. */
+    printf("soldier_efficiency,target_soldier_efficiency,soldiers,"
+           "target_soldiers,target_land,outcome,odds,monte_carlo,"
+           "error_limit,result\n");
+    if (optind < argc)
+    {
+        battle.soldierEfficiency = strtol(argv[optind], NULL, 0);
+        battle.targetSoldierEfficiency = strtol(argv[optind + 1], NULL, 0);
+        battle.soldierCount = strtol(argv[optind + 2], NULL, 0);
+        battle.targetSoldierCount = strtol(argv[optind + 3], NULL, 0);
+        battle.targetLand = strtol(argv[optind + 4], NULL, 0);
+        passed = CheckOdds(game, &battle, battleCount);
+    }
+    else
+    {
+        for (i = 0; i < CHECK_COUNT; i++)
+        {
+            if (!CheckOdds(game, &(checkList[i]), battleCount))
+                passed = FALSE;
+        }
+    }
+
+    /* Clean up. */
+    EngineDestroyGame(game);
+
+    return passed ? 0 : 1;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Check the odds of the battle specified by aBattle against the number of
+ * battles specified by battleCount stepped round by round, and print the
+ * result for each outcome.  Return true if all of the outcomes pass.  Exit if
+ * out of memory.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to check.
+ *   battleCount            Number of times to fight the battle.
+ */
+
+static bool CheckOdds(Game              *aGame,
+                      const CheckBattle *aBattle,
+                      int                battleCount)
+{
+    Battle      battle;
+    BattleOdds  odds;
+    double      oddsList[CHECK_OUTCOME_COUNT];
+    double      scaleList[CHECK_OUTCOME_COUNT];
+    double      sumList[CHECK_OUTCOME_COUNT];
+    double      squareSumList[CHECK_OUTCOME_COUNT];
+    double      outcomeList[CHECK_OUTCOME_COUNT];
+    double      mean;
+    double      variance;
+    double      errorLimit;
+    bool        battleDone;
+    bool        passed = TRUE;
+    bool        outcomePassed;
+    int         i;
+    int         j;
+
+    /* Compute the odds. */
+    if (!OddsCompute(aBattle->soldierEfficiency,
+                     aBattle->targetSoldierEfficiency,
+                     aBattle->soldierCount,
+                     aBattle->targetSoldierCount,
+                     aBattle->targetLand,
+                     &odds))
+    {
+        fprintf(stderr, "empire-check: out of memory\n");
+        exit(1);
+    }
+    oddsList[CHECK_WIN] = odds.winProbability;
+    oddsList[CHECK_LAND] = odds.landCaptured;
+    oddsList[CHECK_SOLDIER_LOSS] = odds.soldierLoss;
+    oddsList[CHECK_TARGET_LOSS] = odds.targetSoldierLoss;
+    scaleList[CHECK_WIN] = 1.0;
+    scaleList[CHECK_LAND] = aBattle->targetLand;
+    scaleList[CHECK_SOLDIER_LOSS] = aBattle->soldierCount;
+    scaleList[CHECK_TARGET_LOSS] = aBattle->targetSoldierCount;
+
+    /* Fight the battles. */
+    memset(sumList, 0, sizeof(sumList));
+    memset(squareSumList, 0, sizeof(squareSumList));
+    for (i = 0; i < battleCount; i++)
+    {
+        memset(&battle, 0, sizeof(battle));
+        battle.soldiersToAttackCount = aBattle->soldierCount;
+        battle.soldierCount = aBattle->soldierCount;
+        battle.soldierEfficiency = aBattle->soldierEfficiency;
+        battle.targetSoldierCount = aBattle->targetSoldierCount;
+        battle.targetSoldierEfficiency = aBattle->targetSoldierEfficiency;
+        battle.targetLand = aBattle->targetLand;
+        battleDone = FALSE;
+        while (!battleDone)
+            battleDone = EngineBattleRound(aGame, &battle);
+
+        outcomeList[CHECK_WIN] = battle.targetDefeated ? 1.0 : 0.0;
+        outcomeList[CHECK_LAND] = battle.landCaptured;
+        outcomeList[CHECK_SOLDIER_LOSS] =
+            aBattle->soldierCount - battle.soldierCount;
+        outcomeList[CHECK_TARGET_LOSS] =
+            aBattle->targetSoldierCount - battle.targetSoldierCount;
+        for (j = 0; j < CHECK_OUTCOME_COUNT; j++)
+        {
+            sumList[j] += outcomeList[j];
+            squareSumList[j] += outcomeList[j] * outcomeList[j];
+        }
+    }
+
+    /* Compare each outcome with the odds. */
+    for (j = 0; j < CHECK_OUTCOME_COUNT; j++)
+    {
+        mean = sumList[j] / battleCount;
+        variance =   (squareSumList[j] - (sumList[j] * mean))
+                   / (battleCount - 1);
+        if (variance < 0.0)
+            variance = 0.0;
+        errorLimit =   (CHECK_SIGMAS * sqrt(variance / battleCount))
+                     + (CHECK_SLACK * scaleList[j]);
+        outcomePassed = (fabs(oddsList[j] - mean) <= errorLimit);
+        if (!outcomePassed)
+            passed = FALSE;
+        printf("%d,%d,%d,%d,%d,%s,%.4f,%.4f,%.4f,%s\n",
+               aBattle->soldierEfficiency,
+               aBattle->targetSoldierEfficiency,
+               aBattle->soldierCount,
+               aBattle->targetSoldierCount,
+               aBattle->targetLand,
+               checkOutcomeNameList[j],
+               oddsList[j],
+               mean,
+               errorLimit,
+               outcomePassed ? "pass" : "FAIL");
+    }
+    fflush(stdout);
+
+    return passed;
+}
@@ -0,0 +1,116 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire nCurses renderer backend.
+ *
+ *   The curses backend copies each frame into stdscr and refreshes it, leaving
+ * nCurses to send the cells that changed.  It drives the terminal of the
+ * process, so only one renderer may use it at a time.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <ncurses.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "render.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static bool CursesOpen(Render *aRender);
+
+static void CursesClose(Render *aRender);
+
+static void CursesPresent(Render *aRender);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ *   Curses renderer backend.  getnstr echoes input lines into stdscr, so the
+ * backend has nothing to do for them.
+ */
+
+const RenderBackend renderCursesBackend =
+{
+    .name = "curses",
+    .open = CursesOpen,
+    .close = CursesClose,
+    .present = CursesPresent,
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal curses backend functions.
+ */
+
+/*
+ * Start nCurses for the renderer specified by aRender.
+ *
+ *   aRender                Renderer.
+ */
+
+static bool CursesOpen(Render *aRender)
+{
+    /* Initialize the screen. */
+    if (initscr() == NULL)
+        return FALSE;
+
+    /* Resize the window to 16x64 and set it to scroll. */
+    wresize(stdscr, RENDER_LINE_COUNT, RENDER_COLUMN_COUNT);
+    scrollok(stdscr, TRUE);
+
+    return TRUE;
+}
+
+
+/*
+ * End nCurses for the renderer specified by aRender.
+ *
+ *   aRender                Renderer.
+ */
+
+static void CursesClose(Render *aRender)
+{
+    endwin();
+}
+
+
+/*
+ *   Present the screen of the renderer specified by aRender by copying it into
+ * stdscr and refreshing.  The lines are copied as characters so that filling
+ * the last line does not scroll the window.
+ *
+ *   aRender                Renderer.
+ */
+
+static void CursesPresent(Render *aRender)
+{
+    chtype line[RENDER_COLUMN_COUNT];
+    int    x;
+    int    y;
+
+    for (y = 0; y < RENDER_LINE_COUNT; y++)
+    {
+        for (x = 0; x < RENDER_COLUMN_COUNT; x++)
+            line[x] = (unsigned char) aRender->lineList[y][x];
+        mvaddchnstr(y, 0, line, RENDER_COLUMN_COUNT);
+    }
+    move(aRender->y, aRender->x);
+    refresh();
+}
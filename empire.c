@@ -13,14 +13,19 @@
 
 /* System includes. */
 #include <ncurses.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
 
 /* Local includes. */
 #include "empire.h"
-#include "grain.h"
-#include "population.h"
+#include "probe.h"
+#include "render.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -28,19 +33,13 @@
  * Prototypes.
  */
 
-static void StartScreen(void);
+static const RenderBackend *FindBackend(const char *aName);
 
-static void GameSetupScreen(void);
+static bool ReadInput(char *aInput, int size);
 
-static void NewYearScreen(void);
+static bool DelayKey(int delay);
 
-static void SummaryScreen(void);
-
-static void PlayHuman(Player *aPlayer);
-
-static void PlayCPU(Player *aPlayer);
-
-static void UpdateCPUPlayerHoldings(Player *aPlayer);
+static void DelayExpired(void *aContext);
 
 
 /*------------------------------------------------------------------------------
@@ -49,93 +48,37 @@ static void UpdateCPUPlayerHoldings(Player *aPlayer);
  */
 
 /*
- * Country  list.
+ * List of renderer backends that may be selected, the first being the default.
  */
 
-Country countryList[COUNTRY_COUNT] =
+static const RenderBackend *backendList[] =
 {
-    /* AUVEYRON. */
-    {
-        .name = "AUVEYRON",
-        .rulerName = "MONTAIGNE",
-        .currency = "FRANCS",
-        .titleList = { "CHEVALIER", "PRINCE", "ROI", "EMPEREUR", },
-    },
-
-    /* BRITTANY. */
-    {
-        .name = "BRITTANY",
-        .rulerName = "ARTHUR",
-        .currency = "FRANCS",
-        .titleList = { "SIR", "PRINCE", "KING", "EMPEROR", },
-    },
-
-    /* BAVARIA. */
-    {
-        .name = "BAVARIA",
-        .rulerName = "MUNSTER",
-        .currency = "MARKS",
-        .titleList = { "RITTER", "PRINZ", "KONIG", "KAISER", },
-    },
-
-    /* QUATARA. */
-    {
-        .name = "QUATARA",
-        .rulerName = "KHOTAN",
-        .currency = "DINARS",
-        .titleList = { "HASID", "CALIPH", "SHEIK", "SHAH", },
-    },
-
-    /* BARCELONA. */
-    {
-        .name = "BARCELONA",
-        .rulerName = "FERDINAND",
-        .currency = "PESETA",
-        .titleList = { "CABALLERO", "PRINCIPE", "REY", "EMPERADORE", },
-    },
-
-    /* SVEALAND. */
-    {
-        .name = "SVEALAND",
-        .rulerName = "HJODOLF",
-        .currency = "KRONA",
-        .titleList = { "RIDDARE", "PRINS", "KUNG", "KEJSARE", },
-    },
+    &renderCursesBackend,
+    &renderAnsiBackend,
+    &renderCaptureBackend,
+    &renderNullBackend,
+    NULL
 };
 
 
 /*
- * Weather list.
+ * Renderer backend in use.
  */
 
-char *weatherList[] =
-{
-    "POOR WEATHER. NO RAIN. LOCUSTS MIGRATE.",
-    "EARLY FROSTS. ARID CONDITIONS.",
-    "FLASH FLOODS. TOO MUCH RAIN.",
-    "AVERAGE WEATHER. GOOD YEAR.",
-    "FINE WEATHER. LONG SUMMER.",
-    "FANTASTIC WEATHER ! GREAT YEAR !",
-};
+static const RenderBackend *backend;
 
 
 /*
- * Game state variables.
+ * Delay state.
  *
- *   playerList             List of players.
- *   playerCount            Count of the number of human players.
- *   year                   Current year.
- *   weather                Weather for year, 1 based.
- *   barbarianLand          Amount of barbarian land in acres.
- *   gameOver               If true, game is over.
+ *   delayMode              Delay mode.
+ *   delayWheel             Timer wheel for delays.
+ *   delayTimer             Timer for the current delay.
  */
 
-Player playerList[COUNTRY_COUNT];
-int playerCount = 0;
-int year = 0;
-int weather;
-int barbarianLand = 6000;
-int gameOver = FALSE;
+static int delayMode = DELAY_WAIT;
+static TimerWheel delayWheel;
+static Timer delayTimer;
 
 
 /*------------------------------------------------------------------------------
@@ -143,64 +86,124 @@ int gameOver = FALSE;
  * Main entry point.
  */
 
-int main(argc, argv)
+int main(int argc, char **argv)
 {
-    Player *player;
-    int     i, j;
+    Session    *session;
+    const char *journalPath;
+    char        input[80];
+    uint64_t    seed;
+    int         countryCount;
+    int         mode;
+    int         result;
+    int         opt;
+    int         fd;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line.  Use the time as the seed if none is given. */
+    seed = time(NULL);
+    countryCount = COUNTRY_COUNT;
+    mode = DELAY_WAIT;
+    backend = backendList[0];
+    journalPath = NULL;
+    while ((opt = getopt(argc, argv, "s:c:fr:j:")) != -1)
+    {
+        switch (opt)
+        {
+            case 's' :
+                seed = strtoull(optarg, NULL, 0);
+                break;
 
-    /* Initialize the screen. */
-    initscr();
+            case 'c' :
+                countryCount = strtol(optarg, NULL, 0);
+                break;
 
-    /* Resize the window to 16x64 and set it to scroll. */
-    wresize(stdscr, 16, 64);
-    scrollok(stdscr, TRUE);
+            case 'f' :
+                mode = DELAY_FAST;
+                break;
 
-    /* Seed the random number generator. */
-    srand(time(NULL));
+            case 'r' :
+                backend = FindBackend(optarg);
+                if (backend == NULL)
+                {
+                    fprintf(stderr,
+                            "%s: unknown renderer %s\n",
+                            argv[0],
+                            optarg);
+                    return 1;
+                }
+                break;
 
-    /* Display the game start screen. */
-    StartScreen();
+            case 'j' :
+                journalPath = optarg;
+                break;
 
-    /* Set up game options. */
-    GameSetupScreen();
+            default :
+                fprintf(stderr,
+                        "usage: %s [-s seed] [-c countries] [-f] "
+                        "[-r curses|ansi|capture|null] [-j journal]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    DelayInit(mode);
 
-    /* Run game until it's over. */
-    while (!gameOver)
+    /* Create the game session. */
+    session = SessionCreate(countryCount, seed);
+    if (session == NULL)
     {
-        /* Start a new year. */
-        NewYearScreen();
-
-        /* Go through each player. */
-        for (i = 0; i < COUNTRY_COUNT; i++)
-        {
-            /* Get player. */
-            player = &(playerList[i]);
+        fprintf(stderr,
+                "%s: can't create a game of %d countries\n",
+                argv[0],
+                countryCount);
+        return 1;
+    }
 
-            /* Skip dead players. */
-            if (player->dead)
-                continue;
+    /* Record the game to a journal if asked to. */
+    if ((journalPath != NULL) && !SessionStartJournal(session, journalPath))
+    {
+        perror(journalPath);
+        SessionDestroy(session);
+        return 1;
+    }
 
-            /* Play as human or CPU. */
-            if (player->human)
-                PlayHuman(player);
-            else
-                PlayCPU(player);
+    /*
+     *   Open the renderer.  nCurses writes to the terminal itself; the other
+     * backends write their frames to stdout.
+     */
+    fd = (backend == &renderCursesBackend) ? -1 : STDOUT_FILENO;
+    if (!RenderOpen(&(session->render), backend, fd))
+    {
+        fprintf(stderr, "%s: can't open %s renderer\n", argv[0], backend->name);
+        SessionDestroy(session);
+        return 1;
+    }
 
-            /* Stop if game over. */
-            if (gameOver)
+    /*
+     *   Run the session until the game is over or input ends, presenting the
+     * screen each time it waits for an input line or a delay.
+     */
+    result = SessionRun(session, NULL);
+    while (result != SESSION_DONE)
+    {
+        RenderPresent(&(session->render));
+        if (result == SESSION_INPUT)
+        {
+            if (!ReadInput(input, sizeof(input)))
                 break;
+            RenderInput(&(session->render), input);
+            result = SessionRun(session, input);
+        }
+        else
+        {
+            Delay(session->delay);
+            result = SessionRun(session, NULL);
         }
-
-        /* Stop if game over. */
-        if (gameOver)
-            break;
-
-        /* Display summary. */
-        SummaryScreen();
     }
 
-    /* End nCurses. */
-    endwin();
+    /* Clean up, which closes the renderer and any journal. */
+    SessionDestroy(session);
 
     return 0;
 }
@@ -208,422 +211,136 @@ int main(argc, argv)
 
 /*------------------------------------------------------------------------------
  *
- * External functions.
+ * External delay functions.
  */
 
 /*
- *   Return a random integer value between 1 and the value specified by range,
- * inclusive (i.e., [1, range]).  If range is 0, return 0.
+ * Initialize delays to use the delay mode specified by mode.
  *
- *   range                  Range of random value.
+ *   mode                   Delay mode.
  */
 
-int RandRange(int range)
+void DelayInit(int mode)
 {
-    return (range > 0) ? (rand() % range) + 1 : 0;
-}
-
-
-/*------------------------------------------------------------------------------
- *
- * Internal functions.
- */
-
-/*
- * Display the game start splash screen.
- */
-
-static void StartScreen(void)
-{
-    /* Clear screen. */
-    clear();
-
-    /* Display splash screen. */
-    move(0, 20);
-    printw("E M P I R E\n");
-    move(7, 0);
-    printw("(ALWAYS HIT <ENTER> TO CONTINUE)");
-    refresh();
-
-    /* Delay. */
-    sleep(DELAY_TIME);
+    delayMode = mode;
+    TimerWheelInit(&delayWheel, TimerNow());
 }
 
 
 /*
- * Set up the game options.
+ *   Delay for the number of milliseconds specified by delay.  How the delay is
+ * made depends upon the delay mode.  When waiting, any key press ends the delay
+ * early.
+ *
+ *   delay                  Delay in milliseconds.
  */
 
-static void GameSetupScreen(void)
+void Delay(int delay)
 {
-    Country *country;
-    Player  *player;
-    char     input[80];
-    int      i, j;
-
-    /* Reset screen. */
-    clear();
-    move(0, 0);
-
-    /* Get the number of players. */
-    do
-    {
-        printw("HOW MANY PEOPLE ARE PLAYING? ");
-        refresh();
-        getnstr(input, sizeof(input));
-        playerCount = strtol(input, NULL, 0);
-    } while (playerCount > COUNTRY_COUNT);
-
-    /* Get the player names. */
-    for (i = 0; i < playerCount; i++)
-    {
-        /* Get the country and player records. */
-        country = &(countryList[i]);
-        player = &(playerList[i]);
-
-        /* Player is human. */
-        player->human = TRUE;
-
-        /* Get the country's ruler's name. */
-        printw("WHO IS THE RULER OF %s? ", country->name);
-        getnstr(player->name, sizeof(player->name));
-        for (j = 0; j < strlen(player->name); j++)
-        {
-            player->name[j] = toupper(player->name[j]);
-        }
-    }
-    for (; i < COUNTRY_COUNT; i++)
-    {
-        /* Get the country and player records. */
-        country = &(countryList[i]);
-        player = &(playerList[i]);
-
-        /* Player is not human. */
-        player->human = FALSE;
-
-        /* Get the country's ruler's name. */
-        snprintf(player->name, sizeof(player->name), "%s", country->rulerName);
-    }
+    /* Fast-forward through delays. */
+    if (delayMode == DELAY_FAST)
+        return;
 
-    /* Initialize the player records. */
-    for (i = 0; i < COUNTRY_COUNT; i++)
+    /* Wait for the delay to end or a key to be pressed. */
+    TimerStart(&delayWheel, &delayTimer, TimerNow(), delay, DelayExpired, NULL);
+    while (TimerRunning(&delayTimer))
     {
-        /* Get the country and player records. */
-        country = &(countryList[i]);
-        player = &(playerList[i]);
-
-        /* Initialize the player's number. */
-        player->number = i + 1;
-
-        /* Initialize the player's country. */
-        player->country = country;
-
-        /* Initialize the player's level and title. */
-        player->level = 0;
-        snprintf(player->title,
-                 sizeof(player->title),
-                 "%s",
-                 country->titleList[player->level]);
-
-        /* Initialize the player's state. */
-        player->dead = FALSE;
-        player->land = 10000;
-        player->grain = 15000 + RandRange(10000);
-        player->treasury = 1000;
-        player->serfCount = 2000;
-        player->soldierCount = 20;
-        player->nobleCount = 1;
-        player->merchantCount = 25;
-        player->armyEfficiency = 15;
-        player->customsTax = 20;
-        player->salesTax = 5;
-        player->incomeTax = 35;
-        player->marketplaceCount = 0;
-        player->grainMillCount = 0;
-        player->foundryCount = 0;
-        player->shipyardCount = 0;
-        player->palaceCount = 0;
-        player->grainForSale = 0;
-        player->grainPrice = 0.0;
+        if (DelayKey(TimerWheelTimeout(&delayWheel, TimerNow())))
+            TimerStop(&delayWheel, &delayTimer);
+        else
+            TimerWheelRun(&delayWheel, TimerNow());
     }
 }
 
 
-/*
- * Start a new year.
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
  */
 
-static void NewYearScreen(void)
-{
-    /* Update year. */
-    year++;
-
-    /* Update weather. */
-    weather = RandRange(ArraySize(weatherList));
-
-    /* Reset screen. */
-    clear();
-    move(0, 0);
-
-    /* Display the year. */
-    printw("YEAR %d\n\n", year);
-
-    /* Display the weather. */
-    printw("%s\n", weatherList[weather - 1]);
-
-    /* Refresh screen. */
-    refresh();
-
-    /* Delay. */
-    sleep(DELAY_TIME);
-}
-
-
 /*
- * Display a summary of all players.
+ *   Return the renderer backend with the name specified by aName, or NULL if
+ * there is none.
+ *
+ *   aName                  Backend name.
  */
 
-static void SummaryScreen(void)
+static const RenderBackend *FindBackend(const char *aName)
 {
-    char     input[80];
-    Player  *player;
-    Country *country;
-    int      i;
-
-    /* Reset screen. */
-    clear();
-    move(0, 0);
-
-    /* Display summary. */
-    printw("SUMMARY\n");
-    printw("NOBLES   SOLDIERS   MERCHANTS   SERFS   LAND    PALACE\n\n");
-    for (i = 0; i < COUNTRY_COUNT; i++)
+    int i;
+
+    for (i = 0; backendList[i] != NULL; i++)
     {
-        /* Get the country and player records. */
-        country = &(countryList[i]);
-        player = &(playerList[i]);
-
-        /* Skip dead players. */
-        if (player->dead)
-            continue;
-
-        /* Display player summary. */
-        printw("%s %s OF %s\n", player->title, player->name, country->name);
-        printw(" %3d       %5d       %5d    %6d   %5d  %3d%%\n",
-               player->nobleCount,
-               player->soldierCount,
-               player->merchantCount,
-               player->serfCount,
-               player->land,
-               10 * player->palaceCount);
+        if (strcmp(backendList[i]->name, aName) == 0)
+            return backendList[i];
     }
 
-    /* Wait for player. */
-    printw("<ENTER>? ");
-    getnstr(input, sizeof(input));
+    return NULL;
 }
 
 
 /*
- * Play the human player specified by aPlayer.
+ *   Read an input line into the buffer specified by aInput of the size
+ * specified by size.  nCurses reads and echoes the line itself; otherwise the
+ * line is read from stdin, which the terminal echoes if there is one.  Return
+ * false if input has ended.
  *
- *   aPlayer                Human player.
+ *   aInput                 Input buffer.
+ *   size                   Size of the input buffer.
  */
 
-static void PlayHuman(Player *aPlayer)
+static bool ReadInput(char *aInput, int size)
 {
-    int i;
+    if (backend == &renderCursesBackend)
+        return getnstr(aInput, size) != ERR;
 
-    /* Show grain screen. */
-    GrainScreen(aPlayer);
+    if (fgets(aInput, size, stdin) == NULL)
+        return FALSE;
+    aInput[strcspn(aInput, "\r\n")] = '\0';
 
-    /* Show population screen. */
-    PopulationScreen(aPlayer);
-
-    /* If all human players have died, end game. */
-    for (i = 0; i < playerCount; i++)
-    {
-        if (!playerList[i].dead)
-            break;
-    }
-    if (i == playerCount)
-    {
-        gameOver = TRUE;
-        return;
-    }
-
-    /* Show investments screen. */
-    InvestmentsScreen(aPlayer);
-
-    /* Show attack screen. */
-    AttackScreen(aPlayer);
+    return TRUE;
 }
 
 
 /*
- * Play the CPU player specified by aPlayer.
+ *   Wait for up to the number of milliseconds specified by delay for a key to
+ * be pressed, and return true if one was.  nCurses reads the key, which skips
+ * it; otherwise the key is left for the next input line.
  *
- *   aPlayer                CPU player.
+ *   delay                  Time in milliseconds to wait.
  */
 
-static void PlayCPU(Player *aPlayer)
+static bool DelayKey(int delay)
 {
-    /* Reset screen. */
-    clear();
-    move(0, 0);
+    struct pollfd pollFd;
+    int           key;
 
-    /* Announce player's turn. */
-    printw("ONE MOMENT -- %s %s'S TURN . . .", aPlayer->title, aPlayer->name);
-    refresh();
-    sleep(DELAY_TIME);
+    if (backend == &renderCursesBackend)
+    {
+        noecho();
+        timeout(delay);
+        key = getch();
+        timeout(-1);
+        echo();
+
+        return key != ERR;
+    }
+
+    pollFd.fd = STDIN_FILENO;
+    pollFd.events = POLLIN;
 
-    /* Update CPU player holdings. */
-    UpdateCPUPlayerHoldings(aPlayer);
+    return poll(&pollFd, 1, delay) > 0;
 }
 
 
 /*
- * Update the holdings of the CPU player specified by aPlayer.
+ * Handle expiry of the delay timer.  Nothing needs to be done; the timer is no
+ * longer running once it expires.
  *
- *   aPlayer                CPU player.
+ *   aContext               Unused.
  */
 
-static void UpdateCPUPlayerHoldings(Player *aPlayer)
+static void DelayExpired(void *aContext)
 {
-    Player *humanPlayer;
-    int     cpuSerfCount = 0;
-    int     cpuGrainForSale = 0;
-    float   cpuGrainPrice = 0.0;
-    int     cpuTreasury = 0;
-    int     cpuMerchantCount = 0;
-    int     cpuMarketplaceCount = 0;
-    int     cpuGrainMillCount = 0;
-    int     cpuFoundryCount = 0;
-    int     cpuShipyardCount = 0;
-    int     cpuPalaceCount = 0;
-    int     cpuNobleCount = 0;
-    int     cpuArmyEfficiency = 0;
-    int     livingHumanPlayerCount = 0;
-    int     i;
-
-    /*
-     * Determine the average human player holdings.  If there are no human
-     * players, treat the first living player as a human player.
-     */
-    for (i = 0; (i < playerCount) || (livingHumanPlayerCount == 0); i++)
-    {
-        /* Get the player record. */
-        humanPlayer = &(playerList[i]);
-
-        /* Skip dead players. */
-        if (humanPlayer->dead)
-            continue;
-
-        /* Increment total human player holdings. */
-        livingHumanPlayerCount++;
-        cpuSerfCount += humanPlayer->serfCount;
-        cpuGrainForSale += humanPlayer->grainForSale;
-        cpuGrainPrice += humanPlayer->grainPrice;
-        cpuTreasury += humanPlayer->treasury;
-        cpuMerchantCount += humanPlayer->merchantCount;
-        cpuMarketplaceCount += humanPlayer->marketplaceCount;
-        cpuGrainMillCount += humanPlayer->grainMillCount;
-        cpuFoundryCount += humanPlayer->foundryCount;
-        cpuShipyardCount += humanPlayer->shipyardCount;
-        cpuPalaceCount += humanPlayer->palaceCount;
-        cpuNobleCount += humanPlayer->nobleCount;
-        cpuArmyEfficiency += humanPlayer->armyEfficiency;
-    }
-    cpuSerfCount /= livingHumanPlayerCount;
-    cpuGrainForSale /= livingHumanPlayerCount;
-    cpuGrainPrice /= livingHumanPlayerCount;
-    cpuTreasury /= livingHumanPlayerCount;
-    cpuMerchantCount /= livingHumanPlayerCount;
-    cpuMarketplaceCount /= livingHumanPlayerCount;
-    cpuGrainMillCount /= livingHumanPlayerCount;
-    cpuFoundryCount /= livingHumanPlayerCount;
-    cpuShipyardCount /= livingHumanPlayerCount;
-    cpuPalaceCount /= livingHumanPlayerCount;
-    cpuNobleCount /= livingHumanPlayerCount;
-    cpuArmyEfficiency /= livingHumanPlayerCount;
-
-    /* Update serf count. */
-    cpuSerfCount += RandRange(200) - RandRange(200);
-    aPlayer->serfCount = cpuSerfCount;
-
-    /* Update grain for sale.  Charge more in bad weather. */
-    cpuGrainForSale += RandRange(1000) - RandRange(1000);
-    while (1)
-    {
-        cpuGrainPrice += RandRange(100)/100.0 - RandRange(100)/100.0;
-        if (cpuGrainPrice < 0.0)
-            cpuGrainPrice = 0.0;
-        else
-            break;
-    }
-    if ((cpuGrainForSale > aPlayer->grainForSale) && (RandRange(9) > 6))
-    {
-        aPlayer->grainForSale = cpuGrainForSale;
-        aPlayer->grainPrice = cpuGrainPrice;
-        if (weather < 3)
-            aPlayer->grainPrice += RandRange(100) / 150.0;
-    }
-
-    /* Update treasury. */
-    cpuTreasury += RandRange(1500) - RandRange(1500);
-    aPlayer->treasury = cpuTreasury;
-
-    /* Update merchant count. */
-    cpuMerchantCount += RandRange(25) - RandRange(25);
-    aPlayer->merchantCount = MAX(aPlayer->merchantCount, cpuMerchantCount);
-
-    /* Update marketplace count. */
-    cpuMarketplaceCount += RandRange(4) - RandRange(4);
-    aPlayer->marketplaceCount = MAX(aPlayer->marketplaceCount,
-                                    cpuMarketplaceCount);
-
-    /* Update grain mill count. */
-    cpuGrainMillCount += RandRange(2) - RandRange(2);
-    aPlayer->grainMillCount = MAX(aPlayer->grainMillCount, cpuGrainMillCount);
-
-    /* Update foundry count. */
-    if (RandRange(100) > 30)
-        cpuFoundryCount += RandRange(2) - RandRange(2);
-    aPlayer->foundryCount = MAX(aPlayer->foundryCount, cpuFoundryCount);
-
-    /* Update shipyard count. */
-    if (RandRange(100) > 30)
-        cpuShipyardCount += RandRange(2) - RandRange(2);
-    aPlayer->shipyardCount = MAX(aPlayer->shipyardCount, cpuShipyardCount);
-
-    /* Update palace count. */
-    if ((RandRange(100) > 30) && (RandRange(100) > 50))
-        cpuPalaceCount += RandRange(2) - RandRange(2);
-    aPlayer->palaceCount = MAX(aPlayer->palaceCount, cpuPalaceCount);
-
-    /* Update noble count. */
-    if ((RandRange(100) > 30) && (RandRange(100) > 50))
-        cpuNobleCount += RandRange(2) - RandRange(2);
-    aPlayer->nobleCount = MAX(aPlayer->nobleCount, cpuNobleCount);
-
-    /* Update army efficiency. */
-    aPlayer->armyEfficiency = cpuArmyEfficiency;
-
-    /* Update soldier count. */
-    aPlayer->soldierCount =   (10 * aPlayer->nobleCount)
-                            + RandRange(10 * aPlayer->nobleCount);
-    if (aPlayer->serfCount > 0)
-    {
-        while ((  ((float) aPlayer->soldierCount)
-                / ((float) aPlayer->serfCount)) >
-               ((0.01 * ((float) aPlayer->foundryCount)) + 0.05))
-        {
-            aPlayer->soldierCount /= 2;
-        }
-    }
-    else
-    {
-        aPlayer->soldierCount = 0;
-    }
 }
 
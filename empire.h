@@ -9,24 +9,101 @@
 #ifndef __EMPIRE_H__
 #define __EMPIRE_H__
 
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Local includes. */
+#include "market.h"
+#include "rng.h"
+#include "timer.h"
+
+
 /*------------------------------------------------------------------------------
  *
  * Defs.
  */
 
+/*
+ * Boolean values, if not already defined by nCurses.
+ */
+
+#ifndef TRUE
+#define TRUE                1
+#endif
+#ifndef FALSE
+#define FALSE               0
+#endif
+
+
 /*
  * Game defs.
  *
- *   COUNTRY_COUNT          Count of the number of countries.
+ *   COUNTRY_COUNT          Count of the number of classic countries, and the
+ *                          default number of countries in a game.
+ *   COUNTRY_MAX            Maximum number of countries in a game.
+ *   COUNTRY_NAME_SIZE      Size of a generated country name, including the
+ *                          terminator.
  *   TITLE_COUNT            Count of the number of ruler titles.
- *   DELAY_TIME             Time in seconds to delay.
+ *   WEATHER_COUNT          Count of the number of kinds of weather.
+ *   DELAY_TIME             Time in milliseconds to delay.
+ *   BATTLE_ROUND_TIME      Time in milliseconds to delay each battle round.
  *   SERF_EFFICIENCY        Serf fighting efficiency (10 = 100%).
+ *   PLAYER_NAME_SIZE       Size of a player name, including the terminator.
  */
 
 #define COUNTRY_COUNT       6
+#define COUNTRY_MAX         65535
+#define COUNTRY_NAME_SIZE   24
 #define TITLE_COUNT         4
-#define DELAY_TIME          3
+#define WEATHER_COUNT       6
+#define DELAY_TIME          3000
+#define BATTLE_ROUND_TIME   250
 #define SERF_EFFICIENCY     5
+#define PLAYER_NAME_SIZE    32
+
+
+/*
+ *   Random number streams.  Each part of the game draws from its own stream,
+ * seeded from the game seed, so drawing more or fewer numbers in one part
+ * does not shift the numbers drawn in the others.
+ *
+ *   STREAM_WEATHER         Weather.
+ *   STREAM_HARVEST         Starting grain, rats, and harvests.
+ *   STREAM_POPULATION      Births, deaths, migration, and people gained with
+ *                          investments.
+ *   STREAM_REVENUE         Revenues.
+ *   STREAM_BATTLE          Battles and sacking.
+ *   STREAM_DEATH           Deaths of rulers.
+ *   STREAM_CPU             CPU player turns.
+ *   STREAM_COUNT           Count of the number of streams.
+ */
+
+#define STREAM_WEATHER      0
+#define STREAM_HARVEST      1
+#define STREAM_POPULATION   2
+#define STREAM_REVENUE      3
+#define STREAM_BATTLE       4
+#define STREAM_DEATH        5
+#define STREAM_CPU          6
+#define STREAM_COUNT        7
+
+
+/*
+ * Delay modes.
+ *
+ *   DELAY_WAIT             Wait for delays to end or for a key to skip them.
+ *   DELAY_FAST             Fast-forward through delays without waiting.
+ */
+
+#define DELAY_WAIT          0
+#define DELAY_FAST          1
 
 
 /*------------------------------------------------------------------------------
@@ -45,104 +122,106 @@
 
 typedef struct
 {
-    char                    name[80];
-    char                    rulerName[80];
-    char                    currency[80];
-    char                    titleList[TITLE_COUNT][80];
+    const char             *name;
+    const char             *rulerName;
+    const char             *currency;
+    const char             *titleList[TITLE_COUNT];
 } Country;
 
 
 /*
- * This structure contains fields for a player record.
+ *   This structure contains fields for a player record.  The record holds only
+ * numeric state and fits in two cache lines: the first holds the state that
+ * carries over from year to year and the second the state that is recomputed
+ * each year.  The country is given by the player number, the title by the
+ * country and level, and the name by the game's name table; use PlayerCountry,
+ * PlayerTitle, and PlayerName to get them.
  *
- *   name                   Player name.
- *   number                 Player number.
- *   country                Player country.
- *   level                  Player level.
- *   title                  Player title.
- *   human                  If true, player is human.
- *   dead                   If true, player is dead.
  *   land                   Land in acres.
  *   grain                  Grain reserves in bushels.
  *   treasury               Currency treasury.
  *   serfCount              Count of number of serfs.
  *   soldierCount           Count of number of soldiers.
- *   soldierRevenue         Revenue from soldiers.
  *   nobleCount             Count of number of nobles.
  *   merchantCount          Count of number of merchants.
- *   immigrated             Number of people who immigrated into country.
- *   armyEfficiency         Efficiency of army.
+ *   marketplaceCount       Count of number of marketplaces.
+ *   grainMillCount         Count of number of grain mills.
+ *   foundryCount           Count of number of foundries.
+ *   shipyardCount          Count of number of shipyards.
+ *   palaceCount            Count of work done on palace.
+ *   grainForSale           Bushels of grain for sale in all of the player's
+ *                          market lots.
+ *   grainPrice             Average price of the grain for sale.
+ *   number                 Player number.
+ *   armyEfficiency         Efficiency of army (5-15).
  *   customsTax             Customs tax.
- *   customsTaxRevenue      Revenue from customs tax.
  *   salesTax               Sales tax.
- *   salesTaxRevenue        Revenue from sales tax.
  *   incomeTax              Income tax.
+ *   level                  Player level.
+ *   human                  If true, player is human.
+ *   dead                   If true, player is dead.
+ *
+ *   soldierRevenue         Revenue from soldiers.
+ *   immigrated             Number of people who immigrated into country.
+ *   customsTaxRevenue      Revenue from customs tax.
+ *   salesTaxRevenue        Revenue from sales tax.
  *   incomeTaxRevenue       Revenue from income tax.
- *   marketplaceCount       Count of number of marketplaces.
  *   marketplaceRevenue     Revenue from marketplaces.
- *   grainMillCount         Count of number of grain mills.
  *   grainMillRevenue       Revenue from grain mills.
- *   foundryCount           Count of number of foundries.
  *   foundryRevenue         Revenue from foundries.
- *   shipyardCount          Count of number of shipyards.
  *   shipyardRevenue        Revenue from shipyards.
- *   palaceCount            Count of work done on palace.
- *   grainForSale           Bushels of grain for sale.
- *   grainPrice             Grain price.
- *   ratPct                 Percent of grain eaten by rats.
  *   grainHarvest           Grain harvest for year.
  *   peopleGrainNeed        How much grain people need for year.
  *   peopleGrainFeed        How much grain to feed people for year.
  *   armyGrainNeed          How much grain army needs for year.
  *   armyGrainFeed          How much grain to feed army for year.
  *   diedStarvation         How many people died of starvation.
+ *   ratPct                 Percent of grain eaten by rats.
  *   attackCount            Count of the number of attacks this year.
  */
 
 typedef struct
 {
-    char                    name[80];
-    int                     number;
-    Country                *country;
-    int                     level;
-    char                    title[80];
-    bool                    human;
-    bool                    dead;
-    int                     land;
-    int                     grain;
-    int                     treasury;
-    int                     serfCount;
-    int                     soldierCount;
-    int                     soldierRevenue;
-    int                     nobleCount;
-    int                     merchantCount;
-    int                     immigrated;
-    int                     armyEfficiency;
-    int                     customsTax;
-    int                     customsTaxRevenue;
-    int                     salesTax;
-    int                     salesTaxRevenue;
-    int                     incomeTax;
-    int                     incomeTaxRevenue;
-    int                     marketplaceCount;
-    int                     marketplaceRevenue;
-    int                     grainMillCount;
-    int                     grainMillRevenue;
-    int                     foundryCount;
-    int                     foundryRevenue;
-    int                     shipyardCount;
-    int                     shipyardRevenue;
-    int                     palaceCount;
-    int                     grainForSale;
+    _Alignas(64) int32_t    land;
+    int32_t                 grain;
+    int32_t                 treasury;
+    int32_t                 serfCount;
+    int32_t                 soldierCount;
+    int32_t                 nobleCount;
+    int32_t                 merchantCount;
+    int32_t                 marketplaceCount;
+    int32_t                 grainMillCount;
+    int32_t                 foundryCount;
+    int32_t                 shipyardCount;
+    int32_t                 palaceCount;
+    int32_t                 grainForSale;
     float                   grainPrice;
-    int                     ratPct;
-    int                     grainHarvest;
-    int                     peopleGrainNeed;
-    int                     peopleGrainFeed;
-    int                     armyGrainNeed;
-    int                     armyGrainFeed;
-    int                     diedStarvation;
-    int                     attackCount;
+    uint16_t                number;
+    uint8_t                 armyEfficiency;
+    uint8_t                 customsTax;
+    uint8_t                 salesTax;
+    uint8_t                 incomeTax;
+    uint8_t                 level;
+    bool                    human : 1;
+    bool                    dead : 1;
+
+    _Alignas(64) int32_t    soldierRevenue;
+    int32_t                 immigrated;
+    int32_t                 customsTaxRevenue;
+    int32_t                 salesTaxRevenue;
+    int32_t                 incomeTaxRevenue;
+    int32_t                 marketplaceRevenue;
+    int32_t                 grainMillRevenue;
+    int32_t                 foundryRevenue;
+    int32_t                 shipyardRevenue;
+    int32_t                 grainHarvest;
+    int32_t                 peopleGrainNeed;
+    int32_t                 peopleGrainFeed;
+    int32_t                 armyGrainNeed;
+    int32_t                 armyGrainFeed;
+    int32_t                 diedStarvation;
+    uint8_t                 ratPct;
+    uint16_t                attackCount;
 } Player;
 
 
@@ -161,8 +240,10 @@ typedef struct
  *   targetSoldierLabel     Label to use to show remaining target soldiers.
  *   targetLand             Acres of land of target.
  *   targetSerfs            If true, target is defending with serfs.
+ *   landCaptured           Acres of land captured.
  *   targetDefeated         If true, target has been defeated.
  *   targetOverrun          If true, target has been overrun.
+ *   targetSacked           If true, target has been sacked.
  */
 
 typedef struct
@@ -181,38 +262,119 @@ typedef struct
     int                     landCaptured;
     bool                    targetDefeated;
     bool                    targetOverrun;
+    bool                    targetSacked;
 } Battle;
 
 
-/*------------------------------------------------------------------------------
- *
- * Globals.
- */
-
 /*
- * Country  list.
+ *   This structure contains the average holdings of the living human players,
+ * which the CPU players follow.  With no living human players, the holdings
+ * are those of the first living player, the leader.
+ *
+ *   valid                  If true, the averages are up to date.
+ *   leader                 Player followed when there are no living human
+ *                          players, or NULL.
+ *   serfCount              Average number of serfs.
+ *   grainForSale           Average amount of grain for sale.
+ *   grainPrice             Average price of grain for sale.
+ *   treasury               Average treasury.
+ *   merchantCount          Average number of merchants.
+ *   marketplaceCount       Average number of marketplaces.
+ *   grainMillCount         Average number of grain mills.
+ *   foundryCount           Average number of foundries.
+ *   shipyardCount          Average number of shipyards.
+ *   palaceCount            Average number of palace parts.
+ *   nobleCount             Average number of nobles.
+ *   armyEfficiency         Average army efficiency.
  */
 
-extern Country countryList[COUNTRY_COUNT];
+typedef struct
+{
+    bool                    valid;
+    const Player           *leader;
+    int                     serfCount;
+    int                     grainForSale;
+    float                   grainPrice;
+    int                     treasury;
+    int                     merchantCount;
+    int                     marketplaceCount;
+    int                     grainMillCount;
+    int                     foundryCount;
+    int                     shipyardCount;
+    int                     palaceCount;
+    int                     nobleCount;
+    int                     armyEfficiency;
+} HumanAverage;
 
 
 /*
- * Game state variables.
+ *   This structure contains all of the state for a game.  Nothing about a game
+ * is kept in globals, so a process may run any number of games at once.  The
+ * number of countries is set when the game is created with EngineCreateGame.
  *
- *   playerList             List of players.
+ *   The live list holds the player list index of each living player, in
+ * player order.  It is compacted at the start of each year, so players that
+ * die during a year stay in it, marked dead, until the next year.
+ *
+ *   playerList             List of players, one per country.
+ *   countryCount           Count of the number of countries.
  *   playerCount            Count of the number of human players.
+ *   liveList               List of living players.
+ *   liveCount              Count of the number of entries in the live list.
+ *   countryList            List of countries.  The first COUNTRY_COUNT are
+ *                          the classic countries; the rest are generated.
+ *   countryNameList        Names of the generated countries.
+ *   sharedCountries        If true, the country lists belong to another game.
  *   year                   Current year.
  *   weather                Weather for year, 1 based.
  *   barbarianLand          Amount of barbarian land in acres.
- *   done                   If true, game is done.
+ *   gameOver               If true, game is over.
+ *   seed                   Random number seed the game was started with.
+ *   rngList                Random number generator of each stream.
+ *   nameList               Name of each player, indexed by player number - 1.
+ *                          An empty name is the country's default ruler name.
+ *   humanAverage           Average human player holdings for the CPU players.
+ *   market                 Grain market.  Sellers are indexed by player
+ *                          number - 1.
+ *   mapping                Snapshot mapping holding the player, live, and
+ *                          name lists, or NULL if they were allocated.
+ *   mappingSize            Size of the snapshot mapping.
  */
 
-extern Player playerList[COUNTRY_COUNT];
-extern int playerCount;
-extern int year;
-extern int weather;
-extern int barbarianLand;
-extern int done;
+typedef struct
+{
+    Player                 *playerList;
+    int                     countryCount;
+    int                     playerCount;
+    int                    *liveList;
+    int                     liveCount;
+    Country                *countryList;
+    char                  (*countryNameList)[COUNTRY_NAME_SIZE];
+    bool                    sharedCountries;
+    int                     year;
+    int                     weather;
+    int                     barbarianLand;
+    bool                    gameOver;
+    uint64_t                seed;
+    Rng                     rngList[STREAM_COUNT];
+    char                  (*nameList)[PLAYER_NAME_SIZE];
+    HumanAverage            humanAverage;
+    Market                 *market;
+    void                   *mapping;
+    size_t                  mappingSize;
+} Game;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ * Weather list.
+ */
+
+extern const char *const weatherList[WEATHER_COUNT];
 
 
 /*------------------------------------------------------------------------------
@@ -220,11 +382,15 @@ extern int done;
  * Prototypes.
  */
 
-int RandRange(int range);
+const Country *PlayerCountry(const Game *aGame, const Player *aPlayer);
+
+const char *PlayerTitle(const Game *aGame, const Player *aPlayer);
+
+const char *PlayerName(const Game *aGame, const Player *aPlayer);
 
-void InvestmentsScreen(Player *aPlayer);
+void DelayInit(int mode);
 
-void AttackScreen(Player *aPlayer);
+void Delay(int delay);
 
 
 /*------------------------------------------------------------------------------
@@ -0,0 +1,2217 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game rules engine source file.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "battle.h"
+#include "engine.h"
+#include "probe.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * The player record must fit in two cache lines.
+ */
+
+_Static_assert(sizeof(Player) == 128, "Player record is not two cache lines");
+
+
+/*
+ * Generated country name defs.
+ *
+ *   COUNTRY_SYLLABLE_COUNT Number of syllables in generated country names.
+ *   COUNTRY_ENDING_COUNT   Number of endings of generated country names.
+ */
+
+#define COUNTRY_SYLLABLE_COUNT 20
+#define COUNTRY_ENDING_COUNT 8
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static Game *AllocateGame(int countryCount);
+
+static void GenerateCountryName(Game *aGame, int index);
+
+static const HumanAverage *HumanAverageGet(Game *aGame);
+
+static void EngineGrainSold(void *aContext, int seller, int grain, float price);
+
+static void Sack(Game *aGame, Player *aTargetPlayer, SackReport *aSackReport);
+
+static uint64_t ChecksumMix(uint64_t checksum, uint64_t value);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ * Classic country list.
+ */
+
+static const Country classicCountryList[COUNTRY_COUNT] =
+{
+    /* AUVEYRON. */
+    {
+        .name = "AUVEYRON",
+        .rulerName = "MONTAIGNE",
+        .currency = "FRANCS",
+        .titleList = { "CHEVALIER", "PRINCE", "ROI", "EMPEREUR", },
+    },
+
+    /* BRITTANY. */
+    {
+        .name = "BRITTANY",
+        .rulerName = "ARTHUR",
+        .currency = "FRANCS",
+        .titleList = { "SIR", "PRINCE", "KING", "EMPEROR", },
+    },
+
+    /* BAVARIA. */
+    {
+        .name = "BAVARIA",
+        .rulerName = "MUNSTER",
+        .currency = "MARKS",
+        .titleList = { "RITTER", "PRINZ", "KONIG", "KAISER", },
+    },
+
+    /* QUATARA. */
+    {
+        .name = "QUATARA",
+        .rulerName = "KHOTAN",
+        .currency = "DINARS",
+        .titleList = { "HASID", "CALIPH", "SHEIK", "SHAH", },
+    },
+
+    /* BARCELONA. */
+    {
+        .name = "BARCELONA",
+        .rulerName = "FERDINAND",
+        .currency = "PESETA",
+        .titleList = { "CABALLERO", "PRINCIPE", "REY", "EMPERADORE", },
+    },
+
+    /* SVEALAND. */
+    {
+        .name = "SVEALAND",
+        .rulerName = "HJODOLF",
+        .currency = "KRONA",
+        .titleList = { "RIDDARE", "PRINS", "KUNG", "KEJSARE", },
+    },
+};
+
+
+/*
+ * Weather list.
+ */
+
+const char *const weatherList[WEATHER_COUNT] =
+{
+    "POOR WEATHER. NO RAIN. LOCUSTS MIGRATE.",
+    "EARLY FROSTS. ARID CONDITIONS.",
+    "FLASH FLOODS. TOO MUCH RAIN.",
+    "AVERAGE WEATHER. GOOD YEAR.",
+    "FINE WEATHER. LONG SUMMER.",
+    "FANTASTIC WEATHER ! GREAT YEAR !",
+};
+
+
+/*
+ *   Syllables and endings from which the names of generated countries are
+ * built.
+ */
+
+static const char *const countrySyllableList[COUNTRY_SYLLABLE_COUNT] =
+{
+    "AL", "BOR", "CAR", "DUN", "EST", "FAL", "GOR", "HAL", "IS", "KAR",
+    "LOM", "MAR", "NOR", "OST", "PEL", "QUAR", "ROS", "SAL", "TOR", "VAL",
+};
+
+static const char *const countryEndingList[COUNTRY_ENDING_COUNT] =
+{
+    "IA", "ONY", "AND", "ARA", "ENZA", "ISTAN", "UND", "OVA",
+};
+
+
+/*
+ * Investment cost list.
+ */
+
+static const int investmentCost[INVESTMENT_COUNT] =
+{
+    1000, 2000, 7000, 8000, 8, 5000,
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ * Return the country of the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+const Country *PlayerCountry(const Game *aGame, const Player *aPlayer)
+{
+    return &(aGame->countryList[aPlayer->number - 1]);
+}
+
+
+/*
+ * Return the title of the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+const char *PlayerTitle(const Game *aGame, const Player *aPlayer)
+{
+    return PlayerCountry(aGame, aPlayer)->titleList[aPlayer->level];
+}
+
+
+/*
+ * Return the name of the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+const char *PlayerName(const Game *aGame, const Player *aPlayer)
+{
+    const char *name;
+
+    name = aGame->nameList[aPlayer->number - 1];
+    if (name[0] == '\0')
+        name = PlayerCountry(aGame, aPlayer)->rulerName;
+
+    return name;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External game functions.
+ */
+
+/*
+ *   Create a game with the number of countries specified by countryCount.  The
+ * first COUNTRY_COUNT countries are the classic countries; the rest are
+ * generated, taking their rulers, currencies, and titles from the classic
+ * countries in turn.  Start the game with EngineNewGame.  Return NULL if the
+ * country count is out of range or memory could not be allocated.
+ *
+ *   countryCount           Number of countries.
+ */
+
+Game *EngineCreateGame(int countryCount)
+{
+    Game *game;
+    int   i;
+
+    /* Validate the country count. */
+    if ((countryCount < 1) || (countryCount > COUNTRY_MAX))
+        return NULL;
+
+    /* Allocate the game and its country lists. */
+    game = AllocateGame(countryCount);
+    if (game == NULL)
+        return NULL;
+    game->countryList = calloc(countryCount, sizeof(Country));
+    if (countryCount > COUNTRY_COUNT)
+    {
+        game->countryNameList = calloc(countryCount - COUNTRY_COUNT,
+                                       sizeof(game->countryNameList[0]));
+    }
+    if (   (game->countryList == NULL)
+        || (   (countryCount > COUNTRY_COUNT)
+            && (game->countryNameList == NULL)))
+    {
+        EngineDestroyGame(game);
+        return NULL;
+    }
+
+    /* Set up the countries. */
+    for (i = 0; i < countryCount; i++)
+    {
+        game->countryList[i] = classicCountryList[i % COUNTRY_COUNT];
+        if (i >= COUNTRY_COUNT)
+            GenerateCountryName(game, i);
+    }
+
+    return game;
+}
+
+
+/*
+ *   Create a game with the countries of the game specified by aGame, sharing
+ * its country lists rather than setting up its own.  Country lists never
+ * change once set up, so many games may share one; aGame must outlive them.
+ * Start the game with EngineNewGame.  Return NULL if memory could not be
+ * allocated.
+ *
+ *   aGame                  Game whose countries to share.
+ */
+
+Game *EngineCreateSharedGame(const Game *aGame)
+{
+    Game *game;
+
+    game = AllocateGame(aGame->countryCount);
+    if (game == NULL)
+        return NULL;
+    game->countryList = aGame->countryList;
+    game->countryNameList = aGame->countryNameList;
+    game->sharedCountries = TRUE;
+
+    return game;
+}
+
+
+/*
+ *   Destroy the game specified by aGame.  A game whose lists are in a snapshot
+ * mapping unmaps it, and a game sharing another's countries leaves them.
+ *
+ *   aGame                  Game to destroy.
+ */
+
+void EngineDestroyGame(Game *aGame)
+{
+    if (aGame == NULL)
+        return;
+
+    if (aGame->mapping != NULL)
+    {
+        munmap(aGame->mapping, aGame->mappingSize);
+    }
+    else
+    {
+        free(aGame->playerList);
+        free(aGame->liveList);
+        free(aGame->nameList);
+    }
+    if (!aGame->sharedCountries)
+    {
+        free(aGame->countryList);
+        free(aGame->countryNameList);
+    }
+    MarketDestroy(aGame->market);
+    free(aGame);
+}
+
+
+/*
+ *   Start a new game with the number of human players specified by humanCount
+ * and the random number seed specified by seed.  The human players are the
+ * first players in the player list.  All players are named after their
+ * country's ruler; front ends may rename the human players with
+ * EngineSetPlayerName.  Games started with the same seed and given the same
+ * decisions play out identically.
+ *
+ *   aGame                  Game.
+ *   humanCount             Number of human players.
+ *   seed                   Random number seed.
+ */
+
+void EngineNewGame(Game *aGame, int humanCount, uint64_t seed)
+{
+    Player *player;
+    Rng    *rng;
+    int     i;
+
+    rng = &(aGame->rngList[STREAM_HARVEST]);
+
+    /* Reset the game state. */
+    memset(aGame->playerList, 0, aGame->countryCount * sizeof(Player));
+    memset(aGame->nameList,
+           0,
+           aGame->countryCount * sizeof(aGame->nameList[0]));
+    memset(&(aGame->humanAverage), 0, sizeof(aGame->humanAverage));
+    aGame->playerCount = humanCount;
+    aGame->liveCount = aGame->countryCount;
+    aGame->year = 0;
+    aGame->weather = 0;
+    aGame->barbarianLand = 6000;
+    aGame->gameOver = FALSE;
+    MarketReset(aGame->market);
+
+    /* Seed each random number stream from the game seed. */
+    EngineSeed(aGame, seed);
+
+    /* Initialize the player records. */
+    for (i = 0; i < aGame->countryCount; i++)
+    {
+        /* Get the player record. */
+        player = &(aGame->playerList[i]);
+        aGame->liveList[i] = i;
+
+        /* Initialize the player's number and level. */
+        player->number = i + 1;
+        player->human = (i < humanCount);
+        player->level = 0;
+
+        /* Initialize the player's state. */
+        player->dead = FALSE;
+        player->land = 10000;
+        player->grain = 15000 + RngRange(rng, 10000);
+        player->treasury = 1000;
+        player->serfCount = 2000;
+        player->soldierCount = 20;
+        player->nobleCount = 1;
+        player->merchantCount = 25;
+        player->armyEfficiency = 15;
+        player->customsTax = 20;
+        player->salesTax = 5;
+        player->incomeTax = 35;
+        player->marketplaceCount = 0;
+        player->grainMillCount = 0;
+        player->foundryCount = 0;
+        player->shipyardCount = 0;
+        player->palaceCount = 0;
+        player->grainForSale = 0;
+        player->grainPrice = 0.0;
+    }
+}
+
+
+/*
+ *   Seed each random number stream of the game specified by aGame from the
+ * random number seed specified by seed, leaving the rest of the game as it is.
+ * EngineNewGame seeds a new game this way; reseeding a game loaded from a
+ * snapshot gives it a different continuation.
+ *
+ *   aGame                  Game.
+ *   seed                   Random number seed.
+ */
+
+void EngineSeed(Game *aGame, uint64_t seed)
+{
+    Rng seedRng;
+    int i;
+
+    aGame->seed = seed;
+    RngSeed(&seedRng, seed);
+    for (i = 0; i < STREAM_COUNT; i++)
+        RngSeed(&(aGame->rngList[i]), RngNext(&seedRng));
+}
+
+
+/*
+ *   Set the name of the player specified by aPlayer to the name specified by
+ * name.  Names longer than PLAYER_NAME_SIZE - 1 are truncated; an empty name
+ * restores the country's default ruler name.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   name                   New name.
+ */
+
+void EngineSetPlayerName(Game *aGame, Player *aPlayer, const char *name)
+{
+    snprintf(aGame->nameList[aPlayer->number - 1],
+             sizeof(aGame->nameList[aPlayer->number - 1]),
+             "%s",
+             name);
+}
+
+
+/*
+ * Start a new year.  Players that died last year are dropped from the live
+ * list.
+ *
+ *   aGame                  Game.
+ */
+
+void EngineNewYear(Game *aGame)
+{
+    ProbeMark  probe;
+    int        liveCount = 0;
+    int        i;
+    Rng       *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_WEATHER]);
+
+    /* Update year. */
+    aGame->year++;
+    aGame->humanAverage.valid = FALSE;
+
+    /*
+     *   Drop the players that died last year from the live list.  Only entries
+     * that move are written, so a live list in a snapshot mapping stays shared
+     * until a player dies.
+     */
+    for (i = 0; i < aGame->liveCount; i++)
+    {
+        if (aGame->playerList[aGame->liveList[i]].dead)
+            continue;
+        if (liveCount != i)
+            aGame->liveList[liveCount] = aGame->liveList[i];
+        liveCount++;
+    }
+    aGame->liveCount = liveCount;
+
+    /* Update weather. */
+    aGame->weather = RngRange(rng, WEATHER_COUNT);
+    ProbeEnd(&probe, PROBE_NEW_YEAR);
+}
+
+
+/*
+ * Return true if all of the human players are dead.
+ *
+ *   aGame                  Game.
+ */
+
+bool EngineHumansDead(Game *aGame)
+{
+    int i;
+
+    for (i = 0; i < aGame->playerCount; i++)
+    {
+        if (!aGame->playerList[i].dead)
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *   Return a checksum of the state of the game specified by aGame.  Games that
+ * have played out identically have the same checksum.  Per-year reports, such
+ * as revenues, are left out; they are recomputed from the rest each year.
+ *
+ *   aGame                  Game.
+ */
+
+uint64_t EngineChecksum(const Game *aGame)
+{
+    const Player *player;
+    uint64_t      checksum = 0;
+    uint32_t      grainPrice;
+    int           i;
+    int           j;
+
+    /* Mix in the game. */
+    checksum = ChecksumMix(checksum, aGame->seed);
+    checksum = ChecksumMix(checksum, aGame->countryCount);
+    checksum = ChecksumMix(checksum, aGame->playerCount);
+    checksum = ChecksumMix(checksum, aGame->year);
+    checksum = ChecksumMix(checksum, aGame->weather);
+    checksum = ChecksumMix(checksum, aGame->barbarianLand);
+    checksum = ChecksumMix(checksum, aGame->gameOver);
+    for (i = 0; i < STREAM_COUNT; i++)
+        checksum = ChecksumMix(checksum, aGame->rngList[i].counter);
+    checksum = ChecksumMix(checksum, aGame->market->version);
+    for (i = 0; i < aGame->liveCount; i++)
+        checksum = ChecksumMix(checksum, aGame->liveList[i]);
+
+    /* Mix in each player's holdings and name. */
+    for (i = 0; i < aGame->countryCount; i++)
+    {
+        player = &(aGame->playerList[i]);
+        memcpy(&grainPrice, &(player->grainPrice), sizeof(grainPrice));
+        checksum = ChecksumMix(checksum, player->land);
+        checksum = ChecksumMix(checksum, player->grain);
+        checksum = ChecksumMix(checksum, player->treasury);
+        checksum = ChecksumMix(checksum, player->serfCount);
+        checksum = ChecksumMix(checksum, player->soldierCount);
+        checksum = ChecksumMix(checksum, player->nobleCount);
+        checksum = ChecksumMix(checksum, player->merchantCount);
+        checksum = ChecksumMix(checksum, player->marketplaceCount);
+        checksum = ChecksumMix(checksum, player->grainMillCount);
+        checksum = ChecksumMix(checksum, player->foundryCount);
+        checksum = ChecksumMix(checksum, player->shipyardCount);
+        checksum = ChecksumMix(checksum, player->palaceCount);
+        checksum = ChecksumMix(checksum, player->grainForSale);
+        checksum = ChecksumMix(checksum, grainPrice);
+        checksum = ChecksumMix(checksum, player->armyEfficiency);
+        checksum = ChecksumMix(checksum, player->customsTax);
+        checksum = ChecksumMix(checksum, player->salesTax);
+        checksum = ChecksumMix(checksum, player->incomeTax);
+        checksum = ChecksumMix(checksum, player->level);
+        checksum = ChecksumMix(checksum, player->dead);
+        for (j = 0; aGame->nameList[i][j] != '\0'; j++)
+            checksum = ChecksumMix(checksum, aGame->nameList[i][j]);
+    }
+
+    return checksum;
+}
+
+
+/*
+ *   Play a complete turn for the player specified by aPlayer using the
+ * decisions specified by aDecision.  The turn follows the same order as the
+ * screens.  Invalid decisions are skipped, except that the grain fed to the
+ * army and people is clamped to the allowed range.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   aDecision              Decisions for the turn.
+ */
+
+void EnginePlayTurn(Game *aGame, Player *aPlayer, const TurnDecision *aDecision)
+{
+    const AttackDecision *attack;
+    Battle                battle;
+    SackReport            sackReport;
+    Player               *targetPlayer;
+    int                   grainToFeed;
+    int                   grainBought;
+    int                   i;
+
+    /* The turn changes the holdings the CPU players follow. */
+    aGame->humanAverage.valid = FALSE;
+
+    /* Harvest grain. */
+    EngineHarvest(aGame, aPlayer);
+
+    /* Trade grain and land. */
+    if (aDecision->landToSell > 0)
+        EngineSellLand(aGame, aPlayer, aDecision->landToSell);
+    if (aDecision->grainToSell > 0)
+    {
+        EngineSellGrain(aGame, aPlayer,
+                        aDecision->grainToSell,
+                        aDecision->grainPrice);
+    }
+    if (aDecision->grainToBuy > 0)
+        EngineBuyGrain(aGame, aPlayer, aDecision->grainToBuy, &grainBought);
+
+    /* Feed country. */
+    grainToFeed = aDecision->armyGrainFeed;
+    if (grainToFeed > aPlayer->grain)
+        grainToFeed = aPlayer->grain;
+    EngineFeedArmy(aGame, aPlayer, grainToFeed);
+    grainToFeed = aDecision->peopleGrainFeed;
+    if (grainToFeed > aPlayer->grain)
+        grainToFeed = aPlayer->grain;
+    if (((float) grainToFeed) < (0.1 * ((float) aPlayer->grain)))
+        grainToFeed = ceil(0.1 * ((float) aPlayer->grain));
+    EngineFeedPeople(aGame, aPlayer, grainToFeed);
+
+    /* Update population and check if player died. */
+    EnginePopulation(aGame, aPlayer, NULL);
+    EnginePlayerDeath(aGame, aPlayer);
+
+    /* If all human players have died, end game. */
+    if (EngineHumansDead(aGame))
+    {
+        aGame->gameOver = TRUE;
+        return;
+    }
+
+    /* Compute revenues, set taxes, and buy investments. */
+    EngineComputeRevenues(aGame, aPlayer);
+    EngineSetTax(aGame, aPlayer, TAX_CUSTOMS, aDecision->customsTax);
+    EngineSetTax(aGame, aPlayer, TAX_SALES, aDecision->salesTax);
+    EngineSetTax(aGame, aPlayer, TAX_INCOME, aDecision->incomeTax);
+    for (i = 0; i < INVESTMENT_COUNT; i++)
+    {
+        if (aDecision->investmentList[i] > 0)
+        {
+            EngineBuyInvestment(aGame,
+                                aPlayer,
+                                i + 1,
+                                aDecision->investmentList[i]);
+        }
+    }
+
+    /* Attack. */
+    aPlayer->attackCount = 0;
+    for (i = 0; (i < aDecision->attackCount) && (i < ENGINE_MAX_ATTACKS); i++)
+    {
+        /* Get the attack target. */
+        attack = &(aDecision->attackList[i]);
+        if (attack->target == 1)
+            targetPlayer = NULL;
+        else if (   (attack->target >= 2)
+                 && (attack->target <= aGame->countryCount + 1))
+        {
+            targetPlayer = &(aGame->playerList[attack->target - 2]);
+        }
+        else
+        {
+            continue;
+        }
+
+        /* Validate the attack. */
+        if (EngineCheckAttack(aGame, aPlayer, targetPlayer) != ENGINE_OK)
+            continue;
+        if (EngineCheckSoldiersToAttack(aGame, aPlayer, attack->soldierCount) !=
+            ENGINE_OK)
+        {
+            continue;
+        }
+
+        /* Battle. */
+        EngineStartBattle(aGame,
+                          &battle,
+                          aPlayer,
+                          targetPlayer,
+                          attack->soldierCount);
+        EngineRunBattle(aGame, &battle);
+        EngineEndBattle(aGame, &battle, &sackReport);
+    }
+}
+
+
+/*
+ *   Update the holdings of the CPU player specified by aPlayer.  CPU players
+ * follow the average human player holdings, which are computed at the first
+ * CPU turn of a year and shared by the rest.  Human players must take their
+ * turns before the CPU players of the same year, as they do in the game.
+ *
+ *   aGame                  Game.
+ *   aPlayer                CPU player.
+ */
+
+void EngineCPUTurn(Game *aGame, Player *aPlayer)
+{
+    const HumanAverage *average;
+    ProbeMark           probe;
+    int                 cpuSerfCount;
+    int                 cpuGrainForSale;
+    float               cpuGrainPrice;
+    int                 cpuTreasury;
+    int                 cpuMerchantCount;
+    int                 cpuMarketplaceCount;
+    int                 cpuGrainMillCount;
+    int                 cpuFoundryCount;
+    int                 cpuShipyardCount;
+    int                 cpuPalaceCount;
+    int                 cpuNobleCount;
+    int                 cpuArmyEfficiency;
+    Rng                *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_CPU]);
+
+    /* Start from the average human player holdings. */
+    average = HumanAverageGet(aGame);
+    cpuSerfCount = average->serfCount;
+    cpuGrainForSale = average->grainForSale;
+    cpuGrainPrice = average->grainPrice;
+    cpuTreasury = average->treasury;
+    cpuMerchantCount = average->merchantCount;
+    cpuMarketplaceCount = average->marketplaceCount;
+    cpuGrainMillCount = average->grainMillCount;
+    cpuFoundryCount = average->foundryCount;
+    cpuShipyardCount = average->shipyardCount;
+    cpuPalaceCount = average->palaceCount;
+    cpuNobleCount = average->nobleCount;
+    cpuArmyEfficiency = average->armyEfficiency;
+
+    /* A leader's holdings change with its own turn. */
+    if (average->leader == aPlayer)
+        aGame->humanAverage.valid = FALSE;
+
+    /* Update serf count. */
+    cpuSerfCount += RngRange(rng, 200) - RngRange(rng, 200);
+    aPlayer->serfCount = cpuSerfCount;
+
+    /* Update grain for sale.  Charge more in bad weather. */
+    cpuGrainForSale += RngRange(rng, 1000) - RngRange(rng, 1000);
+    while (1)
+    {
+        cpuGrainPrice +=   RngRange(rng, 100)/100.0
+                         - RngRange(rng, 100)/100.0;
+        if (cpuGrainPrice < 0.0)
+            cpuGrainPrice = 0.0;
+        else
+            break;
+    }
+    if ((cpuGrainForSale > aPlayer->grainForSale) && (RngRange(rng, 9) > 6))
+    {
+        if (aGame->weather < 3)
+            cpuGrainPrice += RngRange(rng, 100) / 150.0;
+        EngineSetGrainForSale(aGame, aPlayer, cpuGrainForSale, cpuGrainPrice);
+    }
+
+    /* Update treasury. */
+    cpuTreasury += RngRange(rng, 1500) - RngRange(rng, 1500);
+    aPlayer->treasury = cpuTreasury;
+
+    /* Update merchant count. */
+    cpuMerchantCount += RngRange(rng, 25) - RngRange(rng, 25);
+    aPlayer->merchantCount = MAX(aPlayer->merchantCount, cpuMerchantCount);
+
+    /* Update marketplace count. */
+    cpuMarketplaceCount += RngRange(rng, 4) - RngRange(rng, 4);
+    aPlayer->marketplaceCount = MAX(aPlayer->marketplaceCount,
+                                    cpuMarketplaceCount);
+
+    /* Update grain mill count. */
+    cpuGrainMillCount += RngRange(rng, 2) - RngRange(rng, 2);
+    aPlayer->grainMillCount = MAX(aPlayer->grainMillCount, cpuGrainMillCount);
+
+    /* Update foundry count. */
+    if (RngRange(rng, 100) > 30)
+        cpuFoundryCount += RngRange(rng, 2) - RngRange(rng, 2);
+    aPlayer->foundryCount = MAX(aPlayer->foundryCount, cpuFoundryCount);
+
+    /* Update shipyard count. */
+    if (RngRange(rng, 100) > 30)
+        cpuShipyardCount += RngRange(rng, 2) - RngRange(rng, 2);
+    aPlayer->shipyardCount = MAX(aPlayer->shipyardCount, cpuShipyardCount);
+
+    /* Update palace count. */
+    if ((RngRange(rng, 100) > 30) && (RngRange(rng, 100) > 50))
+        cpuPalaceCount += RngRange(rng, 2) - RngRange(rng, 2);
+    aPlayer->palaceCount = MAX(aPlayer->palaceCount, cpuPalaceCount);
+
+    /* Update noble count. */
+    if ((RngRange(rng, 100) > 30) && (RngRange(rng, 100) > 50))
+        cpuNobleCount += RngRange(rng, 2) - RngRange(rng, 2);
+    aPlayer->nobleCount = MAX(aPlayer->nobleCount, cpuNobleCount);
+
+    /* Update army efficiency. */
+    aPlayer->armyEfficiency = cpuArmyEfficiency;
+
+    /* Update soldier count. */
+    aPlayer->soldierCount =   (10 * aPlayer->nobleCount)
+                            + RngRange(rng, 10 * aPlayer->nobleCount);
+    if (aPlayer->serfCount > 0)
+    {
+        while ((  ((float) aPlayer->soldierCount)
+                / ((float) aPlayer->serfCount)) >
+               ((0.01 * ((float) aPlayer->foundryCount)) + 0.05))
+        {
+            aPlayer->soldierCount /= 2;
+        }
+    }
+    else
+    {
+        aPlayer->soldierCount = 0;
+    }
+    ProbeEnd(&probe, PROBE_CPU_TURN);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External grain functions.
+ */
+
+/*
+ *   Harvest grain for the player specified by aPlayer.  Rats eat some of the
+ * grain reserve, the harvest is added to the reserve, and the grain needed by
+ * the people and army is determined.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+void EngineHarvest(Game *aGame, Player *aPlayer)
+{
+    ProbeMark  probe;
+    int        usableLand;
+    Rng       *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_HARVEST]);
+
+    /* Determine what percentage of grain the rats ate. */
+    aPlayer->ratPct = RngRange(rng, 30);
+    aPlayer->grain -= (aPlayer->grain * aPlayer->ratPct) / 100;
+
+    /* Determine the amount of usable land for grain. */
+    usableLand =   aPlayer->land
+                 - aPlayer->serfCount
+                 - (2 * aPlayer->nobleCount)
+                 - aPlayer->palaceCount
+                 - aPlayer->merchantCount
+                 - (2 * aPlayer->soldierCount);
+
+    /* Each bushel of grain in the reserves can be used to seed 3 acres of */
+    /* land.                                                               */
+    if (usableLand > (3 * aPlayer->grain))
+    {
+        usableLand = 3 * aPlayer->grain;
+    }
+
+    /* Each serf can farm 5 acres of land. */
+    if (usableLand > (5 * aPlayer->serfCount))
+    {
+        usableLand = 5 * aPlayer->serfCount;
+    }
+
+    /* Determine the grain harvest. */
+    aPlayer->grainHarvest =   (aGame->weather * usableLand * 0.72)
+                            + RngRange(rng, 500)
+                            - (aPlayer->foundryCount * 500);
+    if (aPlayer->grainHarvest < 0)
+        aPlayer->grainHarvest = 0;
+    aPlayer->grain += aPlayer->grainHarvest;
+
+    /* Determine the amount of grain required by the people. */
+    aPlayer->peopleGrainNeed = 5 * (  aPlayer->serfCount
+                                    + aPlayer->merchantCount
+                                    + (3 * aPlayer->nobleCount));
+
+    /* Determine the amount of grain required by the army. */
+    aPlayer->armyGrainNeed = 8 * aPlayer->soldierCount;
+    ProbeEnd(&probe, PROBE_HARVEST);
+}
+
+
+/*
+ * Check whether the player specified by aPlayer may buy grain from the market.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player buying grain.
+ */
+
+int EngineCheckGrainForSale(Game *aGame, Player *aPlayer)
+{
+    if (!MarketHasLots(aGame->market, -1))
+        return ENGINE_NONE_FOR_SALE;
+    if (!MarketHasLots(aGame->market, aPlayer->number - 1))
+        return ENGINE_OWN_GRAIN;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Buy up to the number of bushels of grain specified by grain from the market
+ * for the player specified by aPlayer, filling the cheapest lots of the other
+ * players first.  Return the bushels bought in aGrainBought.  If the purchase
+ * is cut short, the grain bought so far is kept and the result says why.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player buying grain.
+ *   grain                  Bushels of grain to buy.
+ *   aGrainBought           Returned bushels of grain bought.
+ */
+
+int EngineBuyGrain(Game   *aGame,
+                   Player *aPlayer,
+                   int     grain,
+                   int    *aGrainBought)
+{
+    int buyer = aPlayer->number - 1;
+    int grainBought;
+    int totalPrice;
+    int result;
+
+    /* Validate the purchase. */
+    *aGrainBought = 0;
+    result = EngineCheckGrainForSale(aGame, aPlayer);
+    if (result != ENGINE_OK)
+        return result;
+    if (grain <= 0)
+        return ENGINE_INVALID;
+
+    /* Sweep the market, including the marketplace markup. */
+    grainBought = MarketBuy(aGame->market,
+                            buyer,
+                            grain,
+                            aPlayer->treasury,
+                            0.9,
+                            &totalPrice,
+                            EngineGrainSold,
+                            aGame);
+
+    /* Update player state. */
+    aPlayer->grain += grainBought;
+    aPlayer->treasury -= totalPrice;
+    *aGrainBought = grainBought;
+
+    /* Report why the purchase was cut short. */
+    if (grainBought < grain)
+    {
+        if (MarketHasLots(aGame->market, buyer))
+            return ENGINE_CANNOT_AFFORD;
+        return ENGINE_NOT_ENOUGH_FOR_SALE;
+    }
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Check whether the player specified by aPlayer may put the number of bushels
+ * of grain specified by grainToSell onto the market.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player selling grain.
+ *   grainToSell            Bushels of grain to sell.
+ */
+
+int EngineCheckGrainToSell(Game *aGame, Player *aPlayer, int grainToSell)
+{
+    if (grainToSell > aPlayer->grain)
+        return ENGINE_NOT_ENOUGH_GRAIN;
+    if (grainToSell <= 0)
+        return ENGINE_INVALID;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ * Check whether grain may be sold at the price specified by grainPrice.
+ *
+ *   aGame                  Game.
+ *   grainPrice             Price per bushel.
+ */
+
+int EngineCheckGrainPrice(Game *aGame, float grainPrice)
+{
+    if (grainPrice > 15.0)
+        return ENGINE_PRICE_TOO_HIGH;
+    if (grainPrice <= 0.0)
+        return ENGINE_INVALID;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Put the number of bushels of grain specified by grainToSell onto the market
+ * at the price specified by grainPrice for the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player selling grain.
+ *   grainToSell            Bushels of grain to sell.
+ *   grainPrice             Price per bushel.
+ */
+
+int EngineSellGrain(Game   *aGame,
+                    Player *aPlayer,
+                    int     grainToSell,
+                    float   grainPrice)
+{
+    int result;
+
+    /* Validate the sale. */
+    result = EngineCheckGrainToSell(aGame, aPlayer, grainToSell);
+    if (result != ENGINE_OK)
+        return result;
+    result = EngineCheckGrainPrice(aGame, grainPrice);
+    if (result != ENGINE_OK)
+        return result;
+
+    /* Update the total grain for sale and price. */
+    aPlayer->grainPrice =
+          (  (aPlayer->grainPrice * ((float) aPlayer->grainForSale))
+           + (grainPrice * ((float) grainToSell)))
+        / ((float) (aPlayer->grainForSale + grainToSell));
+    aPlayer->grainForSale += grainToSell;
+    aPlayer->grain -= grainToSell;
+
+    /* Put a new lot up on the market. */
+    MarketPost(aGame->market, aPlayer->number - 1, grainToSell, grainPrice);
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Replace all of the grain the player specified by aPlayer has on the market
+ * with a single lot of the number of bushels specified by grain at the price
+ * specified by grainPrice.  The grain is not taken from the player's stores.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player selling grain.
+ *   grain                  Bushels of grain for sale.
+ *   grainPrice             Price per bushel.
+ */
+
+void EngineSetGrainForSale(Game   *aGame,
+                           Player *aPlayer,
+                           int     grain,
+                           float   grainPrice)
+{
+    MarketCancelSeller(aGame->market, aPlayer->number - 1);
+    if (grain > 0)
+        MarketPost(aGame->market, aPlayer->number - 1, grain, grainPrice);
+    aPlayer->grainForSale = grain;
+    aPlayer->grainPrice = grainPrice;
+}
+
+
+/*
+ *   Sell the number of acres of land specified by landToSell to the barbarians
+ * for the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player selling land.
+ *   landToSell             Acres of land to sell.
+ */
+
+int EngineSellLand(Game *aGame, Player *aPlayer, int landToSell)
+{
+    /* Validate the land to sell. */
+    if (landToSell < 0)
+        return ENGINE_INVALID;
+    if (((float) landToSell) > (0.95 * ((float) aPlayer->land)))
+        return ENGINE_KEEP_LAND;
+
+    /* Update land and treasury. */
+    aPlayer->treasury += 2 * landToSell;
+    aPlayer->land -= landToSell;
+    aGame->barbarianLand += landToSell;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Feed the number of bushels of grain specified by grainToFeed to the army of
+ * the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   grainToFeed            Bushels of grain to feed.
+ */
+
+int EngineFeedArmy(Game *aGame, Player *aPlayer, int grainToFeed)
+{
+    /* Validate the grain to feed. */
+    if (grainToFeed > aPlayer->grain)
+        return ENGINE_NOT_ENOUGH_GRAIN;
+
+    /* Feed army. */
+    aPlayer->grain -= grainToFeed;
+    aPlayer->armyGrainFeed = grainToFeed;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Feed the number of bushels of grain specified by grainToFeed to the people
+ * of the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   grainToFeed            Bushels of grain to feed.
+ */
+
+int EngineFeedPeople(Game *aGame, Player *aPlayer, int grainToFeed)
+{
+    /* Validate the grain to feed. */
+    if (grainToFeed > aPlayer->grain)
+        return ENGINE_NOT_ENOUGH_GRAIN;
+    if (((float) grainToFeed) < (0.1 * ((float) aPlayer->grain)))
+        return ENGINE_MUST_RELEASE;
+
+    /* Feed people. */
+    aPlayer->grain -= grainToFeed;
+    aPlayer->peopleGrainFeed = grainToFeed;
+
+    return ENGINE_OK;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External population functions.
+ */
+
+/*
+ *   Update the population for the player specified by aPlayer.  If aReport is
+ * not NULL, return the population changes in aReport.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   aReport                Population report.
+ */
+
+void EnginePopulation(Game *aGame, Player *aPlayer, PopulationReport *aReport)
+{
+    ProbeMark probe;
+    int population;
+    int populationGain;
+    int born;
+    int immigrated;
+    int merchantsImmigrated;
+    int noblesImmigrated;
+    int diedDisease;
+    int diedMalnutrition;
+    int diedStarvation;
+    int armyDiedStarvation;
+    int armyDeserted;
+    int armyEfficiency;
+    Rng *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_POPULATION]);
+
+    /* Determine the total population. */
+    population =   aPlayer->serfCount
+                 + aPlayer->merchantCount
+                 + aPlayer->nobleCount;
+
+    /* Determine the number of babies born. */
+    born = RngRange(rng, ((int) (((float) population) / 9.5)));
+
+    /* Determine the number of people who died from disease. */
+    diedDisease = RngRange(rng, population / 22);
+
+    /* Determine the number of people who died of starvation and */
+    /* malnutrition.                                             */
+    diedStarvation = 0;
+    diedMalnutrition = 0;
+    if (aPlayer->peopleGrainNeed > (2 * aPlayer->peopleGrainFeed))
+    {
+        diedMalnutrition = RngRange(rng, population/12 + 1);
+        diedStarvation = RngRange(rng, population/16 + 1);
+    }
+    else if (aPlayer->peopleGrainNeed > aPlayer->peopleGrainFeed)
+    {
+        diedMalnutrition = RngRange(rng, population/15 + 1);
+    }
+    aPlayer->diedStarvation = diedStarvation;
+
+    /* Determine the number of people who immigrated. */
+    if (((float) aPlayer->peopleGrainFeed) >
+        (1.5 * ((float) aPlayer->peopleGrainNeed)))
+    {
+        immigrated =
+              ((int) sqrt(aPlayer->peopleGrainFeed - aPlayer->peopleGrainNeed))
+            - RngRange(rng, (int) (1.5 * ((float) aPlayer->customsTax)));
+        if (immigrated > 0)
+            immigrated = RngRange(rng, ((2 * immigrated) + 1));
+        else
+            immigrated = 0;
+    }
+    else
+    {
+        immigrated = 0;
+    }
+    aPlayer->immigrated = immigrated;
+
+    /* Determine the number of merchants and nobles who immigrated. */
+    merchantsImmigrated = 0;
+    noblesImmigrated = 0;
+    if ((immigrated / 5) > 0)
+        merchantsImmigrated = RngRange(rng, immigrated / 5);
+    if ((immigrated / 25) > 0)
+        noblesImmigrated = RngRange(rng, immigrated / 25);
+
+    /* Determine the number of soldiers who died of starvation or deserted. */
+    armyDiedStarvation = 0;
+    armyDeserted = 0;
+    if (aPlayer->armyGrainNeed > (2 * aPlayer->armyGrainFeed))
+    {
+        armyDiedStarvation = RngRange(rng, aPlayer->soldierCount/2 + 1);
+        aPlayer->soldierCount -= armyDiedStarvation;
+        armyDeserted = RngRange(rng, aPlayer->soldierCount / 5);
+        aPlayer->soldierCount -= armyDeserted;
+    }
+
+    /* Determine the army's efficiency.  An army that needs no grain is fully */
+    /* fed.                                                                   */
+    if (aPlayer->armyGrainNeed > 0)
+    {
+        armyEfficiency =   (10 * aPlayer->armyGrainFeed)
+                         / aPlayer->armyGrainNeed;
+    }
+    else
+    {
+        armyEfficiency = 15;
+    }
+    if (armyEfficiency < 5)
+        armyEfficiency = 5;
+    else if (armyEfficiency > 15)
+        armyEfficiency = 15;
+    aPlayer->armyEfficiency = armyEfficiency;
+
+    /* Update population. */
+    populationGain =
+        born + immigrated - diedDisease - diedMalnutrition - diedStarvation;
+    aPlayer->serfCount +=
+        populationGain - merchantsImmigrated - noblesImmigrated;
+    aPlayer->merchantCount += merchantsImmigrated;
+    aPlayer->nobleCount += noblesImmigrated;
+
+    /* Return the population report. */
+    if (aReport != NULL)
+    {
+        aReport->born = born;
+        aReport->diedDisease = diedDisease;
+        aReport->diedMalnutrition = diedMalnutrition;
+        aReport->diedStarvation = diedStarvation;
+        aReport->immigrated = immigrated;
+        aReport->armyDiedStarvation = armyDiedStarvation;
+        aReport->armyDeserted = armyDeserted;
+        aReport->populationGain = populationGain;
+    }
+    ProbeEnd(&probe, PROBE_POPULATION);
+}
+
+
+/*
+ *   Check if any event happened that killed the player specified by aPlayer.
+ * Return the cause of death, or DEATH_NONE if the player did not die.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+int EnginePlayerDeath(Game *aGame, Player *aPlayer)
+{
+    int cause = DEATH_NONE;
+    Rng *rng;
+
+    rng = &(aGame->rngList[STREAM_DEATH]);
+
+    /* If anyone starved to death, their mother might assassinate the ruler. */
+    if ((aPlayer->diedStarvation > 0) &&
+        (RngRange(rng, aPlayer->diedStarvation) > RngRange(rng, 110)))
+    {
+        aPlayer->dead = TRUE;
+        cause = DEATH_STARVED_CHILD;
+    }
+
+    /* Check if the player died for any other reason. */
+    if (RngRange(rng, 100) == 1)
+    {
+        aPlayer->dead = TRUE;
+        switch(RngRange(rng, 4))
+        {
+            case 1 :
+                cause = DEATH_AMBITIOUS_NOBLE;
+                break;
+
+            case 2 :
+                cause = DEATH_FOX_HUNT;
+                break;
+
+            case 3 :
+                cause = DEATH_FOOD_POISONING;
+                break;
+
+            case 4 :
+            default :
+                cause = DEATH_WEAK_HEART;
+                break;
+        }
+    }
+
+    /* A dead player's grain is taken off the market. */
+    if (aPlayer->dead)
+        MarketCancelSeller(aGame->market, aPlayer->number - 1);
+
+    return cause;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External investment functions.
+ */
+
+/*
+ *   Compute revenues for the player specified by aPlayer.
+ *
+ *   The rules have always computed the foundry and shipyard revenues without
+ * storing them, and used the stored ones instead.  Only the random number
+ * drawn for the foundry revenue is kept, so the results are unchanged.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+void EngineComputeRevenues(Game *aGame, Player *aPlayer)
+{
+    ProbeMark  probe;
+    Rng       *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_REVENUE]);
+
+    /* Determine marketplace revenue. */
+    aPlayer->marketplaceRevenue =
+          (  12
+           * (  aPlayer->merchantCount
+              + RngRange(rng, 35)
+              + RngRange(rng, 35))
+           / (aPlayer->salesTax + 1))
+        + 5;
+    aPlayer->marketplaceRevenue *= aPlayer->marketplaceCount;
+    aPlayer->marketplaceRevenue =
+        (int) pow(aPlayer->marketplaceRevenue, 0.9);
+
+    /* Determine grain mill revenue. */
+    aPlayer->grainMillRevenue =
+          ((int) (5.8 * (  (float) aPlayer->grainHarvest
+                         + RngRange(rng, 250))))
+        / (20*aPlayer->incomeTax + 40*aPlayer->salesTax + 150);
+    aPlayer->grainMillRevenue *= aPlayer->grainMillCount;
+    aPlayer->grainMillRevenue = (int) pow(aPlayer->grainMillRevenue, 0.9);
+
+    /* Draw the random number for the foundry revenue. */
+    RngRange(rng, 150);
+
+    /* Determine the army revenue. */
+    aPlayer->soldierRevenue = -8 * aPlayer->soldierCount;
+
+    /* Determine customs tax revenue. */
+    aPlayer->customsTaxRevenue =
+          aPlayer->customsTax
+        * aPlayer->immigrated
+        * (RngRange(rng, 40) + RngRange(rng, 40))
+        / 100;
+
+    /* Determine sales tax revenue. */
+    aPlayer->salesTaxRevenue =
+        (int) pow(  ((int) (1.8 * ((float) aPlayer->merchantCount)))
+                  + 33*aPlayer->marketplaceRevenue
+                  + 17*aPlayer->grainMillRevenue
+                  + 50*aPlayer->foundryRevenue
+                  + 70*aPlayer->shipyardRevenue,
+                  0.85);
+    aPlayer->salesTaxRevenue =
+          aPlayer->salesTax
+        * (  aPlayer->salesTaxRevenue
+           + 5*aPlayer->nobleCount
+           + aPlayer->serfCount)
+        / 100;
+
+    /* Determine income tax revenue. */
+    aPlayer->incomeTaxRevenue =
+          ((int) (1.3 * ((float) aPlayer->serfCount)))
+        + 145*aPlayer->nobleCount
+        + 39*aPlayer->merchantCount
+        + 99*aPlayer->marketplaceCount
+        + 99*aPlayer->grainMillCount
+        + 425*aPlayer->foundryCount
+        + 965*aPlayer->shipyardCount;
+    aPlayer->incomeTaxRevenue =
+        aPlayer->incomeTax * aPlayer->incomeTaxRevenue / 100;
+    aPlayer->incomeTaxRevenue = (int) pow(aPlayer->incomeTaxRevenue, 0.97);
+
+    /* Update treasury. */
+    aPlayer->treasury +=   aPlayer->customsTaxRevenue
+                         + aPlayer->salesTaxRevenue
+                         + aPlayer->incomeTaxRevenue
+                         + aPlayer->marketplaceRevenue
+                         + aPlayer->grainMillRevenue
+                         + aPlayer->foundryRevenue
+                         + aPlayer->shipyardRevenue
+                         + aPlayer->soldierRevenue;
+
+    ProbeEnd(&probe, PROBE_REVENUE);
+}
+
+
+/*
+ *   Set the tax specified by tax to the rate specified by rate for the player
+ * specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   tax                    Tax to set.
+ *   rate                   New tax rate in percent.
+ */
+
+int EngineSetTax(Game *aGame, Player *aPlayer, int tax, int rate)
+{
+    switch (tax)
+    {
+        case TAX_CUSTOMS :
+            if ((rate < 0) || (rate > 50))
+                return ENGINE_INVALID;
+            aPlayer->customsTax = rate;
+            break;
+
+        case TAX_SALES :
+            if ((rate < 0) || (rate > 20))
+                return ENGINE_INVALID;
+            aPlayer->salesTax = rate;
+            break;
+
+        case TAX_INCOME :
+            if ((rate < 0) || (rate > 35))
+                return ENGINE_INVALID;
+            aPlayer->incomeTax = rate;
+            break;
+
+        default :
+            return ENGINE_INVALID;
+    }
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Check whether the investment and investment count specified by investment
+ * and investmentCount are valid for the player specified by aPlayer.  For
+ * example, if the investment cost times the investment count is greater than
+ * the player's treasury, this function returns ENGINE_CANNOT_AFFORD.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   investment             Investment being purchased.
+ *   investmentCount        Number of investments being purchased.
+ */
+
+int EngineValidateInvestment(Game   *aGame,
+                             Player *aPlayer,
+                             int     investment,
+                             int     investmentCount)
+{
+    int totalCost;
+    int totalSoldierCount;
+    int totalPeopleCount;
+
+    /* Validate that the count is a non-negative number. */
+    if (investmentCount < 0)
+        return ENGINE_INVALID;
+
+    /* Validate there's enough in the treasury for the purchase. */
+    totalCost = investmentCount * investmentCost[investment - 1];
+    if (totalCost > aPlayer->treasury)
+        return ENGINE_CANNOT_AFFORD;
+
+    /* Validate that there are enough serfs to train for the purchase. */
+    if (investmentCount > aPlayer->serfCount)
+        return ENGINE_NOT_ENOUGH_SERFS;
+
+    /*
+     * Validate if there are enough foundries and nobles for the new
+     * soldiers.
+     */
+    if (investment == INVESTMENT_SOLDIER)
+    {
+        /*
+         * Determine the total number of soldiers if the investment is made
+         * and the total number of civilians in the country.
+         */
+        totalSoldierCount = aPlayer->soldierCount + investmentCount;
+        totalPeopleCount =   aPlayer->serfCount
+                           + aPlayer->merchantCount
+                           + aPlayer->nobleCount;
+
+        /*
+         * Validate if there are enough foundries and nobles for the new
+         * soldiers.
+         */
+        if ((((float) totalSoldierCount) / ((float) totalPeopleCount)) >
+            (0.05 + 0.015*aPlayer->foundryCount))
+        {
+            return ENGINE_TOO_MANY_TROOPS;
+        }
+        else if (totalSoldierCount > (20 * aPlayer->nobleCount))
+        {
+            return ENGINE_NOT_ENOUGH_NOBLES;
+        }
+    }
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Buy the number of investments specified by investmentCount of the
+ * investment specified by investment for the player specified by aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   investment             Investment being purchased.
+ *   investmentCount        Number of investments being purchased.
+ */
+
+int EngineBuyInvestment(Game   *aGame,
+                        Player *aPlayer,
+                        int     investment,
+                        int     investmentCount)
+{
+    int newPeopleCount;
+    int result;
+    Rng *rng;
+
+    rng = &(aGame->rngList[STREAM_POPULATION]);
+
+    /* Validate the investment. */
+    result = EngineValidateInvestment(aGame,
+                                      aPlayer,
+                                      investment,
+                                      investmentCount);
+    if (result != ENGINE_OK)
+        return result;
+
+    /* Pay for the investment. */
+    aPlayer->treasury -= investmentCount * investmentCost[investment - 1];
+
+    /* Update the investment count. */
+    switch (investment)
+    {
+        case INVESTMENT_MARKETPLACE :
+            /*
+             * Merchants are gained with every marketplace purchase, even if
+             * none are purchased.
+             */
+            aPlayer->marketplaceCount += investmentCount;
+            newPeopleCount = RngRange(rng, 7);
+            aPlayer->merchantCount += newPeopleCount;
+            aPlayer->serfCount -= newPeopleCount;
+            break;
+
+        case INVESTMENT_GRAIN_MILL :
+            aPlayer->grainMillCount += investmentCount;
+            break;
+
+        case INVESTMENT_FOUNDRY :
+            aPlayer->foundryCount += investmentCount;
+            break;
+
+        case INVESTMENT_SHIPYARD :
+            aPlayer->shipyardCount += investmentCount;
+            break;
+
+        case INVESTMENT_SOLDIER :
+            aPlayer->soldierCount += investmentCount;
+            aPlayer->serfCount -= investmentCount;
+            break;
+
+        case INVESTMENT_PALACE :
+            /*
+             * Nobles are gained with every palace purchase, even if none are
+             * purchased.
+             */
+            aPlayer->palaceCount += investmentCount;
+            newPeopleCount = RngRange(rng, 4);
+            aPlayer->nobleCount += newPeopleCount;
+            aPlayer->serfCount -= newPeopleCount;
+            break;
+
+        default :
+            break;
+    }
+
+    return ENGINE_OK;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External attack functions.
+ */
+
+/*
+ * Return the maximum number of attacks per year for the player specified by
+ * aPlayer.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ */
+
+int EngineMaxAttacks(Game *aGame, Player *aPlayer)
+{
+    return (aPlayer->nobleCount / 4) + 1;
+}
+
+
+/*
+ *   Check whether the player specified by aPlayer may attack the player
+ * specified by aTargetPlayer.  If aTargetPlayer is NULL, check attacking the
+ * barbarians.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   aTargetPlayer          Player to attack.
+ */
+
+int EngineCheckAttack(Game *aGame, Player *aPlayer, Player *aTargetPlayer)
+{
+    /* Can't attack self. */
+    if (aTargetPlayer == aPlayer)
+        return ENGINE_ATTACK_SELF;
+
+    /* Can't attack more than the maximum number of times per year. */
+    if (aPlayer->attackCount >= EngineMaxAttacks(aGame, aPlayer))
+        return ENGINE_TOO_MANY_ATTACKS;
+
+    /* Can't attack other players until the third year. */
+    if ((aTargetPlayer != NULL) && (aGame->year < 3))
+        return ENGINE_TREATY;
+
+    /* If attacking the barbarians, make sure they have land. */
+    if ((aTargetPlayer == NULL) && (aGame->barbarianLand == 0))
+        return ENGINE_NO_BARBARIAN_LAND;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Check whether the player specified by aPlayer may attack with the number of
+ * soldiers specified by soldierCount.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   soldierCount           Number of soldiers to send.
+ */
+
+int EngineCheckSoldiersToAttack(Game *aGame, Player *aPlayer, int soldierCount)
+{
+    if (soldierCount > aPlayer->soldierCount)
+        return ENGINE_NOT_ENOUGH_SOLDIERS;
+
+    return ENGINE_OK;
+}
+
+
+/*
+ *   Start the battle specified by aBattle between the player specified by
+ * aPlayer sending the number of soldiers specified by soldierCount and the
+ * player specified by aTargetPlayer.  If aTargetPlayer is NULL, the battle is
+ * with the barbarians.  The battle labels are left empty for front ends to
+ * fill in.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to start.
+ *   aPlayer                Player initiating the battle.
+ *   aTargetPlayer          Player to attack.
+ *   soldierCount           Number of soldiers to send.
+ */
+
+void EngineStartBattle(Game   *aGame,
+                       Battle *aBattle,
+                       Player *aPlayer,
+                       Player *aTargetPlayer,
+                       int     soldierCount)
+{
+    Rng *rng;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /* Initialize the battle information. */
+    memset(aBattle, 0, sizeof(*aBattle));
+
+    /* Set the player battle information. */
+    aBattle->player = aPlayer;
+    aBattle->soldierEfficiency = aPlayer->armyEfficiency;
+    aBattle->soldiersToAttackCount = soldierCount;
+    aBattle->soldierCount = soldierCount;
+
+    /* Set the target battle information. */
+    if (aTargetPlayer != NULL)
+    {
+        aBattle->targetPlayer = aTargetPlayer;
+        aBattle->targetLand = aTargetPlayer->land;
+        if (aTargetPlayer->soldierCount > 0)
+        {
+            aBattle->targetSoldierCount = aTargetPlayer->soldierCount;
+            aBattle->targetSoldierEfficiency = aTargetPlayer->armyEfficiency;
+        }
+        else
+        {
+            aBattle->targetSerfs = TRUE;
+            aBattle->targetSoldierCount = aTargetPlayer->serfCount;
+            aBattle->targetSoldierEfficiency = SERF_EFFICIENCY;
+        }
+    }
+    else
+    {
+        aBattle->targetLand = aGame->barbarianLand;
+        aBattle->targetSoldierCount =
+              RngRange(rng, 3 * RngRange(rng, aBattle->soldierCount))
+            + RngRange(rng, RngRange(rng, 3 * aBattle->soldierCount / 2));
+        aBattle->targetSoldierEfficiency = 9;
+    }
+}
+
+
+/*
+ *   Run one round of the battle specified by aBattle.  Return true if the
+ * battle is done.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to run.
+ */
+
+bool EngineBattleRound(Game *aGame, Battle *aBattle)
+{
+    ProbeMark  probe;
+    int        soldierKillCount;
+    bool       battleDone = FALSE;
+    Rng       *rng;
+
+    ProbeBegin(&probe);
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /*
+     * Determine how many soldiers were killed in this round, who won the
+     * round, and how much land was captured.
+     */
+    soldierKillCount = (aBattle->soldierCount / 15) + 1;
+    if (  RngRange(rng, aBattle->soldierEfficiency)
+        < RngRange(rng, aBattle->targetSoldierEfficiency))
+    {
+        /* Player lost. */
+        aBattle->soldierCount -= soldierKillCount;
+        if (aBattle->soldierCount < 0)
+            aBattle->soldierCount = 0;
+
+        /* Battle is done if all target land has been captured. */
+        if (aBattle->landCaptured >= aBattle->targetLand)
+            battleDone = TRUE;
+    }
+    else
+    {
+        /* Player won. */
+        aBattle->landCaptured +=   RngRange(rng, 26 * soldierKillCount)
+                                 - RngRange(rng, soldierKillCount + 5);
+        if (aBattle->landCaptured < 0)
+            aBattle->landCaptured = 0;
+        else if (aBattle->landCaptured > aBattle->targetLand)
+            aBattle->landCaptured = aBattle->targetLand;
+        aBattle->targetSoldierCount -= soldierKillCount;
+        if (aBattle->targetSoldierCount < 0)
+            aBattle->targetSoldierCount = 0;
+    }
+
+    /* Keep battling until one army is defeated. */
+    if ((aBattle->soldierCount == 0) || (aBattle->targetSoldierCount == 0))
+        battleDone = TRUE;
+
+    /* Update the battle results. */
+    if (battleDone && (aBattle->soldierCount > 0))
+    {
+        aBattle->targetDefeated = TRUE;
+        if (   aBattle->targetSerfs
+            || (aBattle->landCaptured >= aBattle->targetLand))
+        {
+            aBattle->targetOverrun = TRUE;
+        }
+    }
+    ProbeEnd(&probe, PROBE_BATTLE_ROUND);
+
+    return battleDone;
+}
+
+
+/*
+ * Run the battle specified by aBattle to completion.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to run.
+ */
+
+void EngineRunBattle(Game *aGame, Battle *aBattle)
+{
+    ProbeMark probe;
+
+    ProbeBegin(&probe);
+    BattleResolve(aGame, aBattle);
+    ProbeEnd(&probe, PROBE_BATTLE);
+}
+
+
+/*
+ *   End the battle specified by aBattle and update the players.  If the target
+ * player was sacked, return what was sacked in aSackReport.
+ *
+ *   aGame                  Game.
+ *   aBattle                Battle to end.
+ *   aSackReport            Sack report.
+ */
+
+void EngineEndBattle(Game *aGame, Battle *aBattle, SackReport *aSackReport)
+{
+    Player *player;
+    Player *targetPlayer;
+    Rng    *rng;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /* Get battle information. */
+    player = aBattle->player;
+    targetPlayer = aBattle->targetPlayer;
+
+    /* The battle changes the holdings the CPU players follow. */
+    aGame->humanAverage.valid = FALSE;
+
+    /* A defeated player may nevertheless have captured some land. */
+    memset(aSackReport, 0, sizeof(*aSackReport));
+    if (!aBattle->targetDefeated)
+    {
+        if (aBattle->landCaptured > 2)
+            aBattle->landCaptured /= RngRange(rng, 3);
+        else
+            aBattle->landCaptured = 0;
+    }
+
+    /* Check for sacking. */
+    if (   (targetPlayer != NULL)
+        && !aBattle->targetOverrun
+        && (aBattle->landCaptured > (aBattle->targetLand / 3)))
+    {
+        aBattle->targetSacked = TRUE;
+        Sack(aGame, targetPlayer, aSackReport);
+    }
+
+    /* Update soldiers, land, etc. */
+    player->attackCount++;
+    player->soldierCount -=   aBattle->soldiersToAttackCount
+                            - aBattle->soldierCount;
+    if (targetPlayer != NULL)
+    {
+        if (aBattle->targetSerfs)
+            targetPlayer->serfCount = aBattle->targetSoldierCount;
+        else
+            targetPlayer->soldierCount = aBattle->targetSoldierCount;
+    }
+    player->land += aBattle->landCaptured;
+    if (targetPlayer != NULL)
+        targetPlayer->land -= aBattle->landCaptured;
+    else
+        aGame->barbarianLand -= aBattle->landCaptured;
+    if ((targetPlayer != NULL) && aBattle->targetOverrun)
+    {
+        player->serfCount += targetPlayer->serfCount;
+        targetPlayer->dead = TRUE;
+        MarketCancelSeller(aGame->market, targetPlayer->number - 1);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal game functions.
+ */
+
+/*
+ *   Allocate a game with the number of countries specified by countryCount and
+ * all of its lists but the country lists.  Return NULL if memory could not be
+ * allocated.
+ *
+ *   countryCount           Number of countries.
+ */
+
+static Game *AllocateGame(int countryCount)
+{
+    Game *game;
+
+    game = calloc(1, sizeof(Game));
+    if (game == NULL)
+        return NULL;
+    game->countryCount = countryCount;
+    game->playerList = aligned_alloc(_Alignof(Player),
+                                     countryCount * sizeof(Player));
+    game->liveList = calloc(countryCount, sizeof(int));
+    game->nameList = calloc(countryCount, sizeof(game->nameList[0]));
+    game->market = MarketCreate(countryCount);
+    if (   (game->playerList == NULL)
+        || (game->liveList == NULL)
+        || (game->nameList == NULL)
+        || (game->market == NULL))
+    {
+        EngineDestroyGame(game);
+        return NULL;
+    }
+    memset(game->playerList, 0, countryCount * sizeof(Player));
+
+    return game;
+}
+
+
+/*
+ *   Generate the name of the country in the game specified by aGame with the
+ * country list index specified by index.  The name is built from syllables and
+ * an ending chosen by the index, so every game gets the same names.
+ *
+ *   aGame                  Game.
+ *   index                  Country list index.
+ */
+
+static void GenerateCountryName(Game *aGame, int index)
+{
+    const char *syllable;
+    char       *name;
+    int         ending;
+    int         number;
+    int         length = 0;
+    int         i;
+
+    /* Get the name buffer. */
+    name = aGame->countryNameList[index - COUNTRY_COUNT];
+
+    /* Pick the ending and at least two syllables from the index. */
+    number = index - COUNTRY_COUNT;
+    ending = number % COUNTRY_ENDING_COUNT;
+    number /= COUNTRY_ENDING_COUNT;
+    for (i = 0; (i < 2) || (number > 0); i++)
+    {
+        syllable = countrySyllableList[number % COUNTRY_SYLLABLE_COUNT];
+        length += snprintf(name + length,
+                           COUNTRY_NAME_SIZE - length,
+                           "%s",
+                           syllable);
+        number /= COUNTRY_SYLLABLE_COUNT;
+    }
+    snprintf(name + length,
+             COUNTRY_NAME_SIZE - length,
+             "%s",
+             countryEndingList[ending]);
+
+    /* Name the country. */
+    aGame->countryList[index].name = name;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal CPU functions.
+ */
+
+/*
+ *   Return the average holdings of the living human players in the game
+ * specified by aGame, computing them if they're out of date.  If there are no
+ * living human players, return the holdings of the first living player.
+ *
+ *   aGame                  Game.
+ */
+
+static const HumanAverage *HumanAverageGet(Game *aGame)
+{
+    HumanAverage *average = &(aGame->humanAverage);
+    Player       *player;
+    int           livingCount = 0;
+    int           i;
+
+    /* Use the averages if they're up to date. */
+    if (average->valid)
+        return average;
+
+    /*
+     * Total the holdings of the living human players, which are at the head of
+     * the live list.
+     */
+    memset(average, 0, sizeof(*average));
+    for (i = 0;
+         (i < aGame->liveCount) && (aGame->liveList[i] < aGame->playerCount);
+         i++)
+    {
+        /* Get the player record. */
+        player = &(aGame->playerList[aGame->liveList[i]]);
+
+        /* Skip players that died this year. */
+        if (player->dead)
+            continue;
+
+        /* Increment total human player holdings. */
+        livingCount++;
+        average->serfCount += player->serfCount;
+        average->grainForSale += player->grainForSale;
+        average->grainPrice += player->grainPrice;
+        average->treasury += player->treasury;
+        average->merchantCount += player->merchantCount;
+        average->marketplaceCount += player->marketplaceCount;
+        average->grainMillCount += player->grainMillCount;
+        average->foundryCount += player->foundryCount;
+        average->shipyardCount += player->shipyardCount;
+        average->palaceCount += player->palaceCount;
+        average->nobleCount += player->nobleCount;
+        average->armyEfficiency += player->armyEfficiency;
+    }
+
+    /* With no living human players, follow the first living player. */
+    if (livingCount == 0)
+    {
+        for (; i < aGame->liveCount; i++)
+        {
+            player = &(aGame->playerList[aGame->liveList[i]]);
+            if (!player->dead)
+                break;
+        }
+        if (i < aGame->liveCount)
+        {
+            livingCount = 1;
+            average->leader = player;
+            average->serfCount = player->serfCount;
+            average->grainForSale = player->grainForSale;
+            average->grainPrice = player->grainPrice;
+            average->treasury = player->treasury;
+            average->merchantCount = player->merchantCount;
+            average->marketplaceCount = player->marketplaceCount;
+            average->grainMillCount = player->grainMillCount;
+            average->foundryCount = player->foundryCount;
+            average->shipyardCount = player->shipyardCount;
+            average->palaceCount = player->palaceCount;
+            average->nobleCount = player->nobleCount;
+            average->armyEfficiency = player->armyEfficiency;
+        }
+    }
+
+    /* Average the holdings. */
+    if (livingCount > 1)
+    {
+        average->serfCount /= livingCount;
+        average->grainForSale /= livingCount;
+        average->grainPrice /= livingCount;
+        average->treasury /= livingCount;
+        average->merchantCount /= livingCount;
+        average->marketplaceCount /= livingCount;
+        average->grainMillCount /= livingCount;
+        average->foundryCount /= livingCount;
+        average->shipyardCount /= livingCount;
+        average->palaceCount /= livingCount;
+        average->nobleCount /= livingCount;
+        average->armyEfficiency /= livingCount;
+    }
+    average->valid = TRUE;
+
+    return average;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal grain functions.
+ */
+
+/*
+ *   Pay the seller specified by seller in the game specified by aContext for
+ * the number of bushels of grain specified by grain bought from one of its
+ * lots at the price specified by price.
+ *
+ *   aContext               Game.
+ *   seller                 Player list index of the seller.
+ *   grain                  Bushels of grain bought.
+ *   price                  Price per bushel.
+ */
+
+static void EngineGrainSold(void *aContext, int seller, int grain, float price)
+{
+    Game   *game = aContext;
+    Player *player = &(game->playerList[seller]);
+
+    player->treasury += ((float) grain) * price;
+    player->grainForSale -= grain;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal attack functions.
+ */
+
+/*
+ *   Sack the player specified by aTargetPlayer and return what was sacked in
+ * aSackReport.
+ *
+ *   aGame                  Game.
+ *   aTargetPlayer          Player to sack.
+ *   aSackReport            Sack report.
+ */
+
+static void Sack(Game *aGame, Player *aTargetPlayer, SackReport *aSackReport)
+{
+    Rng *rng;
+
+    rng = &(aGame->rngList[STREAM_BATTLE]);
+
+    /* Sack serfs. */
+    if (aTargetPlayer->serfCount > 0)
+    {
+        aSackReport->serfCount = RngRange(rng, aTargetPlayer->serfCount);
+        aTargetPlayer->serfCount -= aSackReport->serfCount;
+    }
+
+    /* Sack marketplaces. */
+    if (aTargetPlayer->marketplaceCount > 0)
+    {
+        aSackReport->marketplaceCount =
+            RngRange(rng, aTargetPlayer->marketplaceCount);
+        aTargetPlayer->marketplaceCount -= aSackReport->marketplaceCount;
+    }
+
+    /* Sack grain. */
+    if (aTargetPlayer->grain > 0)
+    {
+        aSackReport->grain = RngRange(rng, aTargetPlayer->grain);
+        aTargetPlayer->grain -= aSackReport->grain;
+    }
+
+    /* Sack grain mills. */
+    if (aTargetPlayer->grainMillCount > 0)
+    {
+        aSackReport->grainMillCount =
+            RngRange(rng, aTargetPlayer->grainMillCount);
+        aTargetPlayer->grainMillCount -= aSackReport->grainMillCount;
+    }
+
+    /* Sack foundries. */
+    if (aTargetPlayer->foundryCount > 0)
+    {
+        aSackReport->foundryCount =
+            RngRange(rng, aTargetPlayer->foundryCount);
+        aTargetPlayer->foundryCount -= aSackReport->foundryCount;
+    }
+
+    /* Sack shipyards. */
+    if (aTargetPlayer->shipyardCount > 0)
+    {
+        aSackReport->shipyardCount =
+            RngRange(rng, aTargetPlayer->shipyardCount);
+        aTargetPlayer->shipyardCount -= aSackReport->shipyardCount;
+    }
+
+    /* Sack nobles. */
+    if (aTargetPlayer->nobleCount > 2)
+    {
+        aSackReport->nobleCount =
+            RngRange(rng, aTargetPlayer->nobleCount / 2);
+        aTargetPlayer->nobleCount -= aSackReport->nobleCount;
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal checksum functions.
+ */
+
+/*
+ * Return the checksum specified by checksum with the value specified by value
+ * mixed into it.
+ *
+ *   checksum               Checksum.
+ *   value                  Value to mix in.
+ */
+
+static uint64_t ChecksumMix(uint64_t checksum, uint64_t value)
+{
+    checksum = (checksum ^ value) * 0x9e3779b97f4a7c15ULL;
+
+    return checksum ^ (checksum >> 31);
+}
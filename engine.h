@@ -0,0 +1,352 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game rules engine header file.
+ *
+ *   The rules engine contains all of the game rules with no terminal I/O.  The
+ * screens are thin front ends that collect decisions from the player, pass them
+ * to the engine, and display the results.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __ENGINE_H__
+#define __ENGINE_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdint.h>
+
+/* Local includes. */
+#include "empire.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Engine result codes.
+ *
+ *   ENGINE_OK              Decision was applied.
+ *   ENGINE_INVALID         Decision is invalid and should be silently retried.
+ *   ENGINE_NONE_FOR_SALE   No grain is for sale.
+ *   ENGINE_OWN_GRAIN       The only grain for sale is the player's own.
+ *   ENGINE_NOT_ENOUGH_FOR_SALE
+ *                          Not that much grain is for sale.
+ *   ENGINE_CANNOT_AFFORD   Player cannot afford the purchase.
+ *   ENGINE_NOT_ENOUGH_GRAIN
+ *                          Player does not have that much grain.
+ *   ENGINE_PRICE_TOO_HIGH  Grain price is too high.
+ *   ENGINE_KEEP_LAND       Player must keep some land.
+ *   ENGINE_MUST_RELEASE    Player must release at least 10% of grain.
+ *   ENGINE_NOT_ENOUGH_SERFS
+ *                          Player does not have enough serfs to train.
+ *   ENGINE_TOO_MANY_TROOPS Player cannot equip and maintain so many troops.
+ *   ENGINE_NOT_ENOUGH_NOBLES
+ *                          Player does not have enough nobles to lead troops.
+ *   ENGINE_ATTACK_SELF     Player cannot attack themselves.
+ *   ENGINE_TOO_MANY_ATTACKS
+ *                          Player has used up their attacks for the year.
+ *   ENGINE_TREATY          Player cannot attack other players yet.
+ *   ENGINE_NO_BARBARIAN_LAND
+ *                          All barbarian land has been seized.
+ *   ENGINE_NOT_ENOUGH_SOLDIERS
+ *                          Player does not have that many soldiers.
+ */
+
+#define ENGINE_OK                   0
+#define ENGINE_INVALID              1
+#define ENGINE_NONE_FOR_SALE        2
+#define ENGINE_OWN_GRAIN            3
+#define ENGINE_NOT_ENOUGH_FOR_SALE  4
+#define ENGINE_CANNOT_AFFORD        5
+#define ENGINE_NOT_ENOUGH_GRAIN     6
+#define ENGINE_PRICE_TOO_HIGH       7
+#define ENGINE_KEEP_LAND            8
+#define ENGINE_MUST_RELEASE         9
+#define ENGINE_NOT_ENOUGH_SERFS     10
+#define ENGINE_TOO_MANY_TROOPS      11
+#define ENGINE_NOT_ENOUGH_NOBLES    12
+#define ENGINE_ATTACK_SELF          13
+#define ENGINE_TOO_MANY_ATTACKS     14
+#define ENGINE_TREATY               15
+#define ENGINE_NO_BARBARIAN_LAND    16
+#define ENGINE_NOT_ENOUGH_SOLDIERS  17
+
+
+/*
+ * Investment list.
+ */
+
+#define INVESTMENT_MARKETPLACE      1
+#define INVESTMENT_GRAIN_MILL       2
+#define INVESTMENT_FOUNDRY          3
+#define INVESTMENT_SHIPYARD         4
+#define INVESTMENT_SOLDIER          5
+#define INVESTMENT_PALACE           6
+#define INVESTMENT_COUNT            6
+
+
+/*
+ * Tax list.
+ */
+
+#define TAX_CUSTOMS                 1
+#define TAX_SALES                   2
+#define TAX_INCOME                  3
+
+
+/*
+ * Player death causes.
+ */
+
+#define DEATH_NONE                  0
+#define DEATH_STARVED_CHILD         1
+#define DEATH_AMBITIOUS_NOBLE       2
+#define DEATH_FOX_HUNT              3
+#define DEATH_FOOD_POISONING        4
+#define DEATH_WEAK_HEART            5
+
+
+/*
+ * Maximum number of attacks in a turn decision.
+ */
+
+#define ENGINE_MAX_ATTACKS          8
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the results of a population update.
+ *
+ *   born                   Number of babies born.
+ *   diedDisease            Number of people who died of disease.
+ *   diedMalnutrition       Number of people who died of malnutrition.
+ *   diedStarvation         Number of people who starved to death.
+ *   immigrated             Number of people who immigrated.
+ *   armyDiedStarvation     Number of soldiers who starved to death.
+ *   armyDeserted           Number of soldiers who deserted.
+ *   populationGain         Net population gain.
+ */
+
+typedef struct
+{
+    int                     born;
+    int                     diedDisease;
+    int                     diedMalnutrition;
+    int                     diedStarvation;
+    int                     immigrated;
+    int                     armyDiedStarvation;
+    int                     armyDeserted;
+    int                     populationGain;
+} PopulationReport;
+
+
+/*
+ * This structure contains fields for the results of sacking a player.  A count
+ * of zero means nothing of that kind was sacked.
+ *
+ *   serfCount              Number of serfs murdered.
+ *   marketplaceCount       Number of marketplaces destroyed.
+ *   grain                  Bushels of grain burned.
+ *   grainMillCount         Number of grain mills sabotaged.
+ *   foundryCount           Number of foundries leveled.
+ *   shipyardCount          Number of shipyards over-run.
+ *   nobleCount             Number of nobles executed.
+ */
+
+typedef struct
+{
+    int                     serfCount;
+    int                     marketplaceCount;
+    int                     grain;
+    int                     grainMillCount;
+    int                     foundryCount;
+    int                     shipyardCount;
+    int                     nobleCount;
+} SackReport;
+
+
+/*
+ * This structure contains fields for an attack decision.
+ *
+ *   target                 Target to attack as numbered on the attack screen
+ *                          (1 = barbarians, 2 and up = player number + 1).
+ *   soldierCount           Number of soldiers to send.
+ */
+
+typedef struct
+{
+    int                     target;
+    int                     soldierCount;
+} AttackDecision;
+
+
+/*
+ * This structure contains fields for all of the decisions a player makes in a
+ * turn.  Decisions are applied in the same order as the screens; invalid
+ * decisions are skipped.
+ *
+ *   landToSell             Acres of land to sell to the barbarians.
+ *   grainToSell            Bushels of grain to put on the market.
+ *   grainPrice             Price per bushel of grain put on the market.
+ *   grainToBuy             Bushels of grain to buy from the market.
+ *   armyGrainFeed          Bushels of grain to feed the army.
+ *   peopleGrainFeed        Bushels of grain to feed the people.
+ *   customsTax             New customs tax.
+ *   salesTax               New sales tax.
+ *   incomeTax              New income tax.
+ *   investmentList         Number of each investment to buy, indexed by
+ *                          investment - 1.
+ *   attackCount            Number of attacks.
+ *   attackList             List of attacks.
+ */
+
+typedef struct
+{
+    int                     landToSell;
+    int                     grainToSell;
+    float                   grainPrice;
+    int                     grainToBuy;
+    int                     armyGrainFeed;
+    int                     peopleGrainFeed;
+    int                     customsTax;
+    int                     salesTax;
+    int                     incomeTax;
+    int                     investmentList[INVESTMENT_COUNT];
+    int                     attackCount;
+    AttackDecision          attackList[ENGINE_MAX_ATTACKS];
+} TurnDecision;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+/*
+ * Game prototypes.
+ */
+
+Game *EngineCreateGame(int countryCount);
+
+Game *EngineCreateSharedGame(const Game *aGame);
+
+void EngineDestroyGame(Game *aGame);
+
+void EngineNewGame(Game *aGame, int humanCount, uint64_t seed);
+
+void EngineSeed(Game *aGame, uint64_t seed);
+
+void EngineSetPlayerName(Game *aGame, Player *aPlayer, const char *name);
+
+void EngineNewYear(Game *aGame);
+
+bool EngineHumansDead(Game *aGame);
+
+uint64_t EngineChecksum(const Game *aGame);
+
+void EnginePlayTurn(Game               *aGame,
+                    Player             *aPlayer,
+                    const TurnDecision *aDecision);
+
+void EngineCPUTurn(Game *aGame, Player *aPlayer);
+
+
+/*
+ * Grain prototypes.
+ */
+
+void EngineHarvest(Game *aGame, Player *aPlayer);
+
+int EngineCheckGrainForSale(Game *aGame, Player *aPlayer);
+
+int EngineBuyGrain(Game   *aGame,
+                   Player *aPlayer,
+                   int     grain,
+                   int    *aGrainBought);
+
+int EngineCheckGrainToSell(Game *aGame, Player *aPlayer, int grainToSell);
+
+int EngineCheckGrainPrice(Game *aGame, float grainPrice);
+
+int EngineSellGrain(Game   *aGame,
+                    Player *aPlayer,
+                    int     grainToSell,
+                    float   grainPrice);
+
+void EngineSetGrainForSale(Game   *aGame,
+                           Player *aPlayer,
+                           int     grain,
+                           float   grainPrice);
+
+int EngineSellLand(Game *aGame, Player *aPlayer, int landToSell);
+
+int EngineFeedArmy(Game *aGame, Player *aPlayer, int grainToFeed);
+
+int EngineFeedPeople(Game *aGame, Player *aPlayer, int grainToFeed);
+
+
+/*
+ * Population prototypes.
+ */
+
+void EnginePopulation(Game *aGame, Player *aPlayer, PopulationReport *aReport);
+
+int EnginePlayerDeath(Game *aGame, Player *aPlayer);
+
+
+/*
+ * Investment prototypes.
+ */
+
+void EngineComputeRevenues(Game *aGame, Player *aPlayer);
+
+int EngineSetTax(Game *aGame, Player *aPlayer, int tax, int rate);
+
+int EngineValidateInvestment(Game   *aGame,
+                             Player *aPlayer,
+                             int     investment,
+                             int     investmentCount);
+
+int EngineBuyInvestment(Game   *aGame,
+                        Player *aPlayer,
+                        int     investment,
+                        int     investmentCount);
+
+
+/*
+ * Attack prototypes.
+ */
+
+int EngineMaxAttacks(Game *aGame, Player *aPlayer);
+
+int EngineCheckAttack(Game *aGame, Player *aPlayer, Player *aTargetPlayer);
+
+int EngineCheckSoldiersToAttack(Game *aGame, Player *aPlayer, int soldierCount);
+
+void EngineStartBattle(Game   *aGame,
+                       Battle *aBattle,
+                       Player *aPlayer,
+                       Player *aTargetPlayer,
+                       int     soldierCount);
+
+bool EngineBattleRound(Game *aGame, Battle *aBattle);
+
+void EngineRunBattle(Game *aGame, Battle *aBattle);
+
+void EngineEndBattle(Game *aGame, Battle *aBattle, SackReport *aSackReport);
+
+
+#endif /* __ENGINE_H__ */
+
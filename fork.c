@@ -0,0 +1,138 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game forks.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "engine.h"
+#include "fork.h"
+#include "snapshot.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External fork functions.
+ */
+
+/*
+ *   Create a fork of the game specified by aGame at its current position.  The
+ * game is left as it is and may go on being played.  Return NULL on error.
+ *
+ *   aGame                  Game to fork.
+ */
+
+Fork *ForkCreate(const Game *aGame)
+{
+    Fork *fork;
+    void *snapshot;
+
+    /* Allocate the fork record, its country game, and its memory file. */
+    fork = calloc(1, sizeof(Fork));
+    if (fork == NULL)
+        return NULL;
+    fork->size = SnapshotSize(aGame);
+    fork->countryGame = EngineCreateGame(aGame->countryCount);
+    fork->fd = memfd_create("empire-fork", MFD_CLOEXEC);
+    if ((fork->countryGame == NULL) || (fork->fd < 0))
+    {
+        ForkDestroy(fork);
+        return NULL;
+    }
+
+    /* Save a snapshot of the game into the memory file. */
+    snapshot = MAP_FAILED;
+    if (ftruncate(fork->fd, fork->size) == 0)
+    {
+        snapshot = mmap(NULL,
+                        fork->size,
+                        PROT_READ | PROT_WRITE,
+                        MAP_SHARED,
+                        fork->fd,
+                        0);
+    }
+    if (snapshot == MAP_FAILED)
+    {
+        ForkDestroy(fork);
+        return NULL;
+    }
+    SnapshotSave(aGame, snapshot);
+    munmap(snapshot, fork->size);
+
+    return fork;
+}
+
+
+/*
+ *   Create a branch of the fork specified by aFork: a game at the fork's
+ * position that shares the fork's player, live, and name lists until it
+ * changes them.  Destroy it with EngineDestroyGame before destroying the fork.
+ * Return NULL on error.
+ *
+ *   aFork                  Fork.
+ */
+
+Game *ForkBranch(const Fork *aFork)
+{
+    Game *game;
+    void *snapshot;
+
+    /* Create a game and privately map the fork's snapshot. */
+    game = EngineCreateSharedGame(aFork->countryGame);
+    if (game == NULL)
+        return NULL;
+    snapshot = mmap(NULL,
+                    aFork->size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE,
+                    aFork->fd,
+                    0);
+    if (snapshot == MAP_FAILED)
+    {
+        EngineDestroyGame(game);
+        return NULL;
+    }
+
+    /* Load the game from the mapping in place. */
+    if (!SnapshotMap(game, snapshot, aFork->size))
+    {
+        munmap(snapshot, aFork->size);
+        EngineDestroyGame(game);
+        return NULL;
+    }
+
+    return game;
+}
+
+
+/*
+ *   Destroy the fork specified by aFork.  Its branches share its country lists,
+ * so they must be destroyed first.
+ *
+ *   aFork                  Fork to destroy.
+ */
+
+void ForkDestroy(Fork *aFork)
+{
+    if (aFork == NULL)
+        return;
+
+    if (aFork->fd >= 0)
+        close(aFork->fd);
+    EngineDestroyGame(aFork->countryGame);
+    free(aFork);
+}
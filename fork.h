@@ -0,0 +1,66 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game fork header file.
+ *
+ *   A fork holds one position of a game from which any number of branches are
+ * played out.  The position is kept as a snapshot in a memory file, and each
+ * branch is a game whose player, live, and name lists are a private mapping of
+ * that file.  Branches share the snapshot's pages until they write them; a
+ * branch that changes one player copies only the page holding that player's
+ * record.  Branches also share the fork's country lists.  Fanning out many
+ * branches thus costs memory in proportion to what the branches change, plus
+ * each branch's market.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __FORK_H__
+#define __FORK_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stddef.h>
+
+/* Local includes. */
+#include "empire.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a forked game position.
+ *
+ *   fd                     Memory file holding the position's snapshot.
+ *   size                   Size of the snapshot.
+ *   countryGame            Game whose country lists the branches share.
+ */
+
+typedef struct
+{
+    int                     fd;
+    size_t                  size;
+    Game                   *countryGame;
+} Fork;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+Fork *ForkCreate(const Game *aGame);
+
+Game *ForkBranch(const Fork *aFork);
+
+void ForkDestroy(Fork *aFork);
+
+
+#endif /* __FORK_H__ */
@@ -12,12 +12,27 @@
  */
 
 /* System includes. */
-#include <ncurses.h>
 #include <stdlib.h>
 #include <string.h>
 
 /* Local includes. */
 #include "empire.h"
+#include "engine.h"
+#include "grain.h"
+#include "render.h"
+#include "session.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Number of the best grain lots shown on the grain screen.
+ */
+
+#define GRAIN_LOT_DISPLAY_COUNT 6
 
 
 /*------------------------------------------------------------------------------
@@ -25,17 +40,23 @@
  * Prototypes.
  */
 
-static void DrawGrainScreen(Player *aPlayer);
+static void DrawGrainScreen(Game   *aGame,
+                            Player *aPlayer,
+                            Render *aRender);
+
+static void TradeGrainAndLand(Session *aSession, const char *aInput);
+
+static void BuyGrain(Session *aSession, const char *aInput);
 
-static void TradeGrainAndLand(Player *aPlayer);
+static void SellGrain(Session *aSession, const char *aInput);
 
-static void BuyGrain(Player *aPlayer);
+static void SetGrainPrice(Session *aSession, const char *aInput);
 
-static void SellGrain(Player *aPlayer);
+static void SellLand(Session *aSession, const char *aInput);
 
-static void SellLand(Player *aPlayer);
+static void FeedArmy(Session *aSession, const char *aInput);
 
-static void FeedCountry(Player *aPlayer);
+static void FeedPeople(Session *aSession, const char *aInput);
 
 
 /*------------------------------------------------------------------------------
@@ -44,64 +65,140 @@ static void FeedCountry(Player *aPlayer);
  */
 
 /*
- * Manage grain for the player specified by aPlayer.
+ *   Enter the current grain screen state of the session specified by aSession.
+ * The grain screen harvests grain for the player whose turn it is, lets them
+ * trade grain and land, and then feed their country.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
  */
 
-void GrainScreen(Player *aPlayer)
+void GrainScreenEnter(Session *aSession)
 {
-    int usableLand;
-
-    /* Determine what percentage of grain the rats ate. */
-    aPlayer->ratPct = RandRange(30);
-    aPlayer->grain -= (aPlayer->grain * aPlayer->ratPct) / 100;
-
-    /* Determine the amount of usable land for grain. */
-    usableLand =   aPlayer->land
-                 - aPlayer->serfCount
-                 - (2 * aPlayer->nobleCount)
-                 - aPlayer->palaceCount
-                 - aPlayer->merchantCount
-                 - (2 * aPlayer->soldierCount);
-
-    /* Each bushel of grain in the reserves can be used to seed 3 acres of */
-    /* land.                                                               */
-    if (usableLand > (3 * aPlayer->grain))
+    Game   *game;
+    Player *player;
+    Render *render;
+    int     peopleCount;
+
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+    switch (aSession->state)
     {
-        usableLand = 3 * aPlayer->grain;
+        case SESSION_GRAIN :
+            /* Harvest grain. */
+            EngineHarvest(game, player);
+            SessionGoto(aSession, SESSION_GRAIN_MENU);
+            break;
+
+        case SESSION_GRAIN_MENU :
+            /* Draw grain screen and display options. */
+            DrawGrainScreen(game, player, render);
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "1) BUY GRAIN  2) SELL GRAIN  3) SELL LAND? ");
+            break;
+
+        case SESSION_BUY_GRAIN :
+            /* Get the number of bushels to purchase. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "HOW MANY BUSHELS? ");
+            break;
+
+        case SESSION_SELL_GRAIN :
+            /* Get the amount of grain to sell. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "HOW MANY BUSHELS DO YOU WISH TO SELL? ");
+            break;
+
+        case SESSION_GRAIN_PRICE :
+            /* Get the price at which to sell grain. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "WHAT WILL BE THE PRICE PER BUSHEL? ");
+            break;
+
+        case SESSION_SELL_LAND :
+            /* Display the price per acre. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "THE BARBARIANS WILL GIVE YOU 2 %s PER ACRE",
+                        PlayerCountry(game, player)->currency);
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_LAND_TO_SELL);
+            break;
+
+        case SESSION_LAND_TO_SELL :
+            /* Get the number of acres to sell. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "HOW MANY ACRES WILL YOU SELL THEM? ");
+            break;
+
+        case SESSION_FEED_ARMY :
+            /* Get the amount of grain to feed to army. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "HOW MANY BUSHELS WILL YOU GIVE TO YOUR "
+                        "ARMY OF %d MEN? ",
+                        player->soldierCount);
+            break;
+
+        case SESSION_FEED_PEOPLE :
+            /* Get the amount of grain to feed to people. */
+            peopleCount =
+                player->serfCount + player->merchantCount + player->nobleCount;
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "HOW MANY BUSHELS WILL YOU GIVE TO YOUR %d PEOPLE? ",
+                        peopleCount);
+            break;
+
+        default :
+            break;
     }
+}
+
 
-    /* Each serf can farm 5 acres of land. */
-    if (usableLand > (5 * aPlayer->serfCount))
+/*
+ *   Handle the input line specified by aInput for the current grain screen
+ * state of the session specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
+
+void GrainScreenInput(Session *aSession, const char *aInput)
+{
+    switch (aSession->state)
     {
-        usableLand = 5 * aPlayer->serfCount;
-    }
+        case SESSION_GRAIN_MENU :
+            TradeGrainAndLand(aSession, aInput);
+            break;
+
+        case SESSION_BUY_GRAIN :
+            BuyGrain(aSession, aInput);
+            break;
 
-    /* Determine the grain harvest. */
-    aPlayer->grainHarvest =   (weather * usableLand * 0.72)
-                            + RandRange(500)
-                            - (aPlayer->foundryCount * 500);
-    if (aPlayer->grainHarvest < 0)
-        aPlayer->grainHarvest = 0;
-    aPlayer->grain += aPlayer->grainHarvest;
+        case SESSION_SELL_GRAIN :
+            SellGrain(aSession, aInput);
+            break;
 
-    /* Determine the amount of grain required by the people. */
-    aPlayer->peopleGrainNeed = 5 * (  aPlayer->serfCount
-                                    + aPlayer->merchantCount
-                                    + (3 * aPlayer->nobleCount));
+        case SESSION_GRAIN_PRICE :
+            SetGrainPrice(aSession, aInput);
+            break;
 
-    /* Determine the amount of grain required by the army. */
-    aPlayer->armyGrainNeed = 8 * aPlayer->soldierCount;
+        case SESSION_LAND_TO_SELL :
+            SellLand(aSession, aInput);
+            break;
 
-    /* Draw the grain screen. */
-    DrawGrainScreen(aPlayer);
+        case SESSION_FEED_ARMY :
+            FeedArmy(aSession, aInput);
+            break;
 
-    /* Trade grain and land. */
-    TradeGrainAndLand(aPlayer);
+        case SESSION_FEED_PEOPLE :
+            FeedPeople(aSession, aInput);
+            break;
 
-    /* Feed country. */
-    FeedCountry(aPlayer);
+        default :
+            break;
+    }
 }
 
 
@@ -111,407 +208,430 @@ void GrainScreen(Player *aPlayer)
  */
 
 /*
- * Draw the grain screen for the player specified by aPlayer.
+ *   Draw the grain screen for the player specified by aPlayer, reusing the
+ * regions in the renderer specified by aRender that have not changed.
  *
+ *   aGame                  Game.
  *   aPlayer                Player.
+ *   aRender                Renderer.
  */
 
-static void DrawGrainScreen(Player *aPlayer)
+static void DrawGrainScreen(Game   *aGame,
+                            Player *aPlayer,
+                            Render *aRender)
 {
-    Player  *player;
-    Country *country;
-    bool     anyGrainForSale;
-    int      i;
+    const MarketLot *lot;
+    const Country   *country;
+    const Country   *sellerCountry;
+    uint64_t         stamp;
+    int              top;
+    int              lotList[GRAIN_LOT_DISPLAY_COUNT];
+    int              lotCount;
+    int              i;
 
     /* Get the player country. */
-    country = aPlayer->country;
+    country = PlayerCountry(aGame, aPlayer);
 
     /* Reset screen. */
-    clear();
-    move(0, 0);
-
-    /* Display the ruler and country. */
-    printw("%s %s OF %s\n", aPlayer->title, aPlayer->name, country->name);
-
-    /* Display how much grain the rats ate. */
-    printw("RATS ATE %d %% OF THE GRAIN RESERVE\n", aPlayer->ratPct);
-
-    /* Display grain levels and treasury. */
-    printw("GRAIN     GRAIN     PEOPLE     ARMY       ROYAL\n");
-    printw("HARVEST   RESERVE   REQUIRE    REQUIRES   TREASURY\n");
-    printw(" %6d    %6d    %6d     %6d     %6d\n",
-           aPlayer->grainHarvest,
-           aPlayer->grain,
-           aPlayer->peopleGrainNeed,
-           aPlayer->armyGrainNeed,
-           aPlayer->treasury);
-    printw("BUSHELS   BUSHELS   BUSHELS    BUSHELS    %s\n", country->currency);
-
-    /* Display grain for sale. */
-    printw("------GRAIN FOR SALE:\n");
-    printw("                COUNTRY         BUSHELS         PRICE\n");
-    anyGrainForSale = FALSE;
-    for (i = 0; i < COUNTRY_COUNT; i++)
+    RenderErase(aRender);
+    RenderMove(aRender, 0, 0);
+
+    /* Display the ruler, country, and holdings. */
+    stamp = RenderStamp(RENDER_STAMP_INIT, aPlayer->number);
+    stamp = RenderStamp(stamp, aPlayer->level);
+    stamp = RenderStamp(stamp, aPlayer->ratPct);
+    stamp = RenderStamp(stamp, aPlayer->grainHarvest);
+    stamp = RenderStamp(stamp, aPlayer->grain);
+    stamp = RenderStamp(stamp, aPlayer->peopleGrainNeed);
+    stamp = RenderStamp(stamp, aPlayer->armyGrainNeed);
+    stamp = RenderStamp(stamp, aPlayer->treasury);
+    if (!RenderRegionCached(aRender, RENDER_GRAIN_HOLDINGS, stamp))
     {
-        player = &(playerList[i]);
-        if (player->grainForSale > 0)
-        {
-            anyGrainForSale = TRUE;
-            printw(" %d              %-16s %-14d %5.2f\n",
-                   player->number,
-                   player->country->name,
-                   player->grainForSale,
-                   player->grainPrice);
-        }
+        /* Display the ruler and country. */
+        RenderPrint(aRender,
+                    "%s %s OF %s\n",
+                    PlayerTitle(aGame, aPlayer),
+                    PlayerName(aGame, aPlayer),
+                    country->name);
+
+        /* Display how much grain the rats ate. */
+        RenderPrint(aRender,
+                    "RATS ATE %d %% OF THE GRAIN RESERVE\n",
+                    aPlayer->ratPct);
+
+        /* Display grain levels and treasury. */
+        RenderPrint(aRender,
+                    "GRAIN     GRAIN     PEOPLE     ARMY       ROYAL\n");
+        RenderPrint(aRender,
+                    "HARVEST   RESERVE   REQUIRE    REQUIRES   TREASURY\n");
+        RenderPrint(aRender,
+                    " %6d    %6d    %6d     %6d     %6d\n",
+                    aPlayer->grainHarvest,
+                    aPlayer->grain,
+                    aPlayer->peopleGrainNeed,
+                    aPlayer->armyGrainNeed,
+                    aPlayer->treasury);
+        RenderPrint(aRender,
+                    "BUSHELS   BUSHELS   BUSHELS    BUSHELS    %s\n",
+                    country->currency);
+        RenderRegionSave(aRender,
+                         RENDER_GRAIN_HOLDINGS,
+                         stamp,
+                         0,
+                         RenderGetY(aRender));
     }
 
-    /* Display if no grain is for sale. */
-    if (!anyGrainForSale)
+    /* Display the best lots of grain for sale. */
+    top = RenderGetY(aRender);
+    stamp = RenderStamp(RENDER_STAMP_INIT, aGame->market->version);
+    if (!RenderRegionCached(aRender, RENDER_GRAIN_MARKET, stamp))
     {
-        printw("\n\nNO GRAIN FOR SALE . . .\n\n");
-    }
+        RenderPrint(aRender, "------GRAIN FOR SALE:\n");
+        RenderPrint(aRender,
+                    "                COUNTRY         BUSHELS         PRICE\n");
+        lotCount = MarketBestLots(aGame->market,
+                                  lotList,
+                                  GRAIN_LOT_DISPLAY_COUNT);
+        for (i = 0; i < lotCount; i++)
+        {
+            lot = &(aGame->market->lotList[lotList[i]]);
+            sellerCountry =
+                PlayerCountry(aGame, &(aGame->playerList[lot->seller]));
+            RenderPrint(aRender,
+                        " %d              %-16s %-14d %5.2f\n",
+                        lot->seller + 1,
+                        sellerCountry->name,
+                        lot->grain,
+                        lot->price);
+        }
 
-    /* Refresh screen. */
-    refresh();
+        /* Display if no grain is for sale. */
+        if (lotCount == 0)
+        {
+            RenderPrint(aRender, "\n\nNO GRAIN FOR SALE . . .\n\n");
+        }
+        RenderRegionSave(aRender,
+                         RENDER_GRAIN_MARKET,
+                         stamp,
+                         top,
+                         RenderGetY(aRender) - top);
+    }
 }
 
 
 /*
- * Trade grain and land for the player specified by aPlayer.
+ *   Handle the grain and land trading menu choice specified by aInput for the
+ * session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void TradeGrainAndLand(Player *aPlayer)
+static void TradeGrainAndLand(Session *aSession, const char *aInput)
 {
-    char input[80];
-    bool doneTrading;
+    Game   *game;
+    Player *player;
+    Render *render;
 
-    /* Trade grain and land. */
-    doneTrading = FALSE;
-    while (!doneTrading)
-    {
-        /* Draw grain screen. */
-        DrawGrainScreen(aPlayer);
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
 
-        /* Display options. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("1) BUY GRAIN  2) SELL GRAIN  3) SELL LAND? ");
-        getnstr(input, sizeof(input));
+    /* Parse command. */
+    switch (strtol(aInput, NULL, 0))
+    {
+        case 0 :
+            SessionGoto(aSession, SESSION_FEED_ARMY);
+            break;
+
+        case 1 :
+            /* Validate that there is grain to buy. */
+            switch (EngineCheckGrainForSale(game, player))
+            {
+                case ENGINE_NONE_FOR_SALE :
+                    RenderPrint(render, "THERE IS NO GRAIN FOR SALE!");
+                    SessionDelay(aSession, DELAY_TIME);
+                    SessionGoto(aSession, SESSION_GRAIN_MENU);
+                    break;
+
+                case ENGINE_OWN_GRAIN :
+                    RenderPrint(render,
+                                "YOU CANNOT BUY GRAIN THAT YOU HAVE PUT "
+                                "ONTO THE MARKET!");
+                    SessionDelay(aSession, DELAY_TIME);
+                    SessionGoto(aSession, SESSION_GRAIN_MENU);
+                    break;
+
+                default :
+                    SessionGoto(aSession, SESSION_BUY_GRAIN);
+                    break;
+            }
+            break;
+
+        case 2 :
+            SessionGoto(aSession, SESSION_SELL_GRAIN);
+            break;
+
+        case 3 :
+            SessionGoto(aSession, SESSION_SELL_LAND);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_GRAIN_MENU);
+            break;
+    }
+}
 
-        /* Parse command. */
-        switch (strtol(input, NULL, 0))
-        {
-            case 0 :
-                doneTrading = TRUE;
-                break;
 
-            case 1 :
-                BuyGrain(aPlayer);
-                break;
+/*
+ *   Buy the number of bushels of grain specified by aInput for the session
+ * specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
 
-            case 2 :
-                SellGrain(aPlayer);
-                break;
+static void BuyGrain(Session *aSession, const char *aInput)
+{
+    Game   *game;
+    Player *player;
+    Render *render;
+    int     grain;
+    int     grainBought;
 
-            case 3 :
-                SellLand(aPlayer);
-                break;
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
 
-            default :
-                break;
-        }
+    /* Buy the grain at the best prices. */
+    grain = strtol(aInput, NULL, 0);
+    switch (EngineBuyGrain(game, player, grain, &grainBought))
+    {
+        case ENGINE_NOT_ENOUGH_FOR_SALE :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "YOU BOUGHT ALL %d BUSHELS FOR SALE!",
+                        grainBought);
+            SessionDelay(aSession, DELAY_TIME);
+            break;
+
+        case ENGINE_CANNOT_AFFORD :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "%s %s PLEASE RECONSIDER -\n",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render,
+                        "YOU COULD ONLY AFFORD TO BUY %d BUSHELS",
+                        grainBought);
+            SessionDelay(aSession, DELAY_TIME);
+            break;
+
+        default :
+            break;
     }
+    SessionGoto(aSession, SESSION_GRAIN_MENU);
 }
 
 
 /*
- * Buy grain for the player specified by aPlayer.
+ *   Check the number of bushels of grain to sell specified by aInput for the
+ * session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void BuyGrain(Player *aPlayer)
+static void SellGrain(Session *aSession, const char *aInput)
 {
-    Player *seller;
-    int     sellerIndex;
-    int     grain;
-    int     maxGrain;
-    int     totalPrice;
-    char    input[80];
-    bool    validSeller;
-    bool    validGrain;
-
-    /* Get the seller from which to buy grain. */
-    validSeller = FALSE;
-    do
+    Game   *game;
+    Player *player;
+    Render *render;
+    int     grainToSell;
+
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+
+    /* Check the amount of grain to sell, and get the price if it's valid. */
+    grainToSell = strtol(aInput, NULL, 0);
+    switch (EngineCheckGrainToSell(game, player, grainToSell))
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("FROM WHICH COUNTRY  (GIVE #)? ");
-        getnstr(input, sizeof(input));
-        sellerIndex = strtol(input, NULL, 0);
-        if ((sellerIndex >= 0) & (sellerIndex <= COUNTRY_COUNT))
-        {
-            validSeller = TRUE;
-        }
-    } while (!validSeller);
-    if (sellerIndex > 0)
-        seller = &(playerList[sellerIndex - 1]);
-    else
-        seller = NULL;
-
-    /* Validate that the seller has grain for sale. */
-    if ((seller == NULL) || (seller->dead) || (seller->grainForSale == 0))
-    {
-        printw("THAT COUNTRY HAS NONE FOR SALE!");
-        refresh();
-        sleep(DELAY_TIME);
-        return;
+        case ENGINE_OK :
+            aSession->grainToSell = grainToSell;
+            SessionGoto(aSession, SESSION_GRAIN_PRICE);
+            break;
+
+        case ENGINE_NOT_ENOUGH_GRAIN :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "%s %s, PLEASE THINK AGAIN\n",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render, "YOU ONLY HAVE %d BUSHELS.", player->grain);
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_SELL_GRAIN);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_SELL_GRAIN);
+            break;
     }
+}
 
-    /* Cannot buy grain from self. */
-    if (seller == aPlayer)
-    {
-        printw("YOU CANNOT BUY GRAIN THAT YOU HAVE PUT ONTO THE MARKET!");
-        refresh();
-        sleep(DELAY_TIME);
-        return;
-    }
 
-    /* Get the amount of grain to buy. */
-    validGrain = FALSE;
-    maxGrain = (((float) aPlayer->treasury) * 0.9) / seller->grainPrice;
-    do
-    {
-        /* Get the number of bushels to purchase. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY BUSHELS? ");
-        getnstr(input, sizeof(input));
-        grain = strtol(input, NULL, 0);
+/*
+ *   Put the grain being sold onto the market at the price specified by aInput
+ * for the session specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
 
-        /* Compute the total grain purchase price, including marketplace */
-        /* markup.                                                       */
-        totalPrice = (((float) grain) * seller->grainPrice) / 0.9;
+static void SetGrainPrice(Session *aSession, const char *aInput)
+{
+    Game   *game;
+    Render *render;
+    float   grainPrice;
 
-        if (grain > seller->grainForSale)
-        {
-            printw("YOU CAN'T BUY MORE GRAIN THEN THEY ARE SELLING!");
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else if (totalPrice > aPlayer->treasury)
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("%s %s PLEASE RECONSIDER -\n",
-                   aPlayer->title,
-                   aPlayer->name);
-            printw("YOU CAN ONLY AFFORD TO BUY %d BUSHELS", maxGrain);
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else
-        {
-            validGrain = TRUE;
-        }
-    } while (!validGrain);
+    game = aSession->game;
+    render = &(aSession->render);
 
-    /* Update player and seller state. */
-    aPlayer->grain += grain;
-    aPlayer->treasury -= totalPrice;
-    seller->treasury += grain * seller->grainPrice;
-    seller->grainForSale -= grain;
+    /* Check the price, and put the grain onto the market if it's valid. */
+    grainPrice = strtod(aInput, NULL);
+    switch (EngineCheckGrainPrice(game, grainPrice))
+    {
+        case ENGINE_OK :
+            EngineSellGrain(game,
+                            aSession->player,
+                            aSession->grainToSell,
+                            grainPrice);
+            SessionGoto(aSession, SESSION_GRAIN_MENU);
+            break;
+
+        case ENGINE_PRICE_TOO_HIGH :
+            RenderPrint(render,
+                        "BE REASONABLE . . .EVEN GOLD COSTS LESS THAN THAT!");
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_GRAIN_PRICE);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_GRAIN_PRICE);
+            break;
+    }
 }
 
 
 /*
- * Sell grain for the player specified by aPlayer.
+ *   Sell the number of acres of land specified by aInput for the session
+ * specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void SellGrain(Player *aPlayer)
+static void SellLand(Session *aSession, const char *aInput)
 {
-    int   grainToSell;
-    float grainPrice;
-    char  input[80];
-    bool  validGrainToSell;
-    bool  validGrainPrice;
-
-    /* Get the amount of grain to sell. */
-    validGrainToSell = FALSE;
-    do
-    {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY BUSHELS DO YOU WISH TO SELL? ");
-        getnstr(input, sizeof(input));
-        grainToSell = strtol(input, NULL, 0);
-        if (grainToSell > aPlayer->grain)
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("%s %s, PLEASE THINK AGAIN\n",
-                   aPlayer->title,
-                   aPlayer->name);
-            printw("YOU ONLY HAVE %d BUSHELS.", aPlayer->grain);
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else if (grainToSell > 0)
-        {
-            validGrainToSell = TRUE;
-        }
-    } while (!validGrainToSell);
+    Render *render;
+    int     landToSell;
+
+    render = &(aSession->render);
 
-    /* Get the price at which to sell grain. */
-    validGrainPrice = FALSE;
-    do
+    /* Sell land, offering the price again if it can't be sold. */
+    landToSell = strtol(aInput, NULL, 0);
+    switch (EngineSellLand(aSession->game, aSession->player, landToSell))
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("WHAT WILL BE THE PRICE PER BUSHEL? ");
-        getnstr(input, sizeof(input));
-        grainPrice = strtod(input, NULL);
-        if (grainPrice > 15.0)
-        {
-            printw("BE REASONABLE . . .EVEN GOLD COSTS LESS THAN THAT!");
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else if (grainPrice > 0.0)
-        {
-            validGrainPrice = TRUE;
-        }
-    } while (!validGrainPrice);
-
-    /* Update the total grain for sale and price. */
-    aPlayer->grainPrice =
-          (  (aPlayer->grainPrice * ((float) aPlayer->grainForSale))
-           + (grainPrice * ((float) grainToSell)))
-        / ((float) (aPlayer->grainForSale + grainToSell));
-    aPlayer->grainForSale += grainToSell;
-    aPlayer->grain -= grainToSell;
+        case ENGINE_OK :
+            SessionGoto(aSession, SESSION_GRAIN_MENU);
+            break;
+
+        case ENGINE_KEEP_LAND :
+            RenderPrint(render,
+                        "YOU MUST KEEP SOME LAND FOR THE ROYAL PALACE!");
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_SELL_LAND);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_SELL_LAND);
+            break;
+    }
 }
 
 
 /*
- * Sell land for the player specified by aPlayer.
+ *   Feed the number of bushels of grain specified by aInput to the army for the
+ * session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void SellLand(Player *aPlayer)
+static void FeedArmy(Session *aSession, const char *aInput)
 {
-    int   landToSell;
-    char  input[80];
-    bool  validLandToSell;
+    Render *render;
+    int     grainToFeed;
 
-    /* Sell land. */
-    validLandToSell = FALSE;
-    do
-    {
-        /* Display the price per acre. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("THE BARBARIANS WILL GIVE YOU 2 %s PER ACRE",
-               aPlayer->country->currency);
-        refresh();
-        sleep(DELAY_TIME);
-
-        /* Get the number of acres to sell. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY ACRES WILL YOU SELL THEM? ");
-        getnstr(input, sizeof(input));
-        landToSell = strtol(input, NULL, 0);
-        if (landToSell < 0)
-        {
-            validLandToSell = FALSE;
-        }
-        else if (((float) landToSell) <= (0.95 * ((float) aPlayer->land)))
-        {
-            validLandToSell = TRUE;
-        }
-        else
-        {
-            printw("YOU MUST KEEP SOME LAND FOR THE ROYAL PALACE!");
-            refresh();
-            sleep(DELAY_TIME);
-        }
-    } while (!validLandToSell);
+    render = &(aSession->render);
 
-    /* Update land and treasury. */
-    aPlayer->treasury += 2 * landToSell;
-    aPlayer->land -= landToSell;
-    barbarianLand += landToSell;
+    grainToFeed = strtol(aInput, NULL, 0);
+    if (EngineFeedArmy(aSession->game,
+                       aSession->player,
+                       grainToFeed) == ENGINE_OK)
+    {
+        SessionGoto(aSession, SESSION_FEED_PEOPLE);
+    }
+    else
+    {
+        SessionClearPrompt(aSession);
+        RenderPrint(render,
+                    "YOU CANNOT GIVE YOUR ARMY MORE GRAIN THAN YOU HAVE!");
+        SessionDelay(aSession, DELAY_TIME);
+        SessionGoto(aSession, SESSION_FEED_ARMY);
+    }
 }
 
 
 /*
- * Feed country for the player specified by aPlayer.
+ *   Feed the number of bushels of grain specified by aInput to the people for
+ * the session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-static void FeedCountry(Player *aPlayer)
+static void FeedPeople(Session *aSession, const char *aInput)
 {
-    int   grainToFeed;
-    int   peopleCount;
-    char  input[80];
-    bool  validGrainToFeed;
-
-    /* Feed army. */
-    validGrainToFeed = FALSE;
-    do
+    Player *player;
+    Render *render;
+    int     grainToFeed;
+
+    player = aSession->player;
+    render = &(aSession->render);
+    grainToFeed = strtol(aInput, NULL, 0);
+    switch (EngineFeedPeople(aSession->game, player, grainToFeed))
     {
-        /* Get the amount of grain to feed to army. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY BUSHELS WILL YOU GIVE TO YOUR ARMY OF %d MEN? ",
-               aPlayer->soldierCount);
-        getnstr(input, sizeof(input));
-        grainToFeed = strtol(input, NULL, 0);
-        if (grainToFeed > aPlayer->grain)
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("YOU CANNOT GIVE YOUR ARMY MORE GRAIN THAN YOU HAVE!");
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else
-        {
-            validGrainToFeed = TRUE;
-        }
-    } while (!validGrainToFeed);
-    aPlayer->grain -= grainToFeed;
-    aPlayer->armyGrainFeed = grainToFeed;
-
-    /* Feed people. */
-    validGrainToFeed = FALSE;
-    peopleCount =
-        aPlayer->serfCount + aPlayer->merchantCount + aPlayer->nobleCount;
-    do
-    {
-        /* Get the amount of grain to feed to people. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY BUSHELS WILL YOU GIVE TO YOUR %d PEOPLE? ",
-               peopleCount);
-        getnstr(input, sizeof(input));
-        grainToFeed = strtol(input, NULL, 0);
-        if (grainToFeed > aPlayer->grain)
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("BUT YOU ONLY HAVE %d BUSHELS OF GRAIN!", aPlayer->grain);
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else if (((float) grainToFeed) < (0.1 * ((float) aPlayer->grain)))
-        {
-            move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-            printw("YOU MUST RELEASE AT LEAST 10%% OF THE STORED GRAIN");
-            refresh();
-            sleep(DELAY_TIME);
-        }
-        else
-        {
-            validGrainToFeed = TRUE;
-        }
-    } while (!validGrainToFeed);
-    aPlayer->grain -= grainToFeed;
-    aPlayer->peopleGrainFeed = grainToFeed;
+        case ENGINE_OK :
+            SessionGoto(aSession, SESSION_POPULATION);
+            break;
+
+        case ENGINE_NOT_ENOUGH_GRAIN :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "BUT YOU ONLY HAVE %d BUSHELS OF GRAIN!",
+                        player->grain);
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_FEED_PEOPLE);
+            break;
+
+        case ENGINE_MUST_RELEASE :
+        default :
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "YOU MUST RELEASE AT LEAST 10%% OF THE STORED GRAIN");
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_FEED_PEOPLE);
+            break;
+    }
 }
-
@@ -16,6 +16,7 @@
 
 /* Local includes. */
 #include "empire.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -23,7 +24,9 @@
  * Prototypes.
  */
 
-void GrainScreen(Player *aPlayer);
+void GrainScreenEnter(Session *aSession);
+
+void GrainScreenInput(Session *aSession, const char *aInput);
 
 
 #endif /* __GRAIN_H__ */
@@ -12,12 +12,14 @@
  */
 
 /* System includes. */
-#include <math.h>
-#include <ncurses.h>
-#include <string.h>
+#include <stdlib.h>
 
 /* Local includes. */
 #include "empire.h"
+#include "engine.h"
+#include "investments.h"
+#include "render.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -29,102 +31,145 @@
  * Investment prototypes.
  */
 
-static void DrawInvestmentsScreen(Player *aPlayer);
+static void DrawInvestmentsScreen(Game   *aGame,
+                                  Player *aPlayer,
+                                  Render *aRender);
 
-static void DisplayInvestments(Player *aPlayer);
-
-static void ComputeRevenues(Player *aPlayer);
+static void DisplayInvestments(Game   *aGame,
+                               Player *aPlayer,
+                               Render *aRender);
 
 
 /*
  * Tax prototypes.
  */
 
-static void SetTaxes(Player *aPlayer);
-
-static void SetCustomsTax(Player *aPlayer);
-
-static void SetSalesTax(Player *aPlayer);
+static void SetTaxes(Session *aSession, const char *aInput);
 
-static void SetIncomeTax(Player *aPlayer);
+static void SetTax(Session *aSession, const char *aInput);
 
-static void DisplayTaxRevenues(Player *aPlayer);
+static void DisplayTaxRevenues(Game   *aGame,
+                               Player *aPlayer,
+                               Render *aRender);
 
 
 /*
  * Buy investment prototypes.
  */
 
-static void BuyInvestments(Player *aPlayer);
-
-static void BuyMarketplaces(Player *aPlayer);
-
-static void BuyGrainMills(Player *aPlayer);
+static void BuyInvestments(Session *aSession, const char *aInput);
 
-static void BuyFoundries(Player *aPlayer);
-
-static void BuyShipyards(Player *aPlayer);
-
-static void BuySoldiers(Player *aPlayer);
-
-static void BuyPalaces(Player *aPlayer);
-
-static bool ValidateInvestment(Player *aPlayer,
-                               int investment,
-                               int investmentCount);
+static void BuyInvestment(Session *aSession, const char *aInput);
 
 
 /*------------------------------------------------------------------------------
  *
- * Globals.
- */
-
-/*
- * Investment list.
+ * External investments screen functions.
  */
 
-#define INVESTMENT_MARKETPLACE 1
-#define INVESTMENT_GRAIN_MILL  2
-#define INVESTMENT_FOUNDRY     3
-#define INVESTMENT_SHIPYARD    4
-#define INVESTMENT_SOLDIER     5
-#define INVESTMENT_PALACE      6
-
-
 /*
- * Investment cost list.
+ *   Enter the current investments screen state of the session specified by
+ * aSession.  The investments screen computes the revenues of the player whose
+ * turn it is and lets them set taxes and buy investments.
+ *
+ *   aSession               Session.
  */
 
-int investmentCost[] =
+void InvestmentsScreenEnter(Session *aSession)
 {
-    1000, 2000, 7000, 8000, 8, 5000,
-};
+    Game   *game;
+    Player *player;
+    Render *render;
+
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+    switch (aSession->state)
+    {
+        case SESSION_INVESTMENTS :
+            /* Compute revenues. */
+            EngineComputeRevenues(game, player);
+            SessionGoto(aSession, SESSION_TAX_MENU);
+            break;
+
+        case SESSION_TAX_MENU :
+            /* Draw the investments screen and get tax to set. */
+            DrawInvestmentsScreen(game, player, render);
+            SessionClearPrompt(aSession);
+            RenderPrint(render,
+                        "1) CUSTOMS DUTY  2) SALES TAX  3) INCOME TAX? ");
+            break;
+
+        case SESSION_TAX_RATE :
+            /* Get the new tax. */
+            SessionClearPrompt(aSession);
+            switch (aSession->tax)
+            {
+                case TAX_CUSTOMS :
+                    RenderPrint(render, "GIVE NEW CUSTOMS TAX (MAX=50%%)? ");
+                    break;
+
+                case TAX_SALES :
+                    RenderPrint(render, "GIVE NEW SALES TAX (MAX=20%%)? ");
+                    break;
+
+                case TAX_INCOME :
+                default :
+                    RenderPrint(render, "GIVE NEW INCOME TAX (MAX=35%%)? ");
+                    break;
+            }
+            break;
+
+        case SESSION_INVESTMENT_MENU :
+            /* Draw the investments screen and get investment to buy. */
+            DrawInvestmentsScreen(game, player, render);
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "ANY NEW INVESTMENTS (GIVE #)? ");
+            break;
+
+        case SESSION_INVESTMENT_COUNT :
+            /* Get the number of investments to buy. */
+            SessionClearPrompt(aSession);
+            RenderPrint(render, "HOW MANY? ");
+            break;
+
+        default :
+            break;
+    }
+}
 
 
-/*------------------------------------------------------------------------------
- *
- * External investments screen functions.
- */
-
 /*
- * Manage investments for the player specified by aPlayer.
+ *   Handle the input line specified by aInput for the current investments
+ * screen state of the session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-void InvestmentsScreen(Player *aPlayer)
+void InvestmentsScreenInput(Session *aSession, const char *aInput)
 {
-    /* Compute revenues. */
-    ComputeRevenues(aPlayer);
+    switch (aSession->state)
+    {
+        case SESSION_TAX_MENU :
+            SetTaxes(aSession, aInput);
+            break;
+
+        case SESSION_TAX_RATE :
+            SetTax(aSession, aInput);
+            break;
 
-    /* Draw the investments screen. */
-    DrawInvestmentsScreen(aPlayer);
+        case SESSION_INVESTMENT_MENU :
+            BuyInvestments(aSession, aInput);
+            break;
 
-    /* Set taxes. */
-    SetTaxes(aPlayer);
+        case SESSION_INVESTMENT_COUNT :
+            BuyInvestment(aSession, aInput);
+            break;
 
-    /* Buy investments. */
-    BuyInvestments(aPlayer);
+        default :
+            break;
+    }
 }
 
 
@@ -134,138 +179,87 @@ void InvestmentsScreen(Player *aPlayer)
  */
 
 /*
- * Draw the investments screen for the player specified by aPlayer.
+ *   Draw the investments screen for the player specified by aPlayer, reusing
+ * the regions in the renderer specified by aRender that have not changed.
  *
+ *   aGame                  Game.
  *   aPlayer                Player.
+ *   aRender                Renderer.
  */
 
-static void DrawInvestmentsScreen(Player *aPlayer)
+static void DrawInvestmentsScreen(Game   *aGame,
+                                  Player *aPlayer,
+                                  Render *aRender)
 {
     /* Reset screen. */
-    clear();
-    move(0, 0);
+    RenderErase(aRender);
+    RenderMove(aRender, 0, 0);
 
     /* Display tax revenues. */
-    DisplayTaxRevenues(aPlayer);
+    DisplayTaxRevenues(aGame, aPlayer, aRender);
 
     /* Display investments. */
-    DisplayInvestments(aPlayer);
+    DisplayInvestments(aGame, aPlayer, aRender);
 }
 
 
 /*
  * Display investments for the player specified by aPlayer.
  *
+ *   aGame                  Game.
  *   aPlayer                Player.
+ *   aRender                Renderer.
  */
 
-void DisplayInvestments(Player *aPlayer)
+static void DisplayInvestments(Game   *aGame,
+                               Player *aPlayer,
+                               Render *aRender)
 {
-    /* Display investments. */
-    move(5, 0);
-    printw("INVESTMENTS     NUMBER          PROFITS         COST\n");
-    printw("1) MARKETPLACES % -6d          % -6d          1000\n",
-           aPlayer->marketplaceCount, aPlayer->marketplaceRevenue);
-    printw("2) GRAIN MILLS  % -6d          % -6d          2000\n",
-           aPlayer->grainMillCount, aPlayer->grainMillRevenue);
-    printw("3) FOUNDRIES    % -6d          % -6d          7000\n",
-           aPlayer->foundryCount, aPlayer->foundryRevenue);
-    printw("4) SHIPYARDS    % -6d          % -6d          8000\n",
-           aPlayer->shipyardCount, aPlayer->shipyardRevenue);
-    printw("5) SOLDIERS     % -6d          % -6d          8\n",
-           aPlayer->soldierCount, aPlayer->soldierRevenue);
-    printw("6) PALACE        %d%% COMPLETED                   5000\n",
-           10 * aPlayer->palaceCount);
-}
+    uint64_t stamp;
+
+    /* Reuse the investments if they have not changed. */
+    stamp = RenderStamp(RENDER_STAMP_INIT, aPlayer->marketplaceCount);
+    stamp = RenderStamp(stamp, aPlayer->marketplaceRevenue);
+    stamp = RenderStamp(stamp, aPlayer->grainMillCount);
+    stamp = RenderStamp(stamp, aPlayer->grainMillRevenue);
+    stamp = RenderStamp(stamp, aPlayer->foundryCount);
+    stamp = RenderStamp(stamp, aPlayer->foundryRevenue);
+    stamp = RenderStamp(stamp, aPlayer->shipyardCount);
+    stamp = RenderStamp(stamp, aPlayer->shipyardRevenue);
+    stamp = RenderStamp(stamp, aPlayer->soldierCount);
+    stamp = RenderStamp(stamp, aPlayer->soldierRevenue);
+    stamp = RenderStamp(stamp, aPlayer->palaceCount);
+    if (RenderRegionCached(aRender, RENDER_INVESTMENTS, stamp))
+        return;
 
-
-/*
- * Compute revenues for the player specified by aPlayer.
- *
- *   aPlayer                Player.
- */
-
-void ComputeRevenues(Player *aPlayer)
-{
-    int  marketplaceRevenue;
-    int  grainMillRevenue;
-    int  foundryRevenue;
-    int  shipyardRevenue;
-    int  salesTaxRevenue;
-    int  incomeTaxRevenue;
-
-    /* Determine marketplace revenue. */
-    marketplaceRevenue =
-          (  12
-           * (aPlayer->merchantCount + RandRange(35) + RandRange(35))
-           / (aPlayer->salesTax + 1))
-        + 5;
-    marketplaceRevenue = aPlayer->marketplaceCount * marketplaceRevenue;
-    aPlayer->marketplaceRevenue = pow(marketplaceRevenue, 0.9);
-
-    /* Determine grain mill revenue. */
-    grainMillRevenue = 
-          ((int) (5.8 * ((float) aPlayer->grainHarvest + RandRange(250))))
-        / (20*aPlayer->incomeTax + 40*aPlayer->salesTax + 150);
-    grainMillRevenue = aPlayer->grainMillCount * grainMillRevenue;
-    aPlayer->grainMillRevenue = pow(grainMillRevenue, 0.9);
-
-    /* Determine the foundry revenue. */
-    foundryRevenue = aPlayer->soldierCount + RandRange(150) + 400;
-    foundryRevenue = aPlayer->foundryCount * foundryRevenue;
-    foundryRevenue = pow(foundryRevenue, 0.9);
-
-    /* Determine the shipyard revenue. */
-    shipyardRevenue =
-        (  4*aPlayer->merchantCount
-         + 9*aPlayer->marketplaceCount
-         + 15*aPlayer->foundryCount);
-    shipyardRevenue = aPlayer->shipyardCount * shipyardRevenue * weather;
-    shipyardRevenue = pow(shipyardRevenue, 0.9);
-
-    /* Determine the army revenue. */
-    aPlayer->soldierRevenue = -8 * aPlayer->soldierCount;
-
-    /* Determine customs tax revenue. */
-    aPlayer->customsTaxRevenue =   aPlayer->customsTax
-                                 * aPlayer->immigrated
-                                 * (RandRange(40) + RandRange(40))
-                                 / 100;
-
-    /* Determine sales tax revenue. */
-    salesTaxRevenue =
-        (  ((int) (1.8 * ((float) aPlayer->merchantCount)))
-         + 33*aPlayer->marketplaceRevenue
-         + 17*aPlayer->grainMillRevenue
-         + 50*aPlayer->foundryRevenue
-         + 70*aPlayer->shipyardRevenue);
-    salesTaxRevenue = pow(salesTaxRevenue, 0.85);
-    aPlayer->salesTaxRevenue =
-          aPlayer->salesTax
-        * (salesTaxRevenue + 5*aPlayer->nobleCount + aPlayer->serfCount)
-        / 100;
-
-    /* Determine income tax revenue. */
-    incomeTaxRevenue =
-          ((int) (1.3 * ((float) aPlayer->serfCount)))
-        + 145*aPlayer->nobleCount
-        + 39*aPlayer->merchantCount
-        + 99*aPlayer->marketplaceCount
-        + 99*aPlayer->grainMillCount
-        + 425*aPlayer->foundryCount
-        + 965*aPlayer->shipyardCount;
-    incomeTaxRevenue = aPlayer->incomeTax * incomeTaxRevenue / 100;
-    aPlayer->incomeTaxRevenue = pow(incomeTaxRevenue, 0.97);
-
-    /* Update treasury. */
-    aPlayer->treasury +=   aPlayer->customsTaxRevenue
-                         + aPlayer->salesTaxRevenue
-                         + aPlayer->incomeTaxRevenue
-                         + aPlayer->marketplaceRevenue
-                         + aPlayer->grainMillRevenue
-                         + aPlayer->foundryRevenue
-                         + aPlayer->shipyardRevenue
-                         + aPlayer->soldierRevenue;
+    /* Display investments. */
+    RenderMove(aRender, 5, 0);
+    RenderPrint(aRender,
+                "INVESTMENTS     NUMBER          PROFITS         COST\n");
+    RenderPrint(aRender,
+                "1) MARKETPLACES % -6d          % -6d          1000\n",
+                aPlayer->marketplaceCount,
+                aPlayer->marketplaceRevenue);
+    RenderPrint(aRender,
+                "2) GRAIN MILLS  % -6d          % -6d          2000\n",
+                aPlayer->grainMillCount,
+                aPlayer->grainMillRevenue);
+    RenderPrint(aRender,
+                "3) FOUNDRIES    % -6d          % -6d          7000\n",
+                aPlayer->foundryCount,
+                aPlayer->foundryRevenue);
+    RenderPrint(aRender,
+                "4) SHIPYARDS    % -6d          % -6d          8000\n",
+                aPlayer->shipyardCount,
+                aPlayer->shipyardRevenue);
+    RenderPrint(aRender,
+                "5) SOLDIERS     % -6d          % -6d          8\n",
+                aPlayer->soldierCount,
+                aPlayer->soldierRevenue);
+    RenderPrint(aRender,
+                "6) PALACE        %d%% COMPLETED                   5000\n",
+                10 * aPlayer->palaceCount);
+    RenderRegionSave(aRender, RENDER_INVESTMENTS, stamp, 5, 7);
 }
 
 
@@ -275,159 +269,109 @@ void ComputeRevenues(Player *aPlayer)
  */
 
 /*
- * Set taxes for the player specified by aPlayer.
+ *   Handle the tax menu choice specified by aInput for the session specified by
+ * aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-void SetTaxes(Player *aPlayer)
+static void SetTaxes(Session *aSession, const char *aInput)
 {
-    char input[80];
-    bool done;
+    int tax;
 
-    /* Set taxes. */
-    done = FALSE;
-    while (!done)
+    /* Parse input. */
+    tax = strtol(aInput, NULL, 0);
+    switch (tax)
     {
-        /* Draw the investments screen. */
-        DrawInvestmentsScreen(aPlayer);
-
-        /* Get tax to set. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("1) CUSTOMS DUTY  2) SALES TAX  3) INCOME TAX? ");
-        getnstr(input, sizeof(input));
-
-        /* Parse input. */
-        switch (strtol(input, NULL, 0))
-        {
-            case 0 :
-                done = TRUE;
-                break;
-
-            case 1 :
-                SetCustomsTax(aPlayer);
-                break;
-
-            case 2 :
-                SetSalesTax(aPlayer);
-                break;
-
-            case 3 :
-                SetIncomeTax(aPlayer);
-                break;
-
-            default :
-                break;
-        }
+        case 0 :
+            SessionGoto(aSession, SESSION_INVESTMENT_MENU);
+            break;
+
+        case TAX_CUSTOMS :
+        case TAX_SALES :
+        case TAX_INCOME :
+            aSession->tax = tax;
+            SessionGoto(aSession, SESSION_TAX_RATE);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_TAX_MENU);
+            break;
     }
 }
 
 
 /*
- * Set customs tax for the player specified by aPlayer
+ *   Set the tax being set to the rate specified by aInput for the session
+ * specified by aSession.
  *
- *   aPlayer                Player.
- */
-
-void SetCustomsTax(Player *aPlayer)
-{
-    char input[80];
-    int  customsTax;
-    bool validCustomsTax;
-
-    /* Get the new customs tax. */
-    validCustomsTax = FALSE;
-    do
-    {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("GIVE NEW CUSTOMS TAX (MAX=50%)? ");
-        getnstr(input, sizeof(input));
-        customsTax = strtol(input, NULL, 0);
-        if ((customsTax >= 0) && (customsTax <= 50))
-            validCustomsTax = TRUE;
-    } while (!validCustomsTax);
-    aPlayer->customsTax = customsTax;
-}
-
-
-/*
- * Set sales tax for the player specified by aPlayer
- *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-void SetSalesTax(Player *aPlayer)
+static void SetTax(Session *aSession, const char *aInput)
 {
-    char input[80];
-    int  salesTax;
-    bool validSalesTax;
+    int rate;
 
-    /* Get the new sales tax. */
-    validSalesTax = FALSE;
-    do
+    rate = strtol(aInput, NULL, 0);
+    if (EngineSetTax(aSession->game,
+                     aSession->player,
+                     aSession->tax,
+                     rate) == ENGINE_OK)
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("GIVE NEW SALES TAX (MAX=20%)? ");
-        getnstr(input, sizeof(input));
-        salesTax = strtol(input, NULL, 0);
-        if ((salesTax >= 0) && (salesTax <= 20))
-            validSalesTax = TRUE;
-    } while (!validSalesTax);
-    aPlayer->salesTax = salesTax;
-}
-
-
-/*
- * Set income tax for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void SetIncomeTax(Player *aPlayer)
-{
-    char input[80];
-    int  incomeTax;
-    bool validIncomeTax;
-
-    /* Get the new income tax. */
-    validIncomeTax = FALSE;
-    do
+        SessionGoto(aSession, SESSION_TAX_MENU);
+    }
+    else
     {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("GIVE NEW INCOME TAX (MAX=35%)? ");
-        getnstr(input, sizeof(input));
-        incomeTax = strtol(input, NULL, 0);
-        if ((incomeTax >= 0) && (incomeTax <= 35))
-            validIncomeTax = TRUE;
-    } while (!validIncomeTax);
-    aPlayer->incomeTax = incomeTax;
+        SessionGoto(aSession, SESSION_TAX_RATE);
+    }
 }
 
 
 /*
  * Display tax revenues for the player specified by aPlayer.
  *
+ *   aGame                  Game.
  *   aPlayer                Player.
+ *   aRender                Renderer.
  */
 
-void DisplayTaxRevenues(Player *aPlayer)
+static void DisplayTaxRevenues(Game   *aGame,
+                               Player *aPlayer,
+                               Render *aRender)
 {
-    Country *country;
+    const Country *country;
+    uint64_t       stamp;
+
+    /* Reuse the tax revenues if they have not changed. */
+    stamp = RenderStamp(RENDER_STAMP_INIT, aPlayer->number);
+    stamp = RenderStamp(stamp, aPlayer->treasury);
+    stamp = RenderStamp(stamp, aPlayer->customsTax);
+    stamp = RenderStamp(stamp, aPlayer->salesTax);
+    stamp = RenderStamp(stamp, aPlayer->incomeTax);
+    stamp = RenderStamp(stamp, aPlayer->customsTaxRevenue);
+    stamp = RenderStamp(stamp, aPlayer->salesTaxRevenue);
+    stamp = RenderStamp(stamp, aPlayer->incomeTaxRevenue);
+    if (RenderRegionCached(aRender, RENDER_TAX_REVENUES, stamp))
+        return;
 
     /* Get the player country. */
-    country = aPlayer->country;
+    country = PlayerCountry(aGame, aPlayer);
 
     /* Display tax revenues. */
-    printw("STATE REVENUES:    TREASURY=%6d %s\n",
-           aPlayer->treasury,
-           country->currency);
-    printw("CUSTOMS DUTY    SALES TAX       INCOME TAX\n");
-    mvprintw(2, 1, "%d %%", aPlayer->customsTax);
-    mvprintw(2, 17, "%d %%", aPlayer->salesTax);
-    mvprintw(2, 33, "%d %%", aPlayer->incomeTax);
-    mvprintw(3, 1, "%d", aPlayer->customsTaxRevenue);
-    mvprintw(3, 17, "%d", aPlayer->salesTaxRevenue);
-    mvprintw(3, 33, "%d", aPlayer->incomeTaxRevenue);
+    RenderPrint(aRender,
+                "STATE REVENUES:    TREASURY=%6d %s\n",
+                aPlayer->treasury,
+                country->currency);
+    RenderPrint(aRender, "CUSTOMS DUTY    SALES TAX       INCOME TAX\n");
+    RenderMovePrint(aRender, 2, 1, "%d %%", aPlayer->customsTax);
+    RenderMovePrint(aRender, 2, 17, "%d %%", aPlayer->salesTax);
+    RenderMovePrint(aRender, 2, 33, "%d %%", aPlayer->incomeTax);
+    RenderMovePrint(aRender, 3, 1, "%d", aPlayer->customsTaxRevenue);
+    RenderMovePrint(aRender, 3, 17, "%d", aPlayer->salesTaxRevenue);
+    RenderMovePrint(aRender, 3, 33, "%d", aPlayer->incomeTaxRevenue);
+    RenderRegionSave(aRender, RENDER_TAX_REVENUES, stamp, 0, 4);
 }
 
 
@@ -437,417 +381,105 @@ void DisplayTaxRevenues(Player *aPlayer)
  */
 
 /*
- * Buy investments for the player specified by aPlayer.
+ *   Handle the investment menu choice specified by aInput for the session
+ * specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-void BuyInvestments(Player *aPlayer)
+static void BuyInvestments(Session *aSession, const char *aInput)
 {
-    char input[80];
-    bool done;
+    int investment;
 
-    /* Buy investments. */
-    done = FALSE;
-    while (!done)
+    /* Parse input. */
+    investment = strtol(aInput, NULL, 0);
+    switch (investment)
     {
-        /* Draw the investments screen. */
-        DrawInvestmentsScreen(aPlayer);
-
-        /* Get investment to buy. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("ANY NEW INVESTMENTS (GIVE #)? ");
-        getnstr(input, sizeof(input));
-
-        /* Parse input. */
-        switch (strtol(input, NULL, 0))
-        {
-            case 0 :
-                done = TRUE;
-                break;
-
-            case INVESTMENT_MARKETPLACE :
-                BuyMarketplaces(aPlayer);
-                break;
-
-            case INVESTMENT_GRAIN_MILL :
-                BuyGrainMills(aPlayer);
-                break;
-
-            case INVESTMENT_FOUNDRY :
-                BuyFoundries(aPlayer);
-                break;
-
-            case INVESTMENT_SHIPYARD :
-                BuyShipyards(aPlayer);
-                break;
-
-            case INVESTMENT_SOLDIER :
-                BuySoldiers(aPlayer);
-                break;
-
-            case INVESTMENT_PALACE :
-                BuyPalaces(aPlayer);
-                break;
-
-            default :
-                break;
-        }
+        case 0 :
+            SessionGoto(aSession, SESSION_ATTACK);
+            break;
+
+        case INVESTMENT_MARKETPLACE :
+        case INVESTMENT_GRAIN_MILL :
+        case INVESTMENT_FOUNDRY :
+        case INVESTMENT_SHIPYARD :
+        case INVESTMENT_SOLDIER :
+        case INVESTMENT_PALACE :
+            aSession->investment = investment;
+            SessionGoto(aSession, SESSION_INVESTMENT_COUNT);
+            break;
+
+        default :
+            SessionGoto(aSession, SESSION_INVESTMENT_MENU);
+            break;
     }
 }
 
 
 /*
- * Buy marketplaces for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void BuyMarketplaces(Player *aPlayer)
-{
-    Country *country;
-    char     input[80];
-    int      newMerchantCount;
-    int      marketplaceCount;
-    bool     validMarketplaceCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of marketplaces to buy. */
-    validMarketplaceCount = FALSE;
-    do
-    {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        marketplaceCount = strtol(input, NULL, 0);
-
-        /* Validate the number of marketplaces to buy. */
-        validMarketplaceCount = ValidateInvestment(aPlayer,
-                                                   INVESTMENT_MARKETPLACE,
-                                                   marketplaceCount);
-    } while (!validMarketplaceCount);
-
-    /* Update marketplace count and treasury. */
-    aPlayer->marketplaceCount += marketplaceCount;
-    aPlayer->treasury -= marketplaceCount * 1000;
-
-    /*
-     * Merchants are gained with every marketplace purchase, even if none are
-     * purchased.
-     */
-    newMerchantCount = RandRange(7);
-    aPlayer->merchantCount += newMerchantCount;
-    aPlayer->serfCount -= newMerchantCount;
-}
-
-
-/*
- * Buy grain mills for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void BuyGrainMills(Player *aPlayer)
-{
-    Country *country;
-    char     input[80];
-    int      grainMillCount;
-    bool     validGrainMillCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of grain mills to buy. */
-    validGrainMillCount = FALSE;
-    do
-    {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        grainMillCount = strtol(input, NULL, 0);
-
-        /* Validate the number of grain mills to buy. */
-        validGrainMillCount = ValidateInvestment(aPlayer,
-                                                 INVESTMENT_GRAIN_MILL,
-                                                 grainMillCount);
-    } while (!validGrainMillCount);
-
-    /* Update grain mill count and treasury. */
-    aPlayer->grainMillCount += grainMillCount;
-    aPlayer->treasury -= grainMillCount * 2000;
-}
-
-
-/*
- * Buy foundries for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void BuyFoundries(Player *aPlayer)
-{
-    Country *country;
-    char     input[80];
-    int      foundryCount;
-    bool     validFoundryCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of foundries to buy. */
-    validFoundryCount = FALSE;
-    do
-    {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        foundryCount = strtol(input, NULL, 0);
-
-        /* Validate the number of foundries to buy. */
-        validFoundryCount = ValidateInvestment(aPlayer,
-                                               INVESTMENT_FOUNDRY,
-                                               foundryCount);
-    } while (!validFoundryCount);
-
-    /* Update foundry count and treasury. */
-    aPlayer->foundryCount += foundryCount;
-    aPlayer->treasury -= foundryCount * 7000;
-}
-
-
-/*
- * Buy shipyards for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void BuyShipyards(Player *aPlayer)
-{
-    Country *country;
-    char     input[80];
-    int      shipyardCount;
-    bool     validShipyardCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of shipyards to buy. */
-    validShipyardCount = FALSE;
-    do
-    {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        shipyardCount = strtol(input, NULL, 0);
-
-        /* Validate the number of shipyards to buy. */
-        validShipyardCount = ValidateInvestment(aPlayer,
-                                                INVESTMENT_SHIPYARD,
-                                                shipyardCount);
-    } while (!validShipyardCount);
-
-    /* Update shipyard count and treasury. */
-    aPlayer->shipyardCount += shipyardCount;
-    aPlayer->treasury -= shipyardCount * 8000;
-}
-
-
-/*
- * Buy soldiers for the player specified by aPlayer
- *
- *   aPlayer                Player.
- */
-
-void BuySoldiers(Player *aPlayer)
-{
-    Country *country;
-    char     input[80];
-    int      soldierCount;
-    bool     validSoldierCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of soldiers to buy. */
-    validSoldierCount = FALSE;
-    do
-    {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        soldierCount = strtol(input, NULL, 0);
-
-        /* Validate the number of soldiers to buy. */
-        validSoldierCount = ValidateInvestment(aPlayer,
-                                               INVESTMENT_SOLDIER,
-                                               soldierCount);
-    } while (!validSoldierCount);
-
-    /* Update soldier count and treasury. */
-    aPlayer->soldierCount += soldierCount;
-    aPlayer->serfCount -= soldierCount;
-    aPlayer->treasury -= soldierCount * 8;
-}
-
-
-/*
- * Buy palaces for the player specified by aPlayer
+ *   Buy the number of the investment being bought specified by aInput for the
+ * session specified by aSession.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
+ *   aInput                 Input line.
  */
 
-void BuyPalaces(Player *aPlayer)
+static void BuyInvestment(Session *aSession, const char *aInput)
 {
-    Country *country;
-    char     input[80];
-    int      newNobleCount;
-    int      palaceCount;
-    bool     validPalaceCount;
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Get the number of palaces to buy. */
-    validPalaceCount = FALSE;
-    do
+    Game   *game;
+    Player *player;
+    Render *render;
+    int     investmentCount;
+    int     result;
+
+    game = aSession->game;
+    player = aSession->player;
+    render = &(aSession->render);
+
+    /* Buy the investments. */
+    investmentCount = strtol(aInput, NULL, 0);
+    result = EngineBuyInvestment(game,
+                                 player,
+                                 aSession->investment,
+                                 investmentCount);
+    if (result == ENGINE_OK)
     {
-        /* Get user input. */
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw("HOW MANY? ");
-        getnstr(input, sizeof(input));
-        palaceCount = strtol(input, NULL, 0);
-
-        /* Validate the number of palaces to buy. */
-        validPalaceCount = ValidateInvestment(aPlayer,
-                                              INVESTMENT_PALACE,
-                                              palaceCount);
-    } while (!validPalaceCount);
-
-    /* Update palace count and treasury. */
-    aPlayer->palaceCount += palaceCount;
-    aPlayer->treasury -= palaceCount * 5000;
-
-    /*
-     * Nobles are gained with every palace purchase, even if none are
-     * purchased.
-     */
-    newNobleCount = RandRange(4);
-    aPlayer->nobleCount += newNobleCount;
-    aPlayer->serfCount -= newNobleCount;
-}
-
-
-/*
- *   Return true if the investment and investment count specified by investment
- * and investmentCount are valid for the player specified by aPlayer; return
- * false otherwise.  For example, if the investment cost times times the
- * investment count is greater than the player's treasury, this function returns
- * false.
- *
- *   aPlayer                Player.
- *   investment             Investment being purchased.
- *   investmentCount        Number of investments being purchased.
- */
-
-bool ValidateInvestment(Player *aPlayer, int investment, int investmentCount)
-{
-    Country *country;
-    int      totalCost;
-    char     invalidMessage[128];
-    bool     valid = TRUE;
-
-    /* Clear the invalid message. */
-    invalidMessage[0] = '\0';
-
-    /* Get the player country. */
-    country = aPlayer->country;
-
-    /* Validate that the count is a non-negative number. */
-    if (investmentCount < 0)
-        valid = FALSE;
-
-    /* Validate there's enough in the treasury for the purchase. */
-    if (valid)
-    {
-        totalCost = investmentCount * investmentCost[investment - 1];
-        if (totalCost > aPlayer->treasury)
-        {
-            valid = FALSE;
-            snprintf(invalidMessage,
-                     sizeof(invalidMessage),
-                     "THINK AGAIN . . .YOU ONLY HAVE %d %s",
-                     aPlayer->treasury,
-                     country->currency);
-        }
+        SessionGoto(aSession, SESSION_INVESTMENT_MENU);
+        return;
     }
+    SessionGoto(aSession, SESSION_INVESTMENT_COUNT);
+    if (result == ENGINE_INVALID)
+        return;
 
-    /* Validate that there are enough serfs to train for the purchase. */
-    if (valid && (investmentCount > aPlayer->serfCount))
+    /* Notify the player of an invalid investment. */
+    SessionClearPrompt(aSession);
+    switch (result)
     {
-        valid = FALSE;
-        snprintf(invalidMessage,
-                 sizeof(invalidMessage),
-                 "YOU DON'T HAVE ENOUGH SERFS TO TRAIN");
+        case ENGINE_CANNOT_AFFORD :
+            RenderPrint(render,
+                        "THINK AGAIN . . .YOU ONLY HAVE %d %s",
+                        player->treasury,
+                        PlayerCountry(game, player)->currency);
+            break;
+
+        case ENGINE_NOT_ENOUGH_SERFS :
+            RenderPrint(render, "YOU DON'T HAVE ENOUGH SERFS TO TRAIN");
+            break;
+
+        case ENGINE_TOO_MANY_TROOPS :
+            RenderPrint(render,
+                        "YOU CANNOT EQUIP AND MAINTAIN SO MANY TROOPS, %s",
+                        PlayerTitle(game, player));
+            break;
+
+        case ENGINE_NOT_ENOUGH_NOBLES :
+        default :
+            RenderPrint(render,
+                        "PLEASE THINK AGAIN . . .  YOU ONLY HAVE %d NOBLES\n"
+                        "TO LEAD YOUR TROOPS.",
+                        player->nobleCount);
+            break;
     }
-
-    /*
-     * Validate if there are enough foundries and nobles for the new
-     * soldiers.
-     */
-    if (valid && (investment == INVESTMENT_SOLDIER))
-    {
-        int totalSoldierCount;
-        int totalPeopleCount;
-
-        /*
-         * Determine the total number of soldiers if the investment is made
-         * and the total number of civilians in the country.
-         */
-        totalSoldierCount = aPlayer->soldierCount + investmentCount;
-        totalPeopleCount =   aPlayer->serfCount
-                           + aPlayer->merchantCount
-                           + aPlayer->nobleCount;
-
-        /*
-         * Validate if there are enough foundries and nobles for the new
-         * soldiers.
-         */
-        if ((((float) totalSoldierCount) / ((float) totalPeopleCount)) >
-            (0.05 + 0.015*aPlayer->foundryCount))
-        {
-            valid = FALSE;
-            snprintf(invalidMessage,
-                     sizeof(invalidMessage),
-                     "YOU CANNOT EQUIP AND MAINTAIN SO MANY TROOPS, %s",
-                     aPlayer->title);
-        }
-        else if (totalSoldierCount > (20 * aPlayer->nobleCount))
-        {
-            valid = FALSE;
-            snprintf(invalidMessage,
-                     sizeof(invalidMessage),
-                     "PLEASE THINK AGAIN . . .  YOU ONLY HAVE %d NOBLES\n"
-                     "TO LEAD YOUR TROOPS.",
-                     aPlayer->nobleCount);
-        }
-    }
-
-    /* If investment is invalid, notify the player. */
-    if (!valid && (strlen(invalidMessage) > 0))
-    {
-        move(14, 0); clrtoeol(); move(15, 0); clrtoeol(); move(14, 0);
-        printw(invalidMessage);
-        refresh();
-        sleep(DELAY_TIME);
-    }
-
-    return valid;
+    SessionDelay(aSession, DELAY_TIME);
 }
-
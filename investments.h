@@ -0,0 +1,32 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game investments screen header file.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __INVESTMENTS_H__
+#define __INVESTMENTS_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* Local includes. */
+#include "empire.h"
+#include "session.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+void InvestmentsScreenEnter(Session *aSession);
+
+void InvestmentsScreenInput(Session *aSession, const char *aInput);
+
+
+#endif /* __INVESTMENTS_H__ */
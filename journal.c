@@ -0,0 +1,272 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire input journal.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "journal.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Journal file magic number.
+ */
+
+#define JOURNAL_MAGIC       "EMPJ"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void JournalPutNumber(FILE *aFile, uint64_t value, int byteCount);
+
+static bool JournalGetNumber(FILE *aFile, uint64_t *aValue, int byteCount);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External journal functions.
+ */
+
+/*
+ *   Create a journal at the path specified by aPath for a session started with
+ * the random number seed specified by seed and the number of countries
+ * specified by countryCount, and write its header.  Return NULL on error.
+ *
+ *   aPath                  Journal file path.
+ *   seed                   Random number seed.
+ *   countryCount           Number of countries.
+ */
+
+Journal *JournalCreate(const char *aPath, uint64_t seed, int countryCount)
+{
+    Journal *journal;
+
+    /* Allocate the journal record and create the file. */
+    journal = calloc(1, sizeof(Journal));
+    if (journal == NULL)
+        return NULL;
+    journal->seed = seed;
+    journal->countryCount = countryCount;
+    journal->file = fopen(aPath, "wb");
+    if (journal->file == NULL)
+    {
+        free(journal);
+        return NULL;
+    }
+
+    /* Write the header. */
+    fputs(JOURNAL_MAGIC, journal->file);
+    fputc(JOURNAL_VERSION, journal->file);
+    JournalPutNumber(journal->file, countryCount, 4);
+    JournalPutNumber(journal->file, seed, 8);
+    fflush(journal->file);
+
+    return journal;
+}
+
+
+/*
+ *   Record the input line specified by aInput in the journal specified by
+ * aJournal.
+ *
+ *   aJournal               Journal.
+ *   aInput                 Input line.
+ */
+
+void JournalRecord(Journal *aJournal, const char *aInput)
+{
+    size_t length;
+
+    length = strnlen(aInput, JOURNAL_LINE_MAX);
+    fputc(length, aJournal->file);
+    fwrite(aInput, 1, length, aJournal->file);
+    fflush(aJournal->file);
+    aJournal->inputCount++;
+}
+
+
+/*
+ *   Write the end record with the checksum specified by checksum to the journal
+ * specified by aJournal, and close and destroy the journal.
+ *
+ *   aJournal               Journal.
+ *   checksum               Checksum of the final game state.
+ */
+
+void JournalClose(Journal *aJournal, uint64_t checksum)
+{
+    if (aJournal == NULL)
+        return;
+
+    fputc(JOURNAL_END_MARK, aJournal->file);
+    JournalPutNumber(aJournal->file, checksum, 8);
+    JournalDestroy(aJournal);
+}
+
+
+/*
+ *   Open the journal at the path specified by aPath for replay and read its
+ * header.  Return NULL on error or if the file is not a journal.
+ *
+ *   aPath                  Journal file path.
+ */
+
+Journal *JournalOpen(const char *aPath)
+{
+    Journal  *journal;
+    char      magic[sizeof(JOURNAL_MAGIC) - 1];
+    uint64_t  countryCount;
+
+    /* Allocate the journal record and open the file. */
+    journal = calloc(1, sizeof(Journal));
+    if (journal == NULL)
+        return NULL;
+    journal->file = fopen(aPath, "rb");
+    if (journal->file == NULL)
+    {
+        free(journal);
+        return NULL;
+    }
+
+    /* Read the header. */
+    if (   (fread(magic, 1, sizeof(magic), journal->file) != sizeof(magic))
+        || (memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) != 0)
+        || (fgetc(journal->file) != JOURNAL_VERSION)
+        || !JournalGetNumber(journal->file, &countryCount, 4)
+        || !JournalGetNumber(journal->file, &(journal->seed), 8))
+    {
+        JournalDestroy(journal);
+        return NULL;
+    }
+    journal->countryCount = countryCount;
+
+    return journal;
+}
+
+
+/*
+ *   Read the next input line from the journal specified by aJournal into the
+ * buffer specified by aInput of the size specified by size.  Return false at
+ * the end of the journal.  If the journal has an end record, its ended field
+ * is then set and its checksum field holds the recorded checksum.
+ *
+ *   aJournal               Journal.
+ *   aInput                 Input buffer.
+ *   size                   Size of the input buffer.
+ */
+
+bool JournalRead(Journal *aJournal, char *aInput, int size)
+{
+    int length;
+
+    /* Read the record length, and the checksum at the end record. */
+    length = fgetc(aJournal->file);
+    if (length == EOF)
+        return FALSE;
+    if (length == JOURNAL_END_MARK)
+    {
+        aJournal->ended = JournalGetNumber(aJournal->file,
+                                           &(aJournal->checksum),
+                                           8);
+        return FALSE;
+    }
+
+    /* Read the input line. */
+    if (   (length >= size)
+        || (fread(aInput, 1, length, aJournal->file) != (size_t) length))
+    {
+        return FALSE;
+    }
+    aInput[length] = '\0';
+    aJournal->inputCount++;
+
+    return TRUE;
+}
+
+
+/*
+ * Close and destroy the journal specified by aJournal.
+ *
+ *   aJournal               Journal to destroy.
+ */
+
+void JournalDestroy(Journal *aJournal)
+{
+    if (aJournal == NULL)
+        return;
+
+    fclose(aJournal->file);
+    free(aJournal);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal journal functions.
+ */
+
+/*
+ *   Write the number of low bytes specified by byteCount of the value specified
+ * by value to the file specified by aFile, least significant first.
+ *
+ *   aFile                  File.
+ *   value                  Value to write.
+ *   byteCount              Number of bytes to write.
+ */
+
+static void JournalPutNumber(FILE *aFile, uint64_t value, int byteCount)
+{
+    int i;
+
+    for (i = 0; i < byteCount; i++)
+        fputc((value >> (8 * i)) & 0xff, aFile);
+}
+
+
+/*
+ *   Read a number of the number of bytes specified by byteCount from the file
+ * specified by aFile, least significant first, into the value specified by
+ * aValue.  Return false at the end of the file.
+ *
+ *   aFile                  File.
+ *   aValue                 Value read.
+ *   byteCount              Number of bytes to read.
+ */
+
+static bool JournalGetNumber(FILE *aFile, uint64_t *aValue, int byteCount)
+{
+    int byte;
+    int i;
+
+    *aValue = 0;
+    for (i = 0; i < byteCount; i++)
+    {
+        byte = fgetc(aFile);
+        if (byte == EOF)
+            return FALSE;
+        *aValue |= ((uint64_t) byte) << (8 * i);
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,106 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire input journal header file.
+ *
+ *   A journal records a game session exactly: the seed and country count it
+ * was started with, every input line it consumed, in order, and a checksum of
+ * the game state when the journal was closed.  Sessions are deterministic, so
+ * feeding the input lines back to a session started the same way replays the
+ * game and must end with the same checksum.
+ *
+ *   A journal file holds a header, one record per input line, and an end
+ * record.  All numbers are little endian.
+ *
+ *   header                 "EMPJ", a version byte, the country count (32
+ *                          bits), and the seed (64 bits).
+ *   input                  Length byte (0 to JOURNAL_LINE_MAX) followed by
+ *                          the line, without terminator.
+ *   end                    JOURNAL_END_MARK followed by the checksum (64
+ *                          bits).
+ *
+ *   The journal is flushed after each record, so a journal whose process dies
+ * holds every line up to that point but no end record.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Journal defs.
+ *
+ *   JOURNAL_VERSION        Version of the journal file format.
+ *   JOURNAL_LINE_MAX       Longest input line recorded.  Longer lines are
+ *                          truncated, as getnstr truncates them.
+ *   JOURNAL_END_MARK       Length byte that marks the end record.
+ */
+
+#define JOURNAL_VERSION     1
+#define JOURNAL_LINE_MAX    79
+#define JOURNAL_END_MARK    0xff
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a journal being recorded or replayed.
+ *
+ *   file                   Journal file.
+ *   seed                   Random number seed of the session.
+ *   countryCount           Number of countries in the session's game.
+ *   inputCount             Number of input lines recorded or read.
+ *   ended                  If true, the end record has been read.
+ *   checksum               Checksum from the end record.
+ */
+
+typedef struct
+{
+    FILE                   *file;
+    uint64_t                seed;
+    int                     countryCount;
+    uint32_t                inputCount;
+    bool                    ended;
+    uint64_t                checksum;
+} Journal;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+Journal *JournalCreate(const char *aPath, uint64_t seed, int countryCount);
+
+void JournalRecord(Journal *aJournal, const char *aInput);
+
+void JournalClose(Journal *aJournal, uint64_t checksum);
+
+Journal *JournalOpen(const char *aPath);
+
+bool JournalRead(Journal *aJournal, char *aInput, int size);
+
+void JournalDestroy(Journal *aJournal);
+
+
+#endif /* __JOURNAL_H__ */
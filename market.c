@@ -0,0 +1,608 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire grain market.
+ *
+ *   Lots in use are kept in a binary min-heap ordered by price and then by
+ * sequence number.  Each lot records its own heap index, so a lot can be
+ * cancelled from anywhere in the heap in O(log n) time.  The lots of each
+ * seller are also kept on a doubly linked list so that a seller's lots can be
+ * found without searching the heap.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdlib.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "market.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Initial number of lots in a market.
+ */
+
+#define MARKET_MIN_CAPACITY 64
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static bool MarketGrow(Market *aMarket);
+
+static bool MarketLotBefore(const Market *aMarket, int lot, int otherLot);
+
+static void MarketHeapPlace(Market *aMarket, int heapIndex, int lot);
+
+static void MarketHeapUp(Market *aMarket, int heapIndex);
+
+static void MarketHeapDown(Market *aMarket, int heapIndex);
+
+static void MarketHeapInsert(Market *aMarket, int lot);
+
+static void MarketHeapRemove(Market *aMarket, int lot);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ * Create and return an empty market for the number of sellers specified by
+ * sellerCount.  Return NULL if out of memory.
+ *
+ *   sellerCount            Number of sellers.
+ */
+
+Market *MarketCreate(int sellerCount)
+{
+    Market *market;
+
+    /* Allocate the market. */
+    market = calloc(1, sizeof(Market));
+    if (market == NULL)
+        return NULL;
+    market->sellerCount = sellerCount;
+    market->sellerLotList = malloc(sellerCount * sizeof(int32_t));
+    if ((market->sellerLotList == NULL) || !MarketGrow(market))
+    {
+        MarketDestroy(market);
+        return NULL;
+    }
+    MarketReset(market);
+
+    return market;
+}
+
+
+/*
+ * Destroy the market specified by aMarket.
+ *
+ *   aMarket                Market to destroy.
+ */
+
+void MarketDestroy(Market *aMarket)
+{
+    if (aMarket == NULL)
+        return;
+
+    free(aMarket->lotList);
+    free(aMarket->heap);
+    free(aMarket->holdList);
+    free(aMarket->sellerLotList);
+    free(aMarket);
+}
+
+
+/*
+ * Remove all of the lots from the market specified by aMarket.
+ *
+ *   aMarket                Market.
+ */
+
+void MarketReset(Market *aMarket)
+{
+    int i;
+
+    /* Put all of the lots on the free list. */
+    for (i = 0; i < aMarket->lotCapacity; i++)
+    {
+        aMarket->lotList[i].heapIndex = -1;
+        aMarket->lotList[i].next = i + 1;
+    }
+    aMarket->lotList[aMarket->lotCapacity - 1].next = -1;
+    aMarket->freeLot = 0;
+
+    /* Empty the heap and the seller lot lists. */
+    aMarket->heapCount = 0;
+    for (i = 0; i < aMarket->sellerCount; i++)
+        aMarket->sellerLotList[i] = -1;
+    aMarket->sequence = 0;
+    aMarket->version++;
+}
+
+
+/*
+ *   Grow the lot list of the market specified by aMarket until it holds at
+ * least the number of lots specified by lotCapacity.  Return false if out of
+ * memory.
+ *
+ *   aMarket                Market.
+ *   lotCapacity            Number of lots to hold.
+ */
+
+bool MarketReserve(Market *aMarket, int lotCapacity)
+{
+    while (aMarket->lotCapacity < lotCapacity)
+    {
+        if (!MarketGrow(aMarket))
+            return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *   Put up a lot of the number of bushels of grain specified by grain at the
+ * price specified by price for the seller specified by seller in the market
+ * specified by aMarket.  Return the lot, or -1 if out of memory.
+ *
+ *   aMarket                Market.
+ *   seller                 Player list index of the seller.
+ *   grain                  Bushels of grain.
+ *   price                  Price per bushel.
+ */
+
+int MarketPost(Market *aMarket, int seller, int grain, float price)
+{
+    MarketLot *lot;
+    int        lotIndex;
+
+    /* Get a free lot. */
+    if ((aMarket->freeLot < 0) && !MarketGrow(aMarket))
+        return -1;
+    lotIndex = aMarket->freeLot;
+    lot = &(aMarket->lotList[lotIndex]);
+    aMarket->freeLot = lot->next;
+
+    /* Fill in the lot. */
+    lot->seller = seller;
+    lot->grain = grain;
+    lot->price = price;
+    lot->sequence = aMarket->sequence++;
+    aMarket->version++;
+
+    /* Add the lot to the head of the seller's lot list. */
+    lot->prev = -1;
+    lot->next = aMarket->sellerLotList[seller];
+    if (lot->next >= 0)
+        aMarket->lotList[lot->next].prev = lotIndex;
+    aMarket->sellerLotList[seller] = lotIndex;
+
+    /* Add the lot to the heap. */
+    MarketHeapInsert(aMarket, lotIndex);
+
+    return lotIndex;
+}
+
+
+/*
+ * Cancel the lot specified by lot in the market specified by aMarket.
+ *
+ *   aMarket                Market.
+ *   lot                    Lot to cancel.
+ */
+
+void MarketCancel(Market *aMarket, int lot)
+{
+    MarketLot *marketLot = &(aMarket->lotList[lot]);
+
+    /* Remove the lot from the heap. */
+    MarketHeapRemove(aMarket, lot);
+
+    /* Remove the lot from the seller's lot list. */
+    if (marketLot->prev >= 0)
+        aMarket->lotList[marketLot->prev].next = marketLot->next;
+    else
+        aMarket->sellerLotList[marketLot->seller] = marketLot->next;
+    if (marketLot->next >= 0)
+        aMarket->lotList[marketLot->next].prev = marketLot->prev;
+
+    /* Free the lot. */
+    marketLot->heapIndex = -1;
+    marketLot->next = aMarket->freeLot;
+    aMarket->freeLot = lot;
+    aMarket->version++;
+}
+
+
+/*
+ * Cancel all of the lots of the seller specified by seller in the market
+ * specified by aMarket.
+ *
+ *   aMarket                Market.
+ *   seller                 Player list index of the seller.
+ */
+
+void MarketCancelSeller(Market *aMarket, int seller)
+{
+    while (aMarket->sellerLotList[seller] >= 0)
+        MarketCancel(aMarket, aMarket->sellerLotList[seller]);
+}
+
+
+/*
+ *   Return true if the market specified by aMarket has any lots other than
+ * those of the seller specified by excludeSeller.
+ *
+ *   aMarket                Market.
+ *   excludeSeller          Player list index of the seller to exclude, or -1.
+ */
+
+bool MarketHasLots(const Market *aMarket, int excludeSeller)
+{
+    int lotCount = 0;
+    int lot;
+
+    if (excludeSeller >= 0)
+    {
+        for (lot = aMarket->sellerLotList[excludeSeller];
+             lot >= 0;
+             lot = aMarket->lotList[lot].next)
+        {
+            lotCount++;
+        }
+    }
+
+    return aMarket->heapCount > lotCount;
+}
+
+
+/*
+ *   Buy up to the number of bushels of grain specified by grain for the buyer
+ * specified by buyer from the market specified by aMarket, filling the best
+ * lots first and skipping the buyer's own lots.  The buyer pays each lot's
+ * price divided by the payout specified by payout, and may spend no more than
+ * the amount specified by budget.  The callback specified by callback is
+ * called with the context specified by aContext for each lot filled; lots that
+ * are filled completely are removed from the market.  Return the bushels
+ * bought and the amount spent in aCost.
+ *
+ *   aMarket                Market.
+ *   buyer                  Player list index of the buyer.
+ *   grain                  Bushels of grain to buy.
+ *   budget                 Most the buyer may spend.
+ *   payout                 Fraction of the price paid that goes to the seller.
+ *   aCost                  Returned amount spent.
+ *   callback               Function to call for each lot filled.
+ *   aContext               Context to pass to the callback.
+ */
+
+int MarketBuy(Market             *aMarket,
+              int                 buyer,
+              int                 grain,
+              int                 budget,
+              float               payout,
+              int                *aCost,
+              MarketFillCallback  callback,
+              void               *aContext)
+{
+    MarketLot *lot;
+    int        lotIndex;
+    int        holdCount = 0;
+    int        bought = 0;
+    int        spent = 0;
+    int        fill;
+    int        cost;
+    int        i;
+
+    /* Sweep the book from the best lot. */
+    while ((bought < grain) && (aMarket->heapCount > 0))
+    {
+        /* Hold the buyer's own lots out of the heap. */
+        lotIndex = aMarket->heap[0];
+        lot = &(aMarket->lotList[lotIndex]);
+        if (lot->seller == buyer)
+        {
+            MarketHeapRemove(aMarket, lotIndex);
+            aMarket->holdList[holdCount++] = lotIndex;
+            continue;
+        }
+
+        /* Fill as much of the lot as is wanted and affordable. */
+        fill = grain - bought;
+        if (fill > lot->grain)
+            fill = lot->grain;
+        if (lot->price > 0.0)
+        {
+            if (fill > (((float) (budget - spent)) * payout) / lot->price)
+                fill = (((float) (budget - spent)) * payout) / lot->price;
+            cost = (((float) fill) * lot->price) / payout;
+            while ((fill > 0) && (cost > (budget - spent)))
+            {
+                fill--;
+                cost = (((float) fill) * lot->price) / payout;
+            }
+        }
+        else
+        {
+            cost = 0;
+        }
+        if (fill <= 0)
+            break;
+
+        /* Buy the grain. */
+        bought += fill;
+        spent += cost;
+        lot->grain -= fill;
+        aMarket->version++;
+        callback(aContext, lot->seller, fill, lot->price);
+        if (lot->grain == 0)
+            MarketCancel(aMarket, lotIndex);
+    }
+
+    /* Return the held lots to the heap. */
+    for (i = 0; i < holdCount; i++)
+        MarketHeapInsert(aMarket, aMarket->holdList[i]);
+
+    *aCost = spent;
+
+    return bought;
+}
+
+
+/*
+ *   Return in aLotList up to the number of best lots specified by maxCount in
+ * the market specified by aMarket, best first.  Return the number of lots
+ * returned.
+ *
+ *   aMarket                Market.
+ *   aLotList               Returned list of lots.
+ *   maxCount               Maximum number of lots to return.
+ */
+
+int MarketBestLots(const Market *aMarket, int *aLotList, int maxCount)
+{
+    int frontierList[2 * maxCount + 1];
+    int frontierCount = 0;
+    int lotCount = 0;
+    int best;
+    int heapIndex;
+    int i;
+
+    /*
+     * Walk the heap best first.  The next best lot is always a child of a lot
+     * already taken, so only the frontier of children needs to be searched.
+     */
+    if ((maxCount <= 0) || (aMarket->heapCount == 0))
+        return 0;
+    frontierList[frontierCount++] = 0;
+    while ((lotCount < maxCount) && (frontierCount > 0))
+    {
+        /* Take the best lot on the frontier. */
+        best = 0;
+        for (i = 1; i < frontierCount; i++)
+        {
+            if (MarketLotBefore(aMarket,
+                                aMarket->heap[frontierList[i]],
+                                aMarket->heap[frontierList[best]]))
+            {
+                best = i;
+            }
+        }
+        heapIndex = frontierList[best];
+        frontierList[best] = frontierList[--frontierCount];
+        aLotList[lotCount++] = aMarket->heap[heapIndex];
+
+        /* Add its children to the frontier. */
+        for (i = (2 * heapIndex) + 1; i <= (2 * heapIndex) + 2; i++)
+        {
+            if (i < aMarket->heapCount)
+                frontierList[frontierCount++] = i;
+        }
+    }
+
+    return lotCount;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Double the number of lots in the market specified by aMarket, adding the
+ * new lots to the free list.  Return false if out of memory, leaving the
+ * market unchanged.
+ *
+ *   aMarket                Market.
+ */
+
+static bool MarketGrow(Market *aMarket)
+{
+    MarketLot *lotList;
+    int32_t   *heap;
+    int32_t   *holdList;
+    int        capacity;
+    int        i;
+
+    /* Grow the lists. */
+    capacity = 2 * aMarket->lotCapacity;
+    if (capacity < MARKET_MIN_CAPACITY)
+        capacity = MARKET_MIN_CAPACITY;
+    lotList = realloc(aMarket->lotList, capacity * sizeof(MarketLot));
+    if (lotList == NULL)
+        return FALSE;
+    aMarket->lotList = lotList;
+    heap = realloc(aMarket->heap, capacity * sizeof(int32_t));
+    if (heap == NULL)
+        return FALSE;
+    aMarket->heap = heap;
+    holdList = realloc(aMarket->holdList, capacity * sizeof(int32_t));
+    if (holdList == NULL)
+        return FALSE;
+    aMarket->holdList = holdList;
+
+    /* Put the new lots on the free list. */
+    for (i = aMarket->lotCapacity; i < capacity; i++)
+    {
+        lotList[i].heapIndex = -1;
+        lotList[i].next = i + 1;
+    }
+    lotList[capacity - 1].next = aMarket->freeLot;
+    aMarket->freeLot = aMarket->lotCapacity;
+    aMarket->lotCapacity = capacity;
+
+    return TRUE;
+}
+
+
+/*
+ *   Return true if the lot specified by lot comes before the lot specified by
+ * otherLot in the market specified by aMarket.
+ *
+ *   aMarket                Market.
+ *   lot                    Lot.
+ *   otherLot               Other lot.
+ */
+
+static bool MarketLotBefore(const Market *aMarket, int lot, int otherLot)
+{
+    const MarketLot *a = &(aMarket->lotList[lot]);
+    const MarketLot *b = &(aMarket->lotList[otherLot]);
+
+    if (a->price != b->price)
+        return a->price < b->price;
+
+    return a->sequence < b->sequence;
+}
+
+
+/*
+ *   Place the lot specified by lot at the heap index specified by heapIndex in
+ * the market specified by aMarket.
+ *
+ *   aMarket                Market.
+ *   heapIndex              Heap index.
+ *   lot                    Lot.
+ */
+
+static void MarketHeapPlace(Market *aMarket, int heapIndex, int lot)
+{
+    aMarket->heap[heapIndex] = lot;
+    aMarket->lotList[lot].heapIndex = heapIndex;
+}
+
+
+/*
+ *   Move the lot at the heap index specified by heapIndex in the market
+ * specified by aMarket up the heap until it's in order.
+ *
+ *   aMarket                Market.
+ *   heapIndex              Heap index.
+ */
+
+static void MarketHeapUp(Market *aMarket, int heapIndex)
+{
+    int lot = aMarket->heap[heapIndex];
+    int parent;
+
+    while (heapIndex > 0)
+    {
+        parent = (heapIndex - 1) / 2;
+        if (!MarketLotBefore(aMarket, lot, aMarket->heap[parent]))
+            break;
+        MarketHeapPlace(aMarket, heapIndex, aMarket->heap[parent]);
+        heapIndex = parent;
+    }
+    MarketHeapPlace(aMarket, heapIndex, lot);
+}
+
+
+/*
+ *   Move the lot at the heap index specified by heapIndex in the market
+ * specified by aMarket down the heap until it's in order.
+ *
+ *   aMarket                Market.
+ *   heapIndex              Heap index.
+ */
+
+static void MarketHeapDown(Market *aMarket, int heapIndex)
+{
+    int lot = aMarket->heap[heapIndex];
+    int child;
+
+    while ((child = (2 * heapIndex) + 1) < aMarket->heapCount)
+    {
+        if (   ((child + 1) < aMarket->heapCount)
+            && MarketLotBefore(aMarket,
+                               aMarket->heap[child + 1],
+                               aMarket->heap[child]))
+        {
+            child++;
+        }
+        if (!MarketLotBefore(aMarket, aMarket->heap[child], lot))
+            break;
+        MarketHeapPlace(aMarket, heapIndex, aMarket->heap[child]);
+        heapIndex = child;
+    }
+    MarketHeapPlace(aMarket, heapIndex, lot);
+}
+
+
+/*
+ * Insert the lot specified by lot into the heap of the market specified by
+ * aMarket.
+ *
+ *   aMarket                Market.
+ *   lot                    Lot.
+ */
+
+static void MarketHeapInsert(Market *aMarket, int lot)
+{
+    MarketHeapPlace(aMarket, aMarket->heapCount, lot);
+    aMarket->heapCount++;
+    MarketHeapUp(aMarket, aMarket->heapCount - 1);
+}
+
+
+/*
+ * Remove the lot specified by lot from the heap of the market specified by
+ * aMarket.
+ *
+ *   aMarket                Market.
+ *   lot                    Lot.
+ */
+
+static void MarketHeapRemove(Market *aMarket, int lot)
+{
+    int heapIndex = aMarket->lotList[lot].heapIndex;
+    int lastLot;
+
+    /* Move the last lot into the hole and restore the heap order. */
+    aMarket->heapCount--;
+    lastLot = aMarket->heap[aMarket->heapCount];
+    if (lastLot != lot)
+    {
+        MarketHeapPlace(aMarket, heapIndex, lastLot);
+        MarketHeapUp(aMarket, heapIndex);
+        MarketHeapDown(aMarket, aMarket->lotList[lastLot].heapIndex);
+    }
+}
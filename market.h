@@ -0,0 +1,135 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire grain market header file.
+ *
+ *   The grain market is an order book of lots of grain put up for sale.  Each
+ * seller may have any number of lots.  Lots are filled cheapest first, and
+ * lots at the same price in the order they were put up.  Buyers sweep the book
+ * from the best lot until they have the grain they want, so a purchase may
+ * fill lots from several sellers and leave the last one partly filled.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __MARKET_H__
+#define __MARKET_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a lot of grain for sale.
+ *
+ *   seller                 Player list index of the seller.
+ *   grain                  Bushels of grain left in the lot.
+ *   price                  Price per bushel.
+ *   sequence               Order in which the lot was put up.
+ *   heapIndex              Index of the lot in the market heap, or -1 if the
+ *                          lot is free.
+ *   next                   Next lot of the seller, or next free lot.
+ *   prev                   Previous lot of the seller.
+ */
+
+typedef struct
+{
+    int32_t                 seller;
+    int32_t                 grain;
+    float                   price;
+    uint32_t                sequence;
+    int32_t                 heapIndex;
+    int32_t                 next;
+    int32_t                 prev;
+} MarketLot;
+
+
+/*
+ *   Market fill callback function type.  The callback is called for each lot
+ * filled by a purchase, with the seller, the bushels bought from the lot, and
+ * the lot price.
+ */
+
+typedef void (*MarketFillCallback)(void  *aContext,
+                                   int    seller,
+                                   int    grain,
+                                   float  price);
+
+
+/*
+ *   This structure contains fields for a grain market.  Lots are referred to by
+ * their index in the lot list.
+ *
+ *   lotList                List of lots.
+ *   lotCapacity            Number of entries in the lot, heap, and hold lists.
+ *   freeLot                First free lot, or -1.
+ *   heap                   Binary heap of lots in use, best lot first.
+ *   heapCount              Number of lots in the heap.
+ *   sellerLotList          First lot of each seller, or -1.
+ *   sellerCount            Number of sellers.
+ *   holdList               Lots held out of the heap during a purchase.
+ *   sequence               Sequence number of the next lot put up.
+ *   version                Number of changes made to the market; never reset.
+ */
+
+typedef struct
+{
+    MarketLot              *lotList;
+    int                     lotCapacity;
+    int                     freeLot;
+    int32_t                *heap;
+    int                     heapCount;
+    int32_t                *sellerLotList;
+    int                     sellerCount;
+    int32_t                *holdList;
+    uint32_t                sequence;
+    uint32_t                version;
+} Market;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+Market *MarketCreate(int sellerCount);
+
+void MarketDestroy(Market *aMarket);
+
+void MarketReset(Market *aMarket);
+
+bool MarketReserve(Market *aMarket, int lotCapacity);
+
+int MarketPost(Market *aMarket, int seller, int grain, float price);
+
+void MarketCancel(Market *aMarket, int lot);
+
+void MarketCancelSeller(Market *aMarket, int seller);
+
+bool MarketHasLots(const Market *aMarket, int excludeSeller);
+
+int MarketBuy(Market             *aMarket,
+              int                 buyer,
+              int                 grain,
+              int                 budget,
+              float               payout,
+              int                *aCost,
+              MarketFillCallback  callback,
+              void               *aContext);
+
+int MarketBestLots(const Market *aMarket, int *aLotList, int maxCount);
+
+
+#endif /* __MARKET_H__ */
+
@@ -0,0 +1,789 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire battle odds.
+ *
+ *   A battle is a Markov chain over the number of soldiers on each side and
+ * the land captured.  Each round the player wins with a fixed probability and
+ * kills (soldierCount / 15) + 1 soldiers of the loser, so the player soldier
+ * counts a battle can pass through form a short descending list of levels.
+ * The odds are computed by pushing the probability of each state forward
+ * through the rounds, level by level from the top down.  Each level is a row
+ * of states indexed by the number of target soldiers, and each state holds the
+ * distribution of the land captured so far.  Rounds won move within a row to
+ * fewer target soldiers, and rounds lost move to the same place in the next
+ * row, so a single row is updated in place.
+ *
+ *   The land distribution is what lets the battle end as EngineBattleRound
+ * ends it: when the player loses a round after all of the target land has
+ * been captured, the target is defeated if the player has soldiers left.
+ * Land is tracked acre by acre for targets with up to ODDS_LAND_STEPS acres,
+ * and the odds are then exact.  For larger targets, land is tracked on a grid
+ * of ODDS_LAND_STEPS equal steps from no land to all of it.  Land that falls
+ * between two grid points is split between them so that the expected land of
+ * each round is kept, which makes the odds close but not exact.
+ *
+ *   States less likely than ODDS_MIN_PROBABILITY are dropped, which changes
+ * the odds by far less than the land grid does.  A query costs
+ * O(levels * targetSoldierCount * ODDS_LAND_STEPS^2) time at worst, and memory
+ * for a row of targetSoldierCount * ODDS_LAND_STEPS probabilities.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "battle.h"
+#include "odds.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Odds defs.
+ *
+ *   ODDS_MIN_CAPACITY      Minimum number of entries in an odds table.
+ *   ODDS_LAND_STEPS        Most steps of the land grid.
+ *   ODDS_MIN_PROBABILITY   Probability below which a state is dropped.
+ */
+
+#define ODDS_MIN_CAPACITY       16
+#define ODDS_LAND_STEPS         64
+#define ODDS_MIN_PROBABILITY    1e-15
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the outcomes of a battle that have been
+ * reached so far.
+ *
+ *   winProbability         Probability that the target is defeated.
+ *   soldierCount           Expected final number of player soldiers.
+ *   targetSoldierCount     Expected final number of target soldiers.
+ *   landCaptured           Expected acres of land captured.
+ */
+
+typedef struct
+{
+    double                  winProbability;
+    double                  soldierCount;
+    double                  targetSoldierCount;
+    double                  landCaptured;
+} OddsState;
+
+
+/*
+ *   This structure contains fields for the land captured by a round won at a
+ * player soldier level, as moves on the land grid.
+ *
+ *   stepCount              Number of steps of the land grid.
+ *   low                    Fewest steps moved.
+ *   high                   Most steps moved.
+ *   moveList               Probability of each move from -stepCount to
+ *                          stepCount steps.
+ *   lowSumList             Probability of each move of that many steps or
+ *                          fewer.
+ *   highSumList            Probability of each move of that many steps or
+ *                          more.
+ */
+
+typedef struct
+{
+    int                     stepCount;
+    int                     low;
+    int                     high;
+    double                 *moveList;
+    double                 *lowSumList;
+    double                 *highSumList;
+} OddsLandMove;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void OddsSetLandMove(OddsLandMove *aMove,
+                            int           soldierKillCount,
+                            int           targetLand);
+
+static void OddsCaptureLand(const OddsLandMove *aMove,
+                            const double       *aLandList,
+                            double              probability,
+                            double             *aNewLandList);
+
+static void OddsEnd(OddsState    *aResult,
+                    const double *aLandList,
+                    double        probability,
+                    int           landStepCount,
+                    int           targetLand,
+                    int           soldierCount,
+                    int           targetSoldierCount);
+
+static uint64_t OddsHash(int soldierEfficiency,
+                         int targetSoldierEfficiency,
+                         int soldierCount,
+                         int targetSoldierCount,
+                         int targetLand);
+
+static bool OddsTableGrow(OddsTable *aTable);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ *   Compute the odds of a battle between a player with the number of soldiers
+ * specified by soldierCount with the efficiency specified by soldierEfficiency
+ * and a target with the number of soldiers specified by targetSoldierCount with
+ * the efficiency specified by targetSoldierEfficiency and the acres of land
+ * specified by targetLand.  Return the odds in aOdds.  Return false if memory
+ * could not be allocated.
+ *
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ *   soldierCount           Number of player soldiers.
+ *   targetSoldierCount     Number of target soldiers.
+ *   targetLand             Acres of land of target.
+ *   aOdds                  Returned battle odds.
+ */
+
+bool OddsCompute(int         soldierEfficiency,
+                 int         targetSoldierEfficiency,
+                 int         soldierCount,
+                 int         targetSoldierCount,
+                 int         targetLand,
+                 BattleOdds *aOdds)
+{
+    OddsLandMove  landMove;
+    OddsState     result;
+    double       *landRow;
+    double       *landList;
+    double       *newLandList;
+    double       *moveBuffer;
+    bool         *usedList;
+    double        winProbability;
+    double        lossProbability;
+    double        cappedProbability;
+    double        stateProbability;
+    int           landStepCount;
+    int           soldierKillCount;
+    int           soldiers;
+    int           lossSoldiers;
+    int           targetSoldiers;
+    int           winTargetSoldiers;
+    int           i;
+
+    /* Validate the army sizes. */
+    if (soldierCount < 0)
+        soldierCount = 0;
+    if (targetSoldierCount < 0)
+        targetSoldierCount = 0;
+    if (targetLand < 0)
+        targetLand = 0;
+
+    /* Get the round odds. */
+    winProbability = BattleRoundWinProbability(soldierEfficiency,
+                                               targetSoldierEfficiency);
+    lossProbability = 1.0 - winProbability;
+
+    /* Allocate a row of states and room for the land moves. */
+    landStepCount = targetLand;
+    if (landStepCount > ODDS_LAND_STEPS)
+        landStepCount = ODDS_LAND_STEPS;
+    landRow = calloc((size_t) (targetSoldierCount + 1) * (landStepCount + 1),
+                     sizeof(double));
+    usedList = calloc(targetSoldierCount + 1, sizeof(bool));
+    newLandList = malloc((landStepCount + 1) * sizeof(double));
+    moveBuffer = malloc(3 * (2 * landStepCount + 1) * sizeof(double));
+    if (   (landRow == NULL)
+        || (usedList == NULL)
+        || (newLandList == NULL)
+        || (moveBuffer == NULL))
+    {
+        free(landRow);
+        free(usedList);
+        free(newLandList);
+        free(moveBuffer);
+        return FALSE;
+    }
+    landMove.stepCount = landStepCount;
+    landMove.moveList = moveBuffer;
+    landMove.lowSumList = moveBuffer + (2 * landStepCount + 1);
+    landMove.highSumList = moveBuffer + 2 * (2 * landStepCount + 1);
+
+    /* The battle starts with all target soldiers and no land captured. */
+    memset(&result, 0, sizeof(result));
+    landRow[targetSoldierCount * (landStepCount + 1)] = 1.0;
+    usedList[targetSoldierCount] = TRUE;
+
+    /*
+     *   Work down through the levels.  Every battle fights at least one round,
+     * even one with no soldiers on a side.
+     */
+    soldiers = soldierCount;
+    do
+    {
+        soldierKillCount = (soldiers / 15) + 1;
+        lossSoldiers = soldiers - soldierKillCount;
+        if (lossSoldiers < 0)
+            lossSoldiers = 0;
+        OddsSetLandMove(&landMove, soldierKillCount, targetLand);
+
+        /*
+         *   Play a round from each state, from the most target soldiers down,
+         * so that all of the rounds won that reach a state are in it before it
+         * is played.
+         */
+        for (targetSoldiers = targetSoldierCount;
+             targetSoldiers >= 0;
+             targetSoldiers--)
+        {
+            if (!usedList[targetSoldiers])
+                continue;
+            landList = &(landRow[targetSoldiers * (landStepCount + 1)]);
+
+            /* Drop states too unlikely to change the odds. */
+            stateProbability = 0.0;
+            for (i = 0; i <= landStepCount; i++)
+                stateProbability += landList[i];
+            if (stateProbability < ODDS_MIN_PROBABILITY)
+            {
+                memset(landList, 0, (landStepCount + 1) * sizeof(double));
+                usedList[targetSoldiers] = FALSE;
+                continue;
+            }
+
+            /* Win the round. */
+            winTargetSoldiers = targetSoldiers - soldierKillCount;
+            if (winTargetSoldiers < 0)
+                winTargetSoldiers = 0;
+            OddsCaptureLand(&landMove, landList, winProbability, newLandList);
+            if ((winTargetSoldiers == 0) || (soldiers == 0))
+            {
+                OddsEnd(&result,
+                        newLandList,
+                        1.0,
+                        landStepCount,
+                        targetLand,
+                        soldiers,
+                        winTargetSoldiers);
+            }
+            else
+            {
+                for (i = 0; i <= landStepCount; i++)
+                {
+                    landRow[winTargetSoldiers * (landStepCount + 1) + i] +=
+                        newLandList[i];
+                }
+                usedList[winTargetSoldiers] = TRUE;
+            }
+
+            /*
+             *   Lose the round.  The battle ends if either army is gone, or if
+             * all of the target land has been captured.  Otherwise, the state
+             * moves to the next level.
+             */
+            if ((lossSoldiers == 0) || (targetSoldiers == 0))
+            {
+                OddsEnd(&result,
+                        landList,
+                        lossProbability,
+                        landStepCount,
+                        targetLand,
+                        lossSoldiers,
+                        targetSoldiers);
+                memset(landList, 0, (landStepCount + 1) * sizeof(double));
+                usedList[targetSoldiers] = FALSE;
+            }
+            else
+            {
+                cappedProbability =
+                    lossProbability * landList[landStepCount];
+                result.winProbability += cappedProbability;
+                result.soldierCount += cappedProbability * lossSoldiers;
+                result.targetSoldierCount +=
+                    cappedProbability * targetSoldiers;
+                result.landCaptured += cappedProbability * targetLand;
+                landList[landStepCount] = 0.0;
+                for (i = 0; i < landStepCount; i++)
+                    landList[i] *= lossProbability;
+            }
+        }
+
+        soldiers = lossSoldiers;
+    } while (soldiers > 0);
+
+    free(landRow);
+    free(usedList);
+    free(newLandList);
+    free(moveBuffer);
+
+    /* Return the odds. */
+    aOdds->winProbability = result.winProbability;
+    aOdds->landCaptured = result.landCaptured;
+    aOdds->soldierLoss = soldierCount - result.soldierCount;
+    aOdds->targetSoldierLoss = targetSoldierCount - result.targetSoldierCount;
+
+    return TRUE;
+}
+
+
+/*
+ * Create an odds table with room for about the number of entries specified by
+ * capacity.  The table grows as needed.  Return NULL if memory could not be
+ * allocated.
+ *
+ *   capacity               Initial number of entries.
+ */
+
+OddsTable *OddsTableCreate(int capacity)
+{
+    OddsTable *table;
+    int        entryCapacity;
+
+    /* Round the capacity up to a power of two. */
+    entryCapacity = ODDS_MIN_CAPACITY;
+    while (entryCapacity < capacity)
+        entryCapacity *= 2;
+
+    /* Allocate the table. */
+    table = calloc(1, sizeof(OddsTable));
+    if (table == NULL)
+        return NULL;
+    table->entryList = calloc(entryCapacity, sizeof(OddsEntry));
+    if (table->entryList == NULL)
+    {
+        free(table);
+        return NULL;
+    }
+    table->capacity = entryCapacity;
+
+    return table;
+}
+
+
+/*
+ * Destroy the odds table specified by aTable.
+ *
+ *   aTable                 Odds table to destroy.
+ */
+
+void OddsTableDestroy(OddsTable *aTable)
+{
+    if (aTable == NULL)
+        return;
+
+    free(aTable->entryList);
+    free(aTable);
+}
+
+
+/*
+ *   Look up the odds of a battle in the odds table specified by aTable,
+ * computing and adding them if they're not in the table.  Return the odds in
+ * aOdds.  Return false if the odds could not be computed.  See OddsCompute for
+ * a description of the battle parameters.
+ *
+ *   aTable                 Odds table.
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ *   soldierCount           Number of player soldiers.
+ *   targetSoldierCount     Number of target soldiers.
+ *   targetLand             Acres of land of target.
+ *   aOdds                  Returned battle odds.
+ */
+
+bool OddsLookup(OddsTable  *aTable,
+                int         soldierEfficiency,
+                int         targetSoldierEfficiency,
+                int         soldierCount,
+                int         targetSoldierCount,
+                int         targetLand,
+                BattleOdds *aOdds)
+{
+    OddsEntry *entry;
+    int        mask;
+    int        index;
+
+    /* Efficiencies that don't fit in an entry aren't cached. */
+    if (   (soldierEfficiency < 0)
+        || (soldierEfficiency > UINT8_MAX)
+        || (targetSoldierEfficiency < 0)
+        || (targetSoldierEfficiency > UINT8_MAX))
+    {
+        return OddsCompute(soldierEfficiency,
+                           targetSoldierEfficiency,
+                           soldierCount,
+                           targetSoldierCount,
+                           targetLand,
+                           aOdds);
+    }
+
+    /* Use the same key for all values that give the same odds. */
+    if (soldierCount < 0)
+        soldierCount = 0;
+    if (targetSoldierCount < 0)
+        targetSoldierCount = 0;
+    if (targetLand < 0)
+        targetLand = 0;
+
+    /* Look for the entry. */
+    aTable->lookupCount++;
+    mask = aTable->capacity - 1;
+    index = OddsHash(soldierEfficiency,
+                     targetSoldierEfficiency,
+                     soldierCount,
+                     targetSoldierCount,
+                     targetLand) & mask;
+    for (entry = &(aTable->entryList[index]);
+         entry->used;
+         index = (index + 1) & mask, entry = &(aTable->entryList[index]))
+    {
+        if (   (entry->soldierEfficiency == soldierEfficiency)
+            && (entry->targetSoldierEfficiency == targetSoldierEfficiency)
+            && (entry->soldierCount == soldierCount)
+            && (entry->targetSoldierCount == targetSoldierCount)
+            && (entry->targetLand == targetLand))
+        {
+            aTable->hitCount++;
+            *aOdds = entry->odds;
+            return TRUE;
+        }
+    }
+
+    /* Compute the odds. */
+    if (!OddsCompute(soldierEfficiency,
+                     targetSoldierEfficiency,
+                     soldierCount,
+                     targetSoldierCount,
+                     targetLand,
+                     aOdds))
+    {
+        return FALSE;
+    }
+
+    /*
+     * Keep the table at most three quarters full.  If it can't grow, leave the
+     * odds out of it.
+     */
+    if ((4 * (aTable->entryCount + 1)) > (3 * aTable->capacity))
+    {
+        if (!OddsTableGrow(aTable))
+            return TRUE;
+        mask = aTable->capacity - 1;
+        index = OddsHash(soldierEfficiency,
+                         targetSoldierEfficiency,
+                         soldierCount,
+                         targetSoldierCount,
+                         targetLand) & mask;
+        while (aTable->entryList[index].used)
+            index = (index + 1) & mask;
+        entry = &(aTable->entryList[index]);
+    }
+
+    /* Add the entry. */
+    entry->soldierEfficiency = soldierEfficiency;
+    entry->targetSoldierEfficiency = targetSoldierEfficiency;
+    entry->used = TRUE;
+    entry->soldierCount = soldierCount;
+    entry->targetSoldierCount = targetSoldierCount;
+    entry->targetLand = targetLand;
+    entry->odds = *aOdds;
+    aTable->entryCount++;
+
+    return TRUE;
+}
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Set the land moves specified by aMove for a round won at the player
+ * soldier level that kills the number of soldiers specified by
+ * soldierKillCount against a target with the acres of land specified by
+ * targetLand.  The round captures RngRange(26 * soldierKillCount) acres less
+ * RngRange(soldierKillCount + 5) acres, and each number of acres is moved onto
+ * the two nearest grid steps.  Moves past either end of the grid are the same
+ * as moves to the end.
+ *
+ *   aMove                  Land moves to set.  The number of steps must be set.
+ *   soldierKillCount       Number of soldiers killed by a round won.
+ *   targetLand             Acres of land of target.
+ */
+
+static void OddsSetLandMove(OddsLandMove *aMove,
+                            int           soldierKillCount,
+                            int           targetLand)
+{
+    double *moveList;
+    double  drawCount;
+    double  probability;
+    double  position;
+    double  fraction;
+    int     stepCount;
+    int     land;
+    int     step;
+    int     low;
+    int     high;
+    int     i;
+
+    /* Clear the moves, indexed from -stepCount. */
+    stepCount = aMove->stepCount;
+    moveList = aMove->moveList + stepCount;
+    memset(aMove->moveList, 0, (2 * stepCount + 1) * sizeof(double));
+
+    /* Add the probability of each number of acres captured. */
+    drawCount = (26.0 * soldierKillCount) * (soldierKillCount + 5);
+    for (land = -(soldierKillCount + 4);
+         land < 26 * soldierKillCount;
+         land++)
+    {
+        /* Count the draws that capture this land. */
+        low = 1 - land;
+        if (low < 1)
+            low = 1;
+        high = (26 * soldierKillCount) - land;
+        if (high > soldierKillCount + 5)
+            high = soldierKillCount + 5;
+        probability = (high - low + 1) / drawCount;
+
+        /* Split the land between the two nearest steps. */
+        if (stepCount == 0)
+        {
+            moveList[0] += probability;
+            continue;
+        }
+        position = ((double) land * stepCount) / targetLand;
+        step = floor(position);
+        fraction = position - step;
+        if (step < -stepCount)
+            moveList[-stepCount] += probability;
+        else if (step >= stepCount)
+            moveList[stepCount] += probability;
+        else
+        {
+            moveList[step] += probability * (1.0 - fraction);
+            moveList[step + 1] += probability * fraction;
+        }
+    }
+
+    /* Find the range of moves and sum them from each end. */
+    aMove->low = -stepCount;
+    while ((aMove->low < stepCount) && (moveList[aMove->low] == 0.0))
+        aMove->low++;
+    aMove->high = stepCount;
+    while ((aMove->high > aMove->low) && (moveList[aMove->high] == 0.0))
+        aMove->high--;
+    aMove->lowSumList[0] = aMove->moveList[0];
+    for (i = 1; i <= 2 * stepCount; i++)
+    {
+        aMove->lowSumList[i] = aMove->lowSumList[i - 1] + aMove->moveList[i];
+    }
+    aMove->highSumList[2 * stepCount] = aMove->moveList[2 * stepCount];
+    for (i = 2 * stepCount - 1; i >= 0; i--)
+    {
+        aMove->highSumList[i] = aMove->highSumList[i + 1] + aMove->moveList[i];
+    }
+}
+
+
+/*
+ *   Capture land in a round won, starting from the land distribution specified
+ * by aLandList, with the probability of winning the round specified by
+ * probability.  Return the land distribution after the round in aNewLandList.
+ *
+ *   aMove                  Land moves of the round.
+ *   aLandList              Land distribution before the round.
+ *   probability            Probability of winning the round.
+ *   aNewLandList           Returned land distribution after the round.
+ */
+
+static void OddsCaptureLand(const OddsLandMove *aMove,
+                            const double       *aLandList,
+                            double              probability,
+                            double             *aNewLandList)
+{
+    const double *moveList;
+    double        mass;
+    int           stepCount;
+    int           low;
+    int           high;
+    int           step;
+    int           move;
+
+    stepCount = aMove->stepCount;
+    moveList = aMove->moveList + stepCount;
+    memset(aNewLandList, 0, (stepCount + 1) * sizeof(double));
+    for (step = 0; step <= stepCount; step++)
+    {
+        mass = probability * aLandList[step];
+        if (mass == 0.0)
+            continue;
+
+        /* Moves to or past either end of the grid stop at the end. */
+        aNewLandList[0] += mass * aMove->lowSumList[stepCount - step];
+        if (stepCount > 0)
+        {
+            aNewLandList[stepCount] +=
+                mass * aMove->highSumList[2 * stepCount - step];
+        }
+
+        /* Moves within the grid. */
+        low = -step + 1;
+        if (low < aMove->low)
+            low = aMove->low;
+        high = stepCount - step - 1;
+        if (high > aMove->high)
+            high = aMove->high;
+        for (move = low; move <= high; move++)
+            aNewLandList[step + move] += mass * moveList[move];
+    }
+}
+
+
+/*
+ *   Add the battles that end with the land distribution specified by aLandList
+ * times the probability specified by probability to the outcomes specified by
+ * aResult.  The battles end with the number of player soldiers specified by
+ * soldierCount and the number of target soldiers specified by
+ * targetSoldierCount.
+ *
+ *   aResult                Outcomes reached so far.
+ *   aLandList              Land distribution at the end.
+ *   probability            Probability to scale the land distribution by.
+ *   landStepCount          Number of steps of the land grid.
+ *   targetLand             Acres of land of target.
+ *   soldierCount           Final number of player soldiers.
+ *   targetSoldierCount     Final number of target soldiers.
+ */
+
+static void OddsEnd(OddsState    *aResult,
+                    const double *aLandList,
+                    double        probability,
+                    int           landStepCount,
+                    int           targetLand,
+                    int           soldierCount,
+                    int           targetSoldierCount)
+{
+    double mass = 0.0;
+    double land = 0.0;
+    int    step;
+
+    for (step = 0; step <= landStepCount; step++)
+    {
+        mass += aLandList[step];
+        if (step > 0)
+            land += aLandList[step] * targetLand * step / landStepCount;
+    }
+    mass *= probability;
+    land *= probability;
+
+    if (soldierCount > 0)
+        aResult->winProbability += mass;
+    aResult->soldierCount += mass * soldierCount;
+    aResult->targetSoldierCount += mass * targetSoldierCount;
+    aResult->landCaptured += land;
+}
+
+
+
+/*
+ * Return the hash of an odds table key.
+ *
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ *   soldierCount           Number of player soldiers.
+ *   targetSoldierCount     Number of target soldiers.
+ *   targetLand             Acres of land of target.
+ */
+
+static uint64_t OddsHash(int soldierEfficiency,
+                         int targetSoldierEfficiency,
+                         int soldierCount,
+                         int targetSoldierCount,
+                         int targetLand)
+{
+    uint64_t hash;
+
+    hash =   (((uint64_t) soldierEfficiency << 8) | targetSoldierEfficiency)
+           * 0x9E3779B97F4A7C15ULL;
+    hash = (hash ^ (uint32_t) soldierCount) * 0xBF58476D1CE4E5B9ULL;
+    hash = (hash ^ (uint32_t) targetSoldierCount) * 0x94D049BB133111EBULL;
+    hash = (hash ^ (uint32_t) targetLand) * 0x9E3779B97F4A7C15ULL;
+
+    return hash ^ (hash >> 32);
+}
+
+
+/*
+ *   Double the capacity of the odds table specified by aTable.  Return false if
+ * memory could not be allocated, leaving the table unchanged.
+ *
+ *   aTable                 Odds table.
+ */
+
+static bool OddsTableGrow(OddsTable *aTable)
+{
+    OddsEntry *entryList;
+    OddsEntry *entry;
+    int        capacity;
+    int        mask;
+    int        index;
+    int        i;
+
+    /* Allocate the new entry list. */
+    capacity = 2 * aTable->capacity;
+    entryList = calloc(capacity, sizeof(OddsEntry));
+    if (entryList == NULL)
+        return FALSE;
+
+    /* Move the entries into the new list. */
+    mask = capacity - 1;
+    for (i = 0; i < aTable->capacity; i++)
+    {
+        entry = &(aTable->entryList[i]);
+        if (!entry->used)
+            continue;
+        index = OddsHash(entry->soldierEfficiency,
+                         entry->targetSoldierEfficiency,
+                         entry->soldierCount,
+                         entry->targetSoldierCount,
+                         entry->targetLand) & mask;
+        while (entryList[index].used)
+            index = (index + 1) & mask;
+        entryList[index] = *entry;
+    }
+
+    /* Replace the entry list. */
+    free(aTable->entryList);
+    aTable->entryList = entryList;
+    aTable->capacity = capacity;
+
+    return TRUE;
+}
+
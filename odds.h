@@ -0,0 +1,123 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire battle odds header file.
+ *
+ *   The battle odds module computes the odds of a battle by dynamic
+ * programming over the rounds of the battle, and caches them in odds tables so
+ * that strategies weighing many attacks can look them up cheaply.  The odds
+ * are exact for targets with little land, and close for larger targets, whose
+ * land is tracked on a grid, as described in odds.c.  An odds table belongs to
+ * a single thread.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __ODDS_H__
+#define __ODDS_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the odds of a battle.
+ *
+ *   winProbability         Probability that the target is defeated.
+ *   landCaptured           Expected acres of land captured.
+ *   soldierLoss            Expected number of player soldiers lost.
+ *   targetSoldierLoss      Expected number of target soldiers lost.
+ */
+
+typedef struct
+{
+    float                   winProbability;
+    float                   landCaptured;
+    float                   soldierLoss;
+    float                   targetSoldierLoss;
+} BattleOdds;
+
+
+/*
+ * This structure contains fields for an odds table entry.
+ *
+ *   soldierEfficiency      Efficiency of player soldiers.
+ *   targetSoldierEfficiency
+ *                          Efficiency of target soldiers.
+ *   used                   If true, the entry is in use.
+ *   soldierCount           Number of player soldiers.
+ *   targetSoldierCount     Number of target soldiers.
+ *   targetLand             Acres of land of target.
+ *   odds                   Battle odds.
+ */
+
+typedef struct
+{
+    uint8_t                 soldierEfficiency;
+    uint8_t                 targetSoldierEfficiency;
+    uint16_t                used;
+    int32_t                 soldierCount;
+    int32_t                 targetSoldierCount;
+    int32_t                 targetLand;
+    BattleOdds              odds;
+} OddsEntry;
+
+
+/*
+ * This structure contains fields for an odds table.
+ *
+ *   entryList              List of entries.
+ *   capacity               Number of entries in the entry list.
+ *   entryCount             Number of entries in use.
+ *   lookupCount            Number of lookups.
+ *   hitCount               Number of lookups found in the table.
+ */
+
+typedef struct
+{
+    OddsEntry              *entryList;
+    int                     capacity;
+    int                     entryCount;
+    uint64_t                lookupCount;
+    uint64_t                hitCount;
+} OddsTable;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+bool OddsCompute(int         soldierEfficiency,
+                 int         targetSoldierEfficiency,
+                 int         soldierCount,
+                 int         targetSoldierCount,
+                 int         targetLand,
+                 BattleOdds *aOdds);
+
+OddsTable *OddsTableCreate(int capacity);
+
+void OddsTableDestroy(OddsTable *aTable);
+
+bool OddsLookup(OddsTable  *aTable,
+                int         soldierEfficiency,
+                int         targetSoldierEfficiency,
+                int         soldierCount,
+                int         targetSoldierCount,
+                int         targetLand,
+                BattleOdds *aOdds);
+
+
+#endif /* __ODDS_H__ */
+
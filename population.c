@@ -11,12 +11,11 @@
  * Includes.
  */
 
-/* System includes. */
-#include <math.h>
-#include <ncurses.h>
-
 /* Local includes. */
 #include "empire.h"
+#include "engine.h"
+#include "population.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -24,7 +23,11 @@
  * Prototypes.
  */
 
-static void PlayerDeath(Player *aPlayer);
+static void DrawPopulationScreen(Game   *aGame,
+                                 Player *aPlayer,
+                                 Render *aRender);
+
+static void PlayerDeath(Session *aSession);
 
 
 /*------------------------------------------------------------------------------
@@ -33,225 +36,244 @@ static void PlayerDeath(Player *aPlayer);
  */
 
 /*
- * Manage population for the player specified by aPlayer.
+ *   Enter the current population screen state of the session specified by
+ * aSession.  The population screen updates and reports the population of the
+ * player whose turn it is, and then checks if the player died.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
  */
 
-void PopulationScreen(Player *aPlayer)
+void PopulationScreenEnter(Session *aSession)
 {
-    char     input[80];
-    Country *country;
-    int      population;
-    int      populationGain;
-    int      born;
-    int      immigrated;
-    int      merchantsImmigrated;
-    int      noblesImmigrated;
-    int      diedDisease;
-    int      diedMalnutrition;
-    int      diedStarvation;
-    int      armyDiedStarvation;
-    int      armyDeserted;
+    switch (aSession->state)
+    {
+        case SESSION_POPULATION :
+            DrawPopulationScreen(aSession->game,
+                                 aSession->player,
+                                 &(aSession->render));
+            break;
+
+        case SESSION_PLAYER_DEATH :
+            PlayerDeath(aSession);
+            break;
+
+        default :
+            break;
+    }
+}
 
-    /* Get the player country. */
-    country = aPlayer->country;
 
-    /* Reset screen. */
-    clear();
-    move(0, 0);
+/*
+ *   Handle the input line specified by aInput for the current population screen
+ * state of the session specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
 
-    /* Display the ruler and country. */
-    printw("%s %s OF %s:\n", aPlayer->title, aPlayer->name, country->name);
+void PopulationScreenInput(Session *aSession, const char *aInput)
+{
+    /* Check if player died. */
+    SessionGoto(aSession, SESSION_PLAYER_DEATH);
+}
 
-    /* Display the year. */
-    printw("IN YEAR %d,\n\n", year);
 
-    /* Determine the total population. */
-    population =   aPlayer->serfCount
-                 + aPlayer->merchantCount
-                 + aPlayer->nobleCount;
+/*------------------------------------------------------------------------------
+ *
+ * Internal population screen functions.
+ */
 
-    /* Determine the number of babies born. */
-    born = RandRange(((int) (((float) population) / 9.5)));
+/*
+ *   Update the population of the player specified by aPlayer and draw the
+ * population screen.
+ *
+ *   aGame                  Game.
+ *   aPlayer                Player.
+ *   aRender                Renderer.
+ */
 
-    /* Determine the number of people who died from disease. */
-    diedDisease = RandRange(population / 22);
+static void DrawPopulationScreen(Game   *aGame,
+                                 Player *aPlayer,
+                                 Render *aRender)
+{
+    PopulationReport report;
+    const Country   *country;
 
-    /* Determine the number of people who died of starvation and */
-    /* malnutrition.                                             */
-    diedStarvation = 0;
-    diedMalnutrition = 0;
-    if (aPlayer->peopleGrainNeed > (2 * aPlayer->peopleGrainFeed))
-    {
-        diedMalnutrition = RandRange(population/12 + 1);
-        diedStarvation = RandRange(population/16 + 1);
-    }
-    else if (aPlayer->peopleGrainNeed > aPlayer->peopleGrainFeed)
-    {
-        diedMalnutrition = RandRange(population/15 + 1);
-    }
-    aPlayer->diedStarvation = diedStarvation;
+    /* Get the player country. */
+    country = PlayerCountry(aGame, aPlayer);
 
-    /* Determine the number of people who immigrated. */
-    if (((float) aPlayer->peopleGrainFeed) >
-        (1.5 * ((float) aPlayer->peopleGrainNeed)))
-    {
-        immigrated =
-              ((int) sqrt(aPlayer->peopleGrainFeed - aPlayer->peopleGrainNeed))
-            - RandRange((int) (1.5 * ((float) aPlayer->customsTax)));
-        if (immigrated > 0)
-            immigrated = RandRange(((2 * immigrated) + 1));
-        else
-            immigrated = 0;
-    }
-    else
-    {
-        immigrated = 0;
-    }
-    aPlayer->immigrated = immigrated;
-
-    /* Determine the number of merchants and nobles who immigrated. */
-    merchantsImmigrated = 0;
-    noblesImmigrated = 0;
-    if ((immigrated / 5) > 0)
-        merchantsImmigrated = RandRange(immigrated / 5);
-    if ((immigrated / 25) > 0)
-        noblesImmigrated = RandRange(immigrated / 25);
-
-    /* Determine the number of soldiers who died of starvation or deserted. */
-    armyDiedStarvation = 0;
-    armyDeserted = 0;
-    if (aPlayer->armyGrainNeed > (2 * aPlayer->armyGrainFeed))
-    {
-        armyDiedStarvation = RandRange(aPlayer->soldierCount/2 + 1);
-        aPlayer->soldierCount -= armyDiedStarvation;
-        armyDeserted = RandRange(aPlayer->soldierCount / 5);
-        aPlayer->soldierCount -= armyDeserted;
-    }
+    /* Reset screen. */
+    RenderErase(aRender);
+    RenderMove(aRender, 0, 0);
+
+    /* Display the ruler and country. */
+    RenderPrint(aRender,
+                "%s %s OF %s:\n",
+                PlayerTitle(aGame, aPlayer),
+                PlayerName(aGame, aPlayer),
+                country->name);
+
+    /* Display the year. */
+    RenderPrint(aRender, "IN YEAR %d,\n\n", aGame->year);
 
-    /* Determine the army's efficiency. */
-    aPlayer->armyEfficiency =   (10 * aPlayer->armyGrainFeed)
-                              / aPlayer->armyGrainNeed;
-    if (aPlayer->armyEfficiency < 5)
-        aPlayer->armyEfficiency = 5;
-    else if (aPlayer->armyEfficiency > 15)
-        aPlayer->armyEfficiency = 15;
+    /* Update population. */
+    EnginePopulation(aGame, aPlayer, &report);
 
     /* Display the number of babies born. */
-    printw(" %d BABIES WERE BORN\n", born);
+    RenderPrint(aRender, " %d BABIES WERE BORN\n", report.born);
 
     /* Display the number of people who died of disease. */
-    printw(" %d PEOPLE DIED OF DISEASE\n", diedDisease);
+    RenderPrint(aRender, " %d PEOPLE DIED OF DISEASE\n", report.diedDisease);
 
     /* Display the number of people who immigrated. */
-    if (immigrated > 0)
-        printw(" %d PEOPLE IMMIGRATED INTO YOUR COUNTRY.\n", immigrated);
+    if (report.immigrated > 0)
+    {
+        RenderPrint(aRender,
+                    " %d PEOPLE IMMIGRATED INTO YOUR COUNTRY.\n",
+                    report.immigrated);
+    }
 
     /* Display the number of people who died of starvation and malnutrition. */
-    if (diedMalnutrition > 0)
-        printw(" %d PEOPLE DIED OF MALNUTRITION.\n", diedMalnutrition);
-    if (diedStarvation > 0)
-        printw(" %d PEOPLE STARVED TO DEATH.\n", diedStarvation);
+    if (report.diedMalnutrition > 0)
+        RenderPrint(aRender,
+                    " %d PEOPLE DIED OF MALNUTRITION.\n",
+                    report.diedMalnutrition);
+    if (report.diedStarvation > 0)
+        RenderPrint(aRender,
+                    " %d PEOPLE STARVED TO DEATH.\n",
+                    report.diedStarvation);
 
     /* Display the number of soldiers who starved to death. */
-    if (armyDiedStarvation > 0)
-        printw(" %d SOLDIERS STARVED TO DEATH.\n", armyDiedStarvation);
+    if (report.armyDiedStarvation > 0)
+    {
+        RenderPrint(aRender,
+                    " %d SOLDIERS STARVED TO DEATH.\n",
+                    report.armyDiedStarvation);
+    }
 
     /* Display the army efficiency. */
-    printw("YOUR ARMY WILL FIGHT AT %d%% EFFICIENCY.\n",
-           10 * aPlayer->armyEfficiency);
+    RenderPrint(aRender,
+                "YOUR ARMY WILL FIGHT AT %d%% EFFICIENCY.\n",
+                10 * aPlayer->armyEfficiency);
 
     /* Display the population gain or loss. */
-    populationGain =
-        born + immigrated - diedDisease - diedMalnutrition - diedStarvation;
-    if (populationGain >= 0)
-        printw("YOUR POPULATION GAINED %d CITIZENS.\n", populationGain);
+    if (report.populationGain >= 0)
+    {
+        RenderPrint(aRender,
+                    "YOUR POPULATION GAINED %d CITIZENS.\n",
+                    report.populationGain);
+    }
     else
-        printw("YOUR POPULATION LOST %d CITIZENS.\n", -populationGain);
-
-    /* Update population. */
-    aPlayer->serfCount +=
-        populationGain - merchantsImmigrated - noblesImmigrated;
-    aPlayer->merchantCount += merchantsImmigrated;
-    aPlayer->nobleCount += noblesImmigrated;
+    {
+        RenderPrint(aRender,
+                    "YOUR POPULATION LOST %d CITIZENS.\n",
+                    -report.populationGain);
+    }
 
     /* Wait for player to be done. */
-    printw("\n\n<ENTER>? ");
-    getnstr(input, 80);
-
-    /* Check if player died. */
-    PlayerDeath(aPlayer);
+    RenderPrint(aRender, "\n\n<ENTER>? ");
 }
 
 
 /*
- * Check if any event happened that killed the player specified by aPlayer.
+ *   Check if any event happened that killed the player whose turn it is in the
+ * session specified by aSession.  The player's turn goes on to the investments
+ * screen even if they died, unless all of the human players are dead.
  *
- *   aPlayer                Player.
+ *   aSession               Session.
  */
 
-static void PlayerDeath(Player *aPlayer)
+static void PlayerDeath(Session *aSession)
 {
-    Country *country;
+    Game          *game;
+    Player        *player;
+    const Country *country;
+    Render        *render;
+    int            cause;
+
+    render = &(aSession->render);
 
     /* Get the player country. */
-    country = aPlayer->country;
+    game = aSession->game;
+    player = aSession->player;
+    country = PlayerCountry(game, player);
 
-    /* If anyone starved to death, their mother might assassinate the ruler. */
-    if ((aPlayer->diedStarvation > 0) &&
-        (RandRange(aPlayer->diedStarvation) > RandRange(110)))
+    /* Check if the player died. */
+    cause = EnginePlayerDeath(game, player);
+
+    /* Go on to the investments screen unless all human players have died. */
+    if (EngineHumansDead(game))
     {
-        aPlayer->dead = TRUE;
-        clear();
-        move(0, 0);
-        printw("VERY SAD NEWS ...\n\n");
-        printw("%s %s OF %s HAS BEEN ASSASSINATED\n",
-            aPlayer->title,
-            aPlayer->name,
-            country->name);
-        printw("BY A CRAZED MOTHER WHOSE CHILD HAD STARVED TO DEATH. . .\n\n");
+        game->gameOver = TRUE;
+        SessionGoto(aSession, SESSION_NEXT_PLAYER);
     }
-
-    /* Check if the player died for any other reason. */
-    if (RandRange(100) == 1)
+    else
     {
-        aPlayer->dead = TRUE;
-        clear();
-        move(0, 0);
-        printw("VERY SAD NEWS ...\n\n");
-        printw("%s %s ", aPlayer->title, aPlayer->name);
-        switch(RandRange(4))
-        {
-            case 1 :
-                printw("HAS BEEN ASSASSINATED BY AN AMBITIOUS\nNOBLE\n\n");
-                break;
-
-            case 2 :
-                printw("HAS BEEN KILLED FROM A FALL DURING\n"
-                       "THE ANNUAL FOX-HUNT.\n\n");
-                break;
-
-            case 3 :
-                printw("DIED OF ACUTE FOOD POISONING.\n"
-                       "THE ROYAL COOK WAS SUMMARILY EXECUTED.\n\n");
-                break;
-
-            case 4 :
-            default :
-                printw("PASSED AWAY THIS WINTER FROM A WEAK HEART.\n\n");
-                break;
-        }
+        SessionGoto(aSession, SESSION_INVESTMENTS);
     }
-
-    /* If the player died, display the funeral. */
-    if (aPlayer->dead)
+    if (cause == DEATH_NONE)
+        return;
+
+    /* Display the cause of death. */
+    RenderErase(render);
+    RenderMove(render, 0, 0);
+    RenderPrint(render, "VERY SAD NEWS ...\n\n");
+    switch (cause)
     {
-        printw("THE OTHER NATION-STATES HAVE SENT REPRESENTATIVES TO THE\n");
-        printw("FUNERAL\n");
-        refresh();
-        sleep(2 * DELAY_TIME);
+        case DEATH_STARVED_CHILD :
+            RenderPrint(render,
+                        "%s %s OF %s HAS BEEN ASSASSINATED\n",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player),
+                        country->name);
+            RenderPrint(render,
+                        "BY A CRAZED MOTHER WHOSE CHILD HAD "
+                        "STARVED TO DEATH. . .\n\n");
+            break;
+
+        case DEATH_AMBITIOUS_NOBLE :
+            RenderPrint(render,
+                        "%s %s ",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render,
+                        "HAS BEEN ASSASSINATED BY AN AMBITIOUS\nNOBLE\n\n");
+            break;
+
+        case DEATH_FOX_HUNT :
+            RenderPrint(render,
+                        "%s %s ",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render,
+                        "HAS BEEN KILLED FROM A FALL DURING\n"
+                        "THE ANNUAL FOX-HUNT.\n\n");
+            break;
+
+        case DEATH_FOOD_POISONING :
+            RenderPrint(render,
+                        "%s %s ",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render,
+                        "DIED OF ACUTE FOOD POISONING.\n"
+                        "THE ROYAL COOK WAS SUMMARILY EXECUTED.\n\n");
+            break;
+
+        case DEATH_WEAK_HEART :
+        default :
+            RenderPrint(render,
+                        "%s %s ",
+                        PlayerTitle(game, player),
+                        PlayerName(game, player));
+            RenderPrint(render,
+                        "PASSED AWAY THIS WINTER FROM A WEAK HEART.\n\n");
+            break;
     }
-}
-
 
+    /* Display the funeral. */
+    RenderPrint(render,
+                "THE OTHER NATION-STATES HAVE SENT REPRESENTATIVES TO THE\n");
+    RenderPrint(render, "FUNERAL\n");
+    SessionDelay(aSession, 2 * DELAY_TIME);
+}
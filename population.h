@@ -16,6 +16,7 @@
 
 /* Local includes. */
 #include "empire.h"
+#include "session.h"
 
 
 /*------------------------------------------------------------------------------
@@ -23,7 +24,9 @@
  * Prototypes.
  */
 
-void PopulationScreen(Player *aPlayer);
+void PopulationScreenEnter(Session *aSession);
+
+void PopulationScreenInput(Session *aSession, const char *aInput);
 
 
 #endif /* __POPULATION_H__ */
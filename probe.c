@@ -0,0 +1,524 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire phase probes.
+ *
+ *   Each thread counts into its own probe record, so probes never contend.
+ * Records are pushed onto a global list when a thread first probes and are
+ * never freed, so the counts of threads that have exited are still dumped.
+ * The dump only reads the records and writes with write(2), so it may run in
+ * a signal handler.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "probe.h"
+
+#ifdef PROBE
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Cycles are read from the time stamp counter where there is one, and are
+ * otherwise nanoseconds.
+ */
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PROBE_CYCLE_UNIT    "cycles"
+#else
+#define PROBE_CYCLE_UNIT    "ns"
+#endif
+
+
+/*
+ * Size of the dump buffer.  The dump is written in one piece.
+ */
+
+#define PROBE_DUMP_SIZE     2048
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ *   This structure contains fields for the probe counts of a thread.  Counts
+ * are only written by their own thread, but are atomic so that a dump may read
+ * them at any time.
+ *
+ *   next                   Next probe record in the list.
+ *   counterFdList          Hardware counter file descriptors, or -1.  The
+ *                          first is the group leader.
+ *   callCountList          Number of calls to each phase.
+ *   cycleCountList         Number of cycles spent in each phase.
+ *   counterCountList       Hardware counts of each phase.
+ */
+
+typedef struct ProbeThread
+{
+    struct ProbeThread     *next;
+    int                     counterFdList[PROBE_COUNTER_COUNT];
+    _Atomic uint64_t        callCountList[PROBE_COUNT];
+    _Atomic uint64_t        cycleCountList[PROBE_COUNT];
+    _Atomic uint64_t        counterCountList[PROBE_COUNT]
+                                            [PROBE_COUNTER_COUNT];
+} ProbeThread;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ * Probe globals.
+ *
+ *   probeThreadList        List of the probe records of all threads.
+ *   probeThread            Probe record of this thread.
+ *   probeCounters          If true, count hardware events.
+ *   probePhaseNameList     Name of each phase.
+ *   probeCounterConfigList perf event of each hardware counter.
+ */
+
+static _Atomic(ProbeThread *) probeThreadList;
+static _Thread_local ProbeThread *probeThread;
+static bool probeCounters;
+
+static const char *const probePhaseNameList[PROBE_COUNT] =
+{
+    "new year",
+    "harvest",
+    "population",
+    "revenue",
+    "battle",
+    "battle round",
+    "cpu turn",
+    "batch year",
+};
+
+static const uint64_t probeCounterConfigList[PROBE_COUNTER_COUNT] =
+{
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static ProbeThread *ProbeThreadGet(void);
+
+static void ProbeOpenCounters(ProbeThread *aThread);
+
+static void ProbeReadCounters(const ProbeThread *aThread, uint64_t *aValueList);
+
+static inline uint64_t ProbeCycles(void);
+
+static inline void ProbeAdd(_Atomic uint64_t *aCount, uint64_t value);
+
+static void ProbeSignal(int signalNumber);
+
+static char *ProbePutString(char *aOut, const char *aString, int width);
+
+static char *ProbePutNumber(char *aOut, uint64_t value, int width);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ *   Set up probing for the process: read the environment, and dump the counts
+ * at exit and on SIGUSR2.  Call once at the start of main.
+ */
+
+void ProbeInit(void)
+{
+    struct sigaction action;
+
+    probeCounters = getenv("EMPIRE_PROBE_COUNTERS") != NULL;
+    atexit(ProbeDump);
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = ProbeSignal;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR2, &action, NULL);
+}
+
+
+/*
+ * Mark the start of a probed phase in the probe mark specified by aMark.
+ *
+ *   aMark                  Probe mark.
+ */
+
+void ProbeBegin(ProbeMark *aMark)
+{
+    ProbeThread *thread = ProbeThreadGet();
+
+    if ((thread != NULL) && (thread->counterFdList[0] >= 0))
+        ProbeReadCounters(thread, aMark->counterList);
+    aMark->cycles = ProbeCycles();
+}
+
+
+/*
+ *   Count a call to the phase specified by phase, started at the probe mark
+ * specified by aMark.
+ *
+ *   aMark                  Probe mark from ProbeBegin.
+ *   phase                  Phase.
+ */
+
+void ProbeEnd(const ProbeMark *aMark, int phase)
+{
+    ProbeThread *thread = probeThread;
+    uint64_t     valueList[PROBE_COUNTER_COUNT];
+    uint64_t     cycles;
+    int          i;
+
+    cycles = ProbeCycles();
+    if (thread == NULL)
+        return;
+    ProbeAdd(&(thread->callCountList[phase]), 1);
+    ProbeAdd(&(thread->cycleCountList[phase]), cycles - aMark->cycles);
+    if (thread->counterFdList[0] >= 0)
+    {
+        ProbeReadCounters(thread, valueList);
+        for (i = 0; i < PROBE_COUNTER_COUNT; i++)
+        {
+            ProbeAdd(&(thread->counterCountList[phase][i]),
+                     valueList[i] - aMark->counterList[i]);
+        }
+    }
+}
+
+
+/*
+ *   Write the counts of each phase called so far, summed over all threads, to
+ * standard error.
+ */
+
+void ProbeDump(void)
+{
+    ProbeThread *thread;
+    char         dump[PROBE_DUMP_SIZE];
+    char        *out = dump;
+    uint64_t     callCount;
+    uint64_t     cycleCount;
+    uint64_t     counterCountList[PROBE_COUNTER_COUNT];
+    bool         counters = FALSE;
+    int          phase;
+    int          i;
+
+    /* Find whether any thread counted hardware events. */
+    thread = atomic_load(&probeThreadList);
+    for (; thread != NULL; thread = thread->next)
+    {
+        if (thread->counterFdList[0] >= 0)
+            counters = TRUE;
+    }
+
+    /* Put the heading. */
+    out = ProbePutString(out, "probe phase", 14);
+    out = ProbePutString(out, "calls", -12);
+    out = ProbePutString(out, PROBE_CYCLE_UNIT, -16);
+    out = ProbePutString(out, "per call", -10);
+    if (counters)
+    {
+        out = ProbePutString(out, "cache miss", -14);
+        out = ProbePutString(out, "branch miss", -14);
+    }
+    *out++ = '\n';
+
+    /* Put each phase that was called. */
+    for (phase = 0; phase < PROBE_COUNT; phase++)
+    {
+        /* Sum the phase over the threads. */
+        callCount = 0;
+        cycleCount = 0;
+        memset(counterCountList, 0, sizeof(counterCountList));
+        thread = atomic_load(&probeThreadList);
+        for (; thread != NULL; thread = thread->next)
+        {
+            callCount += atomic_load_explicit(&(thread->callCountList[phase]),
+                                              memory_order_relaxed);
+            cycleCount +=
+                atomic_load_explicit(&(thread->cycleCountList[phase]),
+                                     memory_order_relaxed);
+            for (i = 0; i < PROBE_COUNTER_COUNT; i++)
+            {
+                counterCountList[i] += atomic_load_explicit(
+                    &(thread->counterCountList[phase][i]),
+                    memory_order_relaxed);
+            }
+        }
+        if (callCount == 0)
+            continue;
+
+        /* Put the phase. */
+        out = ProbePutString(out, probePhaseNameList[phase], 14);
+        out = ProbePutNumber(out, callCount, 12);
+        out = ProbePutNumber(out, cycleCount, 16);
+        out = ProbePutNumber(out, cycleCount / callCount, 10);
+        if (counters)
+        {
+            out = ProbePutNumber(out, counterCountList[PROBE_CACHE_MISSES], 14);
+            out = ProbePutNumber(out,
+                                 counterCountList[PROBE_BRANCH_MISSES],
+                                 14);
+        }
+        *out++ = '\n';
+    }
+
+    /* Write the dump. */
+    if (write(STDERR_FILENO, dump, out - dump) < 0)
+        return;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Return the probe record of this thread, creating it on first use.  Return
+ * NULL if out of memory.
+ */
+
+static ProbeThread *ProbeThreadGet(void)
+{
+    ProbeThread *thread = probeThread;
+    int          i;
+
+    if (thread != NULL)
+        return thread;
+
+    /* Create the record and open its hardware counters. */
+    thread = calloc(1, sizeof(ProbeThread));
+    if (thread == NULL)
+        return NULL;
+    for (i = 0; i < PROBE_COUNTER_COUNT; i++)
+        thread->counterFdList[i] = -1;
+    if (probeCounters)
+        ProbeOpenCounters(thread);
+
+    /* Push it onto the list. */
+    thread->next = atomic_load(&probeThreadList);
+    while (!atomic_compare_exchange_weak(&probeThreadList,
+                                         &(thread->next),
+                                         thread))
+    {
+    }
+    probeThread = thread;
+
+    return thread;
+}
+
+
+/*
+ *   Open a group of hardware counters of this thread for the probe record
+ * specified by aThread.  If any can't be opened, none are.
+ *
+ *   aThread                Probe record.
+ */
+
+static void ProbeOpenCounters(ProbeThread *aThread)
+{
+    struct perf_event_attr attr;
+    int                    fd;
+    int                    i;
+
+    for (i = 0; i < PROBE_COUNTER_COUNT; i++)
+    {
+        /* Open the counter, in the group of the first one. */
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = probeCounterConfigList[i];
+        attr.read_format = PERF_FORMAT_GROUP;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(SYS_perf_event_open,
+                     &attr,
+                     0,
+                     -1,
+                     aThread->counterFdList[0],
+                     0);
+
+        /* Give up on all of them if it can't be opened. */
+        if (fd < 0)
+        {
+            for (i--; i >= 0; i--)
+            {
+                close(aThread->counterFdList[i]);
+                aThread->counterFdList[i] = -1;
+            }
+            return;
+        }
+        aThread->counterFdList[i] = fd;
+    }
+}
+
+
+/*
+ *   Read the hardware counters of the probe record specified by aThread into
+ * the list specified by aValueList.  The counters are read as a group, in one
+ * system call.
+ *
+ *   aThread                Probe record.
+ *   aValueList             List of counter values.
+ */
+
+static void ProbeReadCounters(const ProbeThread *aThread, uint64_t *aValueList)
+{
+    uint64_t group[1 + PROBE_COUNTER_COUNT];
+    int      i;
+
+    if (read(aThread->counterFdList[0], group, sizeof(group)) < 0)
+        memset(group, 0, sizeof(group));
+    for (i = 0; i < PROBE_COUNTER_COUNT; i++)
+        aValueList[i] = group[1 + i];
+}
+
+
+/*
+ * Return the current cycle count.
+ */
+
+static inline uint64_t ProbeCycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000000000) + now.tv_nsec;
+#endif
+}
+
+
+/*
+ *   Add the value specified by value to the count specified by aCount.  Only
+ * the owning thread writes a count, so this need not be an atomic add.
+ *
+ *   aCount                 Count.
+ *   value                  Value to add.
+ */
+
+static inline void ProbeAdd(_Atomic uint64_t *aCount, uint64_t value)
+{
+    atomic_store_explicit(aCount,
+                            atomic_load_explicit(aCount, memory_order_relaxed)
+                          + value,
+                          memory_order_relaxed);
+}
+
+
+/*
+ * Dump the counts on a signal.
+ *
+ *   signalNumber           Signal number.
+ */
+
+static void ProbeSignal(int signalNumber)
+{
+    int savedErrno = errno;
+
+    (void) signalNumber;
+    ProbeDump();
+    errno = savedErrno;
+}
+
+
+/*
+ *   Put the string specified by aString at the position in the dump specified
+ * by aOut, padded to the width specified by width: on the right for a positive
+ * width and on the left for a negative one.  Return the new position.
+ *
+ *   aOut                   Dump position.
+ *   aString                String.
+ *   width                  Field width.
+ */
+
+static char *ProbePutString(char *aOut, const char *aString, int width)
+{
+    size_t length = strlen(aString);
+    int    padding;
+
+    /* Pad on the left for a negative width. */
+    padding = ((width < 0) ? -width : width) - (int) length;
+    if (width < 0)
+    {
+        for (; padding > 0; padding--)
+            *aOut++ = ' ';
+    }
+
+    /* Put the string and pad on the right. */
+    memcpy(aOut, aString, length);
+    aOut += length;
+    for (; padding > 0; padding--)
+        *aOut++ = ' ';
+
+    return aOut;
+}
+
+
+/*
+ *   Put the number specified by value at the position in the dump specified by
+ * aOut, right aligned to the width specified by width.  Return the new
+ * position.
+ *
+ *   aOut                   Dump position.
+ *   value                  Number.
+ *   width                  Field width.
+ */
+
+static char *ProbePutNumber(char *aOut, uint64_t value, int width)
+{
+    char  digitList[24];
+    char *digit = &(digitList[sizeof(digitList) - 1]);
+
+    *digit = '\0';
+    do
+    {
+        *--digit = '0' + (value % 10);
+        value /= 10;
+    } while (value != 0);
+
+    return ProbePutString(aOut, digit, -width);
+}
+
+
+#endif /* PROBE */
@@ -0,0 +1,128 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire phase probe header file.
+ *
+ *   Probes measure where the rules engine spends its time.  Each phase of the
+ * rules, such as the harvest or a battle round, is bracketed by ProbeBegin and
+ * ProbeEnd, which count the calls to the phase and the cycles spent in it.
+ * Phases nest where the rules do: a battle includes the battle rounds it runs.
+ *
+ *   Probes are compiled in only when PROBE is defined, as with make PROBE=1.
+ * Otherwise ProbeBegin and ProbeEnd compile away and cost nothing.
+ *
+ *   With EMPIRE_PROBE_COUNTERS set in the environment, probes also count cache
+ * misses and branch misses with perf_event_open.  Reading the counters takes a
+ * system call at each end of a phase, so phase times then include that cost.
+ * Where perf events are not permitted, the counters are left out.
+ *
+ *   Counts are kept per thread and summed when dumped.  They are dumped to
+ * standard error when the process exits and whenever it receives SIGUSR2.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __PROBE_H__
+#define __PROBE_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Probe phases.
+ *
+ *   PROBE_NEW_YEAR         Start of a year.
+ *   PROBE_HARVEST          Rats and harvest.
+ *   PROBE_POPULATION       Births, deaths, and migration.
+ *   PROBE_REVENUE          Revenues.
+ *   PROBE_BATTLE           Battle run to completion.
+ *   PROBE_BATTLE_ROUND     Battle round.
+ *   PROBE_CPU_TURN         CPU player holdings update.
+ *   PROBE_BATCH_YEAR       Year of a batch of CPU games.
+ *   PROBE_COUNT            Count of the number of phases.
+ */
+
+#define PROBE_NEW_YEAR      0
+#define PROBE_HARVEST       1
+#define PROBE_POPULATION    2
+#define PROBE_REVENUE       3
+#define PROBE_BATTLE        4
+#define PROBE_BATTLE_ROUND  5
+#define PROBE_CPU_TURN      6
+#define PROBE_BATCH_YEAR    7
+#define PROBE_COUNT         8
+
+
+/*
+ * Hardware counters.
+ *
+ *   PROBE_CACHE_MISSES     Cache misses.
+ *   PROBE_BRANCH_MISSES    Branch misses.
+ *   PROBE_COUNTER_COUNT    Count of the number of hardware counters.
+ */
+
+#define PROBE_CACHE_MISSES  0
+#define PROBE_BRANCH_MISSES 1
+#define PROBE_COUNTER_COUNT 2
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the start of a probed phase.
+ *
+ *   cycles                 Cycle count at the start of the phase.
+ *   counterList            Hardware counter values at the start of the phase.
+ */
+
+typedef struct
+{
+    uint64_t                cycles;
+    uint64_t                counterList[PROBE_COUNTER_COUNT];
+} ProbeMark;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+#ifdef PROBE
+
+void ProbeInit(void);
+
+void ProbeBegin(ProbeMark *aMark);
+
+void ProbeEnd(const ProbeMark *aMark, int phase);
+
+void ProbeDump(void);
+
+#else
+
+/*
+ * Probes compile away.
+ */
+
+#define ProbeInit() ((void) 0)
+#define ProbeBegin(aMark) ((void) (aMark))
+#define ProbeEnd(aMark, phase) ((void) (aMark))
+#define ProbeDump() ((void) 0)
+
+#endif
+
+
+#endif /* __PROBE_H__ */
@@ -0,0 +1,710 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire screen renderer.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "render.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Renderer defs.
+ *
+ *   RENDER_OUTPUT_SIZE     Initial size of the output buffer.
+ *   RENDER_SKIP_MAX        Most unchanged cells the ANSI backend rewrites to
+ *                          move the cursor rather than addressing it.
+ */
+
+#define RENDER_OUTPUT_SIZE  4096
+#define RENDER_SKIP_MAX     4
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+#ifndef RENDER_NULL
+
+static void RenderPutChar(Render *aRender, int c);
+
+static void RenderScroll(Render *aRender);
+
+#endif
+
+static void RenderAppendFormat(Render *aRender, const char *aFormat, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static int RenderLineLength(const char *aLine);
+
+static void RenderCapturePresent(Render *aRender);
+
+static void RenderAnsiPresent(Render *aRender);
+
+static void RenderAnsiMove(Render *aRender, int y, int x);
+
+static void RenderAnsiInput(Render *aRender, const char *aInput);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ * Renderer backends.  The curses backend is in curses.c, so that only the
+ * programs that use it link with nCurses.
+ */
+
+const RenderBackend renderAnsiBackend =
+{
+    .name = "ansi",
+    .present = RenderAnsiPresent,
+    .input = RenderAnsiInput,
+};
+
+const RenderBackend renderCaptureBackend =
+{
+    .name = "capture",
+    .present = RenderCapturePresent,
+};
+
+const RenderBackend renderNullBackend =
+{
+    .name = "null",
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External renderer functions.
+ */
+
+/*
+ *   Initialize the renderer specified by aRender with a blank screen and the
+ * null backend.
+ *
+ *   aRender                Renderer.
+ */
+
+void RenderInit(Render *aRender)
+{
+    memset(aRender, 0, sizeof(Render));
+    memset(aRender->lineList, ' ', sizeof(aRender->lineList));
+    aRender->backend = &renderNullBackend;
+    aRender->fd = -1;
+}
+
+
+/*
+ *   Open the renderer backend specified by aBackend for the renderer specified
+ * by aRender, writing frames to the file descriptor specified by fd, or leaving
+ * them in the renderer's output if fd is -1.  Return false on error.
+ *
+ *   aRender                Renderer.
+ *   aBackend               Backend.
+ *   fd                     File descriptor, or -1.
+ */
+
+bool RenderOpen(Render *aRender, const RenderBackend *aBackend, int fd)
+{
+    aRender->backend = aBackend;
+    aRender->fd = fd;
+    aRender->shownValid = FALSE;
+    if ((aBackend->open != NULL) && !aBackend->open(aRender))
+    {
+        aRender->backend = &renderNullBackend;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *   Close the backend of the renderer specified by aRender, and free its
+ * output.
+ *
+ *   aRender                Renderer.
+ */
+
+void RenderClose(Render *aRender)
+{
+    if (aRender->backend->close != NULL)
+        aRender->backend->close(aRender);
+    aRender->backend = &renderNullBackend;
+    free(aRender->output);
+    aRender->output = NULL;
+    aRender->outputLength = 0;
+    aRender->outputSize = 0;
+}
+
+
+/*
+ *   Present the screen of the renderer specified by aRender as a new frame,
+ * and write the frame's output, if any, to the renderer's file descriptor in
+ * one write.
+ *
+ *   aRender                Renderer.
+ */
+
+void RenderPresent(Render *aRender)
+{
+    ssize_t length;
+    size_t  written = 0;
+
+    /* Present the frame. */
+    if (aRender->backend->present != NULL)
+        aRender->backend->present(aRender);
+    aRender->frameCount++;
+
+    /* Write the output. */
+    if (aRender->fd < 0)
+        return;
+    while (written < aRender->outputLength)
+    {
+        length = write(aRender->fd,
+                       aRender->output + written,
+                       aRender->outputLength - written);
+        if ((length < 0) && (errno == EINTR))
+            continue;
+        if (length <= 0)
+            break;
+        written += length;
+    }
+    aRender->outputLength = 0;
+}
+
+
+/*
+ *   Copy the input line specified by aInput into the screen of the renderer
+ * specified by aRender as getnstr does, and move to the next line.  The
+ * backend is told first, since the terminal has already echoed the line.
+ *
+ *   aRender                Renderer.
+ *   aInput                 Input line.
+ */
+
+void RenderInput(Render *aRender, const char *aInput)
+{
+    if (aRender->backend->input != NULL)
+        aRender->backend->input(aRender, aInput);
+#ifndef RENDER_NULL
+    RenderAddString(aRender, aInput);
+    RenderPutChar(aRender, '\n');
+#endif
+}
+
+
+/*
+ *   Append the number of bytes specified by length of the data specified by
+ * aData to the output of the renderer specified by aRender.  Return false if
+ * out of memory.
+ *
+ *   aRender                Renderer.
+ *   aData                  Data to append.
+ *   length                 Length of the data.
+ */
+
+bool RenderAppend(Render *aRender, const char *aData, size_t length)
+{
+    char   *output;
+    size_t  outputSize;
+
+    /* Make room for the data. */
+    if ((aRender->outputLength + length) > aRender->outputSize)
+    {
+        outputSize = aRender->outputSize;
+        if (outputSize == 0)
+            outputSize = RENDER_OUTPUT_SIZE;
+        while ((aRender->outputLength + length) > outputSize)
+            outputSize *= 2;
+        output = realloc(aRender->output, outputSize);
+        if (output == NULL)
+            return FALSE;
+        aRender->output = output;
+        aRender->outputSize = outputSize;
+    }
+
+    /* Append the data. */
+    memcpy(aRender->output + aRender->outputLength, aData, length);
+    aRender->outputLength += length;
+
+    return TRUE;
+}
+
+
+#ifndef RENDER_NULL
+
+/*------------------------------------------------------------------------------
+ *
+ * External drawing functions.
+ */
+
+/*
+ * Erase the screen of the renderer specified by aRender.
+ *
+ *   aRender                Renderer.
+ */
+
+void RenderErase(Render *aRender)
+{
+    memset(aRender->lineList, ' ', sizeof(aRender->lineList));
+    aRender->y = 0;
+    aRender->x = 0;
+}
+
+
+/*
+ *   Move the cursor of the renderer specified by aRender to the line specified
+ * by y and the column specified by x.  Moves off the screen are ignored.
+ *
+ *   aRender                Renderer.
+ *   y                      Line.
+ *   x                      Column.
+ */
+
+void RenderMove(Render *aRender, int y, int x)
+{
+    if (   (y < 0) || (y >= RENDER_LINE_COUNT)
+        || (x < 0) || (x >= RENDER_COLUMN_COUNT))
+    {
+        return;
+    }
+    aRender->y = y;
+    aRender->x = x;
+}
+
+
+/*
+ *   Add the string specified by aString to the screen of the renderer specified
+ * by aRender at the cursor, as addstr does.
+ *
+ *   aRender                Renderer.
+ *   aString                String.
+ */
+
+void RenderAddString(Render *aRender, const char *aString)
+{
+    while (*aString != '\0')
+        RenderPutChar(aRender, *aString++);
+}
+
+
+/*
+ *   Add text formatted with the format specified by aFormat to the screen of
+ * the renderer specified by aRender at the cursor, as printw does.
+ *
+ *   aRender                Renderer.
+ *   aFormat                Format.
+ */
+
+void RenderPrint(Render *aRender, const char *aFormat, ...)
+{
+    va_list argList;
+    char    text[RENDER_TEXT_SIZE];
+
+    va_start(argList, aFormat);
+    vsnprintf(text, sizeof(text), aFormat, argList);
+    va_end(argList);
+    RenderAddString(aRender, text);
+}
+
+
+/*
+ *   Move the cursor of the renderer specified by aRender to the line specified
+ * by y and the column specified by x, and add text formatted with the format
+ * specified by aFormat there, as mvprintw does.
+ *
+ *   aRender                Renderer.
+ *   y                      Line.
+ *   x                      Column.
+ *   aFormat                Format.
+ */
+
+void RenderMovePrint(Render *aRender, int y, int x, const char *aFormat, ...)
+{
+    va_list argList;
+    char    text[RENDER_TEXT_SIZE];
+
+    RenderMove(aRender, y, x);
+    va_start(argList, aFormat);
+    vsnprintf(text, sizeof(text), aFormat, argList);
+    va_end(argList);
+    RenderAddString(aRender, text);
+}
+
+
+/*
+ *   Clear the screen of the renderer specified by aRender from the cursor to
+ * the end of the line.
+ *
+ *   aRender                Renderer.
+ */
+
+void RenderClearToEOL(Render *aRender)
+{
+    memset(&(aRender->lineList[aRender->y][aRender->x]),
+           ' ',
+           RENDER_COLUMN_COUNT - aRender->x);
+}
+
+
+/*
+ *   If the region specified by region of the renderer specified by aRender was
+ * cached with the stamp specified by stamp, put its cached lines back on the
+ * screen, move to the line after it, and return true.  Otherwise, return
+ * false; the caller then formats the region and saves it.
+ *
+ *   aRender                Renderer.
+ *   region                 Region.
+ *   stamp                  Stamp of what the region is formatted from.
+ */
+
+bool RenderRegionCached(Render *aRender, int region, uint64_t stamp)
+{
+    RenderRegion *renderRegion = &(aRender->regionList[region]);
+
+    if (!renderRegion->valid || (renderRegion->stamp != stamp))
+        return FALSE;
+
+    memcpy(aRender->lineList[renderRegion->top],
+           renderRegion->lineList,
+           renderRegion->lineCount * RENDER_COLUMN_COUNT);
+    RenderMove(aRender, renderRegion->top + renderRegion->lineCount, 0);
+
+    return TRUE;
+}
+
+
+/*
+ *   Save the number of screen lines specified by lineCount starting at the line
+ * specified by top as the region specified by region of the renderer specified
+ * by aRender, formatted from what the stamp specified by stamp was made from.
+ * Move to the line after the region.
+ *
+ *   aRender                Renderer.
+ *   region                 Region.
+ *   stamp                  Stamp of what the region was formatted from.
+ *   top                    Top line of the region.
+ *   lineCount              Number of lines in the region.
+ */
+
+void RenderRegionSave(Render   *aRender,
+                      int       region,
+                      uint64_t  stamp,
+                      int       top,
+                      int       lineCount)
+{
+    RenderRegion *renderRegion = &(aRender->regionList[region]);
+
+    if (lineCount > (RENDER_LINE_COUNT - top))
+        lineCount = RENDER_LINE_COUNT - top;
+    memcpy(renderRegion->lineList,
+           aRender->lineList[top],
+           lineCount * RENDER_COLUMN_COUNT);
+    renderRegion->valid = TRUE;
+    renderRegion->stamp = stamp;
+    renderRegion->top = top;
+    renderRegion->lineCount = lineCount;
+    RenderMove(aRender, top + lineCount, 0);
+}
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal drawing functions.
+ */
+
+/*
+ *   Add the character specified by c to the screen of the renderer specified by
+ * aRender at the cursor, as addch does on a window that scrolls.  A newline
+ * clears the rest of the line.
+ *
+ *   aRender                Renderer.
+ *   c                      Character.
+ */
+
+static void RenderPutChar(Render *aRender, int c)
+{
+    if (c == '\n')
+    {
+        RenderClearToEOL(aRender);
+        aRender->x = RENDER_COLUMN_COUNT;
+    }
+    else if ((c >= ' ') && (c <= '~'))
+    {
+        aRender->lineList[aRender->y][aRender->x++] = c;
+    }
+
+    /* Wrap to the next line, scrolling at the bottom. */
+    if (aRender->x >= RENDER_COLUMN_COUNT)
+    {
+        aRender->x = 0;
+        if (aRender->y < (RENDER_LINE_COUNT - 1))
+            aRender->y++;
+        else
+            RenderScroll(aRender);
+    }
+}
+
+
+/*
+ * Scroll the screen of the renderer specified by aRender up one line.
+ *
+ *   aRender                Renderer.
+ */
+
+static void RenderScroll(Render *aRender)
+{
+    memmove(aRender->lineList[0],
+            aRender->lineList[1],
+            (RENDER_LINE_COUNT - 1) * RENDER_COLUMN_COUNT);
+    memset(aRender->lineList[RENDER_LINE_COUNT - 1], ' ', RENDER_COLUMN_COUNT);
+}
+
+#endif /* RENDER_NULL */
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal renderer functions.
+ */
+
+/*
+ *   Append text formatted with the format specified by aFormat to the output
+ * of the renderer specified by aRender.
+ *
+ *   aRender                Renderer.
+ *   aFormat                Format.
+ */
+
+static void RenderAppendFormat(Render *aRender, const char *aFormat, ...)
+{
+    va_list argList;
+    char    text[RENDER_TEXT_SIZE];
+    int     length;
+
+    va_start(argList, aFormat);
+    length = vsnprintf(text, sizeof(text), aFormat, argList);
+    va_end(argList);
+    if (length > 0)
+        RenderAppend(aRender, text, length);
+}
+
+
+/*
+ * Return the length of the line specified by aLine without trailing blanks.
+ *
+ *   aLine                  Line.
+ */
+
+static int RenderLineLength(const char *aLine)
+{
+    int length = RENDER_COLUMN_COUNT;
+
+    while ((length > 0) && (aLine[length - 1] == ' '))
+        length--;
+
+    return length;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Capture backend functions.
+ */
+
+/*
+ *   Present the screen of the renderer specified by aRender by appending its
+ * text to the output, headed by the frame number and cursor position.
+ *
+ *   aRender                Renderer.
+ */
+
+static void RenderCapturePresent(Render *aRender)
+{
+    int y;
+
+    RenderAppendFormat(aRender,
+                       "--- frame %u, cursor %d %d\n",
+                       aRender->frameCount,
+                       aRender->y,
+                       aRender->x);
+    for (y = 0; y < RENDER_LINE_COUNT; y++)
+    {
+        RenderAppend(aRender,
+                     aRender->lineList[y],
+                     RenderLineLength(aRender->lineList[y]));
+        RenderAppend(aRender, "\n", 1);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * ANSI backend functions.
+ */
+
+/*
+ *   Present the screen of the renderer specified by aRender by appending the
+ * ANSI escape sequences and text that change the shown screen into it.
+ *
+ *   aRender                Renderer.
+ */
+
+static void RenderAnsiPresent(Render *aRender)
+{
+    char *line;
+    char *shownLine;
+    int   first;
+    int   last;
+    int   length;
+    int   shownLength;
+    int   y;
+
+    /* Clear the terminal if what it shows is not known. */
+    if (!aRender->shownValid)
+    {
+        RenderAppendFormat(aRender, "\033[H\033[J");
+        memset(aRender->shownList, ' ', sizeof(aRender->shownList));
+        aRender->shownY = 0;
+        aRender->shownX = 0;
+        aRender->shownValid = TRUE;
+    }
+
+    /* Send the changed span of each line. */
+    for (y = 0; y < RENDER_LINE_COUNT; y++)
+    {
+        /* Find the changed span. */
+        line = aRender->lineList[y];
+        shownLine = aRender->shownList[y];
+        first = 0;
+        while ((first < RENDER_COLUMN_COUNT) &&
+               (line[first] == shownLine[first]))
+            first++;
+        if (first == RENDER_COLUMN_COUNT)
+            continue;
+        last = RENDER_COLUMN_COUNT - 1;
+        while (line[last] == shownLine[last])
+            last--;
+
+        /* Send the span, clearing rather than sending a blank tail. */
+        length = RenderLineLength(line);
+        shownLength = RenderLineLength(shownLine);
+        RenderAnsiMove(aRender, y, first);
+        if ((last >= length) && (shownLength > length))
+        {
+            if (length > first)
+                RenderAppend(aRender, line + first, length - first);
+            RenderAppendFormat(aRender, "\033[K");
+            aRender->shownX = (length > first) ? length : first;
+        }
+        else
+        {
+            RenderAppend(aRender, line + first, last - first + 1);
+            aRender->shownX = last + 1;
+        }
+        memcpy(shownLine, line, RENDER_COLUMN_COUNT);
+    }
+
+    /* Put the cursor in place. */
+    RenderAnsiMove(aRender, aRender->y, aRender->x);
+}
+
+
+/*
+ *   Append to the output of the renderer specified by aRender what moves the
+ * terminal cursor to the line specified by y and the column specified by x.
+ *
+ *   aRender                Renderer.
+ *   y                      Line.
+ *   x                      Column.
+ */
+
+static void RenderAnsiMove(Render *aRender, int y, int x)
+{
+    int shownY = aRender->shownY;
+    int shownX = aRender->shownX;
+
+    /*
+     *   After writing the last column, terminals differ in where the cursor
+     * is, so address it.
+     */
+    if (shownX >= RENDER_COLUMN_COUNT)
+    {
+        RenderAppendFormat(aRender, "\033[%d;%dH", y + 1, x + 1);
+    }
+    else if ((y == shownY) && (x == shownX))
+    {
+        return;
+    }
+    else if ((y == shownY) && (x > shownX) && ((x - shownX) <= RENDER_SKIP_MAX))
+    {
+        RenderAppend(aRender, &(aRender->shownList[y][shownX]), x - shownX);
+    }
+    else if ((y == shownY) && (x == 0))
+    {
+        RenderAppend(aRender, "\r", 1);
+    }
+    else if ((y == (shownY + 1)) && (x == 0))
+    {
+        RenderAppend(aRender, "\r\n", 2);
+    }
+    else
+    {
+        RenderAppendFormat(aRender, "\033[%d;%dH", y + 1, x + 1);
+    }
+    aRender->shownY = y;
+    aRender->shownX = x;
+}
+
+
+/*
+ *   Note that the terminal of the renderer specified by aRender has echoed the
+ * input line specified by aInput at its cursor, followed by a newline.  If
+ * the echo wrapped or ran off the screen, what the terminal shows is no longer
+ * known.
+ *
+ *   aRender                Renderer.
+ *   aInput                 Input line.
+ */
+
+static void RenderAnsiInput(Render *aRender, const char *aInput)
+{
+    int length = strlen(aInput);
+
+    if (   !aRender->shownValid
+        || (aRender->shownX + length >= RENDER_COLUMN_COUNT)
+        || (aRender->shownY >= (RENDER_LINE_COUNT - 1)))
+    {
+        aRender->shownValid = FALSE;
+        return;
+    }
+    memcpy(&(aRender->shownList[aRender->shownY][aRender->shownX]),
+           aInput,
+           length);
+    aRender->shownY++;
+    aRender->shownX = 0;
+}
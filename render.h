@@ -0,0 +1,286 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire screen renderer header file.
+ *
+ *   Screens draw into a renderer, which holds the 16x64 character screen in
+ * memory.  Drawing is plain memory writes and never calls a backend; once a
+ * frame is complete, the driver presents it, and only then does the backend
+ * selected at startup send it somewhere:
+ *
+ *   curses                 nCurses, for a local terminal.
+ *   ANSI                   ANSI escape sequences for the cells that changed
+ *                          since the last frame, written with one write per
+ *                          frame.
+ *   capture                Text of each frame, for golden tests.
+ *   null                   Nothing.
+ *
+ *   Building with RENDER_NULL defined compiles the drawing functions away
+ * altogether, along with the formatting of everything drawn, for batch runs
+ * that never look at the screen.
+ *
+ *   Formatting a screen region, such as the grain market table, can still
+ * cost more than the rest of the screen.  The renderer keeps the formatted
+ * lines of such regions along with a stamp of what they were formatted from,
+ * and puts the cached lines back on the screen as long as the stamp is
+ * unchanged.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __RENDER_H__
+#define __RENDER_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Renderer defs.
+ *
+ *   RENDER_LINE_COUNT      Number of lines on the screen.
+ *   RENDER_COLUMN_COUNT    Number of columns on the screen.
+ *   RENDER_TEXT_SIZE       Size of the text formatted by one print.
+ *   RENDER_STAMP_INIT      Initial stamp value.
+ */
+
+#define RENDER_LINE_COUNT   16
+#define RENDER_COLUMN_COUNT 64
+#define RENDER_TEXT_SIZE    1024
+#define RENDER_STAMP_INIT   0xcbf29ce484222325ULL
+
+
+/*
+ * Cached screen regions.
+ *
+ *   RENDER_GRAIN_HOLDINGS  Grain screen ruler and holdings.
+ *   RENDER_GRAIN_MARKET    Grain screen grain for sale.
+ *   RENDER_TAX_REVENUES    Investments screen tax revenues.
+ *   RENDER_INVESTMENTS     Investments screen investments.
+ *   RENDER_LAND_HOLDINGS   Attack screen land holdings.
+ *   RENDER_REGION_COUNT    Count of the number of cached regions.
+ */
+
+#define RENDER_GRAIN_HOLDINGS 0
+#define RENDER_GRAIN_MARKET 1
+#define RENDER_TAX_REVENUES 2
+#define RENDER_INVESTMENTS  3
+#define RENDER_LAND_HOLDINGS 4
+#define RENDER_REGION_COUNT 5
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+struct Render;
+
+/*
+ *   This structure contains the functions of a renderer backend.  Any function
+ * may be NULL if the backend has nothing to do.
+ *
+ *   name                   Name by which the backend is selected.
+ *   open                   Open the backend for a renderer.  Return false on
+ *                          error.
+ *   close                  Close the backend for a renderer.
+ *   present                Present the screen of a renderer as a new frame,
+ *                          appending any output to the renderer's output.
+ *   input                  Note an input line that the terminal has echoed.
+ */
+
+typedef struct
+{
+    const char             *name;
+    bool                    (*open)(struct Render *aRender);
+    void                    (*close)(struct Render *aRender);
+    void                    (*present)(struct Render *aRender);
+    void                    (*input)(struct Render *aRender,
+                                     const char    *aInput);
+} RenderBackend;
+
+
+/*
+ * This structure contains fields for a cached screen region.
+ *
+ *   valid                  If true, the region has been cached.
+ *   stamp                  Stamp of what the region was formatted from.
+ *   top                    Top line of the region.
+ *   lineCount              Number of lines in the region.
+ *   lineList               Lines of the region.
+ */
+
+typedef struct
+{
+    bool                    valid;
+    uint64_t                stamp;
+    int                     top;
+    int                     lineCount;
+    char                    lineList[RENDER_LINE_COUNT][RENDER_COLUMN_COUNT];
+} RenderRegion;
+
+
+/*
+ *   This structure contains fields for a renderer.  Lines are not null
+ * terminated; blank cells hold spaces.
+ *
+ *   backend                Backend.
+ *   fd                     File descriptor to which frames are written, or -1
+ *                          to leave them in the output.
+ *   y                      Cursor line.
+ *   x                      Cursor column.
+ *   lineList               Screen lines.
+ *   shownValid             If true, the shown screen is known.
+ *   shownY                 Cursor line on the shown screen.
+ *   shownX                 Cursor column on the shown screen.
+ *   shownList              Lines on the shown screen.
+ *   frameCount             Number of frames presented.
+ *   output                 Output of presented frames.
+ *   outputLength           Length of the output.
+ *   outputSize             Size of the output buffer.
+ *   regionList             List of cached regions.
+ */
+
+typedef struct Render
+{
+    const RenderBackend    *backend;
+    int                     fd;
+    int                     y;
+    int                     x;
+    char                    lineList[RENDER_LINE_COUNT][RENDER_COLUMN_COUNT];
+    bool                    shownValid;
+    int                     shownY;
+    int                     shownX;
+    char                    shownList[RENDER_LINE_COUNT][RENDER_COLUMN_COUNT];
+    uint32_t                frameCount;
+    char                   *output;
+    size_t                  outputLength;
+    size_t                  outputSize;
+    RenderRegion            regionList[RENDER_REGION_COUNT];
+} Render;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External variables.
+ */
+
+extern const RenderBackend renderCursesBackend;
+
+extern const RenderBackend renderAnsiBackend;
+
+extern const RenderBackend renderCaptureBackend;
+
+extern const RenderBackend renderNullBackend;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+void RenderInit(Render *aRender);
+
+bool RenderOpen(Render *aRender, const RenderBackend *aBackend, int fd);
+
+void RenderClose(Render *aRender);
+
+void RenderPresent(Render *aRender);
+
+void RenderInput(Render *aRender, const char *aInput);
+
+bool RenderAppend(Render *aRender, const char *aData, size_t length);
+
+#ifndef RENDER_NULL
+
+void RenderErase(Render *aRender);
+
+void RenderMove(Render *aRender, int y, int x);
+
+void RenderAddString(Render *aRender, const char *aString);
+
+void RenderPrint(Render *aRender, const char *aFormat, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void RenderMovePrint(Render *aRender, int y, int x, const char *aFormat, ...)
+    __attribute__((format(printf, 4, 5)));
+
+void RenderClearToEOL(Render *aRender);
+
+bool RenderRegionCached(Render *aRender, int region, uint64_t stamp);
+
+void RenderRegionSave(Render   *aRender,
+                      int       region,
+                      uint64_t  stamp,
+                      int       top,
+                      int       lineCount);
+
+#else
+
+/*
+ *   Drawing compiles away.  Cached regions always report being cached, so
+ * nothing in them is formatted either.
+ */
+
+#define RenderErase(aRender) ((void) (aRender))
+#define RenderMove(aRender, y, x) ((void) (aRender))
+#define RenderAddString(aRender, aString) ((void) (aRender))
+#define RenderPrint(aRender, ...) ((void) (aRender))
+#define RenderMovePrint(aRender, y, x, ...) ((void) (aRender))
+#define RenderClearToEOL(aRender) ((void) (aRender))
+#define RenderRegionCached(aRender, region, stamp) ((void) (aRender), true)
+#define RenderRegionSave(aRender, region, stamp, top, lineCount) \
+    ((void) (aRender))
+
+#endif
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Inline functions.
+ */
+
+/*
+ *   Return the stamp specified by stamp with the value specified by value mixed
+ * into it.  Start a stamp with RENDER_STAMP_INIT and mix in everything that a
+ * region is formatted from.  This is inline so that stamps compile away along
+ * with drawing.
+ *
+ *   stamp                  Stamp.
+ *   value                  Value to mix in.
+ */
+
+static inline uint64_t RenderStamp(uint64_t stamp, int64_t value)
+{
+    stamp = (stamp ^ ((uint64_t) value)) * 0x9e3779b97f4a7c15ULL;
+    stamp = (stamp ^ (stamp >> 29)) * 0xbf58476d1ce4e5b9ULL;
+
+    return stamp ^ (stamp >> 32);
+}
+
+
+/*
+ * Return the cursor line of the renderer specified by aRender.
+ *
+ *   aRender                Renderer.
+ */
+
+static inline int RenderGetY(const Render *aRender)
+{
+    return aRender->y;
+}
+
+
+#endif /* __RENDER_H__ */
@@ -0,0 +1,283 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire journal replayer.
+ *
+ *   The replayer plays journaled game sessions back through the same session
+ * code the game and server run, feeding each session its recorded input lines
+ * as fast as it asks for them.  Delays are skipped, and the replayer is built
+ * with RENDER_NULL so nothing is drawn.  After the last input line, the
+ * checksum of the game is checked against the one in the journal.
+ *
+ *   The replayer can also snapshot each replayed game to a file next to its
+ * journal and check that the snapshot loads back to the same game.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <inttypes.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "journal.h"
+#include "probe.h"
+#include "session.h"
+#include "snapshot.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static bool ReplayJournal(const char *aPath, bool verbose, bool snapshot);
+
+static bool ReplaySnapshot(const Game *aGame, const char *aPath);
+
+static double ReplaySeconds(const struct timespec *aStartTime);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    bool verbose;
+    bool snapshot;
+    bool usage;
+    bool failed;
+    int  opt;
+    int  i;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line. */
+    verbose = FALSE;
+    snapshot = FALSE;
+    usage = FALSE;
+    while ((opt = getopt(argc, argv, "vS")) != -1)
+    {
+        switch (opt)
+        {
+            case 'v' :
+                verbose = TRUE;
+                break;
+
+            case 'S' :
+                snapshot = TRUE;
+                break;
+
+            default :
+                usage = TRUE;
+                break;
+        }
+    }
+    if (usage || (optind >= argc))
+    {
+        fprintf(stderr, "usage: %s [-v] [-S] journal...\n", argv[0]);
+        return 1;
+    }
+
+    /* Replay each journal. */
+    failed = FALSE;
+    for (i = optind; i < argc; i++)
+    {
+        if (!ReplayJournal(argv[i], verbose, snapshot))
+            failed = TRUE;
+    }
+
+    return failed ? 1 : 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Replay the journal at the path specified by aPath and report the result.
+ * Return false if the journal can't be read or the replay does not match it.
+ * A journal without an end record, from a process that died, is replayed but
+ * can't be checked.
+ *
+ *   aPath                  Journal file path.
+ *   verbose                If true, print each input line as it is replayed.
+ *   snapshot               If true, snapshot the replayed game.
+ */
+
+static bool ReplayJournal(const char *aPath, bool verbose, bool snapshot)
+{
+    Journal         *journal;
+    Session         *session;
+    struct timespec  startTime;
+    const char      *status;
+    double           seconds;
+    char             input[JOURNAL_LINE_MAX + 1];
+    uint64_t         checksum;
+    bool             replayed;
+    int              result;
+
+    /* Open the journal and create a session started as the recorded one was. */
+    journal = JournalOpen(aPath);
+    if (journal == NULL)
+    {
+        fprintf(stderr, "%s: not a readable journal\n", aPath);
+        return FALSE;
+    }
+    session = SessionCreate(journal->countryCount, journal->seed);
+    if (session == NULL)
+    {
+        fprintf(stderr,
+                "%s: can't create a game of %d countries\n",
+                aPath,
+                journal->countryCount);
+        JournalDestroy(journal);
+        return FALSE;
+    }
+
+    /* Feed the session its input lines, skipping delays. */
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    result = SessionRun(session, NULL);
+    while (result != SESSION_DONE)
+    {
+        if (result == SESSION_DELAY)
+        {
+            result = SessionRun(session, NULL);
+            continue;
+        }
+        if (!JournalRead(journal, input, sizeof(input)))
+            break;
+        if (verbose)
+            printf("%5" PRIu32 " %s\n", journal->inputCount, input);
+        result = SessionRun(session, input);
+    }
+    seconds = ReplaySeconds(&startTime);
+    checksum = EngineChecksum(session->game);
+
+    /*
+     *   Check the replay.  The game must not have ended with input lines left
+     * over, and must end with the recorded checksum.
+     */
+    replayed = TRUE;
+    if ((result == SESSION_DONE) && JournalRead(journal, input, sizeof(input)))
+    {
+        status = "GAME ENDED EARLY";
+        replayed = FALSE;
+    }
+    else if (!journal->ended)
+    {
+        status = "unchecked (no end record)";
+    }
+    else if (checksum != journal->checksum)
+    {
+        status = "MISMATCH";
+        replayed = FALSE;
+    }
+    else
+    {
+        status = "ok";
+    }
+
+    /* Report the result. */
+    printf("%s: %" PRIu32 " inputs, year %d, checksum %016" PRIx64 " %s "
+           "in %.3f ms\n",
+           aPath,
+           journal->inputCount,
+           session->game->year,
+           checksum,
+           status,
+           seconds * 1000.0);
+
+    /* Snapshot the game. */
+    if (snapshot && !ReplaySnapshot(session->game, aPath))
+        replayed = FALSE;
+
+    /* Clean up. */
+    SessionDestroy(session);
+    JournalDestroy(journal);
+
+    return replayed;
+}
+
+
+/*
+ *   Write a snapshot of the game specified by aGame next to the journal at the
+ * path specified by aPath, read it back, and report the result.  Return false
+ * if the snapshot can't be written or read, or reads back to a different game.
+ *
+ *   aGame                  Game.
+ *   aPath                  Journal file path.
+ */
+
+static bool ReplaySnapshot(const Game *aGame, const char *aPath)
+{
+    Game            *game;
+    struct timespec  startTime;
+    char             path[PATH_MAX];
+    double           writeSeconds;
+    double           readSeconds;
+    bool             matched;
+
+    /* Write the snapshot and read it back. */
+    snprintf(path, sizeof(path), "%s.snapshot", aPath);
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    if (!SnapshotWrite(aGame, path))
+    {
+        perror(path);
+        return FALSE;
+    }
+    writeSeconds = ReplaySeconds(&startTime);
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    game = SnapshotRead(path);
+    readSeconds = ReplaySeconds(&startTime);
+    if (game == NULL)
+    {
+        fprintf(stderr, "%s: can't read snapshot\n", path);
+        return FALSE;
+    }
+
+    /* Check that it is the same game. */
+    matched = EngineChecksum(game) == EngineChecksum(aGame);
+    printf("%s: %zu bytes, %s, written in %.1f us, read in %.1f us\n",
+           path,
+           SnapshotSize(game),
+           matched ? "ok" : "MISMATCH",
+           writeSeconds * 1e6,
+           readSeconds * 1e6);
+    EngineDestroyGame(game);
+
+    return matched;
+}
+
+
+/*
+ * Return the number of seconds since the time specified by aStartTime.
+ *
+ *   aStartTime             Start time.
+ */
+
+static double ReplaySeconds(const struct timespec *aStartTime)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return   (now.tv_sec - aStartTime->tv_sec)
+           + (now.tv_nsec - aStartTime->tv_nsec) / 1e9;
+}
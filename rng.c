@@ -0,0 +1,180 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire random number generator.
+ *
+ *   Values are generated with the SplitMix64 mixing function applied to the
+ * stream seed plus a Weyl sequence of the stream counter.  The block is filled
+ * with a plain loop that the compiler vectorizes.  Only AVX-512 has a 64 bit
+ * vector multiply; for AVX2 the compiler builds one from 32 bit multiplies,
+ * which is little faster than the scalar loop.  Values are reduced to a range
+ * with Lemire's multiply-shift method, rejecting the few values that would
+ * bias the result.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <math.h>
+
+/* Local includes. */
+#include "rng.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Weyl sequence increment (2^64 / golden ratio).
+ */
+
+#define RNG_GAMMA           0x9E3779B97F4A7C15ULL
+
+
+/*
+ *   Instruction sets for which to build the block fill.  The best one the
+ * processor supports is picked when the program is loaded.
+ */
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__)
+#define RNG_TARGETS \
+    __attribute__((target_clones("arch=x86-64-v4", "avx2", "default")))
+#else
+#define RNG_TARGETS
+#endif
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ * Seed the random number generator specified by aRng with the value specified
+ * by seed and rewind it to the start of the stream.
+ *
+ *   aRng                   Random number generator.
+ *   seed                   Seed value.
+ */
+
+void RngSeed(Rng *aRng, uint64_t seed)
+{
+    aRng->seed = seed;
+    RngSeek(aRng, 0);
+}
+
+
+/*
+ *   Move the random number generator specified by aRng to the position in its
+ * stream specified by counter, as if counter values had been drawn since it was
+ * seeded.
+ *
+ *   aRng                   Random number generator.
+ *   counter                Number of values drawn from the stream.
+ */
+
+void RngSeek(Rng *aRng, uint64_t counter)
+{
+    aRng->counter = counter;
+    aRng->blockIndex = RNG_BLOCK_SIZE;
+}
+
+
+/*
+ *   Return a random integer value from the random number generator specified
+ * by aRng between 1 and the value specified by range, inclusive (i.e.,
+ * [1, range]).  If range is 0 or less, return 0.
+ *
+ *   aRng                   Random number generator.
+ *   range                  Range of random value.
+ */
+
+int RngRange(Rng *aRng, int range)
+{
+    uint64_t product;
+    uint32_t threshold;
+
+    /* Validate range. */
+    if (range <= 0)
+        return 0;
+
+    /* Scale a 32-bit random value into the range. */
+    product = (RngNext(aRng) >> 32) * (uint64_t) range;
+
+    /* Reject values that fall into the biased low end of a range slot. */
+    if ((uint32_t) product < (uint32_t) range)
+    {
+        threshold = -((uint32_t) range) % ((uint32_t) range);
+        while ((uint32_t) product < threshold)
+            product = (RngNext(aRng) >> 32) * (uint64_t) range;
+    }
+
+    return ((int) (product >> 32)) + 1;
+}
+
+
+/*
+ *   Return a random value from the random number generator specified by aRng
+ * uniformly distributed in [0, 1).
+ *
+ *   aRng                   Random number generator.
+ */
+
+double RngUniform(Rng *aRng)
+{
+    return (RngNext(aRng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/*
+ *   Return a random value from the random number generator specified by aRng
+ * from the standard normal distribution.
+ *
+ *   aRng                   Random number generator.
+ */
+
+double RngNormal(Rng *aRng)
+{
+    double u;
+    double v;
+
+    /* Box-Muller transform.  Keep u away from 0 for the log. */
+    u = 1.0 - RngUniform(aRng);
+    v = RngUniform(aRng);
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+
+/*
+ *   Fill the block of the random number generator specified by aRng with the
+ * next RNG_BLOCK_SIZE values of its stream.
+ *
+ *   aRng                   Random number generator.
+ */
+
+RNG_TARGETS
+void RngFill(Rng *aRng)
+{
+    uint64_t start;
+    uint64_t z;
+    int      i;
+
+    /* Mix the seed and the counter of each value. */
+    start = aRng->seed + aRng->counter * RNG_GAMMA;
+    for (i = 0; i < RNG_BLOCK_SIZE; i++)
+    {
+        z = start + ((uint64_t) (i + 1)) * RNG_GAMMA;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        aRng->block[i] = z ^ (z >> 31);
+    }
+    aRng->blockIndex = 0;
+}
@@ -0,0 +1,111 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire random number generator header file.
+ *
+ *   The random number generator is counter-based: the nth value of a stream is
+ * a pure function of the stream seed and n.  Each game owns its own generator,
+ * so games are reproducible from their seed and never share hidden state.
+ *
+ *   Values are generated a block at a time into a buffer in the generator and
+ * handed out from there.  The block is filled with vector instructions where
+ * the processor has them; since each value depends only on its position in the
+ * stream, the values do not depend on the vector width or the block size.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __RNG_H__
+#define __RNG_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Number of values generated at a time.
+ */
+
+#define RNG_BLOCK_SIZE      16
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ *   This structure contains fields for a random number generator.  The block
+ * holds the next values of the stream, starting with the value at blockIndex.
+ *
+ *   seed                   Seed of the random number stream.
+ *   counter                Number of values drawn from the stream.
+ *   blockIndex             Index of the next value in the block, or
+ *                          RNG_BLOCK_SIZE if the block is used up.
+ *   block                  Block of values.
+ */
+
+typedef struct
+{
+    uint64_t                seed;
+    uint64_t                counter;
+    int                     blockIndex;
+    uint64_t                block[RNG_BLOCK_SIZE];
+} Rng;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+void RngSeed(Rng *aRng, uint64_t seed);
+
+void RngSeek(Rng *aRng, uint64_t counter);
+
+void RngFill(Rng *aRng);
+
+int RngRange(Rng *aRng, int range);
+
+double RngUniform(Rng *aRng);
+
+double RngNormal(Rng *aRng);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Inline functions.
+ */
+
+/*
+ *   Return the next 64-bit random value from the random number generator
+ * specified by aRng.  This is called for every value drawn, so it is inline and
+ * only leaves the block to fill a new one.
+ *
+ *   aRng                   Random number generator.
+ */
+
+static inline uint64_t RngNext(Rng *aRng)
+{
+    /* Fill a new block if the block is used up. */
+    if (aRng->blockIndex >= RNG_BLOCK_SIZE)
+        RngFill(aRng);
+
+    aRng->counter++;
+
+    return aRng->block[aRng->blockIndex++];
+}
+
+
+#endif /* __RNG_H__ */
+
@@ -0,0 +1,775 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game server.
+ *
+ *   The game server accepts connections on a Unix or TCP socket and plays a
+ * game session with each client.  All sessions run in one thread on an epoll
+ * event loop: a session runs until it needs an input line or a delay, so the
+ * server only does work for a session when a line arrives from its client or
+ * one of its delays ends.  Delays are kept on a timer wheel.
+ *
+ *   Each session draws into its own renderer using the ANSI backend.  After
+ * running a session, the server presents its screen and moves the escape
+ * sequences for the cells that changed into that client's output buffer.
+ *
+ *   Clients are ANSI line mode terminals that echo their own input, such as
+ * "socat -,icanon UNIX-CONNECT:<path>" or telnet.  The server hands each line
+ * to the renderer, which accounts for the client's echo of it.
+ *
+ *   With a journal directory, each game's input lines are journaled to a file
+ * named by the game's seed, so that empire-replay can play the game back.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "probe.h"
+#include "render.h"
+#include "session.h"
+#include "timer.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Server defs.
+ *
+ *   SERVER_MAX_EVENTS      Maximum number of events to handle per wait.
+ *   SERVER_BACKLOG         Listen backlog.
+ *   SERVER_LINE_SIZE       Size of an input line, as read by getnstr.
+ *   SERVER_READ_SIZE       Size of each socket read.
+ *   SERVER_OUTPUT_MAX      Most output to hold for a client that is not
+ *                          reading before dropping it.
+ */
+
+#define SERVER_MAX_EVENTS   256
+#define SERVER_BACKLOG      1024
+#define SERVER_LINE_SIZE    80
+#define SERVER_READ_SIZE    4096
+#define SERVER_OUTPUT_MAX   (1024 * 1024)
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a game server.
+ *
+ *   epollFD                Epoll file descriptor.
+ *   listenFD               Listening socket.
+ *   wheel                  Timer wheel for session delays.
+ *   countryCount           Number of countries in each game.
+ *   seed                   Random number seed of the first game.  Each game
+ *                          after it uses the next seed.
+ *   fast                   If true, fast-forward through delays.
+ *   journalDir             Directory in which to journal each game, or NULL.
+ *   clientCount            Number of connected clients.
+ */
+
+typedef struct
+{
+    int                     epollFD;
+    int                     listenFD;
+    TimerWheel              wheel;
+    int                     countryCount;
+    uint64_t                seed;
+    bool                    fast;
+    const char             *journalDir;
+    int                     clientCount;
+} Server;
+
+
+/*
+ * This structure contains fields for a client connection.
+ *
+ *   server                 Server.
+ *   fd                     Client socket.
+ *   session                Game session.
+ *   result                 Result of the last run of the session.
+ *   delayTimer             Timer for the current session delay.
+ *   line                   Input line being read.
+ *   lineLength             Length of the input line.
+ *   output                 Output waiting to be sent.
+ *   outputLength           Length of the output.
+ *   outputSize             Allocated size of the output buffer.
+ *   outputSent             Length of the output already sent.
+ *   writeWait              If true, the client is waiting for its socket to
+ *                          become writable.
+ *   closing                If true, close the client once its output is sent.
+ */
+
+typedef struct
+{
+    Server                 *server;
+    int                     fd;
+    Session                *session;
+    int                     result;
+    Timer                   delayTimer;
+    char                    line[SERVER_LINE_SIZE];
+    int                     lineLength;
+    char                   *output;
+    size_t                  outputLength;
+    size_t                  outputSize;
+    size_t                  outputSent;
+    bool                    writeWait;
+    bool                    closing;
+} Client;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static int ServerListen(const char *aPath, const char *aAddress, int port);
+
+static void ServerAccept(Server *aServer);
+
+static Client *ClientCreate(Server *aServer, int fd);
+
+static void ClientDestroy(Client *aClient);
+
+static void ClientRead(Client *aClient);
+
+static void ClientInput(Client *aClient, const char *aInput);
+
+static void ClientRun(Client *aClient, const char *aInput);
+
+static void ClientDelayExpired(void *aContext);
+
+static void ClientCollectOutput(Client *aClient);
+
+static void ClientFlush(Client *aClient);
+
+static void ClientCheckClose(Client *aClient);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    Server              server;
+    struct epoll_event  eventList[SERVER_MAX_EVENTS];
+    struct epoll_event  event;
+    struct rlimit       limit;
+    const char         *path;
+    const char         *address;
+    Client             *client;
+    bool                usage;
+    int                 port;
+    int                 eventCount;
+    int                 opt;
+    int                 i;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line.  Use the time as the seed if none is given. */
+    memset(&server, 0, sizeof(server));
+    server.countryCount = COUNTRY_COUNT;
+    server.seed = time(NULL);
+    path = NULL;
+    address = "127.0.0.1";
+    port = 0;
+    usage = FALSE;
+    while ((opt = getopt(argc, argv, "u:p:a:c:s:fj:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'u' :
+                path = optarg;
+                break;
+
+            case 'p' :
+                port = strtol(optarg, NULL, 0);
+                break;
+
+            case 'a' :
+                address = optarg;
+                break;
+
+            case 'c' :
+                server.countryCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 's' :
+                server.seed = strtoull(optarg, NULL, 0);
+                break;
+
+            case 'f' :
+                server.fast = TRUE;
+                break;
+
+            case 'j' :
+                server.journalDir = optarg;
+                break;
+
+            default :
+                usage = TRUE;
+                break;
+        }
+    }
+    if (usage || ((path == NULL) == (port == 0)))
+    {
+        fprintf(stderr,
+                "usage: %s (-u path | -p port [-a address]) [-c countries] "
+                "[-s seed] [-f] [-j journal-dir]\n",
+                argv[0]);
+        return 1;
+    }
+    if ((server.countryCount < 1) || (server.countryCount > COUNTRY_MAX))
+    {
+        fprintf(stderr,
+                "%s: country count must be from 1 to %d\n",
+                argv[0],
+                COUNTRY_MAX);
+        return 1;
+    }
+
+    /* Allow as many clients as the system lets us. */
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Set up the listening socket and the event loop. */
+    server.listenFD = ServerListen(path, address, port);
+    if (server.listenFD < 0)
+    {
+        perror(argv[0]);
+        return 1;
+    }
+    server.epollFD = epoll_create1(0);
+    if (server.epollFD < 0)
+    {
+        perror(argv[0]);
+        return 1;
+    }
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+    epoll_ctl(server.epollFD, EPOLL_CTL_ADD, server.listenFD, &event);
+    TimerWheelInit(&(server.wheel), TimerNow());
+
+    /* Handle connections, input, output, and delays. */
+    while (1)
+    {
+        eventCount = epoll_wait(server.epollFD,
+                                eventList,
+                                SERVER_MAX_EVENTS,
+                                TimerWheelTimeout(&(server.wheel),
+                                                  TimerNow()));
+        if ((eventCount < 0) && (errno != EINTR))
+        {
+            perror(argv[0]);
+            return 1;
+        }
+        for (i = 0; i < eventCount; i++)
+        {
+            client = eventList[i].data.ptr;
+            if (client == NULL)
+            {
+                ServerAccept(&server);
+                continue;
+            }
+            if (eventList[i].events & EPOLLOUT)
+                ClientFlush(client);
+            if (eventList[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                ClientRead(client);
+            ClientCheckClose(client);
+        }
+        TimerWheelRun(&(server.wheel), TimerNow());
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal server functions.
+ */
+
+/*
+ *   Return a non-blocking socket listening on the Unix socket path specified by
+ * aPath or, if aPath is NULL, on the TCP address and port specified by aAddress
+ * and port.  Return -1 on error.
+ *
+ *   aPath                  Unix socket path, or NULL.
+ *   aAddress               TCP address.
+ *   port                   TCP port.
+ */
+
+static int ServerListen(const char *aPath, const char *aAddress, int port)
+{
+    struct sockaddr_un unixAddress;
+    struct sockaddr_in inetAddress;
+    struct sockaddr   *socketAddress;
+    socklen_t          addressLength;
+    int                on = 1;
+    int                fd;
+
+    /* Fill in the socket address. */
+    if (aPath != NULL)
+    {
+        memset(&unixAddress, 0, sizeof(unixAddress));
+        unixAddress.sun_family = AF_UNIX;
+        if (strlen(aPath) >= sizeof(unixAddress.sun_path))
+        {
+            errno = ENAMETOOLONG;
+            return -1;
+        }
+        strcpy(unixAddress.sun_path, aPath);
+        unlink(aPath);
+        socketAddress = (struct sockaddr *) &unixAddress;
+        addressLength = sizeof(unixAddress);
+    }
+    else
+    {
+        memset(&inetAddress, 0, sizeof(inetAddress));
+        inetAddress.sin_family = AF_INET;
+        inetAddress.sin_port = htons(port);
+        if (inet_pton(AF_INET, aAddress, &(inetAddress.sin_addr)) != 1)
+        {
+            errno = EINVAL;
+            return -1;
+        }
+        socketAddress = (struct sockaddr *) &inetAddress;
+        addressLength = sizeof(inetAddress);
+    }
+
+    /* Create the socket and listen on it. */
+    fd = socket(socketAddress->sa_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (fd < 0)
+        return -1;
+    if (aPath == NULL)
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (   (bind(fd, socketAddress, addressLength) < 0)
+        || (listen(fd, SERVER_BACKLOG) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+
+/*
+ * Accept new connections for the server specified by aServer.
+ *
+ *   aServer                Server.
+ */
+
+static void ServerAccept(Server *aServer)
+{
+    Client *client;
+    int     fd;
+
+    while (1)
+    {
+        fd = accept4(aServer->listenFD, NULL, NULL, SOCK_NONBLOCK);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        /* Start the client's session. */
+        client = ClientCreate(aServer, fd);
+        if (client == NULL)
+        {
+            close(fd);
+            continue;
+        }
+        ClientRun(client, NULL);
+        ClientCheckClose(client);
+    }
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal client functions.
+ */
+
+/*
+ *   Create a client for the connection specified by fd to the server specified
+ * by aServer, with a new game session.  Return NULL on error.
+ *
+ *   aServer                Server.
+ *   fd                     Client socket.
+ */
+
+static Client *ClientCreate(Server *aServer, int fd)
+{
+    Client             *client;
+    struct epoll_event  event;
+    char                journalPath[PATH_MAX];
+
+    /* Allocate the client record. */
+    client = calloc(1, sizeof(Client));
+    if (client == NULL)
+        return NULL;
+    client->server = aServer;
+    client->fd = fd;
+
+    /* Create the session.  Each game uses the next seed. */
+    client->session = SessionCreate(aServer->countryCount, aServer->seed);
+    if (client->session == NULL)
+    {
+        free(client);
+        return NULL;
+    }
+    aServer->seed++;
+
+    /*
+     *   Journal the game, named by its seed, if asked to.  A game that can't be
+     * journaled is still played.
+     */
+    if (aServer->journalDir != NULL)
+    {
+        snprintf(journalPath,
+                 sizeof(journalPath),
+                 "%s/%" PRIu64 ".journal",
+                 aServer->journalDir,
+                 client->session->seed);
+        if (!SessionStartJournal(client->session, journalPath))
+            perror(journalPath);
+    }
+
+    /* Render the session's screen into its output as ANSI escape sequences. */
+    RenderOpen(&(client->session->render), &renderAnsiBackend, -1);
+
+    /* Wait for input. */
+    event.events = EPOLLIN;
+    event.data.ptr = client;
+    if (epoll_ctl(aServer->epollFD, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        SessionDestroy(client->session);
+        free(client);
+        return NULL;
+    }
+    aServer->clientCount++;
+
+    return client;
+}
+
+
+/*
+ * Close the connection of the client specified by aClient and destroy it.
+ *
+ *   aClient                Client.
+ */
+
+static void ClientDestroy(Client *aClient)
+{
+    Server *server = aClient->server;
+
+    /* Stop any delay and close the connection. */
+    if (TimerRunning(&(aClient->delayTimer)))
+        TimerStop(&(server->wheel), &(aClient->delayTimer));
+    epoll_ctl(server->epollFD, EPOLL_CTL_DEL, aClient->fd, NULL);
+    close(aClient->fd);
+
+    /* Clean up. */
+    SessionDestroy(aClient->session);
+    free(aClient->output);
+    free(aClient);
+    server->clientCount--;
+}
+
+
+/*
+ *   Read input from the client specified by aClient and hand each complete line
+ * to its session.  Characters past the size of an input line are dropped.
+ *
+ *   aClient                Client.
+ */
+
+static void ClientRead(Client *aClient)
+{
+    char    buffer[SERVER_READ_SIZE];
+    ssize_t length;
+    ssize_t i;
+
+    while (!aClient->closing)
+    {
+        /* Read what's available.  Close on end of file or error. */
+        length = read(aClient->fd, buffer, sizeof(buffer));
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+                aClient->closing = TRUE;
+            break;
+        }
+        if (length == 0)
+        {
+            aClient->closing = TRUE;
+            break;
+        }
+
+        /* Split the input into lines. */
+        for (i = 0; (i < length) && !aClient->closing; i++)
+        {
+            if (buffer[i] == '\n')
+            {
+                aClient->line[aClient->lineLength] = '\0';
+                ClientInput(aClient, aClient->line);
+                aClient->lineLength = 0;
+            }
+            else if (   (buffer[i] != '\r')
+                     && (aClient->lineLength < (SERVER_LINE_SIZE - 1)))
+            {
+                aClient->line[aClient->lineLength++] = buffer[i];
+            }
+        }
+    }
+
+    /* Drop clients that have hung up, along with any output for them. */
+    if (aClient->closing && (aClient->result != SESSION_DONE))
+        aClient->outputLength = aClient->outputSent = 0;
+}
+
+
+/*
+ *   Handle the input line specified by aInput from the client specified by
+ * aClient.  A line typed during a delay ends the delay, as a key press does on
+ * a terminal.
+ *
+ *   aClient                Client.
+ *   aInput                 Input line.
+ */
+
+static void ClientInput(Client *aClient, const char *aInput)
+{
+    Server *server = aClient->server;
+
+    switch (aClient->result)
+    {
+        case SESSION_INPUT :
+            ClientRun(aClient, aInput);
+            break;
+
+        case SESSION_DELAY :
+            TimerStop(&(server->wheel), &(aClient->delayTimer));
+            ClientRun(aClient, NULL);
+            break;
+
+        default :
+            break;
+    }
+}
+
+
+/*
+ *   Run the session of the client specified by aClient with the input line
+ * specified by aInput, and send the client its updated screen.
+ *
+ *   aClient                Client.
+ *   aInput                 Input line, or NULL.
+ */
+
+static void ClientRun(Client *aClient, const char *aInput)
+{
+    Server  *server = aClient->server;
+    Session *session = aClient->session;
+
+    /* Copy the input line, which the client has echoed, into the screen. */
+    if (aInput != NULL)
+        RenderInput(&(session->render), aInput);
+
+    /* Run the session. */
+    aClient->result = SessionRun(session, aInput);
+    while (server->fast && (aClient->result == SESSION_DELAY))
+        aClient->result = SessionRun(session, NULL);
+
+    /* Update the screen, and close once the game is over. */
+    if (aClient->result == SESSION_DONE)
+        aClient->closing = TRUE;
+    ClientCollectOutput(aClient);
+
+    /* Start any delay. */
+    if (aClient->result == SESSION_DELAY)
+    {
+        TimerStart(&(server->wheel),
+                   &(aClient->delayTimer),
+                   TimerNow(),
+                   session->delay,
+                   ClientDelayExpired,
+                   aClient);
+    }
+
+    /* Send the output. */
+    ClientFlush(aClient);
+}
+
+
+/*
+ * Resume the session of the client specified by aContext after its delay.
+ *
+ *   aContext               Client.
+ */
+
+static void ClientDelayExpired(void *aContext)
+{
+    Client *client = aContext;
+
+    ClientRun(client, NULL);
+    ClientCheckClose(client);
+}
+
+
+/*
+ *   Present the screen of the client specified by aClient and move the output
+ * into its output buffer.  Drop the client if it has let too much output build
+ * up.
+ *
+ *   aClient                Client.
+ */
+
+static void ClientCollectOutput(Client *aClient)
+{
+    Render *render = &(aClient->session->render);
+    char   *output;
+    size_t  outputSize;
+
+    /* Present the screen. */
+    RenderPresent(render);
+
+    /* Make room for the output, dropping the client if there is none. */
+    outputSize = aClient->outputSize;
+    if (outputSize < SERVER_READ_SIZE)
+        outputSize = SERVER_READ_SIZE;
+    while ((outputSize - aClient->outputLength) < render->outputLength)
+        outputSize *= 2;
+    if (outputSize != aClient->outputSize)
+    {
+        output = realloc(aClient->output, outputSize);
+        if (output == NULL)
+        {
+            render->outputLength = 0;
+            aClient->closing = TRUE;
+            aClient->outputLength = aClient->outputSent = 0;
+            return;
+        }
+        aClient->output = output;
+        aClient->outputSize = outputSize;
+    }
+
+    /* Move the output. */
+    memcpy(aClient->output + aClient->outputLength,
+           render->output,
+           render->outputLength);
+    aClient->outputLength += render->outputLength;
+    render->outputLength = 0;
+
+    /* Drop clients that don't read their output. */
+    if ((aClient->outputLength - aClient->outputSent) > SERVER_OUTPUT_MAX)
+    {
+        aClient->closing = TRUE;
+        aClient->outputLength = aClient->outputSent = 0;
+    }
+}
+
+
+/*
+ *   Send as much of the output of the client specified by aClient as its
+ * socket takes, and wait for the socket to become writable if any is left.
+ *
+ *   aClient                Client.
+ */
+
+static void ClientFlush(Client *aClient)
+{
+    Server             *server = aClient->server;
+    struct epoll_event  event;
+    ssize_t             length;
+    bool                writeWait;
+
+    /* Send the output. */
+    while (aClient->outputSent < aClient->outputLength)
+    {
+        length = send(aClient->fd,
+                      aClient->output + aClient->outputSent,
+                      aClient->outputLength - aClient->outputSent,
+                      MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+            {
+                aClient->closing = TRUE;
+                aClient->outputLength = aClient->outputSent = 0;
+            }
+            break;
+        }
+        aClient->outputSent += length;
+    }
+    if (aClient->outputSent == aClient->outputLength)
+        aClient->outputLength = aClient->outputSent = 0;
+
+    /* Wait for the socket to become writable only while output is left. */
+    writeWait = aClient->outputLength > 0;
+    if (writeWait != aClient->writeWait)
+    {
+        event.events = writeWait ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+        event.data.ptr = aClient;
+        epoll_ctl(server->epollFD, EPOLL_CTL_MOD, aClient->fd, &event);
+        aClient->writeWait = writeWait;
+    }
+}
+
+
+/*
+ *   Destroy the client specified by aClient if it is closing and all of its
+ * output has been sent.
+ *
+ *   aClient                Client.
+ */
+
+static void ClientCheckClose(Client *aClient)
+{
+    if (aClient->closing && (aClient->outputLength == 0))
+        ClientDestroy(aClient);
+}
+
@@ -0,0 +1,518 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game session source file.
+ *
+ *   The session handles the states that frame the game: the start screen,
+ * game setup, the start of each year, the order of player turns, CPU turns,
+ * and the end of year summary.  The screens handle the states of a human
+ * player's turn.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "attack.h"
+#include "engine.h"
+#include "grain.h"
+#include "investments.h"
+#include "population.h"
+#include "session.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains the handlers for a session state.
+ *
+ *   enter                  Handler run when the state is entered.
+ *   input                  Handler run with each input line, or NULL if the
+ *                          state does not wait for input.
+ */
+
+typedef struct
+{
+    SessionEnterHandler     enter;
+    SessionInputHandler     input;
+} SessionState;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void GameScreenEnter(Session *aSession);
+
+static void GameScreenInput(Session *aSession, const char *aInput);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Globals.
+ */
+
+/*
+ * Session state list.
+ */
+
+static const SessionState sessionStateList[SESSION_STATE_COUNT] =
+{
+    [SESSION_START] = { GameScreenEnter, NULL },
+    [SESSION_HUMAN_COUNT] = { GameScreenEnter, GameScreenInput },
+    [SESSION_RULER_NAME] = { GameScreenEnter, GameScreenInput },
+    [SESSION_NEW_YEAR] = { GameScreenEnter, NULL },
+    [SESSION_NEXT_PLAYER] = { GameScreenEnter, NULL },
+    [SESSION_CPU_TURN] = { GameScreenEnter, NULL },
+    [SESSION_SUMMARY] = { GameScreenEnter, GameScreenInput },
+    [SESSION_OVER] = { NULL, NULL },
+
+    [SESSION_GRAIN] = { GrainScreenEnter, NULL },
+    [SESSION_GRAIN_MENU] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_BUY_GRAIN] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_SELL_GRAIN] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_GRAIN_PRICE] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_SELL_LAND] = { GrainScreenEnter, NULL },
+    [SESSION_LAND_TO_SELL] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_FEED_ARMY] = { GrainScreenEnter, GrainScreenInput },
+    [SESSION_FEED_PEOPLE] = { GrainScreenEnter, GrainScreenInput },
+
+    [SESSION_POPULATION] = { PopulationScreenEnter, PopulationScreenInput },
+    [SESSION_PLAYER_DEATH] = { PopulationScreenEnter, NULL },
+
+    [SESSION_INVESTMENTS] = { InvestmentsScreenEnter, NULL },
+    [SESSION_TAX_MENU] = { InvestmentsScreenEnter, InvestmentsScreenInput },
+    [SESSION_TAX_RATE] = { InvestmentsScreenEnter, InvestmentsScreenInput },
+    [SESSION_INVESTMENT_MENU] =
+        { InvestmentsScreenEnter, InvestmentsScreenInput },
+    [SESSION_INVESTMENT_COUNT] =
+        { InvestmentsScreenEnter, InvestmentsScreenInput },
+
+    [SESSION_ATTACK] = { AttackScreenEnter, NULL },
+    [SESSION_ATTACK_MENU] = { AttackScreenEnter, AttackScreenInput },
+    [SESSION_SOLDIERS_TO_ATTACK] = { AttackScreenEnter, AttackScreenInput },
+    [SESSION_BATTLE_ROUND] = { AttackScreenEnter, NULL },
+    [SESSION_BATTLE_FIGHT] = { AttackScreenEnter, NULL },
+    [SESSION_BATTLE_RESULTS] = { AttackScreenEnter, AttackScreenInput },
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External session functions.
+ */
+
+/*
+ *   Create and return a session for a game with the number of countries
+ * specified by countryCount, started with the random number seed specified by
+ * seed.  Return NULL if out of memory.
+ *
+ *   countryCount           Number of countries.
+ *   seed                   Random number seed.
+ */
+
+Session *SessionCreate(int countryCount, uint64_t seed)
+{
+    Session *session;
+
+    /* Allocate the session record. */
+    session = calloc(1, sizeof(Session));
+    if (session == NULL)
+        return NULL;
+
+    /* Create the game. */
+    session->game = EngineCreateGame(countryCount);
+    if (session->game == NULL)
+    {
+        free(session);
+        return NULL;
+    }
+
+    /* Start with a blank screen that goes nowhere until opened. */
+    RenderInit(&(session->render));
+
+    /* Start at the start screen. */
+    session->seed = seed;
+    SessionGoto(session, SESSION_START);
+
+    return session;
+}
+
+
+/*
+ *   Destroy the session specified by aSession.  Any journal is closed with a
+ * checksum of the game as it stands.
+ *
+ *   aSession               Session.
+ */
+
+void SessionDestroy(Session *aSession)
+{
+    if (aSession == NULL)
+        return;
+    JournalClose(aSession->journal, EngineChecksum(aSession->game));
+    RenderClose(&(aSession->render));
+    EngineDestroyGame(aSession->game);
+    free(aSession);
+}
+
+
+/*
+ *   Start recording the input lines of the session specified by aSession to a
+ * journal at the path specified by aPath.  Call before the session first runs.
+ * Return false if the journal can't be created.
+ *
+ *   aSession               Session.
+ *   aPath                  Journal file path.
+ */
+
+bool SessionStartJournal(Session *aSession, const char *aPath)
+{
+    aSession->journal = JournalCreate(aPath,
+                                      aSession->seed,
+                                      aSession->game->countryCount);
+
+    return aSession->journal != NULL;
+}
+
+
+/*
+ *   Run the session specified by aSession until it needs an input line or a
+ * delay, or the game is over, and return which with SESSION_INPUT,
+ * SESSION_DELAY, or SESSION_DONE.  If aInput is not NULL, it is the line the
+ * player typed in answer to the last SESSION_INPUT; otherwise, the session is
+ * started or resumed after a delay.  After SESSION_DELAY, the length of the
+ * delay is in the session's delay field.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line, or NULL.
+ */
+
+int SessionRun(Session *aSession, const char *aInput)
+{
+    const SessionState *state;
+
+    /* Hand the input line to the state waiting for it, journaling it. */
+    aSession->delay = 0;
+    state = &(sessionStateList[aSession->state]);
+    if ((aInput != NULL) && aSession->entered && (state->input != NULL))
+    {
+        if (aSession->journal != NULL)
+            JournalRecord(aSession->journal, aInput);
+        state->input(aSession, aInput);
+    }
+
+    /* Run states until one needs input or a delay, or the game ends. */
+    while (1)
+    {
+        if (aSession->delay > 0)
+            return SESSION_DELAY;
+        if (aSession->state == SESSION_OVER)
+            return SESSION_DONE;
+        state = &(sessionStateList[aSession->state]);
+        if (aSession->entered)
+            return SESSION_INPUT;
+        aSession->entered = TRUE;
+        state->enter(aSession);
+    }
+}
+
+
+/*
+ *   Move the session specified by aSession to the state specified by state.
+ * The state's enter handler is run the next time the session runs, after any
+ * delay requested before it.  Moving to the current state enters it again.
+ *
+ *   aSession               Session.
+ *   state                  State to move to.
+ */
+
+void SessionGoto(Session *aSession, int state)
+{
+    aSession->state = state;
+    aSession->entered = FALSE;
+}
+
+
+/*
+ *   Request a delay of the number of milliseconds specified by delay for the
+ * session specified by aSession.  The session returns SESSION_DELAY once the
+ * current handler is done, and the caller resumes it when the delay ends or is
+ * skipped.
+ *
+ *   aSession               Session.
+ *   delay                  Delay in milliseconds.
+ */
+
+void SessionDelay(Session *aSession, int delay)
+{
+    aSession->delay = delay;
+}
+
+
+/*
+ *   Clear the prompt lines at the bottom of the screen of the session specified
+ * by aSession and move to the first.
+ *
+ *   aSession               Session.
+ */
+
+void SessionClearPrompt(Session *aSession)
+{
+    Render *render;
+
+    render = &(aSession->render);
+    RenderMove(render, 14, 0);
+    RenderClearToEOL(render);
+    RenderMove(render, 15, 0);
+    RenderClearToEOL(render);
+    RenderMove(render, 14, 0);
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal session functions.
+ */
+
+/*
+ * Enter the current game state of the session specified by aSession.
+ *
+ *   aSession               Session.
+ */
+
+static void GameScreenEnter(Session *aSession)
+{
+    Game          *game;
+    Player        *player;
+    const Country *country;
+    Render        *render;
+    int            i;
+
+    game = aSession->game;
+    render = &(aSession->render);
+    switch (aSession->state)
+    {
+        case SESSION_START :
+            /* Display splash screen. */
+            RenderErase(render);
+            RenderMove(render, 0, 20);
+            RenderPrint(render, "E M P I R E\n");
+            RenderMove(render, 7, 0);
+            RenderPrint(render, "(ALWAYS HIT <ENTER> TO CONTINUE)");
+            SessionDelay(aSession, DELAY_TIME);
+            SessionGoto(aSession, SESSION_HUMAN_COUNT);
+            break;
+
+        case SESSION_HUMAN_COUNT :
+            /* Reset screen and get the number of players. */
+            RenderErase(render);
+            RenderMove(render, 0, 0);
+            RenderPrint(render, "HOW MANY PEOPLE ARE PLAYING? ");
+            break;
+
+        case SESSION_RULER_NAME :
+            /* Get the country's ruler's name. */
+            country = PlayerCountry(game, aSession->player);
+            RenderPrint(render, "WHO IS THE RULER OF %s? ", country->name);
+            break;
+
+        case SESSION_NEW_YEAR :
+            /* Stop if game over. */
+            if (game->gameOver)
+            {
+                SessionGoto(aSession, SESSION_OVER);
+                break;
+            }
+
+            /* Start a new year. */
+            EngineNewYear(game);
+
+            /* Display the year and the weather. */
+            RenderErase(render);
+            RenderMove(render, 0, 0);
+            RenderPrint(render, "YEAR %d\n\n", game->year);
+            RenderPrint(render, "%s\n", weatherList[game->weather - 1]);
+            SessionDelay(aSession, DELAY_TIME);
+
+            /* Start with the first living player. */
+            aSession->turnIndex = -1;
+            SessionGoto(aSession, SESSION_NEXT_PLAYER);
+            break;
+
+        case SESSION_NEXT_PLAYER :
+            /* Stop if game over. */
+            if (game->gameOver)
+            {
+                SessionGoto(aSession, SESSION_OVER);
+                break;
+            }
+
+            /* Get the next player.  Skip players that died this year. */
+            do
+            {
+                aSession->turnIndex++;
+            } while (   (aSession->turnIndex < game->liveCount)
+                     && game->playerList[game->liveList[aSession->turnIndex]]
+                            .dead);
+
+            /* Display the summary after the last player. */
+            if (aSession->turnIndex >= game->liveCount)
+            {
+                SessionGoto(aSession, SESSION_SUMMARY);
+                break;
+            }
+
+            /* Play as human or CPU. */
+            player = &(game->playerList[game->liveList[aSession->turnIndex]]);
+            aSession->player = player;
+            if (player->human)
+                SessionGoto(aSession, SESSION_GRAIN);
+            else
+                SessionGoto(aSession, SESSION_CPU_TURN);
+            break;
+
+        case SESSION_CPU_TURN :
+            /* Announce player's turn. */
+            RenderErase(render);
+            RenderMove(render, 0, 0);
+            RenderPrint(render,
+                        "ONE MOMENT -- %s %s'S TURN . . .",
+                        PlayerTitle(game, aSession->player),
+                        PlayerName(game, aSession->player));
+            SessionDelay(aSession, DELAY_TIME);
+
+            /* Update CPU player holdings. */
+            EngineCPUTurn(game, aSession->player);
+            SessionGoto(aSession, SESSION_NEXT_PLAYER);
+            break;
+
+        case SESSION_SUMMARY :
+            /* Reset screen. */
+            RenderErase(render);
+            RenderMove(render, 0, 0);
+
+            /* Display summary. */
+            RenderPrint(render, "SUMMARY\n");
+            RenderPrint(render,
+                        "NOBLES   SOLDIERS   MERCHANTS   "
+                        "SERFS   LAND    PALACE\n\n");
+            for (i = 0; i < game->liveCount; i++)
+            {
+                /* Get the country and player records. */
+                player = &(game->playerList[game->liveList[i]]);
+                country = PlayerCountry(game, player);
+
+                /* Skip players that died this year. */
+                if (player->dead)
+                    continue;
+
+                /* Display player summary. */
+                RenderPrint(render,
+                            "%s %s OF %s\n",
+                            PlayerTitle(game, player),
+                            PlayerName(game, player),
+                            country->name);
+                RenderPrint(render,
+                            " %3d       %5d       %5d    %6d   %5d  %3d%%\n",
+                            player->nobleCount,
+                            player->soldierCount,
+                            player->merchantCount,
+                            player->serfCount,
+                            player->land,
+                            10 * player->palaceCount);
+            }
+
+            /* Wait for player. */
+            RenderPrint(render, "<ENTER>? ");
+            break;
+
+        default :
+            break;
+    }
+}
+
+
+/*
+ *   Handle the input line specified by aInput for the current game state of the
+ * session specified by aSession.
+ *
+ *   aSession               Session.
+ *   aInput                 Input line.
+ */
+
+static void GameScreenInput(Session *aSession, const char *aInput)
+{
+    Game   *game;
+    Render *render;
+    char    name[PLAYER_NAME_SIZE];
+    int     humanCount;
+    int     i;
+
+    game = aSession->game;
+    render = &(aSession->render);
+    switch (aSession->state)
+    {
+        case SESSION_HUMAN_COUNT :
+            /* Ask again if there are more players than countries. */
+            humanCount = strtol(aInput, NULL, 0);
+            if (humanCount > game->countryCount)
+            {
+                RenderPrint(render, "HOW MANY PEOPLE ARE PLAYING? ");
+                break;
+            }
+
+            /* Start a new game and name the human players. */
+            EngineNewGame(game, humanCount, aSession->seed);
+            if (game->playerCount > 0)
+            {
+                aSession->player = &(game->playerList[0]);
+                SessionGoto(aSession, SESSION_RULER_NAME);
+            }
+            else
+            {
+                SessionGoto(aSession, SESSION_NEW_YEAR);
+            }
+            break;
+
+        case SESSION_RULER_NAME :
+            /* Set the ruler's name. */
+            snprintf(name, sizeof(name), "%s", aInput);
+            for (i = 0; i < strlen(name); i++)
+            {
+                name[i] = toupper(name[i]);
+            }
+            EngineSetPlayerName(game, aSession->player, name);
+
+            /* Name the next human player. */
+            aSession->player++;
+            if (aSession->player < &(game->playerList[game->playerCount]))
+                SessionGoto(aSession, SESSION_RULER_NAME);
+            else
+                SessionGoto(aSession, SESSION_NEW_YEAR);
+            break;
+
+        case SESSION_SUMMARY :
+            /* Start the next year. */
+            SessionGoto(aSession, SESSION_NEW_YEAR);
+            break;
+
+        default :
+            break;
+    }
+}
@@ -0,0 +1,214 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game session header file.
+ *
+ *   A session runs the flow of one game, from the start screen through each
+ * year and each player's turn, as a state machine.  Each state has an enter
+ * handler that draws its screen and, if the state asks the player something,
+ * prints the prompt; input states then have an input handler that acts on the
+ * line the player typed.  Nothing in a session ever blocks: SessionRun runs
+ * states until the session needs an input line or a delay, and returns to the
+ * caller, which resumes the session when the input arrives or the delay ends.
+ * One thread can thus drive any number of sessions.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "engine.h"
+#include "journal.h"
+#include "render.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Session run results.
+ *
+ *   SESSION_INPUT          Session is waiting for an input line.
+ *   SESSION_DELAY          Session is waiting for a delay to end.
+ *   SESSION_DONE           Game is over.
+ */
+
+#define SESSION_INPUT       0
+#define SESSION_DELAY       1
+#define SESSION_DONE        2
+
+
+/*
+ * Session states.  States marked with an asterisk wait for an input line.
+ *
+ *   SESSION_START          Start splash screen.
+ *   SESSION_HUMAN_COUNT    * Number of human players.
+ *   SESSION_RULER_NAME     * Name of each human ruler.
+ *   SESSION_NEW_YEAR       Start of a year.
+ *   SESSION_NEXT_PLAYER    Start of the next player's turn.
+ *   SESSION_CPU_TURN       CPU player turn.
+ *   SESSION_SUMMARY        * End of year summary.
+ *   SESSION_OVER           Game over.
+ *
+ *   SESSION_GRAIN          Start of the grain screen.
+ *   SESSION_GRAIN_MENU     * Grain and land trading menu.
+ *   SESSION_BUY_GRAIN      * Bushels of grain to buy.
+ *   SESSION_SELL_GRAIN     * Bushels of grain to sell.
+ *   SESSION_GRAIN_PRICE    * Price of grain to sell.
+ *   SESSION_SELL_LAND      Price of land.
+ *   SESSION_LAND_TO_SELL   * Acres of land to sell.
+ *   SESSION_FEED_ARMY      * Bushels of grain to feed the army.
+ *   SESSION_FEED_PEOPLE    * Bushels of grain to feed the people.
+ *
+ *   SESSION_POPULATION     * Population report.
+ *   SESSION_PLAYER_DEATH   Player death check.
+ *
+ *   SESSION_INVESTMENTS    Start of the investments screen.
+ *   SESSION_TAX_MENU       * Tax menu.
+ *   SESSION_TAX_RATE       * New tax rate.
+ *   SESSION_INVESTMENT_MENU
+ *                          * Investment menu.
+ *   SESSION_INVESTMENT_COUNT
+ *                          * Number of investments to buy.
+ *
+ *   SESSION_ATTACK         Start of the attack screen.
+ *   SESSION_ATTACK_MENU    * Country to attack.
+ *   SESSION_SOLDIERS_TO_ATTACK
+ *                          * Number of soldiers to send.
+ *   SESSION_BATTLE_ROUND   Display of a battle round.
+ *   SESSION_BATTLE_FIGHT   Fight of a battle round.
+ *   SESSION_BATTLE_RESULTS * Battle results.
+ *
+ *   SESSION_STATE_COUNT    Count of the number of session states.
+ */
+
+#define SESSION_START               0
+#define SESSION_HUMAN_COUNT         1
+#define SESSION_RULER_NAME          2
+#define SESSION_NEW_YEAR            3
+#define SESSION_NEXT_PLAYER         4
+#define SESSION_CPU_TURN            5
+#define SESSION_SUMMARY             6
+#define SESSION_OVER                7
+
+#define SESSION_GRAIN               8
+#define SESSION_GRAIN_MENU          9
+#define SESSION_BUY_GRAIN           10
+#define SESSION_SELL_GRAIN          11
+#define SESSION_GRAIN_PRICE         12
+#define SESSION_SELL_LAND           13
+#define SESSION_LAND_TO_SELL        14
+#define SESSION_FEED_ARMY           15
+#define SESSION_FEED_PEOPLE         16
+
+#define SESSION_POPULATION          17
+#define SESSION_PLAYER_DEATH        18
+
+#define SESSION_INVESTMENTS         19
+#define SESSION_TAX_MENU            20
+#define SESSION_TAX_RATE            21
+#define SESSION_INVESTMENT_MENU     22
+#define SESSION_INVESTMENT_COUNT    23
+
+#define SESSION_ATTACK              24
+#define SESSION_ATTACK_MENU         25
+#define SESSION_SOLDIERS_TO_ATTACK  26
+#define SESSION_BATTLE_ROUND        27
+#define SESSION_BATTLE_FIGHT        28
+#define SESSION_BATTLE_RESULTS      29
+
+#define SESSION_STATE_COUNT         30
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ *   This structure contains fields for a game session.  Everything a screen
+ * needs to carry from one state to the next is kept here rather than in locals,
+ * since the session returns to its caller whenever it waits.
+ *
+ *   game                   Game.
+ *   seed                   Random number seed with which to start the game.
+ *   state                  Current state.
+ *   entered                If true, the current state's enter handler has run.
+ *   delay                  Time in milliseconds of a requested delay, or 0.
+ *   turnIndex              Live list index of the player whose turn it is.
+ *   player                 Player whose turn it is, or the human player being
+ *                          named during setup.
+ *   tax                    Tax being set.
+ *   investment             Investment being bought.
+ *   grainToSell            Bushels of grain being sold.
+ *   targetPlayer           Player being attacked, or NULL for barbarians.
+ *   battle                 Battle being fought.
+ *   sackReport             What was sacked in the battle.
+ *   render                 Renderer of the session's screen.
+ *   journal                Journal recording the input lines, or NULL.
+ */
+
+typedef struct
+{
+    Game                   *game;
+    uint64_t                seed;
+    int                     state;
+    bool                    entered;
+    int                     delay;
+    int                     turnIndex;
+    Player                 *player;
+    int                     tax;
+    int                     investment;
+    int                     grainToSell;
+    Player                 *targetPlayer;
+    Battle                  battle;
+    SackReport              sackReport;
+    Render                  render;
+    Journal                *journal;
+} Session;
+
+
+/*
+ * Session state handler function types.
+ */
+
+typedef void (*SessionEnterHandler)(Session *aSession);
+
+typedef void (*SessionInputHandler)(Session *aSession, const char *aInput);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+Session *SessionCreate(int countryCount, uint64_t seed);
+
+void SessionDestroy(Session *aSession);
+
+bool SessionStartJournal(Session *aSession, const char *aPath);
+
+int SessionRun(Session *aSession, const char *aInput);
+
+void SessionGoto(Session *aSession, int state);
+
+void SessionDelay(Session *aSession, int delay);
+
+void SessionClearPrompt(Session *aSession);
+
+
+#endif /* __SESSION_H__ */
@@ -0,0 +1,772 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire batch simulator.
+ *
+ *   The batch simulator plays a number of complete all-CPU games with the rules
+ * engine and prints the outcome of each game as CSV.  Games are spread across
+ * a pool of worker threads.  Each worker owns a range of game numbers; a worker
+ * that runs out of games steals half of the remaining range of another worker.
+ * Each game is seeded from its game number, so the output does not depend on
+ * the number of threads.
+ *
+ *   With a batch size, workers take games in blocks and play each block in
+ * struct-of-arrays form with the batch kernels.  Batch play gives the same
+ * outcomes as playing the games one at a time.
+ *
+ *   With a snapshot, every game is a branch of the snapshot's position, played
+ * on from there for the number of years with its own seed.  Branches share the
+ * snapshot's pages until they change them.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "batch.h"
+#include "engine.h"
+#include "fork.h"
+#include "probe.h"
+#include "rng.h"
+#include "snapshot.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Simulator defs.
+ *
+ *   SIM_MAX_THREADS        Maximum number of worker threads.
+ *   SIM_DEFAULT_GAMES      Default number of games to play.
+ *   SIM_DEFAULT_YEARS      Default number of years to play each game.
+ */
+
+#define SIM_MAX_THREADS     1024
+#define SIM_DEFAULT_GAMES   1000
+#define SIM_DEFAULT_YEARS   30
+
+
+/*
+ * Pack and unpack a worker's range of game numbers.  The first game of the
+ * range is in the low 32 bits and the end of the range in the high 32 bits.
+ */
+
+#define SIM_RANGE(begin, end) \
+    ((((uint64_t) (end)) << 32) | ((uint64_t) (begin)))
+#define SIM_RANGE_BEGIN(range) ((uint32_t) (range))
+#define SIM_RANGE_END(range) ((uint32_t) ((range) >> 32))
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for the outcome of a player in a game.
+ *
+ *   land                   Acres of land.
+ *   grain                  Bushels of grain.
+ *   treasury               Treasury.
+ *   serfCount              Number of serfs.
+ *   soldierCount           Number of soldiers.
+ *   dead                   If true, player is dead.
+ */
+
+typedef struct
+{
+    int                     land;
+    int                     grain;
+    int                     treasury;
+    int                     serfCount;
+    int                     soldierCount;
+    bool                    dead;
+} SimPlayerOutcome;
+
+
+/*
+ * This structure contains fields for the outcome of a game.
+ *
+ *   seed                   Random number seed of the game.
+ *   year                   Last year played.
+ */
+
+typedef struct
+{
+    uint64_t                seed;
+    int                     year;
+} SimOutcome;
+
+
+/*
+ *   This structure contains fields for a worker thread.  Each worker is on its
+ * own cache line so that workers taking games from their own ranges do not
+ * contend.
+ *
+ *   range                  Packed range of game numbers left to the worker.
+ *   thread                 Worker thread.
+ *   number                 Worker number.
+ *   sim                    Simulator the worker belongs to.
+ */
+
+typedef struct Sim Sim;
+
+typedef struct
+{
+    _Alignas(64) _Atomic uint64_t range;
+    pthread_t               thread;
+    int                     number;
+    Sim                    *sim;
+} SimWorker;
+
+
+/*
+ * This structure contains fields for a batch simulation.
+ *
+ *   gameCount              Number of games to play.
+ *   yearCount              Number of years to play each game.
+ *   countryCount           Number of countries in each game.
+ *   seed                   Seed from which each game's seed is derived.
+ *   outcomeList            Outcome of each game, indexed by game number.
+ *   playerOutcomeList      Outcome of each player, indexed by game number *
+ *                          countryCount + player list index.
+ *   batchSize              Number of games to play at once in a batch, or 0 to
+ *                          play games one at a time.
+ *   fork                   Fork of the position games start from, or NULL to
+ *                          start new games.
+ *   startYear              Year games start from.
+ *   workerCount            Number of worker threads.
+ *   workerList             List of worker threads.
+ */
+
+struct Sim
+{
+    uint32_t                gameCount;
+    int                     yearCount;
+    int                     countryCount;
+    uint64_t                seed;
+    SimOutcome             *outcomeList;
+    SimPlayerOutcome       *playerOutcomeList;
+    int                     batchSize;
+    Fork                   *fork;
+    int                     startYear;
+    int                     workerCount;
+    SimWorker              *workerList;
+};
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void *SimWorkerMain(void *aArg);
+
+static void SimRunGames(SimWorker *aWorker);
+
+static void SimRunBatches(SimWorker *aWorker);
+
+static uint32_t SimTakeGames(SimWorker *aWorker,
+                             uint32_t   maxCount,
+                             uint32_t  *aGameNumber);
+
+static bool SimSteal(SimWorker *aWorker);
+
+static Game *SimStartGame(Sim *aSim, Game *aGame, uint32_t gameNumber);
+
+static void SimPlayGame(Sim *aSim, Game *aGame);
+
+static void SimRecordOutcome(Sim *aSim, Game *aGame, uint32_t gameNumber);
+
+static void SimPrintOutcomes(Sim *aSim);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    Sim             sim;
+    SimWorker      *worker;
+    Game           *game;
+    struct timespec startTime;
+    struct timespec endTime;
+    double          seconds;
+    uint32_t        begin;
+    uint32_t        end;
+    const char     *snapshotPath;
+    bool            quiet;
+    int             opt;
+    int             i;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line. */
+    sim.gameCount = SIM_DEFAULT_GAMES;
+    sim.yearCount = SIM_DEFAULT_YEARS;
+    sim.countryCount = COUNTRY_COUNT;
+    sim.seed = time(NULL);
+    sim.workerCount = sysconf(_SC_NPROCESSORS_ONLN);
+    sim.batchSize = 0;
+    sim.fork = NULL;
+    sim.startYear = 0;
+    snapshotPath = NULL;
+    quiet = FALSE;
+    while ((opt = getopt(argc, argv, "n:y:c:s:t:b:l:q")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n' :
+                sim.gameCount = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'y' :
+                sim.yearCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 'c' :
+                sim.countryCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 's' :
+                sim.seed = strtoull(optarg, NULL, 0);
+                break;
+
+            case 't' :
+                sim.workerCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 'b' :
+                sim.batchSize = strtol(optarg, NULL, 0);
+                break;
+
+            case 'l' :
+                snapshotPath = optarg;
+                break;
+
+            case 'q' :
+                quiet = TRUE;
+                break;
+
+            default :
+                fprintf(stderr,
+                        "usage: %s [-n games] [-y years] [-c countries] "
+                        "[-s seed] [-t threads] [-b batch size] "
+                        "[-l snapshot] [-q]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    if (sim.workerCount < 1)
+        sim.workerCount = 1;
+    if (sim.workerCount > SIM_MAX_THREADS)
+        sim.workerCount = SIM_MAX_THREADS;
+    if (sim.batchSize < 0)
+        sim.batchSize = 0;
+
+    /* Fork the snapshot's position, which sets the number of countries. */
+    if (snapshotPath != NULL)
+    {
+        game = SnapshotRead(snapshotPath);
+        if (game == NULL)
+        {
+            fprintf(stderr,
+                    "%s: can't read snapshot %s\n",
+                    argv[0],
+                    snapshotPath);
+            return 1;
+        }
+        sim.countryCount = game->countryCount;
+        sim.startYear = game->year;
+        sim.fork = ForkCreate(game);
+        EngineDestroyGame(game);
+        if (sim.fork == NULL)
+        {
+            fprintf(stderr, "%s: can't fork snapshot\n", argv[0]);
+            return 1;
+        }
+        if (sim.batchSize > 0)
+        {
+            fprintf(stderr,
+                    "%s: batches can't start from a snapshot\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if ((sim.countryCount < 1) || (sim.countryCount > COUNTRY_MAX))
+    {
+        fprintf(stderr,
+                "%s: country count must be from 1 to %d\n",
+                argv[0],
+                COUNTRY_MAX);
+        return 1;
+    }
+
+    /* Allocate the outcome and worker lists. */
+    sim.outcomeList = calloc(sim.gameCount, sizeof(SimOutcome));
+    sim.playerOutcomeList = calloc((size_t) sim.gameCount * sim.countryCount,
+                                   sizeof(SimPlayerOutcome));
+    sim.workerList = aligned_alloc(64, sim.workerCount * sizeof(SimWorker));
+    if (   (sim.outcomeList == NULL)
+        || (sim.playerOutcomeList == NULL)
+        || (sim.workerList == NULL))
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    /* Deal the games out evenly to the workers. */
+    for (i = 0; i < sim.workerCount; i++)
+    {
+        worker = &(sim.workerList[i]);
+        begin = ((uint64_t) sim.gameCount * i) / sim.workerCount;
+        end = ((uint64_t) sim.gameCount * (i + 1)) / sim.workerCount;
+        atomic_init(&(worker->range), SIM_RANGE(begin, end));
+        worker->number = i;
+        worker->sim = &sim;
+    }
+
+    /* Play the games. */
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (i = 1; i < sim.workerCount; i++)
+    {
+        worker = &(sim.workerList[i]);
+        pthread_create(&(worker->thread), NULL, SimWorkerMain, worker);
+    }
+    SimWorkerMain(&(sim.workerList[0]));
+    for (i = 1; i < sim.workerCount; i++)
+        pthread_join(sim.workerList[i].thread, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    /* Print the outcomes and throughput. */
+    if (!quiet)
+        SimPrintOutcomes(&sim);
+    seconds =   (endTime.tv_sec - startTime.tv_sec)
+              + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+    fprintf(stderr,
+            "%" PRIu32 " games of %d years in %.3f s on %d threads "
+            "(%.0f games/s)\n",
+            sim.gameCount,
+            sim.yearCount,
+            seconds,
+            sim.workerCount,
+            (seconds > 0.0) ? sim.gameCount / seconds : 0.0);
+
+    /* Clean up. */
+    ForkDestroy(sim.fork);
+    free(sim.outcomeList);
+    free(sim.playerOutcomeList);
+    free(sim.workerList);
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Play games with the worker specified by aArg until no worker has any games
+ * left.
+ *
+ *   aArg                   Worker.
+ */
+
+static void *SimWorkerMain(void *aArg)
+{
+    SimWorker *worker = aArg;
+
+    if (worker->sim->batchSize > 0)
+        SimRunBatches(worker);
+    else
+        SimRunGames(worker);
+
+    return NULL;
+}
+
+
+/*
+ * Play games one at a time with the worker specified by aWorker.
+ *
+ *   aWorker                Worker.
+ */
+
+static void SimRunGames(SimWorker *aWorker)
+{
+    Sim      *sim = aWorker->sim;
+    Game     *game = NULL;
+    uint32_t  gameNumber;
+
+    do
+    {
+        while (SimTakeGames(aWorker, 1, &gameNumber) > 0)
+        {
+            /* Play the game to the end. */
+            game = SimStartGame(sim, game, gameNumber);
+            SimPlayGame(sim, game);
+
+            /* Record the outcome. */
+            SimRecordOutcome(sim, game, gameNumber);
+        }
+    } while (SimSteal(aWorker));
+
+    /* Clean up. */
+    EngineDestroyGame(game);
+}
+
+
+/*
+ *   Play games in blocks of up to the batch size with the worker specified by
+ * aWorker.  A game the batch can't load is played on its own instead.
+ *
+ *   aWorker                Worker.
+ */
+
+static void SimRunBatches(SimWorker *aWorker)
+{
+    Sim      *sim = aWorker->sim;
+    Game    **gameList;
+    uint32_t *slotList;
+    Batch    *batch;
+    uint32_t  gameNumber;
+    uint32_t  gameCount;
+    uint32_t  loadCount;
+    uint32_t  i;
+    int       year;
+
+    /* Allocate the game and slot lists and batch. */
+    gameList = calloc(sim->batchSize, sizeof(Game *));
+    slotList = calloc(sim->batchSize, sizeof(uint32_t));
+    batch = BatchCreate(sim->batchSize, sim->countryCount);
+    if ((gameList == NULL) || (slotList == NULL) || (batch == NULL))
+    {
+        fprintf(stderr, "empire-sim: out of memory\n");
+        exit(1);
+    }
+    do
+    {
+        while ((gameCount = SimTakeGames(aWorker,
+                                         sim->batchSize,
+                                         &gameNumber)) > 0)
+        {
+            /*
+             *   Start the games and load them into the batch slots in order.
+             * Play any game that doesn't load to the end now.
+             */
+            batch->gameCount = gameCount;
+            loadCount = 0;
+            for (i = 0; i < gameCount; i++)
+            {
+                gameList[i] = SimStartGame(sim,
+                                           gameList[i],
+                                           gameNumber + i);
+                if (BatchLoad(batch, loadCount, gameList[i]))
+                {
+                    slotList[loadCount++] = i;
+                }
+                else
+                {
+                    SimPlayGame(sim, gameList[i]);
+                    SimRecordOutcome(sim, gameList[i], gameNumber + i);
+                }
+            }
+
+            /*
+             *   The batch lists are laid out for the number of games, so
+             * reload the games if any were left out.
+             */
+            if (loadCount < gameCount)
+            {
+                batch->gameCount = loadCount;
+                for (i = 0; i < loadCount; i++)
+                    BatchLoad(batch, i, gameList[slotList[i]]);
+            }
+            if (loadCount == 0)
+                continue;
+
+            /* Play the games to the end. */
+            for (year = 0; year < sim->yearCount; year++)
+                BatchCPUYear(batch);
+
+            /* Store the games and record their outcomes. */
+            for (i = 0; i < loadCount; i++)
+            {
+                BatchStore(batch, i, gameList[slotList[i]]);
+                SimRecordOutcome(sim,
+                                 gameList[slotList[i]],
+                                 gameNumber + slotList[i]);
+            }
+        }
+    } while (SimSteal(aWorker));
+
+    /* Clean up. */
+    BatchDestroy(batch);
+    for (i = 0; i < sim->batchSize; i++)
+        EngineDestroyGame(gameList[i]);
+    free(gameList);
+    free(slotList);
+}
+
+
+/*
+ *   Take up to the number of games specified by maxCount from the range of the
+ * worker specified by aWorker.  Return the number of games taken and the
+ * number of the first game in aGameNumber.
+ *
+ *   aWorker                Worker.
+ *   maxCount               Maximum number of games to take.
+ *   aGameNumber            Returned number of first game.
+ */
+
+static uint32_t SimTakeGames(SimWorker *aWorker,
+                             uint32_t   maxCount,
+                             uint32_t  *aGameNumber)
+{
+    uint64_t range;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t count;
+
+    range = atomic_load_explicit(&(aWorker->range), memory_order_relaxed);
+    do
+    {
+        begin = SIM_RANGE_BEGIN(range);
+        end = SIM_RANGE_END(range);
+        if (begin >= end)
+            return 0;
+        count = end - begin;
+        if (count > maxCount)
+            count = maxCount;
+    } while (!atomic_compare_exchange_weak(&(aWorker->range),
+                                           &range,
+                                           SIM_RANGE(begin + count, end)));
+    *aGameNumber = begin;
+
+    return count;
+}
+
+
+/*
+ *   Steal the upper half of the games left to another worker and give them to
+ * the worker specified by aWorker.  Return false if no other worker has any
+ * games left.  Ranges only ever shrink or move to an empty worker, so once a
+ * full pass finds every range empty, all games have been taken.
+ *
+ *   aWorker                Worker.
+ */
+
+static bool SimSteal(SimWorker *aWorker)
+{
+    Sim       *sim = aWorker->sim;
+    SimWorker *victim;
+    uint64_t   range;
+    uint32_t   begin;
+    uint32_t   end;
+    uint32_t   split;
+    int        i;
+
+    for (i = 1; i < sim->workerCount; i++)
+    {
+        /* Try the next worker. */
+        victim = &(sim->workerList[(aWorker->number + i) % sim->workerCount]);
+        range = atomic_load_explicit(&(victim->range), memory_order_relaxed);
+        do
+        {
+            begin = SIM_RANGE_BEGIN(range);
+            end = SIM_RANGE_END(range);
+            if (begin >= end)
+                break;
+            split = begin + (end - begin) / 2;
+        } while (!atomic_compare_exchange_weak(&(victim->range),
+                                               &range,
+                                               SIM_RANGE(begin, split)));
+
+        /* Take the stolen games. */
+        if (begin < end)
+        {
+            atomic_store(&(aWorker->range), SIM_RANGE(split, end));
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/*
+ *   Start the game specified by gameNumber and return its game record.  The
+ * game seed is derived from the simulation seed and the game number.  A new
+ * game has no human players and reuses the game record specified by aGame, or
+ * creates one if it is NULL.  With a fork, the game record is destroyed and
+ * the game is a new branch of the fork, reseeded.  Exit if out of memory.
+ *
+ *   aSim                   Simulator.
+ *   aGame                  Game record of the last game, or NULL.
+ *   gameNumber             Number of game to start.
+ */
+
+static Game *SimStartGame(Sim *aSim, Game *aGame, uint32_t gameNumber)
+{
+    Rng      seedRng;
+    uint64_t seed;
+
+    /* Derive the game seed. */
+    RngSeed(&seedRng, aSim->seed);
+    RngSeek(&seedRng, gameNumber);
+    seed = RngNext(&seedRng);
+
+    /* Branch the fork or start a new game. */
+    if (aSim->fork != NULL)
+    {
+        EngineDestroyGame(aGame);
+        aGame = ForkBranch(aSim->fork);
+    }
+    else if (aGame == NULL)
+    {
+        aGame = EngineCreateGame(aSim->countryCount);
+    }
+    if (aGame == NULL)
+    {
+        fprintf(stderr, "empire-sim: out of memory\n");
+        exit(1);
+    }
+    if (aSim->fork != NULL)
+        EngineSeed(aGame, seed);
+    else
+        EngineNewGame(aGame, 0, seed);
+
+    return aGame;
+}
+
+
+/*
+ *   Play the game specified by aGame with CPU players until it is over or has
+ * been played the number of years of the simulator specified by aSim.
+ *
+ *   aSim                   Simulator.
+ *   aGame                  Game.
+ */
+
+static void SimPlayGame(Sim *aSim, Game *aGame)
+{
+    Player *player;
+    int     endYear = aSim->startYear + aSim->yearCount;
+    int     i;
+
+    while (!aGame->gameOver && (aGame->year < endYear))
+    {
+        EngineNewYear(aGame);
+        for (i = 0; i < aGame->liveCount; i++)
+        {
+            player = &(aGame->playerList[aGame->liveList[i]]);
+            if (!player->dead)
+                EngineCPUTurn(aGame, player);
+        }
+    }
+}
+
+
+/*
+ *   Record the outcome of the game specified by gameNumber from the game record
+ * specified by aGame.
+ *
+ *   aSim                   Simulator.
+ *   aGame                  Game record.
+ *   gameNumber             Number of game.
+ */
+
+static void SimRecordOutcome(Sim *aSim, Game *aGame, uint32_t gameNumber)
+{
+    SimOutcome       *outcome;
+    SimPlayerOutcome *playerOutcome;
+    Player           *player;
+    int               i;
+
+    outcome = &(aSim->outcomeList[gameNumber]);
+    outcome->seed = aGame->seed;
+    outcome->year = aGame->year;
+    playerOutcome =
+        &(aSim->playerOutcomeList[(size_t) gameNumber * aSim->countryCount]);
+    for (i = 0; i < aSim->countryCount; i++, playerOutcome++)
+    {
+        player = &(aGame->playerList[i]);
+        playerOutcome->land = player->land;
+        playerOutcome->grain = player->grain;
+        playerOutcome->treasury = player->treasury;
+        playerOutcome->serfCount = player->serfCount;
+        playerOutcome->soldierCount = player->soldierCount;
+        playerOutcome->dead = player->dead;
+    }
+}
+
+
+/*
+ * Print the outcomes of all of the games as CSV, one game per line.
+ *
+ *   aSim                   Simulator.
+ */
+
+static void SimPrintOutcomes(Sim *aSim)
+{
+    SimOutcome       *outcome;
+    SimPlayerOutcome *playerOutcome;
+    uint32_t          gameNumber;
+    int               i;
+
+    /* Print the header. */
+    printf("game,seed,year");
+    for (i = 1; i <= aSim->countryCount; i++)
+    {
+        printf(",land%d,grain%d,treasury%d,serfs%d,soldiers%d,dead%d",
+               i, i, i, i, i, i);
+    }
+    printf("\n");
+
+    /* Print each game. */
+    for (gameNumber = 0; gameNumber < aSim->gameCount; gameNumber++)
+    {
+        outcome = &(aSim->outcomeList[gameNumber]);
+        printf("%" PRIu32 ",%" PRIu64 ",%d",
+               gameNumber,
+               outcome->seed,
+               outcome->year);
+        playerOutcome =
+            &(aSim->playerOutcomeList[  (size_t) gameNumber
+                                      * aSim->countryCount]);
+        for (i = 0; i < aSim->countryCount; i++, playerOutcome++)
+        {
+            printf(",%d,%d,%d,%d,%d,%d",
+                   playerOutcome->land,
+                   playerOutcome->grain,
+                   playerOutcome->treasury,
+                   playerOutcome->serfCount,
+                   playerOutcome->soldierCount,
+                   playerOutcome->dead);
+        }
+        printf("\n");
+    }
+}
+
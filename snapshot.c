@@ -0,0 +1,649 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game snapshots.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "engine.h"
+#include "snapshot.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Lists are copied in their in-memory form, so their entries must have the
+ * sizes the header describes.
+ */
+
+_Static_assert(sizeof(int) == sizeof(int32_t), "live list is not 32 bit");
+
+
+/*
+ * Round the size specified by size up to a multiple of SNAPSHOT_ALIGN.
+ */
+
+#define SNAPSHOT_ROUND(size) \
+    ((((size) + SNAPSHOT_ALIGN - 1) / SNAPSHOT_ALIGN) * SNAPSHOT_ALIGN)
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static void SnapshotLayout(SnapshotHeader *aHeader,
+                           int             countryCount,
+                           int             lotCapacity);
+
+static bool SnapshotCheck(const SnapshotHeader *aHeader,
+                          size_t                size,
+                          int                   countryCount);
+
+static bool SnapshotCheckLists(const SnapshotHeader *aHeader);
+
+static void SnapshotLoadState(Game *aGame, const void *aSnapshot);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External snapshot functions.
+ */
+
+/*
+ * Return the size of a snapshot of the game specified by aGame.
+ *
+ *   aGame                  Game.
+ */
+
+size_t SnapshotSize(const Game *aGame)
+{
+    SnapshotHeader header;
+
+    SnapshotLayout(&header, aGame->countryCount, aGame->market->lotCapacity);
+
+    return header.size;
+}
+
+
+/*
+ *   Save a snapshot of the game specified by aGame into the buffer specified by
+ * aSnapshot, which must be SnapshotSize bytes long and aligned to
+ * SNAPSHOT_ALIGN.
+ *
+ *   aGame                  Game.
+ *   aSnapshot              Snapshot buffer.
+ */
+
+void SnapshotSave(const Game *aGame, void *aSnapshot)
+{
+    SnapshotHeader     *header = aSnapshot;
+    char               *snapshot = aSnapshot;
+    const HumanAverage *average = &(aGame->humanAverage);
+    const Market       *market = aGame->market;
+    int                 countryCount = aGame->countryCount;
+    int                 i;
+
+    /* Fill in the header, clearing any padding. */
+    memset(header, 0, sizeof(SnapshotHeader));
+    SnapshotLayout(header, countryCount, market->lotCapacity);
+    header->playerCount = aGame->playerCount;
+    header->liveCount = aGame->liveCount;
+    header->year = aGame->year;
+    header->weather = aGame->weather;
+    header->barbarianLand = aGame->barbarianLand;
+    header->gameOver = aGame->gameOver;
+    header->seed = aGame->seed;
+    for (i = 0; i < STREAM_COUNT; i++)
+    {
+        header->rngSeedList[i] = aGame->rngList[i].seed;
+        header->rngCounterList[i] = aGame->rngList[i].counter;
+    }
+
+    /* Store the human averages with the leader as an index. */
+    header->humanAverage.valid = average->valid;
+    header->humanAverage.leader = (average->leader != NULL)
+                                  ? (average->leader - aGame->playerList)
+                                  : -1;
+    header->humanAverage.serfCount = average->serfCount;
+    header->humanAverage.grainForSale = average->grainForSale;
+    header->humanAverage.grainPrice = average->grainPrice;
+    header->humanAverage.treasury = average->treasury;
+    header->humanAverage.merchantCount = average->merchantCount;
+    header->humanAverage.marketplaceCount = average->marketplaceCount;
+    header->humanAverage.grainMillCount = average->grainMillCount;
+    header->humanAverage.foundryCount = average->foundryCount;
+    header->humanAverage.shipyardCount = average->shipyardCount;
+    header->humanAverage.palaceCount = average->palaceCount;
+    header->humanAverage.nobleCount = average->nobleCount;
+    header->humanAverage.armyEfficiency = average->armyEfficiency;
+
+    /* Fill in the market scalars. */
+    header->freeLot = market->freeLot;
+    header->heapCount = market->heapCount;
+    header->sequence = market->sequence;
+    header->marketVersion = market->version;
+
+    /* Copy the lists. */
+    memcpy(snapshot + header->playerOffset,
+           aGame->playerList,
+           countryCount * sizeof(Player));
+    memcpy(snapshot + header->liveOffset,
+           aGame->liveList,
+           aGame->liveCount * sizeof(int32_t));
+    memcpy(snapshot + header->nameOffset,
+           aGame->nameList,
+           countryCount * sizeof(aGame->nameList[0]));
+    memcpy(snapshot + header->lotOffset,
+           market->lotList,
+           market->lotCapacity * sizeof(MarketLot));
+    memcpy(snapshot + header->heapOffset,
+           market->heap,
+           market->heapCount * sizeof(int32_t));
+    memcpy(snapshot + header->sellerLotOffset,
+           market->sellerLotList,
+           countryCount * sizeof(int32_t));
+}
+
+
+/*
+ *   Load the snapshot specified by aSnapshot of the size specified by size into
+ * the game specified by aGame, which must have been created with the same
+ * number of countries.  Return false if the snapshot is not one this build can
+ * load, leaving the game unchanged, or if out of memory.
+ *
+ *   aGame                  Game.
+ *   aSnapshot              Snapshot.
+ *   size                   Size of the snapshot.
+ */
+
+bool SnapshotLoad(Game *aGame, const void *aSnapshot, size_t size)
+{
+    const SnapshotHeader *header = aSnapshot;
+    const char           *snapshot = aSnapshot;
+    int                   countryCount = aGame->countryCount;
+
+    /* Check the snapshot and make room for its market lots. */
+    if (   !SnapshotCheck(header, size, countryCount)
+        || !MarketReserve(aGame->market, header->lotCapacity))
+    {
+        return FALSE;
+    }
+
+    /* Load the player, live, and name lists, and then the rest. */
+    memcpy(aGame->playerList,
+           snapshot + header->playerOffset,
+           countryCount * sizeof(Player));
+    memcpy(aGame->liveList,
+           snapshot + header->liveOffset,
+           header->liveCount * sizeof(int32_t));
+    memcpy(aGame->nameList,
+           snapshot + header->nameOffset,
+           countryCount * sizeof(aGame->nameList[0]));
+    SnapshotLoadState(aGame, aSnapshot);
+
+    return TRUE;
+}
+
+
+/*
+ *   Load the snapshot specified by aSnapshot, a memory mapping of the size
+ * specified by size, into the game specified by aGame in place.  The game's
+ * player, live, and name lists are left in the mapping rather than copied, and
+ * the game takes the mapping over and unmaps it when destroyed.  A private
+ * mapping of a file thus gives a game that shares the file's pages until it
+ * writes them.  The game must have been created with the same number of
+ * countries.  Return false if the snapshot is not one this build can load,
+ * leaving the game unchanged, or if out of memory.
+ *
+ *   aGame                  Game.
+ *   aSnapshot              Snapshot mapping.
+ *   size                   Size of the mapping.
+ */
+
+bool SnapshotMap(Game *aGame, void *aSnapshot, size_t size)
+{
+    const SnapshotHeader *header = aSnapshot;
+    char                 *snapshot = aSnapshot;
+
+    /* Check the snapshot and make room for its market lots. */
+    if (   !SnapshotCheck(header, size, aGame->countryCount)
+        || !MarketReserve(aGame->market, header->lotCapacity))
+    {
+        return FALSE;
+    }
+
+    /* Use the player, live, and name lists in place, and load the rest. */
+    if (aGame->mapping != NULL)
+    {
+        munmap(aGame->mapping, aGame->mappingSize);
+    }
+    else
+    {
+        free(aGame->playerList);
+        free(aGame->liveList);
+        free(aGame->nameList);
+    }
+    aGame->playerList = (Player *) (snapshot + header->playerOffset);
+    aGame->liveList = (int *) (snapshot + header->liveOffset);
+    aGame->nameList = (void *) (snapshot + header->nameOffset);
+    aGame->mapping = aSnapshot;
+    aGame->mappingSize = size;
+    SnapshotLoadState(aGame, aSnapshot);
+
+    return TRUE;
+}
+
+
+/*
+ *   Write a snapshot of the game specified by aGame to a file at the path
+ * specified by aPath.  Return false on error.
+ *
+ *   aGame                  Game.
+ *   aPath                  Snapshot file path.
+ */
+
+bool SnapshotWrite(const Game *aGame, const char *aPath)
+{
+    FILE   *file;
+    void   *snapshot;
+    size_t  size;
+    bool    written;
+
+    /* Save the snapshot. */
+    size = SnapshotSize(aGame);
+    snapshot = aligned_alloc(SNAPSHOT_ALIGN, size);
+    if (snapshot == NULL)
+        return FALSE;
+    SnapshotSave(aGame, snapshot);
+
+    /* Write it out. */
+    file = fopen(aPath, "wb");
+    written = (file != NULL) && (fwrite(snapshot, 1, size, file) == size);
+    if ((file != NULL) && (fclose(file) != 0))
+        written = FALSE;
+    free(snapshot);
+
+    return written;
+}
+
+
+/*
+ *   Create and return a game loaded from the snapshot file at the path
+ * specified by aPath.  The file is memory-mapped and loaded in place.  Return
+ * NULL on error.
+ *
+ *   aPath                  Snapshot file path.
+ */
+
+Game *SnapshotRead(const char *aPath)
+{
+    const SnapshotHeader *header;
+    struct stat           status;
+    Game                 *game = NULL;
+    void                 *snapshot;
+    int                   fd;
+
+    /* Map the file. */
+    fd = open(aPath, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (   (fstat(fd, &status) < 0)
+        || ((size_t) status.st_size < sizeof(SnapshotHeader)))
+    {
+        close(fd);
+        return NULL;
+    }
+    snapshot = mmap(NULL, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (snapshot == MAP_FAILED)
+        return NULL;
+
+    /* Create a game of the snapshot's size and load it. */
+    header = snapshot;
+    if (SnapshotCheck(header, status.st_size, header->countryCount))
+        game = EngineCreateGame(header->countryCount);
+    if ((game != NULL) && !SnapshotLoad(game, snapshot, status.st_size))
+    {
+        EngineDestroyGame(game);
+        game = NULL;
+    }
+    munmap(snapshot, status.st_size);
+
+    return game;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal snapshot functions.
+ */
+
+/*
+ *   Fill in the identifying fields, list offsets, and size of the snapshot
+ * header specified by aHeader for a game with the number of countries
+ * specified by countryCount and the number of market lots specified by
+ * lotCapacity.
+ *
+ *   aHeader                Snapshot header.
+ *   countryCount           Number of countries.
+ *   lotCapacity            Number of market lots.
+ */
+
+static void SnapshotLayout(SnapshotHeader *aHeader,
+                           int             countryCount,
+                           int             lotCapacity)
+{
+    uint64_t offset;
+
+    /* Fill in the identifying fields. */
+    memcpy(aHeader->magic, SNAPSHOT_MAGIC, sizeof(aHeader->magic));
+    aHeader->version = SNAPSHOT_VERSION;
+    aHeader->byteOrder = SNAPSHOT_BYTE_ORDER;
+    aHeader->playerSize = sizeof(Player);
+    aHeader->lotSize = sizeof(MarketLot);
+    aHeader->countryCount = countryCount;
+    aHeader->lotCapacity = lotCapacity;
+
+    /* Lay out the lists, each on an aligned boundary. */
+    offset = SNAPSHOT_ROUND(sizeof(SnapshotHeader));
+    aHeader->playerOffset = offset;
+    offset += SNAPSHOT_ROUND(countryCount * sizeof(Player));
+    aHeader->liveOffset = offset;
+    offset += SNAPSHOT_ROUND(countryCount * sizeof(int32_t));
+    aHeader->nameOffset = offset;
+    offset += SNAPSHOT_ROUND(countryCount * (uint64_t) PLAYER_NAME_SIZE);
+    aHeader->lotOffset = offset;
+    offset += SNAPSHOT_ROUND(lotCapacity * sizeof(MarketLot));
+    aHeader->heapOffset = offset;
+    offset += SNAPSHOT_ROUND(lotCapacity * sizeof(int32_t));
+    aHeader->sellerLotOffset = offset;
+    offset += SNAPSHOT_ROUND(countryCount * sizeof(int32_t));
+    aHeader->size = offset;
+}
+
+
+/*
+ *   Return true if the snapshot header specified by aHeader, of a snapshot of
+ * the size specified by size, describes a snapshot this build can load into a
+ * game with the number of countries specified by countryCount, and its lists
+ * are sound.
+ *
+ *   aHeader                Snapshot header.
+ *   size                   Size of the snapshot.
+ *   countryCount           Number of countries in the game.
+ */
+
+static bool SnapshotCheck(const SnapshotHeader *aHeader,
+                          size_t                size,
+                          int                   countryCount)
+{
+    SnapshotHeader layout;
+
+    /* Check the identifying fields. */
+    if (   (size < sizeof(SnapshotHeader))
+        || (memcmp(aHeader->magic, SNAPSHOT_MAGIC, sizeof(aHeader->magic)) != 0)
+        || (aHeader->version != SNAPSHOT_VERSION)
+        || (aHeader->byteOrder != SNAPSHOT_BYTE_ORDER)
+        || (aHeader->playerSize != sizeof(Player))
+        || (aHeader->lotSize != sizeof(MarketLot))
+        || (aHeader->countryCount != countryCount)
+        || (aHeader->lotCapacity < 1))
+    {
+        return FALSE;
+    }
+
+    /* The lists must be where they belong. */
+    SnapshotLayout(&layout, countryCount, aHeader->lotCapacity);
+    if (   (aHeader->size != layout.size)
+        || (size < layout.size)
+        || (aHeader->playerOffset != layout.playerOffset)
+        || (aHeader->liveOffset != layout.liveOffset)
+        || (aHeader->nameOffset != layout.nameOffset)
+        || (aHeader->lotOffset != layout.lotOffset)
+        || (aHeader->heapOffset != layout.heapOffset)
+        || (aHeader->sellerLotOffset != layout.sellerLotOffset))
+    {
+        return FALSE;
+    }
+
+    /* The counts must fit their lists. */
+    if (   (aHeader->playerCount < 0)
+        || (aHeader->playerCount > countryCount)
+        || (aHeader->liveCount < 0)
+        || (aHeader->liveCount > countryCount)
+        || (aHeader->heapCount < 0)
+        || (aHeader->heapCount > aHeader->lotCapacity)
+        || (aHeader->freeLot < -1)
+        || (aHeader->freeLot >= aHeader->lotCapacity)
+        || (aHeader->humanAverage.leader < -1)
+        || (aHeader->humanAverage.leader >= countryCount))
+    {
+        return FALSE;
+    }
+
+    return SnapshotCheckLists(aHeader);
+}
+
+
+/*
+ *   Return true if every index in the lists of the snapshot specified by
+ * aHeader, whose header has been checked, is in range, and the lists are
+ * linked up as the game and market leave them.  A snapshot that passes can be
+ * used without checking its indices again.
+ *
+ *   aHeader                Snapshot header.
+ */
+
+static bool SnapshotCheckLists(const SnapshotHeader *aHeader)
+{
+    const char      *snapshot = (const char *) aHeader;
+    const Player    *playerList;
+    const int32_t   *liveList;
+    const char      *nameList;
+    const MarketLot *lotList;
+    const MarketLot *lot;
+    const int32_t   *heap;
+    const int32_t   *sellerLotList;
+    int              countryCount = aHeader->countryCount;
+    int              lotCapacity = aHeader->lotCapacity;
+    int              linkCount;
+    int              prev;
+    int              i;
+    int              j;
+
+    playerList = (const Player *) (snapshot + aHeader->playerOffset);
+    liveList = (const int32_t *) (snapshot + aHeader->liveOffset);
+    nameList = snapshot + aHeader->nameOffset;
+    lotList = (const MarketLot *) (snapshot + aHeader->lotOffset);
+    heap = (const int32_t *) (snapshot + aHeader->heapOffset);
+    sellerLotList = (const int32_t *) (snapshot + aHeader->sellerLotOffset);
+
+    /* Each player must be numbered for its place, with a name and title. */
+    for (i = 0; i < countryCount; i++)
+    {
+        if (   (playerList[i].number != i + 1)
+            || (playerList[i].level >= TITLE_COUNT)
+            || (memchr(nameList + i * PLAYER_NAME_SIZE,
+                       '\0',
+                       PLAYER_NAME_SIZE) == NULL))
+        {
+            return FALSE;
+        }
+    }
+
+    /* Each live list entry must be a player. */
+    for (i = 0; i < aHeader->liveCount; i++)
+    {
+        if ((liveList[i] < 0) || (liveList[i] >= countryCount))
+            return FALSE;
+    }
+
+    /* Each lot must be free or in the heap, and each heap entry a lot there. */
+    for (i = 0; i < lotCapacity; i++)
+    {
+        lot = &(lotList[i]);
+        if (   (lot->heapIndex < -1)
+            || (lot->heapIndex >= aHeader->heapCount)
+            || (lot->next < -1)
+            || (lot->next >= lotCapacity)
+            || (   (lot->heapIndex >= 0)
+                && (   (lot->seller < 0)
+                    || (lot->seller >= countryCount)
+                    || (lot->prev < -1)
+                    || (lot->prev >= lotCapacity))))
+        {
+            return FALSE;
+        }
+    }
+    for (i = 0; i < aHeader->heapCount; i++)
+    {
+        if (   (heap[i] < 0)
+            || (heap[i] >= lotCapacity)
+            || (lotList[heap[i]].heapIndex != i))
+        {
+            return FALSE;
+        }
+    }
+
+    /*
+     *   Each seller's lots must be its own and linked both ways, and the free
+     * list must hold only free lots.  A list that loops runs past the number
+     * of lots it could hold.
+     */
+    linkCount = 0;
+    for (i = 0; i < countryCount; i++)
+    {
+        if ((sellerLotList[i] < -1) || (sellerLotList[i] >= lotCapacity))
+            return FALSE;
+        prev = -1;
+        for (j = sellerLotList[i]; j >= 0; j = lotList[j].next)
+        {
+            if (   (++linkCount > aHeader->heapCount)
+                || (lotList[j].heapIndex < 0)
+                || (lotList[j].seller != i)
+                || (lotList[j].prev != prev))
+            {
+                return FALSE;
+            }
+            prev = j;
+        }
+    }
+    if (linkCount != aHeader->heapCount)
+        return FALSE;
+    linkCount = 0;
+    for (j = aHeader->freeLot; j >= 0; j = lotList[j].next)
+    {
+        if (   (++linkCount > lotCapacity - aHeader->heapCount)
+            || (lotList[j].heapIndex >= 0))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/*
+ *   Load everything but the player, live, and name lists from the snapshot
+ * specified by aSnapshot, which has been checked, into the game specified by
+ * aGame, whose market has room for the snapshot's lots.
+ *
+ *   aGame                  Game.
+ *   aSnapshot              Snapshot.
+ */
+
+static void SnapshotLoadState(Game *aGame, const void *aSnapshot)
+{
+    const SnapshotHeader  *header = aSnapshot;
+    const char            *snapshot = aSnapshot;
+    const SnapshotAverage *average = &(header->humanAverage);
+    Market                *market = aGame->market;
+    int                    countryCount = aGame->countryCount;
+    int                    i;
+
+    /* Load the scalars. */
+    aGame->playerCount = header->playerCount;
+    aGame->liveCount = header->liveCount;
+    aGame->year = header->year;
+    aGame->weather = header->weather;
+    aGame->barbarianLand = header->barbarianLand;
+    aGame->gameOver = header->gameOver;
+    aGame->seed = header->seed;
+    for (i = 0; i < STREAM_COUNT; i++)
+    {
+        RngSeed(&(aGame->rngList[i]), header->rngSeedList[i]);
+        RngSeek(&(aGame->rngList[i]), header->rngCounterList[i]);
+    }
+
+    /* Load the human averages. */
+    aGame->humanAverage.valid = average->valid;
+    aGame->humanAverage.leader = (average->leader >= 0)
+                                 ? &(aGame->playerList[average->leader])
+                                 : NULL;
+    aGame->humanAverage.serfCount = average->serfCount;
+    aGame->humanAverage.grainForSale = average->grainForSale;
+    aGame->humanAverage.grainPrice = average->grainPrice;
+    aGame->humanAverage.treasury = average->treasury;
+    aGame->humanAverage.merchantCount = average->merchantCount;
+    aGame->humanAverage.marketplaceCount = average->marketplaceCount;
+    aGame->humanAverage.grainMillCount = average->grainMillCount;
+    aGame->humanAverage.foundryCount = average->foundryCount;
+    aGame->humanAverage.shipyardCount = average->shipyardCount;
+    aGame->humanAverage.palaceCount = average->palaceCount;
+    aGame->humanAverage.nobleCount = average->nobleCount;
+    aGame->humanAverage.armyEfficiency = average->armyEfficiency;
+
+    /* Load the market lists. */
+    memcpy(market->lotList,
+           snapshot + header->lotOffset,
+           header->lotCapacity * sizeof(MarketLot));
+    memcpy(market->heap,
+           snapshot + header->heapOffset,
+           header->heapCount * sizeof(int32_t));
+    memcpy(market->sellerLotList,
+           snapshot + header->sellerLotOffset,
+           countryCount * sizeof(int32_t));
+
+    /* Load the market scalars. */
+    market->freeLot = header->freeLot;
+    market->heapCount = header->heapCount;
+    market->sequence = header->sequence;
+    market->version = header->marketVersion;
+
+    /*
+     *   If the market already had more lots than the snapshot, put the extra
+     * lots ahead of the snapshot's free list.
+     */
+    if (market->lotCapacity > header->lotCapacity)
+    {
+        for (i = header->lotCapacity; i < market->lotCapacity; i++)
+        {
+            market->lotList[i].heapIndex = -1;
+            market->lotList[i].next = i + 1;
+        }
+        market->lotList[market->lotCapacity - 1].next = market->freeLot;
+        market->freeLot = header->lotCapacity;
+    }
+}
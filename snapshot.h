@@ -0,0 +1,177 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire game snapshot header file.
+ *
+ *   A snapshot holds the complete state of a game in a fixed binary layout: a
+ * header with the game's scalars, random number stream positions, and the
+ * offset of each list, followed by the lists themselves.  Lists are stored in
+ * their in-memory form, each starting on a 64 byte boundary, so a snapshot is
+ * saved and loaded with one copy per list and may be loaded straight from a
+ * memory-mapped file.
+ *
+ *   The layout is that of the machine the snapshot was saved on.  The header
+ * records the version, byte order, and record sizes, and snapshots that don't
+ * match are refused rather than converted.
+ *
+ *   Countries are not stored; they follow from the country count.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __SNAPSHOT_H__
+#define __SNAPSHOT_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Local includes. */
+#include "empire.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Snapshot defs.
+ *
+ *   SNAPSHOT_MAGIC         Magic string at the start of a snapshot.
+ *   SNAPSHOT_VERSION       Version of the snapshot layout.
+ *   SNAPSHOT_BYTE_ORDER    Value stored to check the byte order.
+ *   SNAPSHOT_ALIGN         Alignment of each list in a snapshot.
+ */
+
+#define SNAPSHOT_MAGIC      "EMPSNAP"
+#define SNAPSHOT_VERSION    1
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+#define SNAPSHOT_ALIGN      64
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ *   This structure contains the average human player holdings of a snapshot.
+ * The leader is stored as a player list index.
+ *
+ *   valid                  If true, the averages are up to date.
+ *   leader                 Player list index of the leader, or -1.
+ *   Others                 As in HumanAverage.
+ */
+
+typedef struct
+{
+    int32_t                 valid;
+    int32_t                 leader;
+    int32_t                 serfCount;
+    int32_t                 grainForSale;
+    float                   grainPrice;
+    int32_t                 treasury;
+    int32_t                 merchantCount;
+    int32_t                 marketplaceCount;
+    int32_t                 grainMillCount;
+    int32_t                 foundryCount;
+    int32_t                 shipyardCount;
+    int32_t                 palaceCount;
+    int32_t                 nobleCount;
+    int32_t                 armyEfficiency;
+} SnapshotAverage;
+
+
+/*
+ *   This structure contains the header of a snapshot.  List offsets are from
+ * the start of the snapshot.
+ *
+ *   magic                  SNAPSHOT_MAGIC.
+ *   version                SNAPSHOT_VERSION.
+ *   byteOrder              SNAPSHOT_BYTE_ORDER.
+ *   playerSize             Size of a player record.
+ *   lotSize                Size of a market lot record.
+ *   size                   Size of the snapshot.
+ *   countryCount           Count of the number of countries.
+ *   playerCount            Count of the number of human players.
+ *   liveCount              Count of the number of entries in the live list.
+ *   year                   Current year.
+ *   weather                Weather for year.
+ *   barbarianLand          Amount of barbarian land in acres.
+ *   gameOver               If true, game is over.
+ *   seed                   Random number seed the game was started with.
+ *   rngSeedList            Seed of each random number stream.
+ *   rngCounterList         Number of values drawn from each stream.
+ *   humanAverage           Average human player holdings.
+ *   lotCapacity            Number of lots in the market lot list.
+ *   freeLot                First free market lot, or -1.
+ *   heapCount              Number of lots in the market heap.
+ *   sequence               Next market lot sequence number.
+ *   marketVersion          Number of changes made to the market.
+ *   playerOffset           Offset of the player list.
+ *   liveOffset             Offset of the live list.
+ *   nameOffset             Offset of the player name list.
+ *   lotOffset              Offset of the market lot list.
+ *   heapOffset             Offset of the market heap.
+ *   sellerLotOffset        Offset of the market seller lot list.
+ */
+
+typedef struct
+{
+    char                    magic[8];
+    uint32_t                version;
+    uint32_t                byteOrder;
+    uint32_t                playerSize;
+    uint32_t                lotSize;
+    uint64_t                size;
+    int32_t                 countryCount;
+    int32_t                 playerCount;
+    int32_t                 liveCount;
+    int32_t                 year;
+    int32_t                 weather;
+    int32_t                 barbarianLand;
+    int32_t                 gameOver;
+    uint64_t                seed;
+    uint64_t                rngSeedList[STREAM_COUNT];
+    uint64_t                rngCounterList[STREAM_COUNT];
+    SnapshotAverage         humanAverage;
+    int32_t                 lotCapacity;
+    int32_t                 freeLot;
+    int32_t                 heapCount;
+    uint32_t                sequence;
+    uint32_t                marketVersion;
+    uint64_t                playerOffset;
+    uint64_t                liveOffset;
+    uint64_t                nameOffset;
+    uint64_t                lotOffset;
+    uint64_t                heapOffset;
+    uint64_t                sellerLotOffset;
+} SnapshotHeader;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+size_t SnapshotSize(const Game *aGame);
+
+void SnapshotSave(const Game *aGame, void *aSnapshot);
+
+bool SnapshotLoad(Game *aGame, const void *aSnapshot, size_t size);
+
+bool SnapshotMap(Game *aGame, void *aSnapshot, size_t size);
+
+bool SnapshotWrite(const Game *aGame, const char *aPath);
+
+Game *SnapshotRead(const char *aPath);
+
+
+#endif /* __SNAPSHOT_H__ */
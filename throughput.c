@@ -0,0 +1,424 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire end-to-end throughput benchmark.
+ *
+ *   The throughput benchmark plays complete all-CPU games through the same
+ * session code the game and server run: the start screen, the new year, each
+ * CPU player's turn, and the end of year summary, year after year.  It is
+ * built with RENDER_NULL and skips delays, so what it measures is the rules
+ * and the session flow around them.
+ *
+ *   The games are played with 1, 2, 4, and so on up to the maximum number of
+ * threads, with the maximum itself always last.  Threads take games from a
+ * shared counter.  For each thread count, the games per second, years per
+ * second, and speedup over one thread are printed as CSV, along with the
+ * memory per game.  The memory per game is measured once, before the timed
+ * runs, as the growth in anonymous memory while holding a number of finished
+ * games at once.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "probe.h"
+#include "rng.h"
+#include "session.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Throughput benchmark defs.
+ *
+ *   THROUGHPUT_MAX_THREADS Maximum number of threads.
+ *   THROUGHPUT_DEFAULT_GAMES
+ *                          Default number of games to play at each thread
+ *                          count.
+ *   THROUGHPUT_DEFAULT_YEARS
+ *                          Default number of years to play each game.
+ *   THROUGHPUT_DEFAULT_MEMORY_GAMES
+ *                          Default number of games held to measure the memory
+ *                          per game.
+ */
+
+#define THROUGHPUT_MAX_THREADS          1024
+#define THROUGHPUT_DEFAULT_GAMES        2000
+#define THROUGHPUT_DEFAULT_YEARS        30
+#define THROUGHPUT_DEFAULT_MEMORY_GAMES 100
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * This structure contains fields for a throughput run.
+ *
+ *   gameCount              Number of games to play.
+ *   yearCount              Number of years to play each game.
+ *   countryCount           Number of countries in each game.
+ *   seed                   Seed from which each game's seed is derived.
+ *   nextGame               Number of the next game to play.
+ *   yearTotal              Total number of years played.
+ */
+
+typedef struct
+{
+    uint32_t                gameCount;
+    int                     yearCount;
+    int                     countryCount;
+    uint64_t                seed;
+    _Atomic uint32_t        nextGame;
+    _Atomic uint64_t        yearTotal;
+} Throughput;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+static double ThroughputRun(Throughput *aThroughput, int threadCount);
+
+static void *ThroughputWorkerMain(void *aArg);
+
+static Session *ThroughputPlay(Throughput *aThroughput, uint32_t gameNumber);
+
+static long ThroughputMemory(Throughput *aThroughput, int gameCount);
+
+static long ThroughputAnonymousMemory(void);
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Main entry point.
+ */
+
+int main(int argc, char **argv)
+{
+    Throughput  throughput;
+    double      seconds;
+    double      gameRate;
+    double      yearRate;
+    double      baseGameRate;
+    long        gameMemory;
+    int         maxThreadCount;
+    int         memoryGameCount;
+    int         threadCount;
+    int         opt;
+
+    /* Dump the phase probes at exit and on SIGUSR2. */
+    ProbeInit();
+
+    /* Parse the command line. */
+    throughput.gameCount = THROUGHPUT_DEFAULT_GAMES;
+    throughput.yearCount = THROUGHPUT_DEFAULT_YEARS;
+    throughput.countryCount = COUNTRY_COUNT;
+    throughput.seed = time(NULL);
+    maxThreadCount = sysconf(_SC_NPROCESSORS_ONLN);
+    memoryGameCount = THROUGHPUT_DEFAULT_MEMORY_GAMES;
+    while ((opt = getopt(argc, argv, "n:y:c:s:t:m:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n' :
+                throughput.gameCount = strtoul(optarg, NULL, 0);
+                break;
+
+            case 'y' :
+                throughput.yearCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 'c' :
+                throughput.countryCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 's' :
+                throughput.seed = strtoull(optarg, NULL, 0);
+                break;
+
+            case 't' :
+                maxThreadCount = strtol(optarg, NULL, 0);
+                break;
+
+            case 'm' :
+                memoryGameCount = strtol(optarg, NULL, 0);
+                break;
+
+            default :
+                fprintf(stderr,
+                        "usage: %s [-n games] [-y years] [-c countries] "
+                        "[-s seed] [-t max threads] [-m memory games]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    if (maxThreadCount < 1)
+        maxThreadCount = 1;
+    if (maxThreadCount > THROUGHPUT_MAX_THREADS)
+        maxThreadCount = THROUGHPUT_MAX_THREADS;
+    if (memoryGameCount < 1)
+        memoryGameCount = 1;
+    if (   (throughput.countryCount < 1)
+        || (throughput.countryCount > COUNTRY_MAX))
+    {
+        fprintf(stderr,
+                "%s: country count must be from 1 to %d\n",
+                argv[0],
+                COUNTRY_MAX);
+        return 1;
+    }
+
+    /* Measure the memory per game before anything else has used the heap. */
+    gameMemory = ThroughputMemory(&throughput, memoryGameCount);
+
+    /* Play the games at each thread count. */
+    printf("threads,games,years,seconds,games_per_s,years_per_s,speedup,"
+           "bytes_per_game\n");
+    baseGameRate = 0.0;
+    threadCount = 1;
+    while (1)
+    {
+        /* Play the games. */
+        seconds = ThroughputRun(&throughput, threadCount);
+        gameRate = 0.0;
+        yearRate = 0.0;
+        if (seconds > 0.0)
+        {
+            gameRate = throughput.gameCount / seconds;
+            yearRate = atomic_load(&(throughput.yearTotal)) / seconds;
+        }
+        if (threadCount == 1)
+            baseGameRate = gameRate;
+
+        /* Print the point on the curve. */
+        printf("%d,%" PRIu32 ",%" PRIu64 ",%.3f,%.0f,%.0f,%.2f,%ld\n",
+               threadCount,
+               throughput.gameCount,
+               atomic_load(&(throughput.yearTotal)),
+               seconds,
+               gameRate,
+               yearRate,
+               (baseGameRate > 0.0) ? gameRate / baseGameRate : 0.0,
+               gameMemory);
+        fflush(stdout);
+
+        /* Double the threads, ending with the maximum. */
+        if (threadCount >= maxThreadCount)
+            break;
+        threadCount *= 2;
+        if (threadCount > maxThreadCount)
+            threadCount = maxThreadCount;
+    }
+
+    return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Internal functions.
+ */
+
+/*
+ *   Play all of the games of the throughput run specified by aThroughput with
+ * the number of threads specified by threadCount, and return the number of
+ * seconds they took.  Exit if a thread can't be created.
+ *
+ *   aThroughput            Throughput run.
+ *   threadCount            Number of threads.
+ */
+
+static double ThroughputRun(Throughput *aThroughput, int threadCount)
+{
+    pthread_t       threadList[THROUGHPUT_MAX_THREADS];
+    struct timespec startTime;
+    struct timespec endTime;
+    int             i;
+
+    /* Start from the first game. */
+    atomic_store(&(aThroughput->nextGame), 0);
+    atomic_store(&(aThroughput->yearTotal), 0);
+
+    /* Play the games on the threads, this one included. */
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    for (i = 1; i < threadCount; i++)
+    {
+        if (pthread_create(&(threadList[i]),
+                           NULL,
+                           ThroughputWorkerMain,
+                           aThroughput) != 0)
+        {
+            fprintf(stderr, "empire-throughput: can't create thread\n");
+            exit(1);
+        }
+    }
+    ThroughputWorkerMain(aThroughput);
+    for (i = 1; i < threadCount; i++)
+        pthread_join(threadList[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &endTime);
+
+    return   (endTime.tv_sec - startTime.tv_sec)
+           + (endTime.tv_nsec - startTime.tv_nsec) / 1e9;
+}
+
+
+/*
+ *   Play games of the throughput run specified by aArg until there are none
+ * left.
+ *
+ *   aArg                   Throughput run.
+ */
+
+static void *ThroughputWorkerMain(void *aArg)
+{
+    Throughput *throughput = aArg;
+    Session    *session;
+    uint64_t    yearCount = 0;
+    uint32_t    gameNumber;
+
+    while (1)
+    {
+        gameNumber = atomic_fetch_add(&(throughput->nextGame), 1);
+        if (gameNumber >= throughput->gameCount)
+            break;
+        session = ThroughputPlay(throughput, gameNumber);
+        yearCount += session->game->year;
+        SessionDestroy(session);
+    }
+    atomic_fetch_add(&(throughput->yearTotal), yearCount);
+
+    return NULL;
+}
+
+
+/*
+ *   Play the game specified by gameNumber of the throughput run specified by
+ * aThroughput through a session, and return the session.  The game has no
+ * human players and is played until the summary of its last year, or until it
+ * is over.  The game seed is derived from the run seed and the game number.
+ * Exit if out of memory.
+ *
+ *   aThroughput            Throughput run.
+ *   gameNumber             Number of game to play.
+ */
+
+static Session *ThroughputPlay(Throughput *aThroughput, uint32_t gameNumber)
+{
+    Session    *session;
+    Rng         seedRng;
+    const char *input;
+    int         result;
+
+    /* Create the session. */
+    RngSeed(&seedRng, aThroughput->seed);
+    RngSeek(&seedRng, gameNumber);
+    session = SessionCreate(aThroughput->countryCount, RngNext(&seedRng));
+    if (session == NULL)
+    {
+        fprintf(stderr, "empire-throughput: out of memory\n");
+        exit(1);
+    }
+
+    /*
+     *   Answer no human players, and go on from each summary until the last
+     * year.  Delays are skipped.
+     */
+    result = SessionRun(session, NULL);
+    while (result != SESSION_DONE)
+    {
+        input = NULL;
+        if (result == SESSION_INPUT)
+        {
+            if (session->state == SESSION_HUMAN_COUNT)
+                input = "0";
+            else if (session->game->year >= aThroughput->yearCount)
+                break;
+            else
+                input = "";
+        }
+        result = SessionRun(session, input);
+    }
+
+    return session;
+}
+
+
+/*
+ *   Return the anonymous memory used by each of the number of games specified
+ * by gameCount of the throughput run specified by aThroughput, played to the
+ * end and held at once.
+ *
+ *   aThroughput            Throughput run.
+ *   gameCount              Number of games to hold.
+ */
+
+static long ThroughputMemory(Throughput *aThroughput, int gameCount)
+{
+    Session **sessionList;
+    long      startMemory;
+    long      memory;
+    int       i;
+
+    sessionList = calloc(gameCount, sizeof(Session *));
+    if (sessionList == NULL)
+    {
+        fprintf(stderr, "empire-throughput: out of memory\n");
+        exit(1);
+    }
+    startMemory = ThroughputAnonymousMemory();
+    for (i = 0; i < gameCount; i++)
+        sessionList[i] = ThroughputPlay(aThroughput, i);
+    memory = ThroughputAnonymousMemory() - startMemory;
+    for (i = 0; i < gameCount; i++)
+        SessionDestroy(sessionList[i]);
+    free(sessionList);
+
+    return memory / gameCount;
+}
+
+
+/*
+ * Return the anonymous memory of the process in bytes, or 0 if unknown.
+ */
+
+static long ThroughputAnonymousMemory(void)
+{
+    FILE *file;
+    char  line[128];
+    long  memory = 0;
+
+    file = fopen("/proc/self/status", "r");
+    if (file == NULL)
+        return 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        if (strncmp(line, "RssAnon:", 8) == 0)
+            memory = strtol(line + 8, NULL, 10) * 1024;
+    }
+    fclose(file);
+
+    return memory;
+}
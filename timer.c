@@ -0,0 +1,257 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire timers.
+ *
+ *   A timer expiring at tick t is kept in slot t % TIMER_WHEEL_SIZE of the
+ * wheel.  Timers more than one turn of the wheel away share a slot with nearer
+ * timers and are skipped until their own tick comes around.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <limits.h>
+#include <stddef.h>
+#include <time.h>
+
+/* Local includes. */
+#include "empire.h"
+#include "timer.h"
+
+
+/*------------------------------------------------------------------------------
+ *
+ * External functions.
+ */
+
+/*
+ * Return the current monotonic time in milliseconds.
+ */
+
+uint64_t TimerNow(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+
+/*
+ * Initialize the timer wheel specified by aWheel with no timers, starting at
+ * the time specified by now.
+ *
+ *   aWheel                 Timer wheel.
+ *   now                    Current time in milliseconds.
+ */
+
+void TimerWheelInit(TimerWheel *aWheel, uint64_t now)
+{
+    int i;
+
+    for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+        aWheel->slotList[i] = NULL;
+    aWheel->tick = now / TIMER_TICK_MS;
+    aWheel->timerCount = 0;
+}
+
+
+/*
+ *   Start the timer specified by aTimer in the timer wheel specified by aWheel
+ * to call the function specified by callback with the context specified by
+ * aContext after the number of milliseconds specified by delay.  If the timer
+ * is already running, it is restarted.
+ *
+ *   aWheel                 Timer wheel.
+ *   aTimer                 Timer to start.
+ *   now                    Current time in milliseconds.
+ *   delay                  Delay in milliseconds.
+ *   callback               Function to call when the timer expires.
+ *   aContext               Context to pass to the callback.
+ */
+
+void TimerStart(TimerWheel    *aWheel,
+                Timer         *aTimer,
+                uint64_t       now,
+                int            delay,
+                TimerCallback  callback,
+                void          *aContext)
+{
+    Timer    **slot;
+    uint64_t   expiryTick;
+
+    /* Stop the timer if it's running. */
+    if (TimerRunning(aTimer))
+        TimerStop(aWheel, aTimer);
+
+    /* Determine the expiry tick, never earlier than the next tick. */
+    if (delay < 0)
+        delay = 0;
+    expiryTick = (now + delay + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+    if (expiryTick <= aWheel->tick)
+        expiryTick = aWheel->tick + 1;
+
+    /* Add the timer to the head of its slot. */
+    slot = &(aWheel->slotList[expiryTick % TIMER_WHEEL_SIZE]);
+    aTimer->expiryTick = expiryTick;
+    aTimer->callback = callback;
+    aTimer->context = aContext;
+    aTimer->next = *slot;
+    if (aTimer->next != NULL)
+        aTimer->next->link = &(aTimer->next);
+    aTimer->link = slot;
+    *slot = aTimer;
+    aWheel->timerCount++;
+}
+
+
+/*
+ * Stop the timer specified by aTimer in the timer wheel specified by aWheel.
+ * Stopping a timer that isn't running does nothing.
+ *
+ *   aWheel                 Timer wheel.
+ *   aTimer                 Timer to stop.
+ */
+
+void TimerStop(TimerWheel *aWheel, Timer *aTimer)
+{
+    if (!TimerRunning(aTimer))
+        return;
+
+    *(aTimer->link) = aTimer->next;
+    if (aTimer->next != NULL)
+        aTimer->next->link = aTimer->link;
+    aTimer->next = NULL;
+    aTimer->link = NULL;
+    aWheel->timerCount--;
+}
+
+
+/*
+ * Return true if the timer specified by aTimer is running.  Timers must be
+ * zeroed before first use.
+ *
+ *   aTimer                 Timer.
+ */
+
+bool TimerRunning(const Timer *aTimer)
+{
+    return aTimer->link != NULL;
+}
+
+
+/*
+ *   Advance the timer wheel specified by aWheel to the time specified by now,
+ * calling the callbacks of all of the timers that have expired.  Callbacks may
+ * start and stop timers.  Return the number of timers that expired.
+ *
+ *   aWheel                 Timer wheel.
+ *   now                    Current time in milliseconds.
+ */
+
+int TimerWheelRun(TimerWheel *aWheel, uint64_t now)
+{
+    Timer    **link;
+    Timer     *timer;
+    uint64_t   nowTick;
+    int        expiredCount = 0;
+
+    /* A wheel left idle for more than a turn only needs one pass. */
+    nowTick = now / TIMER_TICK_MS;
+    if ((nowTick - aWheel->tick) > TIMER_WHEEL_SIZE)
+        aWheel->tick = nowTick - TIMER_WHEEL_SIZE;
+
+    /* Expire the timers in each slot up to the current tick. */
+    while (aWheel->tick < nowTick)
+    {
+        aWheel->tick++;
+        link = &(aWheel->slotList[aWheel->tick % TIMER_WHEEL_SIZE]);
+        while (*link != NULL)
+        {
+            /* Skip timers that are a turn or more away. */
+            timer = *link;
+            if (timer->expiryTick > aWheel->tick)
+            {
+                link = &(timer->next);
+                continue;
+            }
+
+            /* Expire the timer and rescan the slot, which the callback may */
+            /* have changed.                                                */
+            TimerStop(aWheel, timer);
+            expiredCount++;
+            timer->callback(timer->context);
+            link = &(aWheel->slotList[aWheel->tick % TIMER_WHEEL_SIZE]);
+        }
+    }
+
+    return expiredCount;
+}
+
+
+/*
+ *   Return the number of milliseconds from the time specified by now until the
+ * next timer in the timer wheel specified by aWheel expires, 0 if a timer has
+ * already expired, or -1 if no timers are running.
+ *
+ *   aWheel                 Timer wheel.
+ *   now                    Current time in milliseconds.
+ */
+
+int TimerWheelTimeout(const TimerWheel *aWheel, uint64_t now)
+{
+    const Timer *timer;
+    uint64_t     expiryTick = UINT64_MAX;
+    uint64_t     expiry;
+    uint64_t     tick;
+    bool         found = FALSE;
+    int          i;
+
+    /* Check for no timers. */
+    if (aWheel->timerCount == 0)
+        return -1;
+
+    /* Look for a timer due within a turn of the wheel. */
+    for (tick = aWheel->tick + 1;
+         !found && (tick <= aWheel->tick + TIMER_WHEEL_SIZE);
+         tick++)
+    {
+        for (timer = aWheel->slotList[tick % TIMER_WHEEL_SIZE];
+             timer != NULL;
+             timer = timer->next)
+        {
+            if (timer->expiryTick <= tick)
+            {
+                expiryTick = tick;
+                found = TRUE;
+            }
+        }
+    }
+
+    /* Otherwise, find the earliest timer. */
+    for (i = 0; !found && (i < TIMER_WHEEL_SIZE); i++)
+    {
+        for (timer = aWheel->slotList[i]; timer != NULL; timer = timer->next)
+        {
+            if (timer->expiryTick < expiryTick)
+                expiryTick = timer->expiryTick;
+        }
+    }
+
+    /* Convert the tick to a timeout. */
+    expiry = expiryTick * TIMER_TICK_MS;
+    if (expiry <= now)
+        return 0;
+    if ((expiry - now) > INT_MAX)
+        return INT_MAX;
+
+    return expiry - now;
+}
+
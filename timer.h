@@ -0,0 +1,118 @@
+/*------------------------------------------------------------------------------
+ *------------------------------------------------------------------------------
+ *
+ * TRS-80 Empire timer header file.
+ *
+ *   Timers are kept in a hashed timer wheel.  Starting and stopping a timer
+ * takes constant time, and the owner of a wheel runs it from its event loop,
+ * using TimerWheelTimeout to decide how long it may wait for input.  Nothing
+ * here ever sleeps, so one thread can run the timers of many sessions.
+ *
+ *------------------------------------------------------------------------------
+ *----------------------------------------------------------------------------*/
+
+#ifndef __TIMER_H__
+#define __TIMER_H__
+
+/*------------------------------------------------------------------------------
+ *
+ * Includes.
+ */
+
+/* System includes. */
+#include <stdbool.h>
+#include <stdint.h>
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Defs.
+ */
+
+/*
+ * Timer wheel defs.
+ *
+ *   TIMER_WHEEL_SIZE       Number of slots in a timer wheel.
+ *   TIMER_TICK_MS          Time in milliseconds of each timer wheel slot.
+ */
+
+#define TIMER_WHEEL_SIZE    256
+#define TIMER_TICK_MS       10
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Structure defs.
+ */
+
+/*
+ * Timer callback function type.
+ */
+
+typedef void (*TimerCallback)(void *aContext);
+
+
+/*
+ * This structure contains fields for a timer.
+ *
+ *   next                   Next timer in the wheel slot.
+ *   link                   Link pointing to this timer, or NULL if the timer
+ *                          is not running.
+ *   expiryTick             Wheel tick at which the timer expires.
+ *   callback               Function to call when the timer expires.
+ *   context                Context to pass to the callback.
+ */
+
+typedef struct Timer
+{
+    struct Timer           *next;
+    struct Timer          **link;
+    uint64_t                expiryTick;
+    TimerCallback           callback;
+    void                   *context;
+} Timer;
+
+
+/*
+ * This structure contains fields for a timer wheel.
+ *
+ *   slotList               List of timers in each slot.
+ *   tick                   Current wheel tick.
+ *   timerCount             Number of running timers.
+ */
+
+typedef struct
+{
+    Timer                  *slotList[TIMER_WHEEL_SIZE];
+    uint64_t                tick;
+    int                     timerCount;
+} TimerWheel;
+
+
+/*------------------------------------------------------------------------------
+ *
+ * Prototypes.
+ */
+
+uint64_t TimerNow(void);
+
+void TimerWheelInit(TimerWheel *aWheel, uint64_t now);
+
+void TimerStart(TimerWheel    *aWheel,
+                Timer         *aTimer,
+                uint64_t       now,
+                int            delay,
+                TimerCallback  callback,
+                void          *aContext);
+
+void TimerStop(TimerWheel *aWheel, Timer *aTimer);
+
+bool TimerRunning(const Timer *aTimer);
+
+int TimerWheelRun(TimerWheel *aWheel, uint64_t now);
+
+int TimerWheelTimeout(const TimerWheel *aWheel, uint64_t now);
+
+
+#endif /* __TIMER_H__ */
+